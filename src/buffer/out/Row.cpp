@@ -5,6 +5,7 @@
 #include "Row.hpp"
 
 #include <isa_availability.h>
+#include <til/arena.h>
 #include <til/unicode.h>
 
 #include "textBuffer.hpp"
@@ -434,6 +435,12 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
     auto colorStarts = gsl::narrow_cast<uint16_t>(columnBegin);
     auto currentIndex = colorStarts;
 
+    // The color runs are collected and committed into the attr row in one go at the end.
+    // Calling _attr.replace() for each of them gets expensive for rows with many color changes.
+    const auto scratch = til::get_scratch_arena();
+    til::arena_resource scratchResource{ scratch };
+    std::pmr::vector<til::rle_pair<TextAttribute, uint16_t>> colorRuns{ &scratchResource };
+
     while (it && currentIndex <= finalColumnInRow)
     {
         // Fill the color if the behavior isn't set to keeping the current color.
@@ -448,8 +455,7 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
             else
             {
                 // Otherwise, commit this color into the run and save off the new one.
-                // Now commit the new color runs into the attr row.
-                _attr.replace(colorStarts, currentIndex, currentColor);
+                colorRuns.emplace_back(currentColor, gsl::narrow_cast<uint16_t>(currentIndex - colorStarts));
                 currentColor = it->TextAttr();
                 colorUses = 1;
                 colorStarts = currentIndex;
@@ -526,10 +532,15 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
         ++currentIndex;
     }
 
-    // Now commit the final color into the attr row
+    // Now commit the final color and all previous ones into the attr row
     if (colorUses)
     {
-        _attr.replace(colorStarts, currentIndex, currentColor);
+        colorRuns.emplace_back(currentColor, gsl::narrow_cast<uint16_t>(currentIndex - colorStarts));
+        colorStarts = currentIndex;
+    }
+    if (!colorRuns.empty())
+    {
+        _attr.replace(gsl::narrow_cast<uint16_t>(columnBegin), colorStarts, colorRuns);
     }
 
     return it;
@@ -650,6 +661,13 @@ catch (...)
     {
         if (*it >= 0x80) [[unlikely]]
         {
+            // The preceding ASCII character may form a grapheme cluster with this one (e.g. "e" + U+0301).
+            if (it != chars.begin())
+            {
+                --colEnd;
+                --ch;
+                --it;
+            }
             _replaceTextUnicode(ch, it);
             return;
         }
@@ -660,66 +678,196 @@ catch (...)
         ++it;
     }
 
+    // If we ran out of columns right before a non-ASCII character, it may still be part of the last cluster.
+    if (it != chars.end() && *it >= 0x80 && it != chars.begin()) [[unlikely]]
+    {
+        --colEnd;
+        --ch;
+        --it;
+        _replaceTextUnicode(ch, it);
+        return;
+    }
+
     colEndDirty = colEnd;
     charsConsumed = ch - chBeg;
 }
 
 [[msvc::forceinline]] void ROW::WriteHelper::_replaceTextUnicode(size_t ch, std::wstring_view::const_iterator it) noexcept
 {
-    const auto end = chars.end();
+    GraphemeState state{ .end = gsl::narrow_cast<size_t>(it - chars.begin()) };
+    std::array<uint8_t, 64> widths{};
 
-    while (it != end)
+    // Every grapheme cluster gets stored in a single cell (or 2 for wide ones), even if it consists of many codepoints.
+    for (;;)
     {
-        unsigned int width = 1;
-        auto ptr = &*it;
-        const auto wch = *ptr;
-        size_t advance = 1;
-
-        ++it;
+        // Most clusters consist of a single codepoint, even in CJK or Cyrillic text. See TextBuffer::FitTextIntoColumns.
+        auto pos = state.end;
+        const auto maxCount = std::min<size_t>(widths.size(), colLimit - colEnd + 1);
+        const auto count = GraphemeClusterNextRun(state, chars, { widths.data(), maxCount });
+        if (count == 0)
+        {
+            break;
+        }
 
-        // Even in our slow-path we can avoid calling IsGlyphFullWidth if the current character is ASCII.
-        // It also allows us to skip the surrogate pair decoding at the same time.
-        if (wch >= 0x80)
+        for (size_t i = 0; i < count; ++i)
         {
-            if (til::is_surrogate(wch))
+            const auto colEndNew = gsl::narrow_cast<uint16_t>(colEnd + til::at(widths, i));
+            if (colEndNew > colLimit)
             {
-                if (it != end && til::is_leading_surrogate(wch) && til::is_trailing_surrogate(*it))
-                {
-                    advance = 2;
-                    ++it;
-                }
-                else
-                {
-                    ptr = &UNICODE_REPLACEMENT;
-                }
+                colEndDirty = colLimit;
+                charsConsumed = ch - chBeg;
+                return;
             }
 
-            width = IsGlyphFullWidth({ ptr, advance }) + 1u;
-        }
+            // Fill our char-offset buffer with 1 entry containing the mapping from the
+            // current column (colEnd) to the start of the glyph in the string (ch)...
+            til::at(row._charOffsets, colEnd++) = gsl::narrow_cast<uint16_t>(ch);
+            // ...followed by 0-N entries containing an indication that the
+            // columns are just a wide-glyph extension of the preceding one.
+            while (colEnd < colEndNew)
+            {
+                til::at(row._charOffsets, colEnd++) = gsl::narrow_cast<uint16_t>(ch | CharOffsetsTrailer);
+            }
 
-        const auto colEndNew = gsl::narrow_cast<uint16_t>(colEnd + width);
-        if (colEndNew > colLimit)
-        {
-            colEndDirty = colLimit;
-            charsConsumed = ch - chBeg;
-            return;
+            // All clusters in a run except for the last one are a single codepoint long. The last one ends where the run does.
+            const auto next = i + 1 < count ? til::utf16_iterate_next(chars, pos) : state.end;
+            ch += next - pos;
+            pos = next;
         }
+    }
+
+    colEndDirty = colEnd;
+    charsConsumed = ch - chBeg;
+}
+
+// Splits `count` CHAR_INFOs into their characters and attributes. Returns false if any of them
+// is flagged as the leading or trailing half of a wide glyph, which WriteCharInfos() can't handle.
+static bool splitCharInfos(const CHAR_INFO* charInfos, size_t count, wchar_t* chars, WORD* attrs) noexcept
+{
+    static constexpr WORD dbcsFlags = COMMON_LVB_LEADING_BYTE | COMMON_LVB_TRAILING_BYTE;
+    WORD flags = 0;
+    size_t i = 0;
+
+#pragma warning(push)
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+#if defined(TIL_SSE_INTRINSICS)
+    // A CHAR_INFO is a pair of 16-bit integers: The character in the lower and the attributes in the upper half.
+    // The arithmetic shifts sign-extend both halves, which prevents _mm_packs_epi32 from saturating them.
+    auto flagsVec = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8)
+    {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(charInfos + i));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(charInfos + i + 4));
+        const auto c = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+        const auto d = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(chars + i), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(attrs + i), d);
+        flagsVec = _mm_or_si128(flagsVec, d);
+    }
+    flagsVec = _mm_and_si128(flagsVec, _mm_set1_epi16(static_cast<short>(dbcsFlags)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(flagsVec, _mm_setzero_si128())) != 0xffff)
+    {
+        return false;
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    // vld2q_u16 splits the characters and attributes apart for us.
+    auto flagsVec = vdupq_n_u16(0);
+    for (; i + 8 <= count; i += 8)
+    {
+        const auto v = vld2q_u16(reinterpret_cast<const uint16_t*>(charInfos + i));
+        vst1q_u16(reinterpret_cast<uint16_t*>(chars + i), v.val[0]);
+        vst1q_u16(attrs + i, v.val[1]);
+        flagsVec = vorrq_u16(flagsVec, v.val[1]);
+    }
+    const auto flags64 = vreinterpretq_u64_u16(vandq_u16(flagsVec, vdupq_n_u16(dbcsFlags)));
+    if (vgetq_lane_u64(flags64, 0) | vgetq_lane_u64(flags64, 1))
+    {
+        return false;
+    }
+#endif
+#pragma warning(pop)
+
+    for (; i < count; ++i)
+    {
+        chars[i] = charInfos[i].Char.UnicodeChar;
+        attrs[i] = charInfos[i].Attributes;
+        flags |= attrs[i];
+    }
+
+    return (flags & dbcsFlags) == 0;
+}
+
+// Writes a row of CHAR_INFOs the same way WriteCells() would, but as a single ReplaceCells() and _attr.replace() call.
+// It returns false without modifying the row if any CHAR_INFO is flagged as the leading or trailing half of a wide glyph.
+// The caller needs to fall back to WriteCells() in that case, which has all the logic for dealing with them.
+bool ROW::WriteCharInfos(const til::CoordType columnBegin, const std::span<const CHAR_INFO> charInfos)
+try
+{
+    THROW_HR_IF(E_INVALIDARG, columnBegin < 0 || columnBegin >= size());
 
-        // Fill our char-offset buffer with 1 entry containing the mapping from the
-        // current column (colEnd) to the start of the glyph in the string (ch)...
-        til::at(row._charOffsets, colEnd++) = gsl::narrow_cast<uint16_t>(ch);
-        // ...followed by 0-N entries containing an indication that the
-        // columns are just a wide-glyph extension of the preceding one.
-        while (colEnd < colEndNew)
+    const auto colBeg = gsl::narrow_cast<uint16_t>(columnBegin);
+    const auto count = std::min<size_t>(charInfos.size(), _columnCount - colBeg);
+    if (!count)
+    {
+        return true;
+    }
+
+    const auto scratch = til::get_scratch_arena();
+    const auto chars = scratch->push_uninitialized<wchar_t>(count);
+    const auto attrs = scratch->push_uninitialized<WORD>(count);
+
+    if (!splitCharInfos(charInfos.data(), count, chars.data(), attrs.data()))
+    {
+        return false;
+    }
+
+    til::arena_resource scratchResource{ scratch };
+    std::pmr::vector<til::rle_pair<TextAttribute, uint16_t>> colorRuns{ &scratchResource };
+
+    // Different legacy attributes may still map to the same TextAttribute
+    // (e.g. due to unused bits), which is why adjacent runs get merged.
+    size_t runBeg = 0;
+    for (size_t i = 1; i <= count; ++i)
+    {
+        if (i == count || attrs[i] != attrs[runBeg])
         {
-            til::at(row._charOffsets, colEnd++) = gsl::narrow_cast<uint16_t>(ch | CharOffsetsTrailer);
+            const TextAttribute attr{ attrs[runBeg] };
+            const auto length = gsl::narrow_cast<uint16_t>(i - runBeg);
+            if (!colorRuns.empty() && colorRuns.back().value == attr)
+            {
+                colorRuns.back().length += length;
+            }
+            else
+            {
+                colorRuns.emplace_back(attr, length);
+            }
+            runBeg = i;
         }
-
-        ch += advance;
     }
 
+    const std::wstring_view text{ chars.data(), count };
+    WriteHelper h{ *this, colBeg, _columnCount, text };
+    h.ReplaceCells();
+    h.Finish();
+
+    _attr.replace(colBeg, h.colEnd, colorRuns);
+    return true;
+}
+catch (...)
+{
+    Reset(TextAttribute{});
+    throw;
+}
+
+// Stores each character in a column of its own, like a ReplaceCharacters() call with a width of 1 would do.
+// Unlike ReplaceText() this doesn't measure or cluster the text. That's how the console API treats CHAR_INFOs.
+[[msvc::forceinline]] void ROW::WriteHelper::ReplaceCells() noexcept
+{
+    const auto count = gsl::narrow_cast<uint16_t>(std::min<size_t>(chars.size(), colLimit - colBeg));
+    iota_n(row._charOffsets.begin() + colBeg, count, chBeg);
+    colEnd = gsl::narrow_cast<uint16_t>(colBeg + count);
     colEndDirty = colEnd;
-    charsConsumed = ch - chBeg;
+    charsConsumed = count;
 }
 
 void ROW::CopyTextFrom(RowCopyTextFromState& state)
@@ -1050,6 +1198,84 @@ DbcsAttribute ROW::DbcsAttrAt(til::CoordType column) const noexcept
     return { attr };
 }
 
+// Reads the cells starting at columnBegin into the given CHAR_INFOs, the same way CONSOLE_INFORMATION::AsCharInfo()
+// does for individual cells: Glyphs that don't fit into a single wchar_t turn into U+FFFD and wide glyphs get the
+// COMMON_LVB_LEADING_BYTE/COMMON_LVB_TRAILING_BYTE flags. Surplus CHAR_INFOs past the end of the row are left untouched.
+void ROW::ReadCharInfos(const til::CoordType columnBegin, const std::span<CHAR_INFO> charInfos) const
+{
+    const auto colBeg = _clampedColumnInclusive(columnBegin);
+    const auto colEnd = gsl::narrow_cast<uint16_t>(colBeg + std::min<size_t>(charInfos.size(), _columnCount - colBeg));
+    auto out = charInfos.data();
+    auto col = colBeg;
+    size_t runEnd = 0;
+
+    for (const auto& run : _attr.runs())
+    {
+        runEnd += run.length;
+        if (runEnd <= col)
+        {
+            continue;
+        }
+
+        // The legacy attributes are computed once per run and not once per cell.
+        const auto attributes = run.value.GetLegacyAttributes();
+        const auto end = gsl::narrow_cast<uint16_t>(std::min<size_t>(runEnd, colEnd));
+
+        while (col < end)
+        {
+            // The common case are 8 consecutive cells with 1 wchar_t each. Their _charOffsets are a plain
+            // sequence from `beg` to `beg+8`. In that case we can interleave the chars and attributes directly.
+            if (col + 8 <= end)
+            {
+                const auto beg = _charOffsets[col];
+#pragma warning(push)
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+#if defined(TIL_SSE_INTRINSICS)
+                const auto offsets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&_charOffsets[col]));
+                const auto expected = _mm_add_epi16(_mm_set1_epi16(static_cast<short>(beg)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+                if (!(beg & CharOffsetsTrailer) && _charOffsets[col + 8u] == beg + 8 && _mm_movemask_epi8(_mm_cmpeq_epi16(offsets, expected)) == 0xffff)
+                {
+                    const auto attributesVec = _mm_set1_epi16(static_cast<short>(attributes));
+                    const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&_chars[beg]));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(chars, attributesVec));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(chars, attributesVec));
+                    col += 8;
+                    out += 8;
+                    continue;
+                }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+                alignas(uint16x8_t) static constexpr uint16_t iotaData[]{ 0, 1, 2, 3, 4, 5, 6, 7 };
+                const auto offsets = vld1q_u16(&_charOffsets[col]);
+                const auto equal = vreinterpretq_u64_u16(vceqq_u16(offsets, vaddq_u16(vdupq_n_u16(beg), vld1q_u16(&iotaData[0]))));
+                if (!(beg & CharOffsetsTrailer) && _charOffsets[col + 8u] == beg + 8 && (vgetq_lane_u64(equal, 0) & vgetq_lane_u64(equal, 1)) == UINT64_MAX)
+                {
+                    // vst2q_u16 interleaves the chars and attributes for us.
+                    uint16x8x2_t v;
+                    v.val[0] = vld1q_u16(reinterpret_cast<const uint16_t*>(&_chars[beg]));
+                    v.val[1] = vdupq_n_u16(attributes);
+                    vst2q_u16(reinterpret_cast<uint16_t*>(out), v);
+                    col += 8;
+                    out += 8;
+                    continue;
+                }
+#endif
+#pragma warning(pop)
+            }
+
+            const auto glyph = GlyphAt(col);
+            out->Char.UnicodeChar = glyph.size() == 1 ? glyph.front() : UNICODE_REPLACEMENT;
+            out->Attributes = attributes | GeneratePublicApiAttributeFormat(DbcsAttrAt(col));
+            ++col;
+            ++out;
+        }
+
+        if (col >= colEnd)
+        {
+            break;
+        }
+    }
+}
+
 std::wstring_view ROW::GetText() const noexcept
 {
     const auto width = size_t{ til::at(_charOffsets, GetReadableColumnCount()) } & CharOffsetsMask;
@@ -5,7 +5,9 @@
 
 #include "textBuffer.hpp"
 
+#include <til/arena.h>
 #include <til/hash.h>
+#include <til/small_vector.h>
 #include <til/unicode.h>
 
 #include "UTextAdapter.h"
@@ -146,6 +148,7 @@ void TextBuffer::_decommit() noexcept
     _destroy();
     VirtualFree(_buffer.get(), 0, MEM_DECOMMIT);
     _commitWatermark = _buffer.get();
+    _rowMap.clear();
 }
 
 // Constructs ROWs between [_commitWatermark,until).
@@ -197,10 +200,78 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
         offset += _height;
     }
 
+    auto slot = gsl::narrow_cast<size_t>(offset);
+    if (!_rowMap.empty())
+    {
+        slot = til::at(_rowMap, slot);
+    }
+
     // We add 1 to the row offset, because row "0" is the one returned by GetScratchpadRow().
     // See GetScratchpadRow() for more explanation.
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
-    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(gsl::narrow_cast<size_t>(offset) + 1);
+    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(slot + 1);
+}
+
+// Implements ScrollRows() for overlapping source and destination ranges by rotating the affected entries
+// of _rowMap, so that the ROWs themselves stay where they are. Returns false if the ranges don't overlap,
+// in which case there's nothing to rotate and the caller has to copy the rows instead.
+bool TextBuffer::_rotateRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta)
+{
+    const auto distance = std::abs(delta);
+    const auto count = size + distance;
+    if (distance >= size || count > _height)
+    {
+        return false;
+    }
+
+    if (_rowMap.empty())
+    {
+        _rowMap.resize(_height);
+        std::iota(_rowMap.begin(), _rowMap.end(), uint16_t{ 0 });
+    }
+
+    // The range may wrap around the end of the circular buffer,
+    // which is why its entries are gathered into a contiguous list first.
+    const auto beg = std::min(firstRow, firstRow + delta);
+    auto offset = (_firstRow + beg) % _height;
+    if (offset < 0)
+    {
+        offset += _height;
+    }
+
+    til::small_vector<uint16_t, 64> slots;
+    size_t highest = 0;
+    for (til::CoordType i = 0; i < count; ++i)
+    {
+        const auto o = gsl::narrow_cast<size_t>((offset + i) % _height);
+        const auto slot = til::at(_rowMap, o);
+        highest = std::max({ highest, o, size_t{ slot } });
+        slots.push_back(slot);
+    }
+
+    // _estimateOffsetOfLastCommittedRow() assumes that rows past the _commitWatermark are blank.
+    // Committing all involved offsets and slots ensures that this still holds after the rotation.
+    _getRowByOffsetDirect(highest + 1);
+
+    // Moving the rows up (a negative delta) is a left rotation of the range and vice versa.
+    const auto mid = delta < 0 ? distance : count - distance;
+    std::rotate(slots.begin(), slots.begin() + mid, slots.end());
+
+    for (til::CoordType i = 0; i < count; ++i)
+    {
+        til::at(_rowMap, gsl::narrow_cast<size_t>((offset + i) % _height)) = til::at(slots, gsl::narrow_cast<size_t>(i));
+    }
+
+    // The rotation moved the rows that got overwritten into the rows that the source range uncovered.
+    // ScrollRows() used to leave the source rows untouched there, which this restores.
+    // It's the only copying that's left and it's proportional to the delta instead of the size.
+    const auto uncovered = delta < 0 ? firstRow + size + delta : firstRow;
+    for (til::CoordType i = 0; i < distance; ++i)
+    {
+        GetMutableRowByOffset(uncovered + i).CopyFrom(GetRowByOffset(uncovered + i + delta));
+    }
+
+    return true;
 }
 
 // Returns the "user-visible" index of the last committed row, which can be used
@@ -376,17 +447,19 @@ TextBufferCellIterator TextBuffer::GetCellDataAt(const til::point at, const View
 // Given the character offset `position` in the `chars` string, this function returns the starting position of the next grapheme.
 // For instance, given a `chars` of L"x\uD83D\uDE42y" and a `position` of 1 it'll return 3.
 // GraphemePrev would do the exact inverse of this operation.
-// In the future, these functions are expected to also deliver information about how many columns a grapheme occupies.
-// (I know that mere UTF-16 code point iteration doesn't handle graphemes, but that's what we're working towards.)
+// Graphemes are extended grapheme clusters as defined by UAX #29, so for instance an emoji ZWJ sequence,
+// a flag or a letter followed by combining marks are a single grapheme. See CodepointWidthDetector::GraphemeNext.
 size_t TextBuffer::GraphemeNext(const std::wstring_view& chars, size_t position) noexcept
 {
-    return til::utf16_iterate_next(chars, position);
+    GraphemeState state{ .end = position };
+    GraphemeClusterNext(state, chars);
+    return state.end;
 }
 
 // It's the counterpart to GraphemeNext. See GraphemeNext.
 size_t TextBuffer::GraphemePrev(const std::wstring_view& chars, size_t position) noexcept
 {
-    return til::utf16_iterate_prev(chars, position);
+    return GraphemeClusterPrev(chars, position);
 }
 
 // Ever wondered how much space a piece of text needs before inserting it? This function will tell you!
@@ -404,7 +477,6 @@ size_t TextBuffer::FitTextIntoColumns(const std::wstring_view& chars, til::Coord
     columnLimit = std::max(0, columnLimit);
 
     const auto beg = chars.begin();
-    const auto end = chars.end();
     auto it = beg;
     const auto asciiEnd = beg + std::min(chars.size(), gsl::narrow_cast<size_t>(columnLimit));
 
@@ -416,59 +488,63 @@ size_t TextBuffer::FitTextIntoColumns(const std::wstring_view& chars, til::Coord
     const auto dist = gsl::narrow_cast<size_t>(it - beg);
     auto col = gsl::narrow_cast<til::CoordType>(dist);
 
-    if (it == asciiEnd) [[likely]]
+    // If we stopped right before a non-ASCII character, it may still be part of the last cluster.
+    if (it == asciiEnd && (it == chars.end() || *it < 0x80)) [[likely]]
     {
         columns = col;
         return dist;
     }
 
     // Unicode slow-path where we need to count text and columns separately.
-    for (;;)
+    // The preceding ASCII character may form a grapheme cluster with this one (e.g. "e" + U+0301).
+    if (it != beg)
     {
-        auto ptr = &*it;
-        const auto wch = *ptr;
-        size_t len = 1;
+        --it;
+        --col;
+    }
+
+    GraphemeState state{ .end = gsl::narrow_cast<size_t>(it - beg) };
+    std::array<uint8_t, 64> widths{};
 
-        col++;
+    for (;;)
+    {
+        // Most clusters consist of a single codepoint, even in CJK or Cyrillic text. GraphemeClusterNextRun
+        // measures entire runs of them at once, which is a lot faster than calling GraphemeClusterNext for each.
+        // Every cluster is at least 1 column wide, so there's no point in measuring more than fit.
+        const auto runBeg = state.end;
+        const auto maxCount = std::min(widths.size(), gsl::narrow_cast<size_t>(columnLimit - col) + 1);
+        const auto count = GraphemeClusterNextRun(state, chars, { widths.data(), maxCount });
+        if (count == 0)
+        {
+            break;
+        }
 
-        // Even in our slow-path we can avoid calling IsGlyphFullWidth if the current character is ASCII.
-        // It also allows us to skip the surrogate pair decoding at the same time.
-        if (wch >= 0x80)
+        for (size_t i = 0; i < count; ++i)
         {
-            if (til::is_surrogate(wch))
+            col += til::at(widths, i);
+
+            // If we ran out of columns, we need to always return `columnLimit` and not `cols`,
+            // because if we tried inserting a wide glyph into just 1 remaining column it will
+            // fail to fit, but that remaining column still has been used up. When the caller sees
+            // `columns == columnLimit` they will line-wrap and continue inserting into the next row.
+            if (col > columnLimit)
             {
-                const auto it2 = it + 1;
-                if (til::is_leading_surrogate(wch) && it2 != end && til::is_trailing_surrogate(*it2))
-                {
-                    len = 2;
-                }
-                else
+                // All clusters in a run except for the last one are a single codepoint long.
+                auto pos = runBeg;
+                for (size_t j = 0; j < i; ++j)
                 {
-                    ptr = &UNICODE_REPLACEMENT;
+                    pos = til::utf16_iterate_next(chars, pos);
                 }
-            }
-
-            col += IsGlyphFullWidth({ ptr, len });
-        }
-
-        // If we ran out of columns, we need to always return `columnLimit` and not `cols`,
-        // because if we tried inserting a wide glyph into just 1 remaining column it will
-        // fail to fit, but that remaining column still has been used up. When the caller sees
-        // `columns == columnLimit` they will line-wrap and continue inserting into the next row.
-        if (col > columnLimit)
-        {
-            columns = columnLimit;
-            return gsl::narrow_cast<size_t>(it - beg);
-        }
 
-        // But if we simply ran out of text we just need to return the actual number of columns.
-        it += len;
-        if (it == end)
-        {
-            columns = col;
-            return chars.size();
+                columns = columnLimit;
+                return pos;
+            }
         }
     }
+
+    // But if we simply ran out of text we just need to return the actual number of columns.
+    columns = col;
+    return chars.size();
 }
 
 // Pretend as if `position` is a regular cursor in the TextBuffer.
@@ -810,6 +886,12 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     // A negative size doesn't make any sense anyways.
     size = std::max(0, size);
 
+    // If the source and destination overlap, the rows can be rotated into place instead of being copied.
+    if (_rotateRows(firstRow, size, delta))
+    {
+        return;
+    }
+
     til::CoordType y = 0;
     til::CoordType end = 0;
     til::CoordType step = 0;
@@ -1049,6 +1131,7 @@ void TextBuffer::ResizeTraditional(til::size newSize)
     _bufferOffsetCharOffsets = newBuffer._bufferOffsetCharOffsets;
     _width = newBuffer._width;
     _height = newBuffer._height;
+    _rowMap = std::move(newBuffer._rowMap);
 
     _SetFirstRowIndex(0);
 }
@@ -1944,7 +2027,12 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
 
     try
     {
-        std::string htmlBuilder;
+        // The intermediate strings are only needed until the result gets assembled at the end.
+        const auto scratch = til::get_scratch_arena();
+        til::arena_resource scratchResource{ scratch };
+
+        std::pmr::string htmlBuilder{ &scratchResource };
+        std::pmr::string unescapedText{ &scratchResource };
 
         // First we have to add some standard HTML boiler plate required for
         // CF_HTML as part of the HTML Clipboard format
@@ -2050,7 +2138,6 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
                 htmlBuilder += "\">";
 
                 // text
-                std::string unescapedText;
                 THROW_IF_FAILED(til::u16u8(row.GetText(x, nextX), unescapedText));
                 for (const auto c : unescapedText)
                 {
@@ -2115,7 +2202,9 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
         fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartSelection:{:0>10}\r\n"), fragStartPos);
         fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndSelection:{:0>10}\r\n"), fragEndPos);
 
-        return clipHeaderBuilder + htmlBuilder;
+        clipHeaderBuilder.reserve(clipHeaderBuilder.size() + htmlBuilder.size());
+        clipHeaderBuilder.append(htmlBuilder);
+        return clipHeaderBuilder;
     }
     catch (...)
     {
@@ -2151,6 +2240,10 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
 
     try
     {
+        // The color table and content are only needed until the result gets assembled at the end.
+        const auto scratch = til::get_scratch_arena();
+        til::arena_resource scratchResource{ scratch };
+
         std::string rtfBuilder;
 
         // start rtf
@@ -2179,10 +2272,10 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
         // map to keep track of colors:
         // keys are colors represented by COLORREF
         // values are indices of the corresponding colors in the color table
-        std::unordered_map<COLORREF, size_t> colorMap;
+        std::pmr::unordered_map<COLORREF, size_t> colorMap{ &scratchResource };
 
         // RTF color table
-        std::string colorTableBuilder;
+        std::pmr::string colorTableBuilder{ &scratchResource };
         colorTableBuilder += "{\\colortbl ;";
 
         const auto getColorTableIndex = [&](const COLORREF color) -> size_t {
@@ -2200,7 +2293,7 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
         };
 
         // content
-        std::string contentBuilder;
+        std::pmr::string contentBuilder{ &scratchResource };
 
         // \viewkindN: View mode of the document to be used. N=4 specifies that the document is in Normal view. (maybe unnecessary?)
         // \ucN: Number of unicode fallback characters after each codepoint. (global)
@@ -2305,11 +2398,15 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
             }
         }
 
+        rtfBuilder.reserve(rtfBuilder.size() + colorTableBuilder.size() + contentBuilder.size() + 2);
+
         // add color table to the final RTF
-        rtfBuilder += colorTableBuilder + "}";
+        rtfBuilder.append(colorTableBuilder);
+        rtfBuilder += "}";
 
         // add the text content to the final RTF
-        rtfBuilder += contentBuilder + "}";
+        rtfBuilder.append(contentBuilder);
+        rtfBuilder += "}";
 
         return rtfBuilder;
     }
@@ -2320,7 +2417,7 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
     }
 }
 
-void TextBuffer::_AppendRTFText(std::string& contentBuilder, const std::wstring_view& text)
+void TextBuffer::_AppendRTFText(std::pmr::string& contentBuilder, const std::wstring_view& text)
 {
     for (const auto codeUnit : text)
     {
@@ -2916,7 +3013,7 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
         std::wstring newId{ id };
         // hash the URL and add it to the custom ID - GH#7698
         newId += L"%" + std::to_wstring(til::hash(uri));
-        const auto result = _hyperlinkCustomIdMap.emplace(newId, _currentHyperlinkId);
+        const auto result = _hyperlinkCustomIdMap.try_emplace(std::move(newId), _currentHyperlinkId);
         if (result.second)
         {
             // the custom id did not already exist
@@ -2940,14 +3037,9 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 {
     _hyperlinkMap.erase(id);
-    for (const auto& customIdPair : _hyperlinkCustomIdMap)
-    {
-        if (customIdPair.second == id)
-        {
-            _hyperlinkCustomIdMap.erase(customIdPair.first);
-            break;
-        }
-    }
+    _hyperlinkCustomIdMap.erase_if([=](const auto& customIdPair) noexcept {
+        return customIdPair.second == id;
+    });
 }
 
 // Method Description:
@@ -2959,7 +3051,7 @@ void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 // - The custom ID if there was one, empty string otherwise
 std::wstring TextBuffer::GetCustomIdFromId(uint16_t id) const
 {
-    for (auto customIdPair : _hyperlinkCustomIdMap)
+    for (const auto& customIdPair : _hyperlinkCustomIdMap)
     {
         if (customIdPair.second == id)
         {
@@ -49,6 +49,8 @@ filling in the last row, and updating the screen.
 
 #pragma once
 
+#include <til/flat_map.h>
+
 #include "cursor.h"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
@@ -314,6 +316,7 @@ private:
     void _destroy() const noexcept;
     ROW& _getRowByOffsetDirect(size_t offset);
     ROW& _getRow(til::CoordType y) const;
+    bool _rotateRows(til::CoordType firstRow, til::CoordType size, til::CoordType delta);
     til::CoordType _estimateOffsetOfLastCommittedRow() const noexcept;
 
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
@@ -331,12 +334,12 @@ private:
 
     std::tuple<til::CoordType, til::CoordType, bool> _RowCopyHelper(const CopyRequest& req, const til::CoordType iRow, const ROW& row) const;
 
-    static void _AppendRTFText(std::string& contentBuilder, const std::wstring_view& text);
+    static void _AppendRTFText(std::pmr::string& contentBuilder, const std::wstring_view& text);
 
     Microsoft::Console::Render::Renderer* _renderer = nullptr;
 
-    std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
-    std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
+    til::flat_map<uint16_t, std::wstring> _hyperlinkMap;
+    til::flat_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
     uint16_t _currentHyperlinkId = 1;
 
     // This block describes the state of the underlying virtual memory buffer that holds all ROWs, text and attributes.
@@ -398,6 +401,9 @@ private:
 
     TextAttribute _currentAttributes;
     til::CoordType _firstRow = 0; // indexes top row (not necessarily 0)
+    // Maps the circular storage offsets to the ROW slots that hold them. ScrollRows() rotates this map
+    // instead of copying the ROWs around. It's empty until then, which is equivalent to an identity mapping.
+    std::vector<uint16_t> _rowMap;
     uint64_t _lastMutationId = 0;
 
     Cursor _cursor;
@@ -594,6 +594,15 @@ namespace winrt::TerminalApp::implementation
         args.Handled(res);
     }
 
+    void TerminalPage::_HandleToggleRenderStats(const IInspectable& /*sender*/,
+                                                const ActionEventArgs& args)
+    {
+        const auto res = _ApplyToActiveControls([](auto& control) {
+            control.ToggleRenderStats();
+        });
+        args.Handled(res);
+    }
+
     void TerminalPage::_HandleToggleFocusMode(const IInspectable& /*sender*/,
                                               const ActionEventArgs& args)
     {
@@ -35,6 +35,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
     // Function Description:
     // - creates some basic anonymous pipes and passes them to CreatePseudoConsole
+    //   Our end of the output pipe is overlapped, so that it can be read from the thread pool.
     // Arguments:
     // - size: The size of the conpty to create, in characters.
     // - phInput: Receives the handle to the newly-created anonymous pipe for writing input to the conpty.
@@ -42,19 +43,20 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     // - phPc: Receives a token value to identify this conpty
 #pragma warning(suppress : 26430) // This statement sufficiently checks the out parameters. Analyzer cannot find this.
     static HRESULT _CreatePseudoConsoleAndPipes(const COORD size, const DWORD dwFlags, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
+    try
     {
         RETURN_HR_IF(E_INVALIDARG, phPC == nullptr || phInput == nullptr || phOutput == nullptr);
 
-        wil::unique_hfile outPipeOurSide, outPipePseudoConsoleSide;
         wil::unique_hfile inPipeOurSide, inPipePseudoConsoleSide;
 
         RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&inPipePseudoConsoleSide, &inPipeOurSide, nullptr, 0));
-        RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&outPipeOurSide, &outPipePseudoConsoleSide, nullptr, 0));
+        auto [outPipeOurSide, outPipePseudoConsoleSide] = til::create_overlapped_pipe();
         RETURN_IF_FAILED(ConptyCreatePseudoConsole(size, inPipePseudoConsoleSide.get(), outPipePseudoConsoleSide.get(), dwFlags, phPC));
         *phInput = inPipeOurSide.release();
         *phOutput = outPipeOurSide.release();
         return S_OK;
     }
+    CATCH_RETURN()
 
     // Function Description:
     // - launches the client application attached to the new pseudoconsole
@@ -331,6 +333,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             }
 
             THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(til::unwrap_coord_size(dimensions), flags, &_inPipe, &_outPipe, &_hPC));
+            _outPipeAsync = til::async_file{ std::move(_outPipe) };
 
             if (_initialParentHwnd != 0)
             {
@@ -372,27 +375,37 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         _startTime = std::chrono::high_resolution_clock::now();
 
-        // Create our own output handling thread
+        // Start handling our output.
         // This must be done after the pipes are populated.
         // Each connection needs to make sure to drain the output from its backing host.
-        _hOutputThread.reset(CreateThread(
-            nullptr,
-            0,
-            [](LPVOID lpParameter) noexcept {
-                const auto pInstance = static_cast<ConptyConnection*>(lpParameter);
-                if (pInstance)
-                {
-                    return pInstance->_OutputThread();
-                }
-                return gsl::narrow_cast<DWORD>(E_INVALIDARG);
-            },
-            this,
-            0,
-            nullptr));
+        if (_outPipeAsync)
+        {
+            // We created the output pipe ourselves and so it's overlapped. This allows us to read
+            // it on the thread pool, instead of dedicating a thread to each connection.
+            _outputTask = til::spawn(_OutputLoop());
+        }
+        else
+        {
+            // Handed off pipes are regular synchronous ones and need their own thread.
+            _hOutputThread.reset(CreateThread(
+                nullptr,
+                0,
+                [](LPVOID lpParameter) noexcept {
+                    const auto pInstance = static_cast<ConptyConnection*>(lpParameter);
+                    if (pInstance)
+                    {
+                        return pInstance->_OutputThread();
+                    }
+                    return gsl::narrow_cast<DWORD>(E_INVALIDARG);
+                },
+                this,
+                0,
+                nullptr));
 
-        THROW_LAST_ERROR_IF_NULL(_hOutputThread);
+            THROW_LAST_ERROR_IF_NULL(_hOutputThread);
 
-        LOG_IF_FAILED(SetThreadDescription(_hOutputThread.get(), L"ConptyConnection Output Thread"));
+            LOG_IF_FAILED(SetThreadDescription(_hOutputThread.get(), L"ConptyConnection Output Thread"));
+        }
 
         _transitionToState(ConnectionState::Connected);
     }
@@ -526,10 +539,18 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         // .reset()ing either of these two will signal ConPTY to send out a CTRL_CLOSE_EVENT to all attached clients.
         // FYI: The other members of this class are concurrently read by the _hOutputThread
-        // thread running in the background and so they're not safe to be .reset().
+        // thread (or _outputTask) running in the background and so they're not safe to be .reset().
         _hPC.reset();
         _inPipe.reset();
 
+        if (_outputTask)
+        {
+            // Unlike CancelSynchronousIo() the cancellation is sticky and can't be missed.
+            // Waiting for the task has the same purpose as waiting for the thread below (GH#13880).
+            _outPipeAsync.cancel();
+            _outputTask.wait();
+        }
+
         if (_hOutputThread)
         {
             // Loop around `CancelSynchronousIo()` just in case the signal to shut down was missed.
@@ -558,7 +579,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         // Now that the background thread is done, we can safely clean up the other system objects, without
         // race conditions, or fear of deadlocking ourselves (e.g. by calling CloseHandle() on _outPipe).
         _outPipe.reset();
+        _outPipeAsync.reset();
         _hOutputThread.reset();
+        _outputTask = {};
         _piClient.reset();
 
         _transitionToState(ConnectionState::Closed);
@@ -597,6 +620,66 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return commandline.to_hstring();
     }
 
+    // Processes the result of a single read from the output pipe.
+    // Returns false once no further reads should be made.
+    bool ConptyConnection::_handleOutput(DWORD error, DWORD read)
+    {
+        // When we cancel the read in Close() this is the branch that's taken and gets us out of here.
+        if (_isStateAtOrBeyond(ConnectionState::Closing))
+        {
+            return false;
+        }
+
+        if (error != ERROR_SUCCESS) // reading failed (we must check this first, because read will also be 0.)
+        {
+            // EXIT POINT
+            if (error == ERROR_BROKEN_PIPE)
+            {
+                _LastConPtyClientDisconnected();
+            }
+            else
+            {
+                _indicateExitWithStatus(HRESULT_FROM_WIN32(error)); // print a message
+                _transitionToState(ConnectionState::Failed);
+            }
+            return false;
+        }
+
+        const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
+        if (FAILED(result))
+        {
+            // EXIT POINT
+            _indicateExitWithStatus(result); // print a message
+            _transitionToState(ConnectionState::Failed);
+            return false;
+        }
+
+        if (_u16Str.empty())
+        {
+            return false;
+        }
+
+        if (!_receivedFirstByte)
+        {
+            const auto now = std::chrono::high_resolution_clock::now();
+            const std::chrono::duration<double> delta = now - _startTime;
+
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+            TraceLoggingWrite(g_hTerminalConnectionProvider,
+                              "ReceivedFirstByte",
+                              TraceLoggingDescription("An event emitted when the connection receives the first byte"),
+                              TraceLoggingGuid(_sessionId, "SessionGuid", "The WT_SESSION's GUID"),
+                              TraceLoggingFloat64(delta.count(), "Duration"),
+                              TraceLoggingKeyword(MICROSOFT_KEYWORD_MEASURES),
+                              TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
+            _receivedFirstByte = true;
+        }
+
+        // Pass the output to our registered event handlers
+        TerminalOutput.raise(_u16Str);
+        return true;
+    }
+
     DWORD ConptyConnection::_OutputThread()
     {
         // Keep us alive until the output thread terminates; the destructor
@@ -604,70 +687,36 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         auto strongThis{ get_strong() };
 
         // process the data of the output pipe in a loop
-        while (true)
+        for (;;)
         {
             DWORD read{};
+            const auto ok = ReadFile(_outPipe.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), &read, nullptr);
+            const auto error = ok ? ERROR_SUCCESS : GetLastError();
 
-            const auto readFail{ !ReadFile(_outPipe.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), &read, nullptr) };
-
-            // When we call CancelSynchronousIo() in Close() this is the branch that's taken and gets us out of here.
-            if (_isStateAtOrBeyond(ConnectionState::Closing))
+            if (!_handleOutput(error, read))
             {
                 return 0;
             }
+        }
+    }
 
-            if (readFail) // reading failed (we must check this first, because read will also be 0.)
-            {
-                // EXIT POINT
-                const auto lastError = GetLastError();
-                if (lastError == ERROR_BROKEN_PIPE)
-                {
-                    _LastConPtyClientDisconnected();
-                    return S_OK;
-                }
-                else
-                {
-                    _indicateExitWithStatus(HRESULT_FROM_WIN32(lastError)); // print a message
-                    _transitionToState(ConnectionState::Failed);
-                    return gsl::narrow_cast<DWORD>(HRESULT_FROM_WIN32(lastError));
-                }
-            }
-
-            const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
-            if (FAILED(result))
-            {
-                // EXIT POINT
-                _indicateExitWithStatus(result); // print a message
-                _transitionToState(ConnectionState::Failed);
-                return gsl::narrow_cast<DWORD>(result);
-            }
+    // The thread pool based equivalent of _OutputThread(), used for pipes we created ourselves.
+    til::task<void> ConptyConnection::_OutputLoop()
+    {
+        // Same as in _OutputThread(): Close() waits for us, but the destructor doesn't.
+        auto strongThis{ get_strong() };
 
-            if (_u16Str.empty())
-            {
-                return 0;
-            }
+        for (;;)
+        {
+            // We get resumed on whichever pool thread completed the read, which is also where
+            // _handleOutput() raises TerminalOutput. See the comment on TerminalOutput.
+            const auto [error, read] = co_await _outPipeAsync.read(_buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()));
 
-            if (!_receivedFirstByte)
+            if (!_handleOutput(error, read))
             {
-                const auto now = std::chrono::high_resolution_clock::now();
-                const std::chrono::duration<double> delta = now - _startTime;
-
-#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
-                TraceLoggingWrite(g_hTerminalConnectionProvider,
-                                  "ReceivedFirstByte",
-                                  TraceLoggingDescription("An event emitted when the connection receives the first byte"),
-                                  TraceLoggingGuid(_sessionId, "SessionGuid", "The WT_SESSION's GUID"),
-                                  TraceLoggingFloat64(delta.count(), "Duration"),
-                                  TraceLoggingKeyword(MICROSOFT_KEYWORD_MEASURES),
-                                  TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
-                _receivedFirstByte = true;
+                co_return;
             }
-
-            // Pass the output to our registered event handlers
-            TerminalOutput.raise(_u16Str);
         }
-
-        return 0;
     }
 
     static winrt::event<NewConnectionHandler> _newConnectionHandlers;
@@ -7,6 +7,7 @@
 #include "BaseTerminalConnection.h"
 
 #include "ITerminalHandoff.h"
+#include <til/coroutine.h>
 #include <til/env.h>
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
@@ -57,6 +58,11 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                                                                          const winrt::guid& guid,
                                                                          const winrt::guid& profileGuid);
 
+        // Raised from a background thread. For pipes we created ourselves that's whichever thread pool thread
+        // completed the read (see _OutputLoop()), so it may be a different one each time, but it's never raised
+        // concurrently, because only one read is in flight at any time. Handlers must not rely on thread affinity
+        // and should marshal to their own thread if they need one. They may block (e.g. ControlCore while it
+        // plays MIDI notes), which only holds up the next read, just like the dedicated output thread used to.
         til::event<TerminalOutputHandler> TerminalOutput;
 
     private:
@@ -82,8 +88,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         std::chrono::high_resolution_clock::time_point _startTime{};
 
         wil::unique_hfile _inPipe; // The pipe for writing input to
-        wil::unique_hfile _outPipe; // The pipe for reading output from
+        wil::unique_hfile _outPipe; // The pipe for reading output from, if it was handed off to us
         wil::unique_handle _hOutputThread;
+        til::async_file _outPipeAsync; // The pipe for reading output from, if we created it ourselves
+        til::join_handle _outputTask;
         wil::unique_process_information _piClient;
         wil::unique_any<HPCON, decltype(closePseudoConsoleAsync), closePseudoConsoleAsync> _hPC;
 
@@ -104,7 +112,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         } _startupInfo{};
 
+        bool _handleOutput(DWORD error, DWORD read);
         DWORD _OutputThread();
+        til::task<void> _OutputLoop();
     };
 }
 
@@ -48,6 +48,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return GA::Direct2D;
         case GraphicsAPI::Direct3D11:
             return GA::Direct3D11;
+        case GraphicsAPI::Software:
+            return GA::Software;
         default:
             return GA::Automatic;
         }
@@ -734,6 +736,15 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _renderer->TriggerRedrawAll();
     }
 
+    // Method Description:
+    // - Shows or hides the overlay with the timings of the last rendered frame.
+    void ControlCore::ToggleRenderStats()
+    {
+        const auto lock = _terminal->LockForWriting();
+        _showRenderStats = !_showRenderStats;
+        _renderer->SetStatsOverlay(_showRenderStats ? _renderEngine.get() : nullptr);
+    }
+
     // Method description:
     // - Updates last hovered cell, renders / removes rendering of hyper-link if required
     // Arguments:
@@ -136,6 +136,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void LostFocus();
 
         void ToggleShaderEffects();
+        void ToggleRenderStats();
         void AdjustOpacity(const float adjustment);
         void ResumeRendering();
 
@@ -338,6 +339,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         uint16_t _lastHoveredId{ 0 };
 
         bool _isReadOnly{ false };
+        bool _showRenderStats{ false };
 
         std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> _lastHoveredInterval{ std::nullopt };
 
@@ -773,6 +773,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _core.ToggleShaderEffects();
     }
 
+    void TermControl::ToggleRenderStats()
+    {
+        _core.ToggleRenderStats();
+    }
+
     // Method Description:
     // - Style our UI elements based on the values in our settings, and set up
     //   other control-specific settings. This method will be called whenever
@@ -126,6 +126,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void ClearBuffer(Control::ClearBufferType clearType);
 
         void ToggleShaderEffects();
+        void ToggleRenderStats();
 
         void RenderEngineSwapChainChanged(IInspectable sender, IInspectable args);
         void _AttachDxgiSwapChainToXaml(HANDLE swapChainHandle);
@@ -1239,7 +1239,9 @@ const std::filesystem::path& CascadiaSettings::_releaseSettingsPath()
 // Returns a has (approximately) uniquely identifying the settings.json contents on disk.
 winrt::hstring CascadiaSettings::_calculateHash(std::string_view settings, const FILETIME& lastWriteTime)
 {
-    const auto fileHash = til::hash(settings);
+    // The result is persisted in state.json, which is shared between x86, x64 and ARM64 builds.
+    // Unlike til::hash(), til::stream_hasher produces the same result on all of them.
+    const auto fileHash = til::stream_hasher{}.write(settings).finalize();
     const ULARGE_INTEGER fileTime{ lastWriteTime.dwLowDateTime, lastWriteTime.dwHighDateTime };
     const auto hash = fmt::format(L"{:016x}-{:016x}", fileHash, fileTime.QuadPart);
     return winrt::hstring{ hash };
@@ -26,9 +26,21 @@ namespace
             return _triggerScrollDelta;
         }
 
+        const std::vector<til::rect>& Invalidated() const noexcept
+        {
+            return _invalidated;
+        }
+
+        const std::vector<til::rect>& PaintedLines() const noexcept
+        {
+            return _paintedLines;
+        }
+
         void Reset()
         {
             _triggerScrollDelta.reset();
+            _invalidated.clear();
+            _paintedLines.clear();
         }
 
         HRESULT StartPaint() noexcept { return S_OK; }
@@ -36,7 +48,11 @@ namespace
         HRESULT Present() noexcept { return S_OK; }
         HRESULT PrepareForTeardown(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
         HRESULT ScrollFrame() noexcept { return S_OK; }
-        HRESULT Invalidate(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
+        HRESULT Invalidate(const til::rect* psrRegion) noexcept
+        {
+            _invalidated.push_back(*psrRegion);
+            return S_OK;
+        }
         HRESULT InvalidateCursor(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
         HRESULT InvalidateSystem(const til::rect* /*prcDirtyClient*/) noexcept { return S_OK; }
         HRESULT InvalidateSelection(const std::vector<til::rect>& /*rectangles*/) noexcept { return S_OK; }
@@ -48,7 +64,11 @@ namespace
         HRESULT InvalidateAll() noexcept { return S_OK; }
         HRESULT InvalidateCircling(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
         HRESULT PaintBackground() noexcept { return S_OK; }
-        HRESULT PaintBufferLine(std::span<const Cluster> /*clusters*/, til::point /*coord*/, bool /*fTrimLeft*/, bool /*lineWrapped*/) noexcept { return S_OK; }
+        HRESULT PaintBufferLine(std::span<const Cluster> clusters, til::point coord, bool /*fTrimLeft*/, bool /*lineWrapped*/) noexcept
+        {
+            _paintedLines.emplace_back(coord, til::size{ gsl::narrow_cast<til::CoordType>(clusters.size()), 1 });
+            return S_OK;
+        }
         HRESULT PaintBufferGridLines(GridLineSet /*lines*/, COLORREF /*gridlineColor*/, COLORREF /*underlineColor*/, size_t /*cchLine*/, til::point /*coordTarget*/) noexcept { return S_OK; }
         HRESULT PaintSelection(const til::rect& /*rect*/) noexcept { return S_OK; }
         HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept { return S_OK; }
@@ -66,6 +86,8 @@ namespace
 
     private:
         std::optional<til::point> _triggerScrollDelta;
+        std::vector<til::rect> _invalidated;
+        std::vector<til::rect> _paintedLines;
     };
 
     struct ScrollBarNotification
@@ -96,6 +118,7 @@ class TerminalCoreUnitTests::ScrollTest final
     TEST_CLASS(ScrollTest);
 
     TEST_METHOD(TestNotifyScrolling);
+    TEST_METHOD(TestStatsOverlayScrolledCopyIsInvalidated);
 
     TEST_METHOD_SETUP(MethodSetup)
     {
@@ -236,3 +259,39 @@ void ScrollTest::TestNotifyScrolling()
         }
     }
 }
+
+void ScrollTest::TestStatsOverlayScrolledCopyIsInvalidated()
+{
+    // The stats overlay is anchored to the top right corner of the viewport, but the engines scroll it
+    // along with the text. When the viewport scrolls up, the old copy of the overlay ends up in the middle
+    // of the viewport, and the renderer must invalidate it, since nothing else would repaint it.
+    auto& termSm = *_term->_stateMachine;
+    for (auto i = 0; i < TerminalViewHeight * 2; ++i)
+    {
+        termSm.ProcessString(L"X\r\n");
+    }
+
+    _renderer->SetStatsOverlay(_renderEngine.get());
+    _renderEngine->Reset();
+    VERIFY_SUCCEEDED(_renderer->PaintFrame());
+
+    // The overlay is the only line that gets painted, because the mock engine doesn't have a dirty area.
+    VERIFY_ARE_EQUAL(1u, _renderEngine->PaintedLines().size());
+    const auto overlay = _renderEngine->PaintedLines().front();
+    VERIFY_ARE_EQUAL(0, overlay.top);
+    VERIFY_ARE_EQUAL(TerminalViewWidth, overlay.right);
+
+    constexpr til::CoordType delta = 5;
+    _renderEngine->Reset();
+    _term->UserScrollViewport(_term->GetScrollOffset() - delta);
+    VERIFY_ARE_EQUAL((til::point{ 0, delta }), _renderEngine->TriggerScrollDelta().value());
+    VERIFY_SUCCEEDED(_renderer->PaintFrame());
+
+    const auto& invalidated = _renderEngine->Invalidated();
+    const auto scrolledOverlay = overlay + til::point{ 0, delta };
+    VERIFY_IS_TRUE(std::ranges::find(invalidated, scrolledOverlay) != invalidated.end());
+
+    // The overlay is painted in the first row again.
+    VERIFY_ARE_EQUAL(1u, _renderEngine->PaintedLines().size());
+    VERIFY_ARE_EQUAL(overlay, _renderEngine->PaintedLines().front());
+}
@@ -21,6 +21,8 @@
 
 #include "../interactivity/inc/ServiceLocator.hpp"
 
+#include <til/unicode.h>
+
 #pragma hdrstop
 using namespace Microsoft::Console::Types;
 using Microsoft::Console::Interactivity::ServiceLocator;
@@ -255,6 +257,40 @@ void WriteCharsLegacy(SCREEN_INFORMATION& screenInfo, const std::wstring_view& t
     }
 }
 
+// Writes one slice of DoWriteConsole()'s text into the given buffer.
+// The settings it depends on are looked up anew for each slice, since they may change whenever the lock is released.
+static void _writeSlice(SCREEN_INFORMATION& screenInfo, const std::wstring_view& slice, const bool requiresVtQuirk)
+{
+    const auto vtIo = ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo();
+    const auto restoreVtQuirk = wil::scope_exit([&]() {
+        if (requiresVtQuirk)
+        {
+            screenInfo.ResetIgnoreLegacyEquivalentVTAttributes();
+        }
+        if (vtIo->IsUsingVt())
+        {
+            vtIo->CorkRenderer(false);
+        }
+    });
+    if (requiresVtQuirk)
+    {
+        screenInfo.SetIgnoreLegacyEquivalentVTAttributes();
+    }
+    if (vtIo->IsUsingVt())
+    {
+        vtIo->CorkRenderer(true);
+    }
+
+    if (WI_IsAnyFlagClear(screenInfo.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING | ENABLE_PROCESSED_OUTPUT))
+    {
+        WriteCharsLegacy(screenInfo, slice, nullptr);
+    }
+    else
+    {
+        screenInfo.GetStateMachine().ProcessString(slice);
+    }
+}
+
 // Routine Description:
 // - Takes the given text and inserts it into the given screen buffer.
 // Note:
@@ -266,6 +302,9 @@ void WriteCharsLegacy(SCREEN_INFORMATION& screenInfo, const std::wstring_view& t
 // - screenInfo - Screen Information class to write the text into at the current cursor position
 // - ppWaiter - If writing to the console is blocked for whatever reason, this will be filled with a pointer to context
 //              that can be used by the server to resume the call at a later time.
+// - yieldLock - If true, large writes are processed in slices and the console lock is released in between.
+//               screenInfo must then be the buffer that the client's handle refers to and the text is written
+//               into whichever buffer is active at the time (see SCREEN_INFORMATION::GetActiveBuffer()).
 // Return Value:
 // - STATUS_SUCCESS if OK.
 // - CONSOLE_STATUS_WAIT if we couldn't finish now and need to be called back later (see ppWaiter).
@@ -274,52 +313,73 @@ void WriteCharsLegacy(SCREEN_INFORMATION& screenInfo, const std::wstring_view& t
                                       _Inout_ size_t* const pcbBuffer,
                                       SCREEN_INFORMATION& screenInfo,
                                       bool requiresVtQuirk,
-                                      std::unique_ptr<WriteData>& waiter)
+                                      std::unique_ptr<WriteData>& waiter,
+                                      bool yieldLock)
 try
 {
+    // The number of characters processed under a single acquisition of the console lock, if yieldLock is set.
+    static constexpr size_t maxSliceLength = 16 * 1024;
+    // The number of characters processed at a time while we wait for the end of an escape sequence (see below).
+    static constexpr size_t sequenceSliceLength = 64;
+
     const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-    if (WI_IsAnyFlagSet(gci.Flags, (CONSOLE_SUSPENDED | CONSOLE_SELECTING | CONSOLE_SCROLLBAR_TRACKING)))
+    const std::wstring_view text{ pwchBuffer, *pcbBuffer / sizeof(WCHAR) };
+    size_t written = 0;
+    auto sliceLength = maxSliceLength;
+
+    // Releasing the lock in between slices allows the API calls of other clients, the renderer and the input
+    // thread to make progress during large writes. Everything that was read before releasing the lock is
+    // therefore looked up again afterwards, which is why each iteration starts from scratch.
+    for (;;)
     {
-        waiter = std::make_unique<WriteData>(screenInfo,
-                                             pwchBuffer,
-                                             *pcbBuffer,
-                                             gci.OutputCP,
-                                             requiresVtQuirk);
-        return CONSOLE_STATUS_WAIT;
-    }
+        // Another client may have switched to or from the alternate buffer in the meantime, which also destroys the
+        // latter. With yieldLock, screenInfo is the buffer the client's handle refers to, which is kept alive by it.
+        auto& target = yieldLock ? screenInfo.GetActiveBuffer() : screenInfo;
 
-    const auto vtIo = ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo();
-    const auto restoreVtQuirk = wil::scope_exit([&]() {
-        if (requiresVtQuirk)
+        if (WI_IsAnyFlagSet(gci.Flags, (CONSOLE_SUSPENDED | CONSOLE_SELECTING | CONSOLE_SCROLLBAR_TRACKING)))
         {
-            screenInfo.ResetIgnoreLegacyEquivalentVTAttributes();
+            waiter = std::make_unique<WriteData>(target,
+                                                 pwchBuffer,
+                                                 *pcbBuffer,
+                                                 gci.OutputCP,
+                                                 requiresVtQuirk);
+            waiter->SetBytesAlreadyWritten(written * sizeof(WCHAR));
+            return CONSOLE_STATUS_WAIT;
         }
-        if (vtIo->IsUsingVt())
+
+        auto slice = text.substr(written);
+        if (yieldLock && slice.size() > sliceLength)
         {
-            vtIo->CorkRenderer(false);
+            slice = slice.substr(0, sliceLength);
+            // Don't split surrogate pairs across slices.
+            if (til::is_leading_surrogate(slice.back()))
+            {
+                slice.remove_suffix(1);
+            }
         }
-    });
-    if (requiresVtQuirk)
-    {
-        screenInfo.SetIgnoreLegacyEquivalentVTAttributes();
-    }
-    if (vtIo->IsUsingVt())
-    {
-        vtIo->CorkRenderer(true);
-    }
 
-    const std::wstring_view str{ pwchBuffer, *pcbBuffer / sizeof(WCHAR) };
+        _writeSlice(target, slice, requiresVtQuirk);
+        written += slice.size();
 
-    if (WI_IsAnyFlagClear(screenInfo.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING | ENABLE_PROCESSED_OUTPUT))
-    {
-        WriteCharsLegacy(screenInfo, str, nullptr);
-    }
-    else
-    {
-        screenInfo.GetStateMachine().ProcessString(str);
-    }
+        if (written == text.size())
+        {
+            return STATUS_SUCCESS;
+        }
 
-    return STATUS_SUCCESS;
+        // The VT parser is shared by all clients writing to the buffer. Releasing the lock in the middle of
+        // an escape sequence would allow their output to end up inside of ours, so we hold on to it until
+        // the sequence is complete, which small slices allow us to notice soon after it happened.
+        if (target.GetStateMachine().IsGround())
+        {
+            UnlockConsole();
+            LockConsole();
+            sliceLength = maxSliceLength;
+        }
+        else
+        {
+            sliceLength = sequenceSliceLength;
+        }
+    }
 }
 NT_CATCH_RETURN()
 
@@ -328,7 +388,7 @@ NT_CATCH_RETURN()
 //   to adapt from the server types to the legacy internal host types.
 // - It operates on Unicode data only. It's assumed the text is translated by this point.
 // Arguments:
-// - OutContext - the console output object to write the new text into
+// - OutContext - the console output object the client's handle refers to. The text goes into its active buffer.
 // - pwsTextBuffer - wide character text buffer provided by client application to insert
 // - cchTextBufferLength - text buffer counted in characters
 // - pcchTextBufferRead - character count of the number of characters we were able to insert before returning
@@ -353,7 +413,8 @@ NT_CATCH_RETURN()
         size_t cbTextBufferLength;
         RETURN_IF_FAILED(SizeTMult(buffer.size(), sizeof(wchar_t), &cbTextBufferLength));
 
-        auto Status = DoWriteConsole(const_cast<wchar_t*>(buffer.data()), &cbTextBufferLength, context, requiresVtQuirk, waiter);
+        // We're an API call and own the lock, which is why we can yield it in between slices of a large write.
+        auto Status = DoWriteConsole(const_cast<wchar_t*>(buffer.data()), &cbTextBufferLength, context, requiresVtQuirk, waiter, true);
 
         // Convert back from bytes to characters for the resulting string length written.
         read = cbTextBufferLength / sizeof(wchar_t);
@@ -498,7 +559,7 @@ NT_CATCH_RETURN()
 
         // Make the W version of the call
         size_t wcBufferWritten{};
-        const auto hr{ WriteConsoleWImplHelper(screenInfo, wstr, wcBufferWritten, requiresVtQuirk, writeDataWaiter) };
+        const auto hr{ WriteConsoleWImplHelper(context, wstr, wcBufferWritten, requiresVtQuirk, writeDataWaiter) };
 
         // If there is no waiter, process the byte count now.
         if (nullptr == writeDataWaiter.get())
@@ -585,7 +646,7 @@ NT_CATCH_RETURN()
         auto unlock = wil::scope_exit([&] { UnlockConsole(); });
 
         std::unique_ptr<WriteData> writeDataWaiter;
-        RETURN_IF_FAILED(WriteConsoleWImplHelper(context.GetActiveBuffer(), buffer, read, requiresVtQuirk, writeDataWaiter));
+        RETURN_IF_FAILED(WriteConsoleWImplHelper(context, buffer, read, requiresVtQuirk, writeDataWaiter));
 
         // Transfer specific waiter pointer into the generic interface wrapper.
         waiter.reset(writeDataWaiter.release());
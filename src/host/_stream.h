@@ -23,8 +23,12 @@ void WriteCharsLegacy(SCREEN_INFORMATION& screenInfo, const std::wstring_view& s
 
 // NOTE: console lock must be held when calling this routine
 // String has been translated to unicode at this point.
+// With yieldLock, the lock is briefly released in between slices of large writes (outside of escape sequences),
+// which is only safe if the caller doesn't depend on state that was read before the call. screenInfo must then
+// be the buffer that the client's handle refers to, since the active buffer may change in the meantime.
 [[nodiscard]] NTSTATUS DoWriteConsole(_In_reads_bytes_(pcbBuffer) const wchar_t* pwchBuffer,
                                       _Inout_ size_t* const pcbBuffer,
                                       SCREEN_INFORMATION& screenInfo,
                                       bool requiresVtQuirk,
-                                      std::unique_ptr<WriteData>& waiter);
+                                      std::unique_ptr<WriteData>& waiter,
+                                      bool yieldLock = false);
@@ -44,9 +44,104 @@ struct case_insensitive_equality
     }
 };
 
+// An alias target that was split into literal text and parameter references when the alias was defined.
+// This way expanding an alias on every line read from the console is a single pass over the segments,
+// instead of parsing the $ macros in the target over and over again.
+struct CompiledAlias
+{
+    static constexpr uint8_t literal = 0; // Refers to the [offset, offset+length) slice of literals.
+    static constexpr uint8_t allArgs = 10; // $*
+    // 1-9 refer to the $1-$9 arguments.
+
+    struct Segment
+    {
+        size_t offset = 0;
+        size_t length = 0;
+        uint8_t param = literal;
+    };
+
+    std::wstring target; // The unmodified target as returned by GetConsoleAlias.
+    std::wstring literals;
+    std::vector<Segment> segments;
+    size_t lines = 0;
+    size_t argsNeeded = 0; // The number of arguments past the alias name that the segments refer to.
+};
+
+static CompiledAlias compileAlias(std::wstring target)
+{
+    CompiledAlias alias;
+
+    const auto pushLiteral = [&](const std::wstring_view text) {
+        if (alias.segments.empty() || alias.segments.back().param != CompiledAlias::literal)
+        {
+            alias.segments.push_back({ alias.literals.size(), 0, CompiledAlias::literal });
+        }
+        alias.segments.back().length += text.size();
+        alias.literals.append(text);
+    };
+    const auto pushParam = [&](const uint8_t param) {
+        alias.segments.push_back({ 0, 0, param });
+        // $* appends everything starting at the first argument, so we need to know where that one is.
+        alias.argsNeeded = std::max<size_t>(alias.argsNeeded, param == CompiledAlias::allArgs ? 1 : param);
+    };
+
+    for (auto it = target.begin(), end = target.end(); it != end;)
+    {
+        auto ch = *it++;
+        if (ch != L'$' || it == end)
+        {
+            pushLiteral({ &ch, 1 });
+            continue;
+        }
+
+        // $ is our "escape character" and this code handles the escape
+        // sequence consisting of a single subsequent character.
+        ch = *it++;
+        const auto chLower = til::tolower_ascii(ch);
+        if (chLower >= L'1' && chLower <= L'9')
+        {
+            // $1-9 = append the given parameter
+            pushParam(gsl::narrow_cast<uint8_t>(chLower - L'0'));
+        }
+        else if (chLower == L'*')
+        {
+            // $* = append all parameters
+            pushParam(CompiledAlias::allArgs);
+        }
+        else if (chLower == L'l')
+        {
+            pushLiteral(L"<");
+        }
+        else if (chLower == L'g')
+        {
+            pushLiteral(L">");
+        }
+        else if (chLower == L'b')
+        {
+            pushLiteral(L"|");
+        }
+        else if (chLower == L't')
+        {
+            pushLiteral(L"\r\n");
+            alias.lines++;
+        }
+        else
+        {
+            const wchar_t escape[]{ L'$', ch };
+            pushLiteral({ &escape[0], 2 });
+        }
+    }
+
+    pushLiteral(L"\r\n");
+    alias.lines++;
+
+    alias.target = std::move(target);
+    return alias;
+}
+
 std::unordered_map<std::wstring,
                    std::unordered_map<std::wstring,
-                                      std::wstring,
+                                      CompiledAlias,
                                       case_insensitive_hash,
                                       case_insensitive_equality>,
                    case_insensitive_hash,
@@ -118,7 +213,7 @@ std::unordered_map<std::wstring,
         else
         {
             // Map will auto-create each level as necessary
-            g_aliasData[exeNameString][sourceString] = targetString;
+            g_aliasData[exeNameString][sourceString] = compileAlias(std::move(targetString));
         }
     }
     CATCH_RETURN();
@@ -153,17 +248,14 @@ std::unordered_map<std::wstring,
         til::at(*target, 0) = UNICODE_NULL;
     }
 
-    std::wstring exeNameString(exeName);
-    std::wstring sourceString(source);
-
     // For compatibility, return ERROR_GEN_FAILURE for any result where the alias can't be found.
     // We use .find for the iterators then dereference to search without creating entries.
-    const auto exeIter = g_aliasData.find(exeNameString);
+    const auto exeIter = g_aliasData.find(exeName);
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), exeIter == g_aliasData.end());
     const auto& exeData = exeIter->second;
-    const auto sourceIter = exeData.find(sourceString);
+    const auto sourceIter = exeData.find(source);
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), sourceIter == exeData.end());
-    const auto& targetString = sourceIter->second;
+    const auto& targetString = sourceIter->second.target;
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), targetString.size() == 0);
 
     // TargetLength is a byte count, convert to characters.
@@ -319,8 +411,6 @@ static std::wstring aliasesSeparator(L"=");
 
     try
     {
-        const std::wstring exeNameString(exeName);
-
         size_t cchNeeded = 0;
 
         // Each of the aliases will be made up of the source, a separator, the target, then a null character.
@@ -334,7 +424,7 @@ static std::wstring aliasesSeparator(L"=");
         }
 
         // Find without creating.
-        auto exeIter = g_aliasData.find(exeNameString);
+        auto exeIter = g_aliasData.find(exeName);
         if (exeIter != g_aliasData.end())
         {
             const auto& list = exeIter->second;
@@ -342,13 +432,13 @@ static std::wstring aliasesSeparator(L"=");
             {
                 // Alias stores lengths in bytes.
                 auto cchSource = pair.first.size();
-                auto cchTarget = pair.second.size();
+                auto cchTarget = pair.second.target.size();
 
                 // If we're counting how much multibyte space will be needed, trial convert the source and target strings before we add.
                 if (!countInUnicode)
                 {
                     cchSource = GetALengthFromW(codepage, pair.first);
-                    cchTarget = GetALengthFromW(codepage, pair.second);
+                    cchTarget = GetALengthFromW(codepage, pair.second.target);
                 }
 
                 // Accumulate all sizes to the final string count.
@@ -455,8 +545,6 @@ void Alias::s_ClearCmdExeAliases()
         til::at(*aliasBuffer, 0) = UNICODE_NULL;
     }
 
-    std::wstring exeNameString(exeName);
-
     auto AliasesBufferPtrW = aliasBuffer.has_value() ? aliasBuffer->data() : nullptr;
     size_t cchTotalLength = 0; // accumulate the characters we need/have copied as we walk the list
 
@@ -465,7 +553,7 @@ void Alias::s_ClearCmdExeAliases()
     const size_t cchNull = 1;
 
     // Find without creating.
-    auto exeIter = g_aliasData.find(exeNameString);
+    auto exeIter = g_aliasData.find(exeName);
     if (exeIter != g_aliasData.end())
     {
         const auto& list = exeIter->second;
@@ -473,7 +561,8 @@ void Alias::s_ClearCmdExeAliases()
         {
             // Alias stores lengths in bytes.
             const auto cchSource = pair.first.size();
-            const auto cchTarget = pair.second.size();
+            const auto& target = pair.second.target;
+            const auto cchTarget = target.size();
 
             // Add up how many characters we will need for the full alias data.
             size_t cchNeeded = 0;
@@ -503,7 +592,7 @@ void Alias::s_ClearCmdExeAliases()
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, aliasesSeparator.size(), &cchAliasBufferRemaining));
                 AliasesBufferPtrW += aliasesSeparator.size();
 
-                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.data(), cchTarget));
+                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, target.data(), cchTarget));
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, cchTarget, &cchAliasBufferRemaining));
                 AliasesBufferPtrW += cchTarget;
 
@@ -849,10 +938,15 @@ std::wstring Alias::s_MatchAndCopyAlias(std::wstring_view sourceText, std::wstri
 
     std::wstring_view args[10];
     size_t argc = 0;
+    size_t argBegIdx = 0;
+
+    // Splits the next whitespace delimited argument off the source string.
+    const auto splitNextArg = [&]() {
+        if (argBegIdx >= sourceText.size() || argc >= std::size(args))
+        {
+            return false;
+        }
 
-    // Split the source string into whitespace delimited arguments.
-    for (size_t argBegIdx = 0; argBegIdx < sourceText.size();)
-    {
         // Find the end of the current word (= argument).
         const auto argEndIdx = sourceText.find_first_of(L' ', argBegIdx);
         const auto str = til::safe_slice_abs(sourceText, argBegIdx, argEndIdx);
@@ -862,25 +956,21 @@ std::wstring Alias::s_MatchAndCopyAlias(std::wstring_view sourceText, std::wstri
         // an argument there's only whitespace text left until the end of sourceText.
         if (str.empty())
         {
-            break;
+            argBegIdx = std::wstring_view::npos;
+            return false;
         }
 
         args[argc] = str;
         argc++;
 
-        if (argc >= std::size(args))
-        {
-            break;
-        }
-
         // Find the start of the next word (= argument).
-        // If the rest of the text is only whitespace, argBegIdx will be npos
-        // and the for() loop condition will make us exit.
+        // If the rest of the text is only whitespace, argBegIdx will be npos.
         argBegIdx = sourceText.find_first_not_of(L' ', argEndIdx);
-    }
+        return true;
+    };
 
-    // As mentioned above, argc will be 0 if the source text starts with whitespace or only consists of whitespace.
-    if (argc == 0)
+    // As mentioned above, there's no argument if the source text starts with whitespace or only consists of whitespace.
+    if (!splitNextArg())
     {
         return {};
     }
@@ -892,81 +982,51 @@ std::wstring Alias::s_MatchAndCopyAlias(std::wstring_view sourceText, std::wstri
         return {};
     }
 
-    const auto& target = aliasIter->second;
-    if (target.size() == 0)
+    const auto& alias = aliasIter->second;
+    if (alias.target.size() == 0)
     {
         return {};
     }
 
+    // Only split off as many arguments as the alias actually refers to.
+    while (argc <= alias.argsNeeded && splitNextArg())
+    {
+    }
+
     std::wstring buffer;
-    size_t lines = 0;
+    buffer.reserve(alias.literals.size() + sourceText.size());
 
-    for (auto it = target.begin(), end = target.end(); it != end;)
+    for (const auto& segment : alias.segments)
     {
-        auto ch = *it++;
-        if (ch != L'$' || it == end)
-        {
-            buffer.push_back(ch);
-            continue;
-        }
-
-        // $ is our "escape character" and this code handles the escape
-        // sequence consisting of a single subsequent character.
-        ch = *it++;
-        const auto chLower = til::tolower_ascii(ch);
-        if (chLower >= L'1' && chLower <= L'9')
-        {
-            // $1-9 = append the given parameter
-            const size_t idx = chLower - L'0';
-            if (idx < argc)
-            {
-                buffer.append(args[idx]);
-            }
-        }
-        else if (chLower == L'*')
+        switch (segment.param)
         {
-            // $* = append all parameters
+        case CompiledAlias::literal:
+            buffer.append(alias.literals, segment.offset, segment.length);
+            break;
+        case CompiledAlias::allArgs:
             if (argc > 1)
             {
                 // args[] is an array of slices into the source text. This appends the text
                 // starting at first argument up to the end of the source to the buffer.
                 buffer.append(args[1].data(), sourceText.data() + sourceText.size());
             }
-        }
-        else if (chLower == L'l')
-        {
-            buffer.push_back(L'<');
-        }
-        else if (chLower == L'g')
-        {
-            buffer.push_back(L'>');
-        }
-        else if (chLower == L'b')
-        {
-            buffer.push_back(L'|');
-        }
-        else if (chLower == L't')
-        {
-            buffer.append(L"\r\n");
-            lines++;
-        }
-        else
-        {
-            buffer.push_back(L'$');
-            buffer.push_back(ch);
+            break;
+        default:
+            if (segment.param < argc)
+            {
+                buffer.append(til::at(args, segment.param));
+            }
+            break;
         }
     }
 
-    buffer.append(L"\r\n");
-    lines++;
-
-    lineCount = lines;
+    lineCount = alias.lines;
     return buffer;
 }
 
 void Alias::s_TestAddAlias(std::wstring exe, std::wstring alias, std::wstring target)
 {
-    g_aliasData[std::move(exe)][std::move(alias)] = std::move(target);
+    g_aliasData[std::move(exe)][std::move(alias)] = compileAlias(std::move(target));
 }
 
 void Alias::s_TestClearAliases()
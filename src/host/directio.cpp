@@ -470,7 +470,6 @@ CATCH_RETURN();
 {
     try
     {
-        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         const auto& storageBuffer = context.GetActiveBuffer().GetTextBuffer();
         const auto storageSize = storageBuffer.GetSize().Dimensions();
 
@@ -505,44 +504,23 @@ CATCH_RETURN();
         // The final "request rectangle" or the area inside the buffer we want to read, is the clipped dimensions.
         const auto clippedRequestRectangle = Viewport::FromExclusive(clip);
 
-        // We will start reading the buffer at the point of the top left corner (origin) of the (potentially adjusted) request
-        const auto sourcePoint = clippedRequestRectangle.Origin();
-
-        // Get an iterator to the beginning of the return buffer
-        // We might have to seek this forward or skip around if we clipped the request.
-        auto targetIter = targetBuffer.begin();
-        til::point targetPos;
-        const auto targetLimit = Viewport::FromDimensions(targetPoint, clippedRequestRectangle.Dimensions());
-
-        // Get an iterator to the beginning of the request inside the screen buffer
-        // This should walk exactly along every cell of the clipped request.
-        auto sourceIter = storageBuffer.GetCellDataAt(sourcePoint, clippedRequestRectangle);
+        // The clipped request must still lie within the buffer and cover at least one cell.
+        RETURN_HR_IF(E_INVALIDARG, !storageBuffer.GetSize().IsInBounds(clippedRequestRectangle) || !clippedRequestRectangle.IsInBounds(clippedRequestRectangle.Origin()));
 
-        // Walk through every cell of the target, advancing the buffer.
-        // Validate that we always still have a valid iterator to the backing store,
-        // that we always are writing inside the user's buffer (before the end)
-        // and we're always targeting the user's buffer inside its original bounds.
-        while (sourceIter && targetIter < targetBuffer.end())
+        // Gather each row of the clipped request into the corresponding row of the user's buffer.
+        // If we clipped the request, the first row/column of the target is offset by targetPoint.
+        // The user's buffer may be smaller than the request, in which case we stop once it's full.
+        const auto width = gsl::narrow_cast<size_t>(clippedRequestRectangle.Width());
+        for (auto y = clip.top; y < clip.bottom; ++y)
         {
-            // If the point we're trying to write is inside the limited buffer write zone...
-            if (targetLimit.IsInBounds(targetPos))
+            const auto offset = gsl::narrow_cast<size_t>((targetPoint.y + y - clip.top) * targetSize.width + targetPoint.x);
+            if (offset >= targetBuffer.size())
             {
-                // Copy the data into position...
-                *targetIter = gci.AsCharInfo(*sourceIter);
-                // ... and advance the read iterator.
-                ++sourceIter;
+                break;
             }
 
-            // Always advance the write iterator, we might have skipped it due to clipping.
-            ++targetIter;
-
-            // Increment the target
-            targetPos.x++;
-            if (targetPos.x >= targetSize.width)
-            {
-                targetPos.x = 0;
-                targetPos.y++;
-            }
+            const auto target = targetBuffer.subspan(offset, std::min(width, targetBuffer.size() - offset));
+            storageBuffer.GetRowByOffset(y).ReadCharInfos(clip.left, target);
         }
 
         // Reply with the region we read out of the backing buffer (potentially clipped)
@@ -667,6 +645,7 @@ CATCH_RETURN();
         }
 
         const auto writeRectangle = Viewport::FromInclusive(writeRegion);
+        auto& textBuffer = storageBuffer.GetTextBuffer();
 
         auto target = writeRectangle.Origin();
 
@@ -686,11 +665,17 @@ CATCH_RETURN();
             // Convert to a CHAR_INFO view to fit into the iterator
             const auto charInfos = std::span<const CHAR_INFO>(subspan.data(), subspan.size());
 
-            // Make the iterator and write to the target position.
-            OutputCellIterator it(charInfos);
-            storageBuffer.Write(it, target);
+            // Most CHAR_INFO rows can be written in bulk. Only the ones containing halves of wide glyphs
+            // need to go through the OutputCellIterator, which knows how to pair them up.
+            if (!textBuffer.GetMutableRowByOffset(target.y).WriteCharInfos(target.x, charInfos))
+            {
+                OutputCellIterator it(charInfos);
+                storageBuffer.Write(it, target);
+            }
         }
 
+        textBuffer.TriggerRedraw(writeRectangle);
+
         // Since we've managed to write part of the request, return the clamped part that we actually used.
         writtenRectangle = writeRectangle;
 
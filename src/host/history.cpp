@@ -31,6 +31,108 @@ using Microsoft::Console::Interactivity::ServiceLocator;
 // If CommandHistory::s_Allocate and friends stop shuffling elements
 // for maintaining LRU, then this datatype can be changed.
 std::list<CommandHistory> CommandHistory::s_historyLists;
+CommandHistory::AppIndex CommandHistory::s_historiesByApp;
+uint64_t CommandHistory::s_useCounter = 0;
+
+namespace
+{
+    // The history files live in the user's profile, which may be on a slow or roaming disk. Process attach and
+    // detach happen with the console lock held though, which is why the files are read and written in the background.
+    // The tasks run one at a time and in the order they were queued. That way, a session of an app that starts right
+    // after another one ended reads what that one saved. They never acquire the console lock, so that
+    // s_WaitForPersistence() can be called with it held.
+    class PersistenceQueue
+    {
+    public:
+        void Push(std::function<void()> task)
+        {
+            {
+                const std::lock_guard guard{ _mutex };
+                _tasks.push_back(std::move(task));
+                if (_running)
+                {
+                    return;
+                }
+                _running = true;
+                _idle.ResetEvent();
+            }
+
+            if (!TrySubmitThreadpoolCallback(&s_Run, this, nullptr))
+            {
+                LOG_LAST_ERROR();
+                _Run();
+            }
+        }
+
+        void Wait() noexcept
+        {
+            _idle.wait();
+        }
+
+    private:
+        static void CALLBACK s_Run(PTP_CALLBACK_INSTANCE, void* context) noexcept
+        {
+            static_cast<PersistenceQueue*>(context)->_Run();
+        }
+
+        void _Run() noexcept
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    const std::lock_guard guard{ _mutex };
+                    if (_tasks.empty())
+                    {
+                        _running = false;
+                        _idle.SetEvent();
+                        return;
+                    }
+                    task = std::move(_tasks.front());
+                    _tasks.pop_front();
+                }
+
+                try
+                {
+                    task();
+                }
+                CATCH_LOG();
+            }
+        }
+
+        std::mutex _mutex;
+        std::deque<std::function<void()>> _tasks;
+        bool _running = false;
+        wil::slim_event_manual_reset _idle{ true };
+    };
+
+    PersistenceQueue& GetPersistenceQueue()
+    {
+        // Leaked, so that it outlives any thread pool callback that's still running during ExitProcess().
+        static auto& queue = *new PersistenceQueue;
+        return queue;
+    }
+
+    // Runs the callback on the thread pool with the console lock held.
+    void SubmitLocked(std::function<void()> callback)
+    {
+        auto context = std::make_unique<std::function<void()>>(std::move(callback));
+        THROW_IF_WIN32_BOOL_FALSE(TrySubmitThreadpoolCallback(
+            [](PTP_CALLBACK_INSTANCE, void* parameter) noexcept {
+                const std::unique_ptr<std::function<void()>> pCallback{ static_cast<std::function<void()>*>(parameter) };
+                LockConsole();
+                const auto unlock = wil::scope_exit([] { UnlockConsole(); });
+                try
+                {
+                    (*pCallback)();
+                }
+                CATCH_LOG();
+            },
+            context.get(),
+            nullptr));
+        context.release();
+    }
+}
 
 CommandHistory* CommandHistory::s_Find(const HANDLE processHandle)
 {
@@ -55,6 +157,12 @@ void CommandHistory::s_Free(const HANDLE processHandle)
     const auto History = CommandHistory::s_Find(processHandle);
     if (History)
     {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        if (gci.GetPersistHistory())
+        {
+            _SavePersisted(*History);
+        }
+
         WI_ClearFlag(History->Flags, CLE_ALLOCATED);
         History->_processHandle = nullptr;
     }
@@ -78,6 +186,299 @@ bool CommandHistory::IsAppNameMatch(const std::wstring_view other) const
     return CompareStringOrdinal(_appName.data(), gsl::narrow<int>(_appName.size()), other.data(), gsl::narrow<int>(other.size()), TRUE) == CSTR_EQUAL;
 }
 
+// IsAppNameMatch() ignores case the same way CompareStringOrdinal() does: By converting
+// both strings to upper case using the invariant locale. s_historiesByApp is keyed by that form.
+std::wstring CommandHistory::_FoldAppName(const std::wstring_view appName)
+{
+    std::wstring folded{ appName };
+    if (!folded.empty())
+    {
+        const auto len = gsl::narrow<int>(folded.size());
+        THROW_LAST_ERROR_IF(!LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, appName.data(), len, folded.data(), len, nullptr, nullptr, 0));
+    }
+    return folded;
+}
+
+// Returns the most recently used history for the given app that is (or isn't) allocated to a client.
+std::list<CommandHistory>::iterator CommandHistory::_FindMostRecent(const std::wstring_view appName, const bool allocated)
+{
+    auto best = s_historyLists.end();
+    const auto [beg, end] = s_historiesByApp.equal_range(_FoldAppName(appName));
+
+    for (auto it = beg; it != end; ++it)
+    {
+        const auto history = it->second;
+        if (WI_IsFlagSet(history->Flags, CLE_ALLOCATED) == allocated &&
+            history->IsAppNameMatch(appName) &&
+            (best == s_historyLists.end() || history->_lastUsed > best->_lastUsed))
+        {
+            best = history;
+        }
+    }
+
+    return best;
+}
+
+// s_historyLists is ordered from most to least recently used and _lastUsed mirrors that order,
+// which allows _FindMostRecent() to pick between histories with the same app name without walking the list.
+void CommandHistory::_MoveToFront(std::list<CommandHistory>::iterator it)
+{
+    s_historyLists.splice(s_historyLists.begin(), s_historyLists, it);
+    it->_lastUsed = ++s_useCounter;
+}
+
+void CommandHistory::_Rename(std::list<CommandHistory>::iterator it, const std::wstring_view appName)
+{
+    auto folded = _FoldAppName(appName);
+    const auto [beg, end] = s_historiesByApp.equal_range(_FoldAppName(it->_appName));
+
+    for (auto i = beg; i != end; ++i)
+    {
+        if (i->second == it)
+        {
+            s_historiesByApp.erase(i);
+            break;
+        }
+    }
+
+    it->_appName = appName;
+    s_historiesByApp.emplace(std::move(folded), it);
+}
+
+// Returns the path of the file that persists the history of the given app between console sessions.
+std::wstring CommandHistory::_PersistencePath(const std::wstring_view appName)
+{
+    auto path = wil::ExpandEnvironmentStringsW<std::wstring>(LR"(%LOCALAPPDATA%\Microsoft\Console\History)");
+    THROW_IF_FAILED(wil::CreateDirectoryDeepNoThrow(path.c_str()));
+
+    path.push_back(L'\\');
+    // App names are usually just file names, but we must not allow them to point outside of our directory.
+    for (const auto ch : appName)
+    {
+        path.push_back(ch == L'\\' || ch == L'/' || ch == L':' ? L'_' : ch);
+    }
+    path.append(L".history");
+    return path;
+}
+
+// Reads a file written by Save(). Just like the buffer returned by GetConsoleCommandHistoryW(),
+// it contains the commands from oldest to newest, each of which is terminated by a null character.
+std::vector<std::wstring> CommandHistory::_ReadPersisted(const std::wstring& path)
+{
+    // Protects us from reading arbitrarily large files. It's plenty for any realistic history size.
+    static constexpr LONGLONG maxFileSize = 16 * 1024 * 1024;
+
+    std::vector<std::wstring> commands;
+
+    // FILE_SHARE_DELETE allows other console sessions to replace the file while we read it.
+    const wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    if (!file)
+    {
+        const auto gle = GetLastError();
+        // Nothing has been persisted yet.
+        if (gle == ERROR_FILE_NOT_FOUND || gle == ERROR_PATH_NOT_FOUND)
+        {
+            return commands;
+        }
+        THROW_WIN32(gle);
+    }
+
+    LARGE_INTEGER size;
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &size));
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE), size.QuadPart > maxFileSize);
+
+    std::wstring data;
+    data.resize(gsl::narrow_cast<size_t>(size.QuadPart) / sizeof(wchar_t));
+
+    DWORD read = 0;
+    THROW_IF_WIN32_BOOL_FALSE(ReadFile(file.get(), data.data(), gsl::narrow_cast<DWORD>(data.size() * sizeof(wchar_t)), &read, nullptr));
+    data.resize(read / sizeof(wchar_t));
+
+    for (std::wstring_view rest{ data }; !rest.empty();)
+    {
+        const auto end = std::min(rest.find(L'\0'), rest.size());
+        if (end != 0)
+        {
+            commands.emplace_back(rest.substr(0, end));
+        }
+        rest = rest.substr(std::min(end + 1, rest.size()));
+    }
+
+    return commands;
+}
+
+// Seeds a fresh history with the commands that previous console sessions persisted for its app.
+// The file is read in the background (see PersistenceQueue) and merged into the history once that's done.
+void CommandHistory::_LoadPersisted(CommandHistory& history) noexcept
+try
+{
+    const auto generation = ++history._persistenceGeneration;
+
+    GetPersistenceQueue().Push([&history, generation, appName = history._appName]() {
+        auto persisted = _ReadPersisted(_PersistencePath(appName));
+
+        // The history is modified under the console lock, which the persistence tasks must not wait for.
+        SubmitLocked([&history, generation, persisted = std::move(persisted)]() {
+            if (history._persistenceGeneration == generation)
+            {
+                LOG_IF_FAILED(history._MergePersisted(persisted));
+            }
+        });
+    });
+}
+CATCH_LOG()
+
+// Hands the commands that were added since the last load or save to the background (see PersistenceQueue),
+// which appends them to the app's history file.
+void CommandHistory::_SavePersisted(CommandHistory& history) noexcept
+try
+{
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    const auto unsaved = std::lower_bound(history._ids.begin(), history._ids.end(), history._unsavedId) - history._ids.begin();
+
+    GetPersistenceQueue().Push([appName = history._appName,
+                                commands = std::vector<std::wstring>(history._commands.begin() + unsaved, history._commands.end()),
+                                maxCommands = history._maxCommands,
+                                suppressDuplicates = WI_IsFlagSet(gci.Flags, CONSOLE_HISTORY_NODUP)]() {
+        THROW_IF_FAILED(_WritePersisted(_PersistencePath(appName), commands, maxCommands, suppressDuplicates));
+    });
+
+    history._unsavedId = history._nextId;
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Blocks until the history files have been read and written. Called before the console exits,
+//   so that the histories of the last sessions aren't lost. The console lock may be held.
+void CommandHistory::s_WaitForPersistence()
+{
+    GetPersistenceQueue().Wait();
+}
+
+// Inserts the persisted commands before the ones in this history, which were entered while the file was being read.
+[[nodiscard]] HRESULT CommandHistory::_MergePersisted(const std::vector<std::wstring>& persisted)
+try
+{
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    const auto suppressDuplicates = WI_IsFlagSet(gci.Flags, CONSOLE_HISTORY_NODUP);
+
+    // Some of those commands may have been handed to Save() already. They must not be persisted twice.
+    const auto saved = gsl::narrow_cast<size_t>(std::lower_bound(_ids.begin(), _ids.end(), _unsavedId) - _ids.begin());
+    const auto recent = std::move(_commands);
+    _Clear();
+    LastDisplayed = -1;
+
+    // Add() asserts that the history is allocated, but the client may have detached in the meantime.
+    // The persisted commands still belong into its history, in case the app attaches again.
+    const auto allocated = WI_IsFlagSet(Flags, CLE_ALLOCATED);
+    WI_SetFlag(Flags, CLE_ALLOCATED);
+    const auto restore = wil::scope_exit([&]() noexcept { WI_UpdateFlag(Flags, CLE_ALLOCATED, allocated); });
+
+    for (const auto& command : persisted)
+    {
+        RETURN_IF_FAILED(Add(command, suppressDuplicates));
+    }
+    for (size_t i = 0; i < saved && i < recent.size(); ++i)
+    {
+        RETURN_IF_FAILED(Add(recent[i], suppressDuplicates));
+    }
+
+    _unsavedId = _nextId;
+
+    for (auto i = saved; i < recent.size(); ++i)
+    {
+        RETURN_IF_FAILED(Add(recent[i], suppressDuplicates));
+    }
+
+    return S_OK;
+}
+CATCH_RETURN()
+
+// Routine Description:
+// - Replaces the contents of this history with the commands that were persisted at the given path by Save().
+[[nodiscard]] HRESULT CommandHistory::Load(const std::wstring& path)
+try
+{
+    const auto commands = _ReadPersisted(path);
+    _Clear();
+    return _MergePersisted(commands);
+}
+CATCH_RETURN()
+
+// Routine Description:
+// - Persists this history at the given path, so that future console sessions can Load() it.
+// - Other sessions of the same app may have saved their history in the meantime. That's why only the commands
+//   that were added since the last Load() or Save() are appended to the file, instead of overwriting it.
+[[nodiscard]] HRESULT CommandHistory::Save(const std::wstring& path)
+try
+{
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    const auto unsaved = std::lower_bound(_ids.begin(), _ids.end(), _unsavedId) - _ids.begin();
+
+    RETURN_IF_FAILED(_WritePersisted(path, std::vector<std::wstring>(_commands.begin() + unsaved, _commands.end()), _maxCommands, WI_IsFlagSet(gci.Flags, CONSOLE_HISTORY_NODUP)));
+
+    _unsavedId = _nextId;
+    return S_OK;
+}
+CATCH_RETURN()
+
+// Appends the unsaved commands to the ones persisted at the given path. This doesn't access any console state,
+// which allows it to run in the background without holding the console lock.
+[[nodiscard]] HRESULT CommandHistory::_WritePersisted(const std::wstring& path, std::vector<std::wstring> unsaved, const Index maxCommands, const bool suppressDuplicates)
+try
+{
+    auto commands = _ReadPersisted(path);
+    commands.insert(commands.end(), std::make_move_iterator(unsaved.begin()), std::make_move_iterator(unsaved.end()));
+
+    // Keep only the most recent copy of each command, just like Add() does.
+    if (suppressDuplicates)
+    {
+        // The views point into `commands`, which is why the unique ones must be copied and not moved out of it.
+        std::unordered_set<std::wstring_view> seen;
+        std::vector<std::wstring> unique;
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it)
+        {
+            if (seen.emplace(*it).second)
+            {
+                unique.emplace_back(*it);
+            }
+        }
+        std::reverse(unique.begin(), unique.end());
+        commands = std::move(unique);
+    }
+
+    const auto maxCount = gsl::narrow_cast<size_t>(std::max(0, maxCommands));
+    if (commands.size() > maxCount)
+    {
+        commands.erase(commands.begin(), commands.end() - maxCount);
+    }
+
+    std::wstring data;
+    for (const auto& command : commands)
+    {
+        data.append(command);
+        data.push_back(L'\0');
+    }
+
+    // The new contents are written to a temporary file first, which then replaces the original one
+    // in a single step. This ensures that other sessions never read a partially written file.
+    const auto temp = path + L'.' + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+    auto cleanup = wil::scope_exit([&]() noexcept { DeleteFileW(temp.c_str()); });
+
+    {
+        const wil::unique_hfile file{ CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        RETURN_LAST_ERROR_IF(!file);
+
+        DWORD written = 0;
+        RETURN_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), data.data(), gsl::narrow<DWORD>(data.size() * sizeof(wchar_t)), &written, nullptr));
+    }
+
+    RETURN_IF_WIN32_BOOL_FALSE(MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING));
+    cleanup.release();
+    return S_OK;
+}
+CATCH_RETURN()
+
 // Routine Description:
 // - This routine is called when escape is entered or a command is added.
 void CommandHistory::_Reset()
@@ -120,7 +521,7 @@ void CommandHistory::_Reset()
             // find free record.  if all records are used, free the lru one.
             if (GetNumberOfCommands() == _maxCommands)
             {
-                _commands.erase(_commands.cbegin());
+                _Erase(0);
                 // move LastDisplayed back one in order to stay synced with the
                 // command it referred to before erasing the lru one
                 --LastDisplayed;
@@ -129,11 +530,11 @@ void CommandHistory::_Reset()
             // add newCommand to array
             if (!reuse.empty())
             {
-                _commands.emplace_back(reuse);
+                _PushBack(std::move(reuse));
             }
             else
             {
-                _commands.emplace_back(newCommand);
+                _PushBack(std::wstring{ newCommand });
             }
 
             if (LastDisplayed == -1 ||
@@ -210,7 +611,7 @@ std::wstring_view CommandHistory::GetLastCommand() const
 
 void CommandHistory::Empty()
 {
-    _commands.clear();
+    _Clear();
     LastDisplayed = -1;
     WI_SetFlag(Flags, CLE_RESET);
 }
@@ -243,7 +644,11 @@ void CommandHistory::Realloc(const Index commands)
         return;
     }
 
-    _commands.resize(std::min(_commands.size(), gsl::narrow_cast<size_t>(std::max(0, commands))));
+    const auto newSize = std::min(_commands.size(), gsl::narrow_cast<size_t>(std::max(0, commands)));
+    while (_commands.size() > newSize)
+    {
+        _Erase(GetNumberOfCommands() - 1);
+    }
 
     WI_SetFlag(Flags, CLE_RESET);
     LastDisplayed = GetNumberOfCommands() - 1;
@@ -254,27 +659,18 @@ void CommandHistory::s_ReallocExeToFront(const std::wstring_view appName, const
 {
     const auto size = gsl::narrow<Index>(commands);
 
-    for (auto it = s_historyLists.begin(), end = s_historyLists.end(); it != end; ++it)
+    const auto it = _FindMostRecent(appName, true);
+    if (it != s_historyLists.end())
     {
-        if (WI_IsFlagSet(it->Flags, CLE_ALLOCATED) && it->IsAppNameMatch(appName))
-        {
-            it->Realloc(size);
-            s_historyLists.splice(s_historyLists.begin(), s_historyLists, it);
-            return;
-        }
+        it->Realloc(size);
+        _MoveToFront(it);
     }
 }
 
 CommandHistory* CommandHistory::s_FindByExe(const std::wstring_view appName)
 {
-    for (auto& historyList : s_historyLists)
-    {
-        if (WI_IsFlagSet(historyList.Flags, CLE_ALLOCATED) && historyList.IsAppNameMatch(appName))
-        {
-            return &historyList;
-        }
-    }
-    return nullptr;
+    const auto it = _FindMostRecent(appName, true);
+    return it != s_historyLists.end() ? &*it : nullptr;
 }
 
 size_t CommandHistory::s_CountOfHistories()
@@ -295,22 +691,10 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     // If possible, the buffer should have the same app name.
     const auto beg = s_historyLists.begin();
     const auto end = s_historyLists.end();
-    auto BestCandidate = end;
-    auto SameApp = false;
-
-    for (auto it = beg; it != end; ++it)
-    {
-        if (WI_IsFlagClear(it->Flags, CLE_ALLOCATED))
-        {
-            // use MRU history buffer with same app name
-            if (it->IsAppNameMatch(appName))
-            {
-                BestCandidate = it;
-                SameApp = true;
-                break;
-            }
-        }
-    }
+    // use MRU history buffer with same app name
+    auto BestCandidate = _FindMostRecent(appName, false);
+    const auto SameApp = BestCandidate != end;
+    const auto persist = gci.GetPersistHistory();
 
     // if there isn't a free buffer for the app name and the maximum number of
     // command history buffers hasn't been allocated, allocate a new one.
@@ -323,7 +707,17 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
         History.LastDisplayed = -1;
         History._maxCommands = gsl::narrow<Index>(gci.GetHistoryBufferSize());
         History._processHandle = processHandle;
-        return &s_historyLists.emplace_front(History);
+        History._lastUsed = ++s_useCounter;
+
+        auto folded = _FoldAppName(appName);
+        const auto it = s_historyLists.emplace(beg, std::move(History));
+        s_historiesByApp.emplace(std::move(folded), it);
+
+        if (persist)
+        {
+            _LoadPersisted(*it);
+        }
+        return &*it;
     }
 
     // If we have no candidate already and we need one,
@@ -348,16 +742,22 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     {
         if (!SameApp)
         {
-            BestCandidate->_commands.clear();
+            BestCandidate->_Clear();
             BestCandidate->LastDisplayed = -1;
-            BestCandidate->_appName = appName;
+            BestCandidate->_persistenceGeneration++;
+            _Rename(BestCandidate, appName);
         }
 
         BestCandidate->_processHandle = processHandle;
         WI_SetFlag(BestCandidate->Flags, CLE_ALLOCATED);
 
+        if (!SameApp && persist)
+        {
+            _LoadPersisted(*BestCandidate);
+        }
+
         // move to the front of the list
-        s_historyLists.splice(beg, s_historyLists, BestCandidate);
+        _MoveToFront(BestCandidate);
         return &*BestCandidate;
     }
 
@@ -412,8 +812,7 @@ std::wstring CommandHistory::Remove(const Index iDel)
         return {};
     }
 
-    const auto str = std::move(_commands.at(iDel));
-    _commands.erase(_commands.begin() + iDel);
+    auto str = _Erase(iDel);
 
     if (LastDisplayed == iDel)
     {
@@ -455,31 +854,55 @@ std::wstring CommandHistory::Remove(const Index iDel)
         return true;
     }
 
-    try
+    if (indexFound < 0 || indexFound >= GetNumberOfCommands())
     {
-        for (size_t i = 0; i < _commands.size(); i++)
+        return false;
+    }
+
+    // We're looking for the closest match at or before indexFound, wrapping around to the end of the history.
+    // Since IDs are ascending, that's the largest matching ID up to startId or failing that the largest one overall.
+    const auto startId = til::at(_ids, indexFound);
+    std::optional<Id> before;
+    std::optional<Id> wrapped;
+    const auto consider = [&](const std::vector<Id>& ids) {
+        if (const auto it = std::upper_bound(ids.begin(), ids.end(), startId); it != ids.begin())
         {
-            const auto& storedCommand = _commands.at(indexFound);
-            if ((WI_IsFlagClear(options, MatchOptions::ExactMatch) && (givenCommand.size() <= storedCommand.size())) || (givenCommand.size() == storedCommand.size()))
-            {
-                if (til::starts_with(storedCommand, givenCommand))
-                {
-                    return true;
-                }
-            }
+            before = std::max(before.value_or(0), *(it - 1));
+        }
+        wrapped = std::max(wrapped.value_or(0), ids.back());
+    };
 
-            _Prev(indexFound);
+    if (WI_IsFlagSet(options, MatchOptions::ExactMatch))
+    {
+        if (const auto it = _index.find(givenCommand); it != _index.end())
+        {
+            consider(it->second);
         }
     }
-    CATCH_LOG();
+    else
+    {
+        // All commands starting with givenCommand are sorted right after it.
+        for (auto it = _index.lower_bound(givenCommand); it != _index.end() && til::starts_with(it->first, givenCommand); ++it)
+        {
+            consider(it->second);
+        }
+    }
+
+    const auto found = before ? before : wrapped;
+    if (!found)
+    {
+        return false;
+    }
 
-    return false;
+    indexFound = gsl::narrow_cast<Index>(std::lower_bound(_ids.begin(), _ids.end(), *found) - _ids.begin());
+    return true;
 }
 
 #ifdef UNIT_TESTING
 void CommandHistory::s_ClearHistoryListStorage()
 {
     s_historyLists.clear();
+    s_historiesByApp.clear();
 }
 #endif
 
@@ -495,7 +918,67 @@ void CommandHistory::Swap(const Index indexA, const Index indexB)
         indexA >= 0 && indexA < num &&
         indexB >= 0 && indexB < num)
     {
-        std::swap(_commands.at(indexA), _commands.at(indexB));
+        auto& a = _commands.at(indexA);
+        auto& b = _commands.at(indexB);
+        const auto idA = _ids.at(indexA);
+        const auto idB = _ids.at(indexB);
+
+        _IndexErase(a, idA);
+        _IndexErase(b, idB);
+        std::swap(a, b);
+        _IndexInsert(a, idA);
+        _IndexInsert(b, idB);
+    }
+}
+
+void CommandHistory::_Clear()
+{
+    _commands.clear();
+    _ids.clear();
+    _index.clear();
+}
+
+void CommandHistory::_PushBack(std::wstring command)
+{
+    const auto id = _nextId++;
+    _IndexInsert(command, id);
+    _ids.emplace_back(id);
+    _commands.emplace_back(std::move(command));
+}
+
+std::wstring CommandHistory::_Erase(const Index index)
+{
+    auto& command = _commands.at(index);
+    _IndexErase(command, _ids.at(index));
+
+    auto str = std::move(command);
+    _ids.erase(_ids.begin() + index);
+    _commands.erase(_commands.begin() + index);
+    return str;
+}
+
+void CommandHistory::_IndexInsert(const std::wstring& command, const Id id)
+{
+    auto& ids = _index[command];
+    ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+}
+
+void CommandHistory::_IndexErase(const std::wstring& command, const Id id)
+{
+    const auto it = _index.find(command);
+    if (it == _index.end())
+    {
+        return;
+    }
+
+    auto& ids = it->second;
+    if (const auto pos = std::lower_bound(ids.begin(), ids.end(), id); pos != ids.end() && *pos == id)
+    {
+        ids.erase(pos);
+    }
+    if (ids.empty())
+    {
+        _index.erase(it);
     }
 }
 
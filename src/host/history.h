@@ -20,6 +20,7 @@ public:
     static void s_Free(const HANDLE processHandle);
     static void s_ResizeAll(const size_t commands);
     static size_t s_CountOfHistories();
+    static void s_WaitForPersistence();
 
     enum class MatchOptions
     {
@@ -62,8 +63,30 @@ public:
 
     void Swap(const Index indexA, const Index indexB);
 
+    [[nodiscard]] HRESULT Load(const std::wstring& path);
+    [[nodiscard]] HRESULT Save(const std::wstring& path);
+
 private:
+    using Id = uint64_t;
+    using AppIndex = std::unordered_multimap<std::wstring, std::list<CommandHistory>::iterator>;
+
+    static std::wstring _FoldAppName(const std::wstring_view appName);
+    static std::wstring _PersistencePath(const std::wstring_view appName);
+    static std::vector<std::wstring> _ReadPersisted(const std::wstring& path);
+    [[nodiscard]] static HRESULT _WritePersisted(const std::wstring& path, std::vector<std::wstring> unsaved, const Index maxCommands, const bool suppressDuplicates);
+    static std::list<CommandHistory>::iterator _FindMostRecent(const std::wstring_view appName, const bool allocated);
+    static void _MoveToFront(std::list<CommandHistory>::iterator it);
+    static void _Rename(std::list<CommandHistory>::iterator it, const std::wstring_view appName);
+    static void _LoadPersisted(CommandHistory& history) noexcept;
+    static void _SavePersisted(CommandHistory& history) noexcept;
+    [[nodiscard]] HRESULT _MergePersisted(const std::vector<std::wstring>& persisted);
+
     void _Reset();
+    void _Clear();
+    void _PushBack(std::wstring command);
+    std::wstring _Erase(const Index index);
+    void _IndexInsert(const std::wstring& command, const Id id);
+    void _IndexErase(const std::wstring& command, const Id id);
 
     // _Next and _Prev go to the next and prev command
     // _Inc  and _Dec go to the next and prev slots
@@ -78,10 +101,26 @@ private:
     std::vector<std::wstring> _commands;
     Index _maxCommands = 0;
 
+    // Every entry in _commands gets an ID that never changes and _ids stores them in the same order.
+    // As new commands are only ever appended, _ids is sorted and maps an ID back to its index in O(log n).
+    // _index in turn maps each distinct command to the sorted IDs of all entries holding it,
+    // which turns exact and prefix searches into tree lookups instead of scans over the entire history.
+    std::vector<Id> _ids;
+    std::map<std::wstring, std::vector<Id>, std::less<>> _index;
+    Id _nextId = 0;
+    // Entries with an ID of at least this value haven't been persisted with Save() yet.
+    Id _unsavedId = 0;
+    // Incremented whenever the history is handed to an app. Loads that are still in flight for a previous one are discarded.
+    uint64_t _persistenceGeneration = 0;
+
     std::wstring _appName;
     HANDLE _processHandle = nullptr;
+    uint64_t _lastUsed = 0;
 
     static std::list<CommandHistory> s_historyLists;
+    // Maps the case-folded app names to their entries in s_historyLists.
+    static AppIndex s_historiesByApp;
+    static uint64_t s_useCounter;
 
 public:
     DWORD Flags = 0;
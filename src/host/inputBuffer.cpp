@@ -9,6 +9,7 @@
 
 #include "misc.h"
 #include "stream.h"
+#include "../interactivity/inc/EventSynthesis.hpp"
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../types/inc/GlyphWidth.hpp"
 
@@ -163,42 +164,91 @@ void InputBuffer::Cache(std::wstring_view source)
     _cachedTextReaderW = std::wstring_view{ _cachedTextW }.substr(off);
 }
 
-// Moves up to `count`, previously cached events into `target`.
-size_t InputBuffer::ConsumeCached(bool isUnicode, size_t count, InputEventQueue& target)
+// Same as `Consume`, but the text is taken from the text segment (see WriteText()) at the front of the queue, if any.
+// Only characters that GetChar() would return as-is are consumed. Returns false if there weren't any.
+bool InputBuffer::ConsumeText(bool isUnicode, std::span<char>& target)
 {
-    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
-
-    size_t i = 0;
-
-    while (i < count && !_cachedInputEvents.empty())
+    // Every character results in at least 1 byte of output, so there's no point in looking at more than that.
+    const auto charSize = isUnicode ? sizeof(wchar_t) : sizeof(char);
+    auto text = _frontText(target.size() / charSize);
+    if (text.empty())
     {
-        target.push_back(std::move(_cachedInputEvents.front()));
-        _cachedInputEvents.pop_front();
-        i++;
+        return false;
     }
 
-    return i;
+    const auto sizeBefore = text.size();
+    Consume(isUnicode, text, target);
+    _consumeFrontText(sizeBefore - text.size());
+    return true;
 }
 
-// Copies up to `count`, previously cached events into `target`.
-size_t InputBuffer::PeekCached(bool isUnicode, size_t count, InputEventQueue& target)
+// Returns the dwControlKeyState of the key-down event that carries the character,
+// if the text segment expands it into key events (see _expandTextChar()).
+static DWORD TextCharKeyState(const wchar_t wch, const bool keystrokes) noexcept
 {
-    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
+    // Characters that aren't on the keyboard are typed with Alt+Numpad or without any modifiers.
+    // Either way GetChar() returns them with a dwControlKeyState of 0, just like WriteString() ones.
+    const auto keyState = keystrokes ? OneCoreSafeVkKeyScanW(wch) : -1;
+    if (keyState == -1)
+    {
+        return 0;
+    }
 
-    size_t i = 0;
+    // This matches SynthesizeKeyboardEvents().
+    const auto modifierState = HIBYTE(keyState);
+    DWORD controlKeyState = 0;
+    WI_SetFlagIf(controlKeyState, SHIFT_PRESSED, WI_IsFlagSet(modifierState, 1));
+    WI_SetFlagIf(controlKeyState, LEFT_CTRL_PRESSED, WI_IsFlagSet(modifierState, 2));
+    WI_SetFlagIf(controlKeyState, RIGHT_ALT_PRESSED, WI_IsFlagSet(modifierState, 4));
+    return controlKeyState;
+}
 
-    for (const auto& e : _cachedInputEvents)
+// A shortcut for GetChar(): If the next input is a character from a text segment (see WriteText())
+// that GetChar() would return as-is, it's returned without synthesizing key events for it first.
+// `keyState` receives the modifier keys that GetChar() would have reported for its key events.
+bool InputBuffer::ReadTextChar(wchar_t& wch, DWORD& keyState)
+{
+    // Read() returns previously cached events first.
+    _switchReadingMode(ReadingMode::InputEventsW);
+    if (!_cachedInputEvents.empty())
     {
-        if (i >= count)
-        {
-            break;
-        }
+        return false;
+    }
 
-        target.push_back(e);
-        i++;
+    const auto text = _frontText(1);
+    if (text.empty())
+    {
+        return false;
     }
 
-    return i;
+    wch = text.front();
+    keyState = TextCharKeyState(wch, _textSegments.front().keystrokes);
+    _consumeFrontText(1);
+    return true;
+}
+
+// Moves up to `count`, previously cached events into `target`.
+size_t InputBuffer::ConsumeCached(bool isUnicode, size_t count, InputEventQueue& target)
+{
+    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
+
+    const auto n = std::min(count, _cachedInputEvents.size());
+    const auto [a, b] = _cachedInputEvents.spans(0, n);
+    target.insert(target.end(), a.begin(), a.end());
+    target.insert(target.end(), b.begin(), b.end());
+    _cachedInputEvents.pop_front(n);
+    return n;
+}
+
+// Copies up to `count`, previously cached events into `target`.
+size_t InputBuffer::PeekCached(bool isUnicode, size_t count, InputEventQueue& target)
+{
+    _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
+
+    const auto [a, b] = _cachedInputEvents.spans(0, count);
+    target.insert(target.end(), a.begin(), a.end());
+    target.insert(target.end(), b.begin(), b.end());
+    return a.size() + b.size();
 }
 
 // Trims `source` to have a size below or equal to `expectedSourceSize` by
@@ -209,10 +259,7 @@ void InputBuffer::Cache(bool isUnicode, InputEventQueue& source, size_t expected
 
     if (source.size() > expectedSourceSize)
     {
-        _cachedInputEvents.insert(
-            _cachedInputEvents.end(),
-            std::make_move_iterator(source.begin() + expectedSourceSize),
-            std::make_move_iterator(source.end()));
+        _cachedInputEvents.append({ source.data() + expectedSourceSize, source.size() - expectedSourceSize });
         source.resize(expectedSourceSize);
     }
 }
@@ -233,11 +280,87 @@ void InputBuffer::_switchReadingModeSlowPath(ReadingMode mode)
     _cachedTextW = std::wstring{};
     _cachedTextReaderW = {};
 
-    _cachedInputEvents = std::deque<INPUT_RECORD>{};
+    _cachedInputEvents = til::ring_buffer<INPUT_RECORD>{};
 
     _readingMode = mode;
 }
 
+// A large paste can leave a correspondingly large allocation behind.
+// Once it's been consumed there's no point in holding onto it.
+void InputBuffer::_trimStorage()
+{
+    // 64K records are about 1.25MB.
+    static constexpr size_t retainCapacity = 64 * 1024;
+
+    if (_storage.empty() && _storage.capacity() > retainCapacity)
+    {
+        _storage.shrink_to_fit();
+    }
+}
+
+// Returns the index of the segment's placeholder record in _storage.
+size_t InputBuffer::_indexOf(const TextSegment& segment) const noexcept
+{
+    // This works even if _storageOffset wrapped around, since unsigned arithmetic is modular.
+    return segment.position - _storageOffset;
+}
+
+// Returns true for characters that GetChar() returns unmodified, no matter whether they were written with
+// WriteText() or WriteString(). Others, like escape and linefeed, depend on the kind of read and the input mode.
+static bool IsPlainTextChar(const wchar_t wch) noexcept
+{
+    return wch >= L' ' || wch == UNICODE_CARRIAGERETURN || wch == UNICODE_TAB;
+}
+
+// Returns up to `maxCount` characters from the text segment at the front of the queue that are plain text.
+std::wstring_view InputBuffer::_frontText(const size_t maxCount) const noexcept
+{
+    if (_textSegments.empty())
+    {
+        return {};
+    }
+
+    const auto& segment = _textSegments.front();
+    // If the key events of a character have been partially read, the rest of them must be read as key events as well.
+    if (_indexOf(segment) != 0 || segment.partialEvents != 0)
+    {
+        return {};
+    }
+
+    const std::wstring_view text{ segment.text };
+    const auto end = segment.offset + std::min(maxCount, text.size() - segment.offset);
+    auto it = segment.offset;
+    while (it < end && IsPlainTextChar(text[it]))
+    {
+        ++it;
+    }
+    return text.substr(segment.offset, it - segment.offset);
+}
+
+// Marks `count` characters returned by _frontText() as read.
+void InputBuffer::_consumeFrontText(const size_t count)
+{
+    auto& segment = _textSegments.front();
+    segment.offset += count;
+    // Subtracting the consumed characters from the cached count would mean counting them. It's cheaper to drop the
+    // cache and to count the remainder if GetNumberOfReadyEvents() is ever called, which ReadConsole() clients rarely do.
+    segment.events = 0;
+    segment.countedEnd = segment.offset;
+
+    if (segment.offset == segment.text.size())
+    {
+        _textSegments.pop_front();
+        _storage.pop_front();
+        _storageOffset++;
+        _trimStorage();
+    }
+
+    if (_storage.empty())
+    {
+        ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
+    }
+}
+
 // Routine Description:
 // - checks if any partial char data is available for writing
 // operation.
@@ -286,6 +409,8 @@ void InputBuffer::ReinitializeInputBuffer()
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
     InputMode = INPUT_BUFFER_DEFAULT_INPUT_MODE;
     _storage.clear();
+    _textSegments.clear();
+    _trimStorage();
 }
 
 // Routine Description:
@@ -318,9 +443,22 @@ void InputBuffer::TerminateRead(_In_ WaitTerminationReason Flag)
 // - The number of events currently in the input buffer.
 // Note:
 // - The console lock must be held when calling this routine.
-size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
+// - Text segments count with the number of key events they expand into when they're read.
+//   They're counted here, because only few clients ask, and the count is cached until the segment changes.
+size_t InputBuffer::GetNumberOfReadyEvents() const
 {
-    return _storage.size();
+    auto count = _storage.size();
+    for (const auto& segment : _textSegments)
+    {
+        if (segment.countedEnd < segment.text.size())
+        {
+            segment.events += _countKeyEvents(segment, std::wstring_view{ segment.text }.substr(segment.countedEnd));
+            segment.countedEnd = segment.text.size();
+        }
+        // The events replace the segment's placeholder record.
+        count += segment.events - 1;
+    }
+    return count;
 }
 
 // Routine Description:
@@ -334,6 +472,8 @@ size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
 void InputBuffer::Flush()
 {
     _storage.clear();
+    _textSegments.clear();
+    _trimStorage();
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
 }
 
@@ -347,10 +487,82 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const INPUT_RECORD& event) {
-        return event.EventType != KEY_EVENT;
+    // Text segments consist of key events and are retained. Their placeholder records
+    // are identified by their position and need to be moved along with them.
+    // (erase_if() visits the records in order, which is what makes the counting below work.)
+    auto segment = _textSegments.begin();
+    size_t index = 0;
+    size_t kept = 0;
+
+    _storage.erase_if([&](const INPUT_RECORD& event) {
+        auto remove = event.EventType != KEY_EVENT;
+
+        if (segment != _textSegments.end() && _indexOf(*segment) == index)
+        {
+            segment->position = _storageOffset + kept;
+            ++segment;
+            remove = false;
+        }
+
+        index++;
+        kept += !remove;
+        return remove;
     });
-    _storage.erase(newEnd, _storage.end());
+}
+
+// Returns true if Read() copies the given record to the client without any changes.
+// Key events are converted to the input codepage for ANSI reads and split by their repeat count for stream reads.
+static bool IsReturnedVerbatim(const INPUT_RECORD& record, const bool unicode, const bool stream) noexcept
+{
+    return record.EventType != KEY_EVENT || (unicode && (!stream || record.Event.KeyEvent.wRepeatCount == 1));
+}
+
+// Appends the key event to `OutEvents` the way Read() returns it: Split up by its repeat count
+// for stream reads and converted to the input codepage for ANSI reads.
+// Returns the part of the repeat count that didn't fit into `OutEvents`.
+static WORD AppendKeyEvent(InputEventQueue& OutEvents, INPUT_RECORD event, const size_t AmountToRead, const bool Unicode, const bool Stream, const UINT cp)
+{
+    WORD repeat = 1;
+
+    // for stream reads we need to split any key events that have been coalesced
+    if (Stream)
+    {
+        repeat = std::max<WORD>(1, event.Event.KeyEvent.wRepeatCount);
+        event.Event.KeyEvent.wRepeatCount = 1;
+    }
+
+    if (Unicode)
+    {
+        do
+        {
+            OutEvents.push_back(event);
+            repeat--;
+        } while (repeat > 0 && OutEvents.size() < AmountToRead);
+    }
+    else
+    {
+        const auto wch = event.Event.KeyEvent.uChar.UnicodeChar;
+
+        char buffer[8];
+        const auto length = WideCharToMultiByte(cp, 0, &wch, 1, &buffer[0], sizeof(buffer), nullptr, nullptr);
+        THROW_LAST_ERROR_IF(length <= 0);
+
+        const std::string_view str{ &buffer[0], gsl::narrow_cast<size_t>(length) };
+
+        do
+        {
+            for (const auto& ch : str)
+            {
+                // char is signed and assigning it to UnicodeChar would cause sign-extension.
+                // unsigned char doesn't have this problem.
+                event.Event.KeyEvent.uChar.UnicodeChar = std::bit_cast<uint8_t>(ch);
+                OutEvents.push_back(event);
+            }
+            repeat--;
+        } while (repeat > 0 && OutEvents.size() < AmountToRead);
+    }
+
+    return repeat;
 }
 
 // Routine Description:
@@ -360,7 +572,7 @@ void InputBuffer::FlushAllButKeys()
 // Note:
 // - The console lock must be held when calling this routine.
 // Arguments:
-// - OutEvents - deque to store the read events
+// - OutEvents - queue to store the read events
 // - AmountToRead - the amount of events to try to read
 // - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
 // - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
@@ -391,71 +603,71 @@ try
         ConsumeCached(Unicode, AmountToRead, OutEvents);
     }
 
-    auto it = _storage.begin();
-    const auto end = _storage.end();
+    const auto available = _storage.size();
+    size_t i = 0;
+    // The next text segment at or after index i.
+    auto segment = _textSegments.begin();
 
-    while (it != end && OutEvents.size() < AmountToRead)
+    while (i < available && OutEvents.size() < AmountToRead)
     {
-        if (it->EventType == KEY_EVENT)
-        {
-            auto event = *it;
-            WORD repeat = 1;
+        const auto segmentIndex = segment != _textSegments.end() ? _indexOf(*segment) : available;
 
-            // for stream reads we need to split any key events that have been coalesced
-            if (Stream)
+        if (segmentIndex == i)
+        {
+            if (!_readTextSegment(*segment, OutEvents, AmountToRead, Peek, Unicode, Stream, cp))
             {
-                repeat = std::max<WORD>(1, event.Event.KeyEvent.wRepeatCount);
-                event.Event.KeyEvent.wRepeatCount = 1;
+                break;
             }
+            ++segment;
+            ++i;
+            continue;
+        }
 
-            if (Unicode)
+        // Fast path: Consecutive records that are returned as-is get copied over in bulk.
+        // This is what makes reading back a large paste in one go fast.
+        {
+            const auto limit = std::min({ available, segmentIndex, i + (AmountToRead - OutEvents.size()) });
+            auto end = i;
+            while (end < limit && IsReturnedVerbatim(_storage[end], Unicode, Stream))
             {
-                do
-                {
-                    OutEvents.push_back(event);
-                    repeat--;
-                } while (repeat > 0 && OutEvents.size() < AmountToRead);
+                ++end;
             }
-            else
+            if (end != i)
             {
-                const auto wch = event.Event.KeyEvent.uChar.UnicodeChar;
-
-                char buffer[8];
-                const auto length = WideCharToMultiByte(cp, 0, &wch, 1, &buffer[0], sizeof(buffer), nullptr, nullptr);
-                THROW_LAST_ERROR_IF(length <= 0);
+                const auto [a, b] = _storage.spans(i, end - i);
+                OutEvents.insert(OutEvents.end(), a.begin(), a.end());
+                OutEvents.insert(OutEvents.end(), b.begin(), b.end());
+                i = end;
+                continue;
+            }
+        }
 
-                const std::string_view str{ &buffer[0], gsl::narrow_cast<size_t>(length) };
+        auto& record = _storage[i];
 
-                do
-                {
-                    for (const auto& ch : str)
-                    {
-                        // char is signed and assigning it to UnicodeChar would cause sign-extension.
-                        // unsigned char doesn't have this problem.
-                        event.Event.KeyEvent.uChar.UnicodeChar = std::bit_cast<uint8_t>(ch);
-                        OutEvents.push_back(event);
-                    }
-                    repeat--;
-                } while (repeat > 0 && OutEvents.size() < AmountToRead);
-            }
+        if (record.EventType == KEY_EVENT)
+        {
+            const auto repeat = AppendKeyEvent(OutEvents, record, AmountToRead, Unicode, Stream, cp);
 
             if (repeat && !Peek)
             {
-                it->Event.KeyEvent.wRepeatCount = repeat;
+                record.Event.KeyEvent.wRepeatCount = repeat;
                 break;
             }
         }
         else
         {
-            OutEvents.push_back(*it);
+            OutEvents.push_back(record);
         }
 
-        ++it;
+        ++i;
     }
 
     if (!Peek)
     {
-        _storage.erase(_storage.begin(), it);
+        _storage.pop_front(i);
+        _storageOffset += i;
+        _textSegments.erase(_textSegments.begin(), segment);
+        _trimStorage();
     }
 
     Cache(Unicode, OutEvents, AmountToRead);
@@ -496,17 +708,18 @@ size_t InputBuffer::Prepend(const std::span<const INPUT_RECORD>& inEvents)
         _vtInputShouldSuppress = true;
         auto resetVtInputSuppress = wil::scope_exit([&]() { _vtInputShouldSuppress = false; });
 
-        // read all of the records out of the buffer, then write the
-        // prepend ones, then write the original set. We need to do it
-        // this way to handle any coalescing that might occur.
+        // move all of the records out of the buffer, then write the
+        // prepend ones, then put the original set back behind them.
+        // We need to do it this way to handle any coalescing that might occur.
 
         // get all of the existing records, "emptying" the buffer
-        std::deque<INPUT_RECORD> existingStorage;
+        decltype(_storage) existingStorage;
         existingStorage.swap(_storage);
+        const auto wasEmpty = existingStorage.empty();
 
         // We will need this variable to pass to _WriteBuffer so it can attempt to determine wait status.
-        // However, because we swapped the storage out from under it with an empty deque, it will always
-        // return true after the first one (as it is filling the newly emptied backing deque.)
+        // However, because we swapped the storage out from under it with an empty buffer, it will always
+        // return true after the first one (as it is filling the newly emptied backing buffer.)
         // Then after the second one, because we've inserted some input, it will always say false.
         auto unusedWaitStatus = false;
 
@@ -515,10 +728,12 @@ size_t InputBuffer::Prepend(const std::span<const INPUT_RECORD>& inEvents)
         _WriteBuffer(inEvents, prependEventsWritten, unusedWaitStatus);
         FAIL_FAST_IF(!(unusedWaitStatus));
 
-        for (const auto& event : existingStorage)
-        {
-            _storage.push_back(event);
-        }
+        // The prepended records are usually few in number, so it's cheaper to
+        // insert them in front of the existing ones than the other way around.
+        // Moving the start of the storage back keeps the positions of the text segments intact.
+        _storageOffset -= _storage.size();
+        existingStorage.prepend(_storage);
+        _storage.swap(existingStorage);
 
         // We need to set the wait event if there were 0 events in the
         // input queue when we started.
@@ -527,7 +742,7 @@ size_t InputBuffer::Prepend(const std::span<const INPUT_RECORD>& inEvents)
         // and instead need to set the event if the original backing
         // buffer (the one we swapped out at the top) was empty
         // when this whole thing started.
-        if (existingStorage.empty())
+        if (wasEmpty)
         {
             ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
         }
@@ -600,6 +815,7 @@ size_t InputBuffer::Write(const std::span<const INPUT_RECORD>& inEvents)
     }
 }
 
+// Writes the text as if each character was a key-down event without a virtual key code, like VT input.
 void InputBuffer::WriteString(const std::wstring_view& text)
 try
 {
@@ -608,16 +824,37 @@ try
         return;
     }
 
-    const auto initiallyEmptyQueue = _storage.empty();
+    _writeTextSegment(text, false, 0);
+}
+CATCH_LOG()
 
-    _writeString(text);
+// Writes the text as if it was typed on the keyboard (see CharToKeyEvents()). This is what pastes use.
+// The `codepage` is used for characters that can only be typed with Alt+Numpad.
+void InputBuffer::WriteText(const std::wstring_view& text, const unsigned int codepage)
+try
+{
+    if (text.empty())
+    {
+        return;
+    }
 
-    if (initiallyEmptyQueue && !_storage.empty())
+    // Translating keys to VT sequences, pausing output with Ctrl+S and resuming
+    // it with any key press happen in _WriteBuffer() and need key events.
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    if (IsInVirtualTerminalInputMode() ||
+        WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) ||
+        (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && text.find(L'\x13') != std::wstring_view::npos))
     {
-        ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+        InputEventQueue events;
+        for (const auto& wch : text)
+        {
+            Interactivity::CharToKeyEvents(wch, codepage, events);
+        }
+        Write(events);
+        return;
     }
 
-    WakeUpReadersWaitingForData();
+    _writeTextSegment(text, true, codepage);
 }
 CATCH_LOG()
 
@@ -713,19 +950,32 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
     const auto initialInEventsSize = inEvents.size();
     const auto vtInputMode = IsInVirtualTerminalInputMode();
 
-    for (const auto& inEvent : inEvents)
+    // Events that are stored as-is are gathered into runs which are then appended in bulk.
+    // Pastes can consist of hundreds of thousands of events and this avoids handling them one by one.
+    size_t runBeg = 0;
+    const auto flushRun = [&](size_t runEnd) {
+        _storage.append(inEvents.subspan(runBeg, runEnd - runBeg));
+        eventsWritten += runEnd - runBeg;
+        runBeg = runEnd + 1;
+    };
+
+    for (size_t i = 0; i < inEvents.size(); ++i)
     {
+        const auto& inEvent = inEvents[i];
+
         if (inEvent.EventType == KEY_EVENT && inEvent.Event.KeyEvent.bKeyDown)
         {
             // if output is suspended, any keyboard input releases it.
             if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) && !IsSystemKey(inEvent.Event.KeyEvent.wVirtualKeyCode))
             {
+                flushRun(i);
                 UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
                 continue;
             }
             // intercept control-s
             if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && IsPauseKey(inEvent.Event.KeyEvent))
             {
+                flushRun(i);
                 WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
                 continue;
             }
@@ -740,6 +990,7 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
             // GH#11682: TerminalInput::HandleKey can handle both KeyEvents and Focus events seamlessly
             if (const auto out = _termInput.HandleKey(inEvent))
             {
+                flushRun(i);
                 _HandleTerminalInputCallback(*out);
                 eventsWritten++;
                 continue;
@@ -757,9 +1008,10 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
         }
 
         // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(inEvent);
-        ++eventsWritten;
+        // It'll be stored as part of the current run.
     }
+    flushRun(inEvents.size());
+
     if (initiallyEmptyQueue && !_storage.empty())
     {
         setWaitEvent = true;
@@ -861,23 +1113,156 @@ void InputBuffer::_HandleTerminalInputCallback(const TerminalInput::StringType&
     }
 }
 
+static INPUT_RECORD SynthesizeStringKeyEvent(const wchar_t wch)
+{
+    if (wch == UNICODE_NULL)
+    {
+        // Convert null byte back to input event with proper control state
+        const auto zeroKey = OneCoreSafeVkKeyScanW(0);
+        uint32_t ctrlState = 0;
+        WI_SetFlagIf(ctrlState, SHIFT_PRESSED, WI_IsFlagSet(zeroKey, 0x100));
+        WI_SetFlagIf(ctrlState, LEFT_CTRL_PRESSED, WI_IsFlagSet(zeroKey, 0x200));
+        WI_SetFlagIf(ctrlState, LEFT_ALT_PRESSED, WI_IsFlagSet(zeroKey, 0x400));
+        return SynthesizeKeyEvent(true, 1, LOBYTE(zeroKey), 0, wch, ctrlState);
+    }
+    return SynthesizeKeyEvent(true, 1, 0, 0, wch, 0);
+}
+
 void InputBuffer::_writeString(const std::wstring_view& text)
 {
+    _storage.reserve(_storage.size() + text.size());
+
     for (const auto& wch : text)
     {
-        if (wch == UNICODE_NULL)
+        _storage.push_back(SynthesizeStringKeyEvent(wch));
+    }
+}
+
+void InputBuffer::_writeTextSegment(const std::wstring_view& text, const bool keystrokes, const unsigned int codepage)
+{
+    const auto initiallyEmptyQueue = _storage.empty();
+
+    // Consecutive writes of the same kind get merged. ConPTY for instance receives large pastes in chunks of a few KB.
+    auto merge = false;
+    if (!_textSegments.empty())
+    {
+        const auto& last = _textSegments.back();
+        merge = _indexOf(last) == _storage.size() - 1 && last.keystrokes == keystrokes && last.codepage == codepage;
+    }
+
+    if (merge)
+    {
+        auto& last = _textSegments.back();
+        // The appended text gets counted by GetNumberOfReadyEvents(), since `countedEnd` didn't move.
+        last.text.append(text);
+    }
+    else
+    {
+        _storage.reserve(_storage.size() + 1);
+        auto& segment = _textSegments.emplace_back(TextSegment{
+            .text = std::wstring{ text },
+            .position = _storageOffset + _storage.size(),
+            .keystrokes = keystrokes,
+            .codepage = codepage,
+        });
+        // The placeholder isn't a KEY_EVENT or MOUSE_EVENT, so that _CoalesceEvent() leaves it alone.
+        _storage.push_back(INPUT_RECORD{});
+    }
+
+    if (initiallyEmptyQueue)
+    {
+        ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+    }
+
+    WakeUpReadersWaitingForData();
+}
+
+// Expands the text segment into key events and appends them to `OutEvents` until it holds `AmountToRead` events.
+// Returns true if the segment has been read entirely, at which point its placeholder record can be removed.
+bool InputBuffer::_readTextSegment(TextSegment& segment, InputEventQueue& OutEvents, const size_t AmountToRead, const bool Peek, const bool Unicode, const bool Stream, const UINT cp)
+{
+    InputEventQueue events;
+    auto offset = segment.offset;
+    auto partialEvents = segment.partialEvents;
+    size_t readEvents = 0;
+
+    while (offset < segment.text.size() && OutEvents.size() < AmountToRead)
+    {
+        events.clear();
+        _expandTextChar(segment, segment.text[offset], events);
+
+        for (; partialEvents < events.size() && OutEvents.size() < AmountToRead; ++partialEvents, ++readEvents)
         {
-            // Convert null byte back to input event with proper control state
-            const auto zeroKey = OneCoreSafeVkKeyScanW(0);
-            uint32_t ctrlState = 0;
-            WI_SetFlagIf(ctrlState, SHIFT_PRESSED, WI_IsFlagSet(zeroKey, 0x100));
-            WI_SetFlagIf(ctrlState, LEFT_CTRL_PRESSED, WI_IsFlagSet(zeroKey, 0x200));
-            WI_SetFlagIf(ctrlState, LEFT_ALT_PRESSED, WI_IsFlagSet(zeroKey, 0x400));
-            _storage.push_back(SynthesizeKeyEvent(true, 1, LOBYTE(zeroKey), 0, wch, ctrlState));
-            continue;
+            AppendKeyEvent(OutEvents, events[partialEvents], AmountToRead, Unicode, Stream, cp);
+        }
+
+        if (partialEvents < events.size())
+        {
+            break;
+        }
+
+        partialEvents = 0;
+        ++offset;
+    }
+
+    if (!Peek)
+    {
+        segment.offset = offset;
+        segment.partialEvents = partialEvents;
+
+        // Keep the cached count (see GetNumberOfReadyEvents()) if it covers all the events we've just read.
+        // Otherwise it restarts at the current position, where we already know how many events text[offset] has left.
+        if (segment.countedEnd >= offset + (partialEvents != 0))
+        {
+            segment.events -= readEvents;
         }
-        _storage.push_back(SynthesizeKeyEvent(true, 1, 0, 0, wch, 0));
+        else if (partialEvents != 0)
+        {
+            segment.events = events.size() - partialEvents;
+            segment.countedEnd = offset + 1;
+        }
+        else
+        {
+            segment.events = 0;
+            segment.countedEnd = offset;
+        }
+    }
+
+    return offset == segment.text.size();
+}
+
+// Expands a character of the text segment into the key events that a read returns for it.
+void InputBuffer::_expandTextChar(const TextSegment& segment, const wchar_t wch, InputEventQueue& events)
+{
+    if (segment.keystrokes)
+    {
+        Interactivity::CharToKeyEvents(wch, segment.codepage, events);
+    }
+    else
+    {
+        events.push_back(SynthesizeStringKeyEvent(wch));
+    }
+}
+
+// Returns the number of key events that the given characters of the text segment expand into.
+// Depending on the keyboard layout, a character may take anything from a single key press
+// to typing its code with Alt+Numpad, which is why it's counted with the same expansion.
+size_t InputBuffer::_countKeyEvents(const TextSegment& segment, const std::wstring_view text)
+{
+    if (!segment.keystrokes)
+    {
+        return text.size();
+    }
+
+    InputEventQueue events;
+    size_t count = 0;
+    for (const auto wch : text)
+    {
+        events.clear();
+        _expandTextChar(segment, wch, events);
+        count += events.size();
     }
+    return count;
 }
 
 TerminalInput& InputBuffer::GetTerminalInput()
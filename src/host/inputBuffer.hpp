@@ -10,7 +10,7 @@
 #include "../server/ObjectHeader.h"
 #include "../terminal/input/terminalInput.hpp"
 
-#include <deque>
+#include <til/ring_buffer.h>
 
 namespace Microsoft::Console::Render
 {
@@ -30,6 +30,8 @@ public:
     void Consume(bool isUnicode, std::wstring_view& source, std::span<char>& target);
     void ConsumeCached(bool isUnicode, std::span<char>& target);
     void Cache(std::wstring_view source);
+    bool ConsumeText(bool isUnicode, std::span<char>& target);
+    bool ReadTextChar(wchar_t& wch, DWORD& keyState);
     // INPUT_RECORD oriented APIs
     size_t ConsumeCached(bool isUnicode, size_t count, InputEventQueue& target);
     size_t PeekCached(bool isUnicode, size_t count, InputEventQueue& target);
@@ -43,7 +45,7 @@ public:
     void ReinitializeInputBuffer();
     void WakeUpReadersWaitingForData();
     void TerminateRead(_In_ WaitTerminationReason Flag);
-    size_t GetNumberOfReadyEvents() const noexcept;
+    size_t GetNumberOfReadyEvents() const;
     void Flush();
     void FlushAllButKeys();
 
@@ -58,6 +60,7 @@ public:
     size_t Write(const INPUT_RECORD& inEvent);
     size_t Write(const std::span<const INPUT_RECORD>& inEvents);
     void WriteString(const std::wstring_view& text);
+    void WriteText(const std::wstring_view& text, unsigned int codepage);
     void WriteFocusEvent(bool focused) noexcept;
     bool WriteMouseEvent(til::point position, unsigned int button, short keyState, short wheelDelta);
 
@@ -73,14 +76,41 @@ private:
         InputEventsW,
     };
 
+    // Text written with WriteString() or WriteText() is stored as-is, because synthesizing key events for every
+    // character is expensive and pointless for ReadConsole(), which only wants the text back anyway. Each segment
+    // occupies a placeholder record in _storage, which retains its place in line relative to other events,
+    // and it only gets expanded into key events if it's read with ReadConsoleInput().
+    struct TextSegment
+    {
+        std::wstring text;
+        // The position of the placeholder record (see _storageOffset).
+        size_t position = 0;
+        // The number of characters in `text` that have been read.
+        size_t offset = 0;
+        // The number of key events of text[offset] that have been read.
+        size_t partialEvents = 0;
+        // Counting key events means expanding every character, so it's only done when GetNumberOfReadyEvents() is
+        // called and cached: `events` is the number of unread key events that text[offset, countedEnd) expands into.
+        mutable size_t events = 0;
+        mutable size_t countedEnd = 0;
+        // WriteText() segments expand into key presses as if typed (CharToKeyEvents),
+        // WriteString() segments into a key-down event per character.
+        bool keystrokes = false;
+        unsigned int codepage = 0;
+    };
+
     std::string _cachedTextA;
     std::string_view _cachedTextReaderA;
     std::wstring _cachedTextW;
     std::wstring_view _cachedTextReaderW;
-    std::deque<INPUT_RECORD> _cachedInputEvents;
+    til::ring_buffer<INPUT_RECORD> _cachedInputEvents;
     ReadingMode _readingMode = ReadingMode::StringA;
 
-    std::deque<INPUT_RECORD> _storage;
+    til::ring_buffer<INPUT_RECORD> _storage;
+    // The number of records that have been removed from the front of _storage over its lifetime, or in other words
+    // the position of _storage[0] in the stream of input. Unlike indices it doesn't change when records get read.
+    size_t _storageOffset = 0;
+    std::deque<TextSegment> _textSegments;
     INPUT_RECORD _writePartialByteSequence{};
     bool _writePartialByteSequenceAvailable = false;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
@@ -93,6 +123,14 @@ private:
 
     void _switchReadingMode(ReadingMode mode);
     void _switchReadingModeSlowPath(ReadingMode mode);
+    void _trimStorage();
+    size_t _indexOf(const TextSegment& segment) const noexcept;
+    std::wstring_view _frontText(size_t maxCount) const noexcept;
+    void _consumeFrontText(size_t count);
+    void _writeTextSegment(const std::wstring_view& text, bool keystrokes, unsigned int codepage);
+    bool _readTextSegment(TextSegment& segment, InputEventQueue& OutEvents, size_t AmountToRead, bool Peek, bool Unicode, bool Stream, UINT cp);
+    static void _expandTextChar(const TextSegment& segment, wchar_t wch, InputEventQueue& events);
+    static size_t _countKeyEvents(const TextSegment& segment, std::wstring_view text);
     void _WriteBuffer(const std::span<const INPUT_RECORD>& inRecords, _Out_ size_t& eventsWritten, _Out_ bool& setWaitEvent);
     bool _CoalesceEvent(const INPUT_RECORD& inEvent) noexcept;
     void _HandleTerminalInputCallback(const Microsoft::Console::VirtualTerminal::TerminalInput::StringType& text);
@@ -8,6 +8,7 @@
 #include "handle.h"
 
 #include "getset.h"
+#include "history.h"
 #include "misc.h"
 
 #include "../interactivity/inc/ServiceLocator.hpp"
@@ -480,6 +481,7 @@ void CloseConsoleProcessState()
     //      when it's created suspended and never resumed.
     if (gci.ProcessHandleList.IsEmpty())
     {
+        CommandHistory::s_WaitForPersistence();
         ServiceLocator::RundownAndExit(STATUS_SUCCESS);
     }
 
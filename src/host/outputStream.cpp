@@ -279,15 +279,16 @@ void ConhostInternalGetSet::SetWorkingDirectory(const std::wstring_view /*uri*/)
 // - true if successful. false otherwise.
 void ConhostInternalGetSet::PlayMidiNote(const int noteNumber, const int velocity, const std::chrono::microseconds duration)
 {
-    // Unlock the console, so the UI doesn't hang while we're busy.
-    UnlockConsole();
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    // Unlock the console, so the UI doesn't hang while we're busy. The lock is suspended instead of
+    // just unlocked, because the IO thread may hold it across a batch of API calls (see IoSorter).
+    const auto suspension = gci.SuspendLock();
 
     // This call will block for the duration, unless shutdown early.
     const auto windowHandle = ServiceLocator::LocateConsoleWindow()->GetWindowHandle();
-    auto& midiAudio = ServiceLocator::LocateGlobals().getConsoleInformation().GetMidiAudio();
+    auto& midiAudio = gci.GetMidiAudio();
     midiAudio.PlayNote(windowHandle, noteNumber, velocity, std::chrono::duration_cast<std::chrono::milliseconds>(duration));
-
-    LockConsole();
 }
 
 // Routine Description:
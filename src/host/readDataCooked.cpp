@@ -69,6 +69,11 @@ bool COOKED_READ_DATA::BufferState::IsClean() const noexcept
     return _dirtyBeg == npos;
 }
 
+size_t COOKED_READ_DATA::BufferState::GetDirtyPosition() const noexcept
+{
+    return _dirtyBeg;
+}
+
 void COOKED_READ_DATA::BufferState::MarkEverythingDirty() noexcept
 {
     _dirtyBeg = 0;
@@ -79,16 +84,6 @@ void COOKED_READ_DATA::BufferState::MarkAsClean() noexcept
     _dirtyBeg = npos;
 }
 
-std::wstring_view COOKED_READ_DATA::BufferState::GetUnmodifiedTextBeforeCursor() const noexcept
-{
-    return _slice(0, std::min(_dirtyBeg, _cursor));
-}
-
-std::wstring_view COOKED_READ_DATA::BufferState::GetUnmodifiedTextAfterCursor() const noexcept
-{
-    return _slice(_cursor, _dirtyBeg);
-}
-
 std::wstring_view COOKED_READ_DATA::BufferState::GetModifiedTextBeforeCursor() const noexcept
 {
     return _slice(_dirtyBeg, _cursor);
@@ -802,6 +797,8 @@ void COOKED_READ_DATA::_transitionState(State state) noexcept
 // By using _buffer._dirtyBeg to avoid redrawing the buffer unless needed, we turn the amortized
 // time complexity of _readCharInputLoop() from O(n^2) (n(n+1)/2 redraws) into O(n).
 // Pasting text would quickly turn into "accidentally quadratic" meme material otherwise.
+// Similarly, _columnCache avoids measuring the unmodified text before _buffer._dirtyBeg
+// over and over again, which makes typing and moving the cursor independent of the prompt length.
 //
 // NOTE: Don't call _flushBuffer() after appending newlines to the buffer! See _handlePostCharInputLoop for more information.
 void COOKED_READ_DATA::_flushBuffer()
@@ -823,29 +820,22 @@ void COOKED_READ_DATA::_flushBuffer()
     // This results in 2*2 = 4 writes of which always at least one of the middle two is empty,
     // depending on whether _buffer._cursor > _buffer._dirtyBeg or _buffer._cursor < _buffer._dirtyBeg.
     // slice() returns an empty string-view when `from` index is greater than the `to` index.
+    //
+    // The two unmodified parts aren't written, but we need to know how many columns they occupy.
 
-    ptrdiff_t distanceBeforeCursor = 0;
-    ptrdiff_t distanceAfterCursor = 0;
-    {
-        // _distanceCursor might be larger than the entire viewport (= a really long input line).
-        // _offsetCursorPosition() with such an offset will end up clamping the cursor position to (0,0).
-        // To make this implementation behave a little bit more consistent in this case without
-        // writing a more thorough and complex readline implementation, we pass _measureChars()
-        // the relative "distance" to the current actual cursor position. That way _measureChars()
-        // can still figure out what the logical cursor position is, when it handles tabs, etc.
-        auto dirtyBegDistance = -_distanceCursor;
-
-        distanceBeforeCursor = _measureChars(_buffer.GetUnmodifiedTextBeforeCursor(), dirtyBegDistance);
-        dirtyBegDistance += distanceBeforeCursor;
-        distanceAfterCursor = _measureChars(_buffer.GetUnmodifiedTextAfterCursor(), dirtyBegDistance);
-        dirtyBegDistance += distanceAfterCursor;
-
-        _offsetCursorPosition(dirtyBegDistance);
-    }
+    const auto dirtyBeg = std::min(_buffer.GetDirtyPosition(), _buffer.Get().size());
+    const auto cursor = _buffer.GetCursorPosition();
+
+    // The text before dirtyBeg is unchanged and so are the columns it occupies, but nothing past it.
+    _columnCache.erase(std::upper_bound(_columnCache.begin(), _columnCache.end(), dirtyBeg, [](size_t offset, const ColumnCheckpoint& c) { return offset < c.offset; }), _columnCache.end());
+
+    auto distanceBeforeCursor = _distanceAt(std::min(cursor, dirtyBeg));
+    auto distanceAfterCursor = _distanceAt(dirtyBeg) - distanceBeforeCursor;
+    _offsetCursorPosition(distanceBeforeCursor + distanceAfterCursor - _distanceCursor);
 
     // Now we can finally write the parts of _buffer that have actually changed (or moved).
-    distanceBeforeCursor += _writeChars(_buffer.GetModifiedTextBeforeCursor());
-    distanceAfterCursor += _writeChars(_buffer.GetModifiedTextAfterCursor());
+    distanceBeforeCursor += _writeCharsCached(_buffer.GetModifiedTextBeforeCursor(), distanceBeforeCursor + distanceAfterCursor);
+    distanceAfterCursor += _writeCharsCached(_buffer.GetModifiedTextAfterCursor(), distanceBeforeCursor + distanceAfterCursor);
 
     const auto distanceEnd = distanceBeforeCursor + distanceAfterCursor;
     const auto eraseDistance = std::max<ptrdiff_t>(0, _distanceEnd - distanceEnd);
@@ -860,6 +850,71 @@ void COOKED_READ_DATA::_flushBuffer()
     _distanceEnd = distanceEnd;
 }
 
+// Returns the distance in columns between the start of the prompt and the given offset into _buffer,
+// which must not be past the dirty position. Only the text since the closest cached checkpoint is measured.
+ptrdiff_t COOKED_READ_DATA::_distanceAt(size_t offset)
+{
+    ColumnCheckpoint checkpoint;
+    if (const auto it = std::upper_bound(_columnCache.begin(), _columnCache.end(), offset, [](size_t off, const ColumnCheckpoint& c) { return off < c.offset; }); it != _columnCache.begin())
+    {
+        checkpoint = *(it - 1);
+    }
+
+    if (checkpoint.offset == offset)
+    {
+        return checkpoint.distance;
+    }
+
+    // _distanceCursor might be larger than the entire viewport (= a really long input line).
+    // _offsetCursorPosition() with such an offset will end up clamping the cursor position to (0,0).
+    // To make this implementation behave a little bit more consistent in this case without
+    // writing a more thorough and complex readline implementation, we pass _measureChars()
+    // the relative "distance" to the current actual cursor position. That way _measureChars()
+    // can still figure out what the logical cursor position is, when it handles tabs, etc.
+    const auto text = std::wstring_view{ _buffer.Get() }.substr(checkpoint.offset, offset - checkpoint.offset);
+    const auto distance = checkpoint.distance + _measureChars(text, checkpoint.distance - _distanceCursor);
+
+    _cacheColumns(offset, distance);
+    return distance;
+}
+
+// Like _writeChars(), but `text` must be a slice of _buffer that starts `distance` columns past the start of the prompt.
+// Long text is written in chunks, and the columns at each chunk boundary are cached for future _distanceAt() calls.
+ptrdiff_t COOKED_READ_DATA::_writeCharsCached(const std::wstring_view& text, ptrdiff_t distance)
+{
+    const auto offset = gsl::narrow_cast<size_t>(text.data() - _buffer.Get().data());
+    const auto beg = distance;
+
+    for (size_t pos = 0; pos < text.size();)
+    {
+        auto next = text.size();
+        if (next - pos > ColumnCacheInterval)
+        {
+            // Chunks must end on a grapheme cluster boundary, or we'd split up clusters on the screen.
+            next = TextBuffer::GraphemeNext(text, TextBuffer::GraphemePrev(text, pos + ColumnCacheInterval));
+            if (next <= pos)
+            {
+                next = text.size();
+            }
+        }
+
+        distance += _writeChars(text.substr(pos, next - pos));
+        pos = next;
+        _cacheColumns(offset + pos, distance);
+    }
+
+    return distance - beg;
+}
+
+void COOKED_READ_DATA::_cacheColumns(size_t offset, ptrdiff_t distance)
+{
+    const auto it = std::lower_bound(_columnCache.begin(), _columnCache.end(), offset, [](const ColumnCheckpoint& c, size_t off) { return c.offset < off; });
+    if (it == _columnCache.end() || it->offset != offset)
+    {
+        _columnCache.insert(it, { offset, distance });
+    }
+}
+
 // This is just a small helper to fill the next N cells starting at the current cursor position with whitespace.
 void COOKED_READ_DATA::_erase(ptrdiff_t distance) const
 {
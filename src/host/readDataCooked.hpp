@@ -41,6 +41,8 @@ public:
 private:
     static constexpr uint8_t CommandNumberMaxInputLength = 5;
     static constexpr size_t npos = static_cast<size_t>(-1);
+    // _flushBuffer() writes text in chunks of about this many characters and caches the columns at each chunk boundary.
+    static constexpr size_t ColumnCacheInterval = 256;
 
     enum class State : uint8_t
     {
@@ -65,11 +67,10 @@ private:
         void SetCursorPosition(size_t pos) noexcept;
 
         bool IsClean() const noexcept;
+        size_t GetDirtyPosition() const noexcept;
         void MarkEverythingDirty() noexcept;
         void MarkAsClean() noexcept;
 
-        std::wstring_view GetUnmodifiedTextBeforeCursor() const noexcept;
-        std::wstring_view GetUnmodifiedTextAfterCursor() const noexcept;
         std::wstring_view GetModifiedTextBeforeCursor() const noexcept;
         std::wstring_view GetModifiedTextAfterCursor() const noexcept;
 
@@ -143,6 +144,13 @@ private:
         };
     };
 
+    // The distance in columns between the start of the prompt and an offset into _buffer.
+    struct ColumnCheckpoint
+    {
+        size_t offset = 0;
+        ptrdiff_t distance = 0;
+    };
+
     static size_t _wordPrev(const std::wstring_view& chars, size_t position);
     static size_t _wordNext(const std::wstring_view& chars, size_t position);
 
@@ -152,6 +160,9 @@ private:
     void _handlePostCharInputLoop(bool isUnicode, size_t& numBytes, ULONG& controlKeyState);
     void _transitionState(State state) noexcept;
     void _flushBuffer();
+    ptrdiff_t _distanceAt(size_t offset);
+    ptrdiff_t _writeCharsCached(const std::wstring_view& text, ptrdiff_t distance);
+    void _cacheColumns(size_t offset, ptrdiff_t distance);
     void _erase(ptrdiff_t distance) const;
     ptrdiff_t _measureChars(const std::wstring_view& text, ptrdiff_t cursorOffset) const;
     ptrdiff_t _writeChars(const std::wstring_view& text) const;
@@ -189,8 +200,16 @@ private:
     // _distanceEnd is the distance between the start of the prompt and its last
     // glyph at the end in columns (including wide glyph padding columns).
     ptrdiff_t _distanceEnd = 0;
+    // Checkpoints sorted by offset, which are valid up to the dirty position of _buffer, because the
+    // text before it hasn't changed. It allows _flushBuffer() to skip measuring the entire prompt
+    // up to the edit, which would make every keystroke cost O(n) for long lines otherwise.
+    std::vector<ColumnCheckpoint> _columnCache;
     bool _insertMode = false;
     State _state = State::Accumulating;
 
     std::vector<Popup> _popups;
+
+#ifdef UNIT_TESTING
+    friend class CookedReadTests;
+#endif
 };
@@ -781,3 +781,8 @@ bool Settings::GetEnableBuiltinGlyphs() const noexcept
 {
     return _fEnableBuiltinGlyphs;
 }
+
+bool Settings::GetPersistHistory() const noexcept
+{
+    return _fPersistHistory;
+}
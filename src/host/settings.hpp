@@ -172,6 +172,7 @@ public:
     bool GetUseDx() const noexcept;
     bool GetCopyColor() const noexcept;
     bool GetEnableBuiltinGlyphs() const noexcept;
+    bool GetPersistHistory() const noexcept;
 
 private:
     RenderSettings _renderSettings;
@@ -216,6 +217,7 @@ private:
     bool _fUseDx;
     bool _fCopyColor;
     bool _fEnableBuiltinGlyphs = true;
+    bool _fPersistHistory = false; // should command histories be saved to disk and survive closing the console?
 
     // this is used for the special STARTF_USESIZE mode.
     bool _fUseWindowSizePixels;
@@ -17,6 +17,7 @@
 #include "../server/DeviceHandle.h"
 #include "../server/Entrypoints.h"
 #include "../server/IoSorter.h"
+#include "../server/OutputWorker.h"
 
 #include "../interactivity/inc/ISystemConfigurationProvider.hpp"
 #include "../interactivity/inc/ServiceLocator.hpp"
@@ -998,18 +999,34 @@ PWSTR TranslateConsoleTitle(_In_ PCWSTR pwszConsoleTitle, const BOOL fUnexpand,
 // Routine Description:
 // - This routine is the main one in the console server IO thread.
 // - It reads IO requests submitted by clients through the driver, services and completes them in a loop.
+// - Transports that support it hand us several messages at once, which are then serviced as a batch.
+// - Output is processed on a separate worker thread, so that one client writing lots of output doesn't hold up the others.
 // Arguments:
 // - lpParameter - PCONSOLE_API_MSG being handed off to us from the previous I/O.
 // Return Value:
 // - This routine never returns. The process exits when no more references or clients exist.
 DWORD WINAPI ConsoleIoThread(LPVOID lpParameter)
 {
+    // The upper limit of messages serviced under a single acquisition of the console lock.
+    // It's kept small so that the renderer and input threads don't wait for too long.
+    static constexpr size_t maxBatchSize = 16;
+    // The upper limit of messages queued up for the output worker, before we stop reading new ones.
+    static constexpr uint32_t maxQueuedOutput = 64;
+
     auto& globals = ServiceLocator::LocateGlobals();
+    OutputWorker outputWorker{ maxQueuedOutput };
 
-    CONSOLE_API_MSG ReceiveMsg;
-    ReceiveMsg._pApiRoutines = globals.api;
-    ReceiveMsg._pDeviceComm = globals.pDeviceComm;
-    PCONSOLE_API_MSG ReplyMsg = nullptr;
+    // CONSOLE_API_MSG isn't movable, which is why this isn't a std::vector.
+    const auto storage = std::make_unique<CONSOLE_API_MSG[]>(maxBatchSize);
+    const std::span messages{ storage.get(), maxBatchSize };
+    for (auto& message : messages)
+    {
+        message._pApiRoutines = globals.api;
+        message._pDeviceComm = globals.pDeviceComm;
+    }
+
+    std::vector<PCONSOLE_API_MSG> replies;
+    replies.reserve(maxBatchSize);
 
     // If we were given a message on startup, process that in our context and then continue with the IO loop normally.
     if (lpParameter)
@@ -1018,38 +1035,26 @@ DWORD WINAPI ConsoleIoThread(LPVOID lpParameter)
         // free the heap memory when we're done getting the important bits out of it below.
         std::unique_ptr<CONSOLE_API_MSG> capturedMessage{ static_cast<PCONSOLE_API_MSG>(lpParameter) };
 
-        ReceiveMsg = *capturedMessage.get();
-        ReceiveMsg._pApiRoutines = globals.api;
-        ReceiveMsg._pDeviceComm = globals.pDeviceComm;
-        IoSorter::ServiceIoOperation(&ReceiveMsg, &ReplyMsg);
+        messages[0] = *capturedMessage.get();
+        messages[0]._pApiRoutines = globals.api;
+        messages[0]._pDeviceComm = globals.pDeviceComm;
+        IoSorter::ServiceIoBatch(messages.first(1), replies, &outputWorker);
     }
 
-    auto fShouldExit = false;
-    while (!fShouldExit)
+    for (;;)
     {
-        if (ReplyMsg != nullptr)
-        {
-            LOG_IF_FAILED(ReplyMsg->ReleaseMessageBuffers());
-        }
-
         // TODO: 9115192 correct mixed NTSTATUS/HRESULT
-        auto hr = ServiceLocator::LocateGlobals().pDeviceComm->ReadIo(ReplyMsg, &ReceiveMsg);
+        const auto hr = IoSorter::ServiceNextIoBatch(*globals.pDeviceComm, messages, replies, &outputWorker);
         if (FAILED(hr))
         {
             if (hr == HRESULT_FROM_WIN32(ERROR_PIPE_NOT_CONNECTED))
             {
-                fShouldExit = true;
-
+                // The last clients may have just detached, so their histories may still be on the way to the disk.
+                CommandHistory::s_WaitForPersistence();
                 // This will not return. Terminate immediately when disconnected.
                 ServiceLocator::RundownAndExit(STATUS_SUCCESS);
             }
             LOG_HR_MSG(hr, "DeviceIoControl failed");
-            ReplyMsg = nullptr;
-            continue;
         }
-        ReceiveMsg._pApiRoutines = globals.api;
-        IoSorter::ServiceIoOperation(&ReceiveMsg, &ReplyMsg);
     }
-
-    return 0;
 }
@@ -143,6 +143,17 @@ static bool IsCommandLineEditingKey(const KEY_EVENT_RECORD& event)
 
     for (;;)
     {
+        // Pasted text doesn't need to be turned into key events just so that we can turn them back into text.
+        DWORD keyState = 0;
+        if (pInputBuffer->ReadTextChar(*pwchOut, keyState))
+        {
+            if (pdwKeyState)
+            {
+                *pdwKeyState = keyState;
+            }
+            return STATUS_SUCCESS;
+        }
+
         InputEventQueue events;
         const auto Status = pInputBuffer->Read(events, 1, false, Wait, true, true);
         if (FAILED_NTSTATUS(Status))
@@ -422,6 +433,13 @@ try
 
     while (writer.size() >= charSize)
     {
+        // Same as the GetChar() below, but for as much pasted text as fits into the buffer.
+        if (inputBuffer.ConsumeText(unicode, writer))
+        {
+            noDataReadYet = false;
+            continue;
+        }
+
         wchar_t wch;
         // We don't need to wait for input if `ConsumeCached` read something already, which is
         // indicated by the writer having been advanced (= it's shorter than the original buffer).
@@ -180,4 +180,25 @@ class AliasTests
         VERIFY_IS_TRUE(buffer.empty());
         VERIFY_ARE_EQUAL(1u, dwLines);
     }
+
+    TEST_METHOD(TestMatchAndCopyMissingArguments)
+    {
+        const std::wstring exe(L"exe.exe");
+        Alias::s_TestAddAlias(exe, L"Source", L"target [$2] [$*]$t[$1]");
+
+        size_t dwLines = 0;
+        auto buffer = Alias::s_MatchAndCopyAlias(L"Source", exe, dwLines);
+        VERIFY_ARE_EQUAL(std::wstring{ L"target [] []\r\n[]\r\n" }, buffer);
+        VERIFY_ARE_EQUAL(2u, dwLines);
+
+        // Trailing whitespace is not an argument, but it's part of $*.
+        buffer = Alias::s_MatchAndCopyAlias(L"Source one  ", exe, dwLines);
+        VERIFY_ARE_EQUAL(std::wstring{ L"target [] [one  ]\r\n[one]\r\n" }, buffer);
+
+        // Redefining an alias replaces its compiled form.
+        Alias::s_TestAddAlias(exe, L"Source", L"$2-$1");
+        buffer = Alias::s_MatchAndCopyAlias(L"source one two", exe, dwLines);
+        VERIFY_ARE_EQUAL(std::wstring{ L"two-one\r\n" }, buffer);
+        VERIFY_ARE_EQUAL(1u, dwLines);
+    }
 };
@@ -8,6 +8,8 @@
 
 #include "../types/inc/CodepointWidthDetector.hpp"
 
+#include <til/unicode.h>
+
 using namespace WEX::Logging;
 
 static constexpr std::wstring_view emoji = L"\xD83E\xDD22"; // U+1F922 nauseated face
@@ -25,7 +27,15 @@ static const std::vector<std::tuple<unsigned int, std::wstring, CodepointWidth>>
     { 0x30CA, L"\x30CA", CodepointWidth::Wide }, // U+30CA katakana na
     { 0x72D7, L"\x72D7", CodepointWidth::Wide }, // U+72D7
     { 0x1F47E, L"\xD83D\xDC7E", CodepointWidth::Wide }, // U+1F47E alien monster
-    { 0x1F51C, L"\xD83D\xDD1C", CodepointWidth::Wide } // U+1F51C SOON
+    { 0x1F51C, L"\xD83D\xDD1C", CodepointWidth::Wide }, // U+1F51C SOON
+    // The following test the edges of the blocks in the lookup tables.
+    { 0x115F, L"\x115F", CodepointWidth::Wide }, // U+115F hangul choseong filler
+    { 0x1160, L"\x1160", CodepointWidth::Narrow }, // U+1160 hangul jungseong filler
+    { 0x3000, L"\x3000", CodepointWidth::Wide }, // U+3000 ideographic space
+    { 0xFF01, L"\xFF01", CodepointWidth::Wide }, // U+FF01 fullwidth exclamation mark
+    { 0xFF61, L"\xFF61", CodepointWidth::Narrow }, // U+FF61 halfwidth ideographic full stop
+    { 0x20000, L"\xD840\xDC00", CodepointWidth::Wide }, // U+20000
+    { 0x10FFFF, L"\xDBFF\xDFFF", CodepointWidth::Narrow } // U+10FFFF
 };
 
 class CodepointWidthDetectorTests
@@ -86,4 +96,84 @@ class CodepointWidthDetectorTests
         widthDetector.NotifyFontChanged();
         VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCache.size());
     }
+
+    TEST_METHOD(CanSegmentGraphemeClusters)
+    {
+        struct Test
+        {
+            std::wstring_view text;
+            std::vector<size_t> boundaries;
+            std::vector<int> widths;
+        };
+        const std::array tests{
+            // ASCII, including the CR LF exception.
+            Test{ L"ab\r\nc", { 1, 2, 4, 5 }, { 1, 1, 1, 1 } },
+            // Latin-1 takes the fast path, unless it's followed by a combining mark: U+00E9 U+00E8 U+0301
+            Test{ L"\xE9\xE8\x301", { 1, 3 }, { 1, 1 } },
+            // U+0301 combining acute accent joins the preceding "e".
+            Test{ L"e\x301x", { 2, 3 }, { 1, 1 } },
+            // CJK and Cyrillic don't join: U+65E5 U+672C U+043F U+0440 (the latter are ambiguous and thus narrow)
+            Test{ L"\x65E5\x672C\x43F\x440e\x301", { 1, 2, 3, 4, 6 }, { 2, 2, 1, 1, 1 } },
+            // U+1F468 U+200D U+1F469 U+200D U+1F467 family: man, woman, girl
+            Test{ L"\xD83D\xDC68\x200D\xD83D\xDC69\x200D\xD83D\xDC67!", { 8, 9 }, { 2, 1 } },
+            // Regional indicator pairs: U+1F1E9 U+1F1EA (DE), U+1F1EB U+1F1F7 (FR), U+1F1EE (lone I)
+            Test{ L"\xD83C\xDDE9\xD83C\xDDEA\xD83C\xDDEB\xD83C\xDDF7\xD83C\xDDEE", { 4, 8, 10 }, { 2, 2, 2 } },
+            // U+0915 U+094D U+0937 devanagari ksha (GB9c)
+            Test{ L"\x915\x94D\x937!", { 3, 4 }, { 1, 1 } },
+            // U+1100 U+1161 U+11A8 hangul L V T, followed by the precomposed LVT syllable U+AC01 and LV syllable U+AC00
+            Test{ L"\x1100\x1161\x11A8\xAC01\xAC00", { 3, 4, 5 }, { 2, 2, 2 } },
+            // U+2764 heavy black heart is narrow, but wide with U+FE0F variation selector-16.
+            Test{ L"\x2764\x2764\xFE0F", { 1, 3 }, { 1, 2 } },
+            // Unpaired surrogates are their own cluster.
+            Test{ L"\xD800\x301\xDC00", { 1, 2, 3 }, { 1, 1, 1 } },
+        };
+
+        CodepointWidthDetector widthDetector;
+        for (const auto& test : tests)
+        {
+            std::vector<size_t> boundaries;
+            std::vector<int> widths;
+            GraphemeState state;
+            while (widthDetector.GraphemeNext(state, test.text))
+            {
+                boundaries.emplace_back(state.end);
+                widths.emplace_back(state.width);
+            }
+            VERIFY_ARE_EQUAL(test.boundaries.size(), boundaries.size());
+            for (size_t i = 0; i < boundaries.size(); ++i)
+            {
+                VERIFY_ARE_EQUAL(test.boundaries[i], boundaries[i]);
+                VERIFY_ARE_EQUAL(test.widths[i], widths[i]);
+            }
+
+            // GraphemePrev must find the same boundaries in reverse.
+            for (auto i = test.boundaries.size() - 1; i > 0; --i)
+            {
+                VERIFY_ARE_EQUAL(test.boundaries[i - 1], CodepointWidthDetector::GraphemePrev(test.text, test.boundaries[i]));
+            }
+            VERIFY_ARE_EQUAL(0u, CodepointWidthDetector::GraphemePrev(test.text, test.boundaries[0]));
+
+            // GraphemeNextRun must find the same clusters, no matter how many of them it measures at once.
+            for (const size_t runSize : { 1, 2, 64 })
+            {
+                std::vector<size_t> runBoundaries;
+                std::vector<int> runWidths;
+                std::array<uint8_t, 64> runBuffer{};
+                GraphemeState runState;
+                while (const auto count = widthDetector.GraphemeNextRun(runState, test.text, { runBuffer.data(), runSize }))
+                {
+                    // All clusters in a run except for the last one are a single codepoint long.
+                    auto pos = runState.beg;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        pos = i + 1 < count ? til::utf16_iterate_next(test.text, pos) : runState.end;
+                        runBoundaries.emplace_back(pos);
+                        runWidths.emplace_back(til::at(runBuffer, i));
+                    }
+                }
+                VERIFY_IS_TRUE(boundaries == runBoundaries);
+                VERIFY_IS_TRUE(widths == runWidths);
+            }
+        }
+    }
 };
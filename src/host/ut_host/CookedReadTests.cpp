@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "CommonState.hpp"
+
+#include "readDataCooked.hpp"
+
+#include "../interactivity/inc/ServiceLocator.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+using Microsoft::Console::Interactivity::ServiceLocator;
+
+class CookedReadTests
+{
+    TEST_CLASS(CookedReadTests);
+
+    std::unique_ptr<CommonState> m_state;
+
+    TEST_METHOD_SETUP(MethodSetup)
+    {
+        m_state = std::make_unique<CommonState>();
+
+        m_state->PrepareGlobalFont();
+        m_state->PrepareGlobalInputBuffer();
+        m_state->PrepareGlobalScreenBuffer();
+        m_state->PrepareReadHandle();
+        m_state->PrepareCookedReadData();
+
+        return true;
+    }
+
+    TEST_METHOD_CLEANUP(MethodCleanup)
+    {
+        m_state->CleanupCookedReadData();
+        m_state->CleanupReadHandle();
+        m_state->CleanupGlobalScreenBuffer();
+        m_state->CleanupGlobalInputBuffer();
+        m_state->CleanupGlobalFont();
+
+        m_state.reset(nullptr);
+
+        return true;
+    }
+
+    static COOKED_READ_DATA& _cookedReadData()
+    {
+        return ServiceLocator::LocateGlobals().getConsoleInformation().CookedReadData();
+    }
+
+    // A line that's a few thousand columns wide, so that it spans many ColumnCacheInterval chunks.
+    // The tabs and wide glyphs make the column count depend on everything that precedes them.
+    static std::wstring _longLine()
+    {
+        std::wstring line;
+        for (auto i = 0; i < 96; ++i)
+        {
+            line.append(L"ab\tcd");
+            line.append(i % 3 ? L"\x65E5\x672C" : L"efg");
+            line.append(L" h\t\xD83D\xDE00i ");
+        }
+        return line;
+    }
+
+    // Measures the entire prompt from scratch and compares the result against what
+    // _flushBuffer() computed incrementally with the help of the column cache.
+    static void _verifyAgainstFullMeasure(COOKED_READ_DATA& cookedRead)
+    {
+        const std::wstring_view text{ cookedRead._buffer.Get() };
+        // _measureChars() wants the distance relative to the actual cursor position,
+        // which is at _distanceCursor columns past the start of the prompt after a flush.
+        const auto origin = -cookedRead._distanceCursor;
+
+        VERIFY_IS_TRUE(cookedRead._buffer.IsClean());
+        VERIFY_ARE_EQUAL(cookedRead._measureChars(text.substr(0, cookedRead._buffer.GetCursorPosition()), origin), cookedRead._distanceCursor);
+        VERIFY_ARE_EQUAL(cookedRead._measureChars(text, origin), cookedRead._distanceEnd);
+
+        const auto& cache = cookedRead._columnCache;
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            if (i != 0)
+            {
+                VERIFY_IS_GREATER_THAN(cache[i].offset, cache[i - 1].offset);
+            }
+            VERIFY_IS_LESS_THAN_OR_EQUAL(cache[i].offset, text.size());
+            VERIFY_ARE_EQUAL(cookedRead._measureChars(text.substr(0, cache[i].offset), origin), cache[i].distance);
+        }
+    }
+
+    TEST_METHOD(ColumnCacheMatchesFullMeasureAfterEdits)
+    {
+        auto& cookedRead = _cookedReadData();
+        const auto line = _longLine();
+
+        Log::Comment(L"Writing the whole line should leave a checkpoint at every chunk boundary.");
+        cookedRead._buffer.Replace(line);
+        cookedRead._flushBuffer();
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(cookedRead._columnCache.size(), line.size() / COOKED_READ_DATA::ColumnCacheInterval);
+        _verifyAgainstFullMeasure(cookedRead);
+
+        const auto middle = line.size() / 2;
+
+        Log::Comment(L"Moving the cursor into the middle of the line must not change any columns.");
+        cookedRead._buffer.SetCursorPosition(middle);
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Inserting a wide glyph shifts every tab stop after it.");
+        cookedRead._buffer.Replace(middle, 0, L"\x6F22", 1);
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Inserting text that ends with a tab right before the cursor.");
+        cookedRead._buffer.Replace(cookedRead._buffer.GetCursorPosition(), 0, L"x\t", 2);
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Deleting text in front of the cursor.");
+        cookedRead._buffer.Replace(middle - 7, 7, nullptr, 0);
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Replacing text across a chunk boundary near the start of the line.");
+        cookedRead._buffer.Replace(COOKED_READ_DATA::ColumnCacheInterval - 3, 6, L"\t\x65E5\t", 3);
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Moving the cursor back to the end of the line.");
+        cookedRead._buffer.SetCursorPosition(cookedRead._buffer.Get().size());
+        cookedRead._flushBuffer();
+        _verifyAgainstFullMeasure(cookedRead);
+
+        Log::Comment(L"Truncating the line in the middle drops the checkpoints past it.");
+        cookedRead._buffer.Replace(middle, std::wstring::npos, nullptr, 0);
+        cookedRead._flushBuffer();
+        for (const auto& checkpoint : cookedRead._columnCache)
+        {
+            VERIFY_IS_LESS_THAN_OR_EQUAL(checkpoint.offset, middle);
+        }
+        _verifyAgainstFullMeasure(cookedRead);
+    }
+};
@@ -242,6 +242,170 @@ class HistoryTests
         VERIFY_ARE_EQUAL(2, history->GetNumberOfCommands());
     }
 
+    TEST_METHOD(FindMatchingCommandSearchesBackwards)
+    {
+        auto history = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(history);
+
+        VERIFY_SUCCEEDED(history->Add(L"dir", false));
+        VERIFY_SUCCEEDED(history->Add(L"cd ..", false));
+        VERIFY_SUCCEEDED(history->Add(L"dir /w", false));
+        VERIFY_SUCCEEDED(history->Add(L"ping", false));
+
+        const auto find = [&](std::wstring_view command, CommandHistory::Index start, CommandHistory::MatchOptions options) {
+            CommandHistory::Index found;
+            return history->FindMatchingCommand(command, start, found, options | CommandHistory::MatchOptions::JustLooking) ? found : -1;
+        };
+
+        // The search starts at the entry before the given one and finds the closest match at or before it...
+        VERIFY_ARE_EQUAL(2, find(L"dir", 3, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(0, find(L"dir", 2, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(0, find(L"dir", 2, CommandHistory::MatchOptions::ExactMatch));
+        // ...and wraps around to the end of the history otherwise.
+        VERIFY_ARE_EQUAL(2, find(L"dir", 0, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(3, find(L"ping", 3, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(-1, find(L"dir /p", 3, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(-1, find(L"pin", 3, CommandHistory::MatchOptions::ExactMatch));
+
+        // The index has to follow the commands around.
+        history->Swap(0, 3);
+        VERIFY_ARE_EQUAL(3, find(L"dir", 0, CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(0, find(L"ping", 2, CommandHistory::MatchOptions::ExactMatch));
+
+        VERIFY_ARE_EQUAL(L"dir", history->Remove(3));
+        VERIFY_ARE_EQUAL(-1, find(L"dir", 0, CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(2, find(L"dir", 0, CommandHistory::MatchOptions::None));
+
+        // Evicts "ping" which is the oldest entry now.
+        for (auto i = 0; i < s_BufferSize - 2; ++i)
+        {
+            VERIFY_SUCCEEDED(history->Add(L"echo " + std::to_wstring(i), false));
+        }
+        VERIFY_ARE_EQUAL(s_BufferSize, history->GetNumberOfCommands());
+        VERIFY_ARE_EQUAL(-1, find(L"ping", 0, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(s_BufferSize - 1, find(L"echo", 0, CommandHistory::MatchOptions::None));
+        VERIFY_ARE_EQUAL(1, find(L"dir", 0, CommandHistory::MatchOptions::None));
+    }
+
+    TEST_METHOD(FindByExeAfterReuse)
+    {
+        for (UINT i = 0; i < s_NumberOfBuffers; ++i)
+        {
+            VERIFY_IS_NOT_NULL(CommandHistory::s_Allocate(_manyApps[i], _MakeHandle(i)));
+            CommandHistory::s_Free(_MakeHandle(i));
+        }
+
+        // All buffers are in use, so this one takes over the least recently used one under a new name.
+        const auto history = CommandHistory::s_Allocate(_manyApps[4], _MakeHandle(4));
+        VERIFY_IS_NOT_NULL(history);
+        VERIFY_ARE_EQUAL(history, CommandHistory::s_FindByExe(L"BANANA.exe"));
+        VERIFY_IS_NULL(CommandHistory::s_FindByExe(_manyApps[0]));
+
+        // Reattaching picks the app's previous buffer.
+        CommandHistory::s_Free(_MakeHandle(4));
+        VERIFY_ARE_EQUAL(history, CommandHistory::s_Allocate(L"Banana.EXE", _MakeHandle(5)));
+    }
+
+    TEST_METHOD(SaveAndLoadMergeSessions)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / L"HistoryTests.history").wstring();
+        DeleteFileW(path.c_str());
+        const auto cleanup = wil::scope_exit([&]() noexcept { DeleteFileW(path.c_str()); });
+
+        // Two sessions of the same app that run concurrently.
+        const auto a = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        const auto b = CommandHistory::s_Allocate(_manyApps[1], _MakeHandle(1));
+        VERIFY_IS_NOT_NULL(a);
+        VERIFY_IS_NOT_NULL(b);
+
+        VERIFY_SUCCEEDED(a->Add(L"dir", false));
+        VERIFY_SUCCEEDED(b->Add(L"cd ..", false));
+        VERIFY_SUCCEEDED(a->Add(L"git push", false));
+
+        // The second session must not overwrite what the first one saved
+        // and saving again must not persist the same commands twice.
+        VERIFY_SUCCEEDED(a->Save(path));
+        VERIFY_SUCCEEDED(b->Save(path));
+        VERIFY_SUCCEEDED(a->Save(path));
+
+        const auto c = CommandHistory::s_Allocate(_manyApps[2], _MakeHandle(2));
+        VERIFY_IS_NOT_NULL(c);
+        VERIFY_SUCCEEDED(c->Load(path));
+
+        const std::vector<std::wstring> expected{ L"dir", L"git push", L"cd .." };
+        VERIFY_IS_TRUE(expected == c->GetCommands());
+
+        CommandHistory::Index found;
+        VERIFY_IS_TRUE(c->FindMatchingCommand(L"git", c->GetNumberOfCommands(), found, CommandHistory::MatchOptions::JustLooking));
+        VERIFY_ARE_EQUAL(1, found);
+    }
+
+    TEST_METHOD(LoadMergesCommandsEnteredMeanwhile)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / L"HistoryTests.history").wstring();
+        DeleteFileW(path.c_str());
+        const auto cleanup = wil::scope_exit([&]() noexcept { DeleteFileW(path.c_str()); });
+
+        const auto a = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(a);
+        VERIFY_SUCCEEDED(a->Add(L"dir", false));
+        VERIFY_SUCCEEDED(a->Save(path));
+
+        // The file is read in the background, while the user may already enter commands.
+        // One of them has been saved before the file was merged in, the other one hasn't.
+        const auto b = CommandHistory::s_Allocate(_manyApps[1], _MakeHandle(1));
+        VERIFY_IS_NOT_NULL(b);
+        const auto persisted = CommandHistory::_ReadPersisted(path);
+        VERIFY_SUCCEEDED(b->Add(L"cd ..", false));
+        VERIFY_SUCCEEDED(b->Save(path));
+        VERIFY_SUCCEEDED(b->Add(L"git push", false));
+        VERIFY_SUCCEEDED(b->_MergePersisted(persisted));
+
+        const std::vector<std::wstring> expected{ L"dir", L"cd ..", L"git push" };
+        VERIFY_IS_TRUE(expected == b->GetCommands());
+
+        // Saving again must only append the command that hasn't been saved yet.
+        VERIFY_SUCCEEDED(b->Save(path));
+        VERIFY_IS_TRUE(expected == CommandHistory::_ReadPersisted(path));
+    }
+
+    TEST_METHOD(SaveAndLoadSuppressDuplicates)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / L"HistoryTests.history").wstring();
+        DeleteFileW(path.c_str());
+        const auto cleanup = wil::scope_exit([&]() noexcept { DeleteFileW(path.c_str()); });
+
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto flags = gci.Flags;
+        const auto restore = wil::scope_exit([&]() noexcept { gci.Flags = flags; });
+        WI_SetFlag(gci.Flags, CONSOLE_HISTORY_NODUP);
+
+        // The commands are short enough to fit into std::wstring's small string buffer,
+        // which is cleared when the string is moved from.
+        const auto a = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(a);
+        VERIFY_SUCCEEDED(a->Add(L"dir", false));
+        VERIFY_SUCCEEDED(a->Add(L"cd ..", false));
+        VERIFY_SUCCEEDED(a->Add(L"dir", false));
+        VERIFY_SUCCEEDED(a->Save(path));
+
+        const std::vector<std::wstring> saved{ L"cd ..", L"dir" };
+        VERIFY_IS_TRUE(saved == CommandHistory::_ReadPersisted(path));
+
+        // Another session's duplicates are removed as well, keeping the most recent copy.
+        const auto b = CommandHistory::s_Allocate(_manyApps[1], _MakeHandle(1));
+        VERIFY_IS_NOT_NULL(b);
+        VERIFY_SUCCEEDED(b->Add(L"cd ..", false));
+        VERIFY_SUCCEEDED(b->Save(path));
+
+        const auto c = CommandHistory::s_Allocate(_manyApps[2], _MakeHandle(2));
+        VERIFY_IS_NOT_NULL(c);
+        VERIFY_SUCCEEDED(c->Load(path));
+
+        const std::vector<std::wstring> expected{ L"dir", L"cd .." };
+        VERIFY_IS_TRUE(expected == c->GetCommands());
+    }
+
 private:
     const std::array<std::wstring, 5> _manyApps = {
         L"foo.exe",
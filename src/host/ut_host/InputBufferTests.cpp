@@ -6,9 +6,11 @@
 #include "../../inc/consoletaeftemplates.hpp"
 #include "CommonState.hpp"
 
+#include "../interactivity/inc/EventSynthesis.hpp"
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../types/inc/IInputEvent.hpp"
 
+using namespace std::string_view_literals;
 using namespace WEX::Logging;
 using Microsoft::Console::Interactivity::ServiceLocator;
 
@@ -642,4 +644,304 @@ class InputBufferTests
         VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
         VERIFY_ARE_EQUAL(outEvents.front().Event.KeyEvent.wRepeatCount, 1u);
     }
+
+    TEST_METHOD(LargeWritesAreStoredAndReadInBulk)
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        InputBuffer inputBuffer;
+
+        // This resembles a paste of 256K characters, with a pause key and
+        // the key that resumes output somewhere in the middle of it.
+        static constexpr size_t charCount = 256 * 1024;
+        static constexpr size_t pauseIndex = 100000;
+        InputEventQueue inEvents;
+        for (size_t i = 0; i < charCount; ++i)
+        {
+            const auto wch = static_cast<WCHAR>(L'A' + i % 26);
+            if (i == pauseIndex)
+            {
+                inEvents.push_back(MakeKeyEvent(TRUE, 1, VK_PAUSE, 0, 0, 0));
+                inEvents.push_back(MakeKeyEvent(TRUE, 1, L'Q', 0, L'q', 0));
+            }
+            inEvents.push_back(MakeKeyEvent(TRUE, 1, wch, 0, wch, 0));
+            inEvents.push_back(MakeKeyEvent(FALSE, 1, wch, 0, wch, 0));
+        }
+
+        VERIFY_ARE_EQUAL(charCount * 2, inputBuffer.Write(inEvents));
+        VERIFY_IS_FALSE(WI_IsFlagSet(gci.Flags, CONSOLE_OUTPUT_SUSPENDED));
+        VERIFY_ARE_EQUAL(charCount * 2, inputBuffer.GetNumberOfReadyEvents());
+
+        // Reading in odd sized chunks makes the reads straddle the end of the ring buffer.
+        InputEventQueue outEvents;
+        size_t read = 0;
+        while (read < charCount * 2)
+        {
+            outEvents.clear();
+            VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 4093, false, false, true, false));
+            VERIFY_IS_FALSE(outEvents.empty());
+
+            for (const auto& event : outEvents)
+            {
+                const auto wch = static_cast<WCHAR>(L'A' + (read / 2) % 26);
+                VERIFY_ARE_EQUAL(MakeKeyEvent(read % 2 == 0, 1, wch, 0, wch, 0), event);
+                read++;
+            }
+        }
+
+        VERIFY_ARE_EQUAL(0u, inputBuffer.GetNumberOfReadyEvents());
+        // The storage of the large write shouldn't outlive it.
+        VERIFY_ARE_EQUAL(0u, inputBuffer._storage.capacity());
+    }
+
+    TEST_METHOD(CanPrependAcrossWrapAround)
+    {
+        InputBuffer inputBuffer;
+        InputEventQueue inEvents;
+        InputEventQueue outEvents;
+        const auto makeEvent = [&](size_t i) {
+            return MakeKeyEvent(TRUE, 1, 0, gsl::narrow_cast<WORD>(i), L'a', 0);
+        };
+
+        // Fill the buffer, then consume most of it so that the next write wraps around.
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            inEvents.push_back(makeEvent(i));
+        }
+        VERIFY_ARE_EQUAL(1000u, inputBuffer.Write(inEvents));
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 900, false, false, true, false));
+        VERIFY_ARE_EQUAL(900u, outEvents.size());
+
+        inEvents.clear();
+        for (size_t i = 1000; i < 1500; ++i)
+        {
+            inEvents.push_back(makeEvent(i));
+        }
+        VERIFY_ARE_EQUAL(500u, inputBuffer.Write(inEvents));
+
+        inEvents.clear();
+        for (size_t i = 2000; i < 2010; ++i)
+        {
+            inEvents.push_back(makeEvent(i));
+        }
+        VERIFY_ARE_EQUAL(10u, inputBuffer.Prepend(inEvents));
+        VERIFY_ARE_EQUAL(610u, inputBuffer.GetNumberOfReadyEvents());
+
+        outEvents.clear();
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 1000, false, false, true, false));
+        VERIFY_ARE_EQUAL(610u, outEvents.size());
+        for (size_t i = 0; i < 10; ++i)
+        {
+            VERIFY_ARE_EQUAL(makeEvent(2000 + i), outEvents[i]);
+        }
+        for (size_t i = 10; i < 610; ++i)
+        {
+            VERIFY_ARE_EQUAL(makeEvent(900 + i - 10), outEvents[i]);
+        }
+    }
+
+    TEST_METHOD(WrittenTextIsExpandedOnRead)
+    {
+        InputBuffer inputBuffer;
+        const auto text = L"Hello, World!\r\n\t~"sv;
+
+        InputEventQueue expected;
+        for (const auto& wch : text)
+        {
+            Microsoft::Console::Interactivity::CharToKeyEvents(wch, CP_USA, expected);
+        }
+
+        inputBuffer.WriteText(text, CP_USA);
+        VERIFY_ARE_EQUAL(1u, inputBuffer._storage.size());
+        VERIFY_ARE_EQUAL(expected.size(), inputBuffer.GetNumberOfReadyEvents());
+
+        // Peeking doesn't consume anything.
+        InputEventQueue outEvents;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 5, true, false, true, false));
+        VERIFY_ARE_EQUAL(5u, outEvents.size());
+        VERIFY_ARE_EQUAL(1u, inputBuffer._storage.size());
+        VERIFY_ARE_EQUAL(0u, inputBuffer._textSegments.front().offset);
+
+        // Reading in chunks of 3 splits up the key events of individual characters.
+        InputEventQueue actual;
+        do
+        {
+            outEvents.clear();
+            VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 3, false, false, true, false));
+            actual.insert(actual.end(), outEvents.begin(), outEvents.end());
+            VERIFY_ARE_EQUAL(expected.size() - actual.size(), inputBuffer.GetNumberOfReadyEvents());
+        } while (!outEvents.empty());
+
+        VERIFY_ARE_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], actual[i]);
+        }
+
+        VERIFY_ARE_EQUAL(0u, inputBuffer.GetNumberOfReadyEvents());
+        VERIFY_IS_TRUE(inputBuffer._textSegments.empty());
+    }
+
+    TEST_METHOD(WrittenTextIsCountedOnDemand)
+    {
+        InputBuffer inputBuffer;
+        const auto countKeyEvents = [](const std::wstring_view& text) {
+            InputEventQueue events;
+            for (const auto& wch : text)
+            {
+                Microsoft::Console::Interactivity::CharToKeyEvents(wch, CP_USA, events);
+            }
+            return events.size();
+        };
+
+        // Writing text doesn't count its key events...
+        inputBuffer.WriteText(L"Hello", CP_USA);
+        VERIFY_ARE_EQUAL(0u, inputBuffer._textSegments.front().countedEnd);
+        // ...asking for them does.
+        VERIFY_ARE_EQUAL(countKeyEvents(L"Hello"), inputBuffer.GetNumberOfReadyEvents());
+        VERIFY_ARE_EQUAL(5u, inputBuffer._textSegments.front().countedEnd);
+
+        // Merged text only gets counted on demand as well.
+        inputBuffer.WriteText(L", World!", CP_USA);
+        VERIFY_ARE_EQUAL(1u, inputBuffer._textSegments.size());
+        VERIFY_ARE_EQUAL(5u, inputBuffer._textSegments.front().countedEnd);
+        VERIFY_ARE_EQUAL(countKeyEvents(L"Hello, World!"), inputBuffer.GetNumberOfReadyEvents());
+
+        // Reading text drops the cached count.
+        wchar_t buffer[2]{};
+        std::span target{ reinterpret_cast<char*>(&buffer[0]), sizeof(buffer) };
+        VERIFY_IS_TRUE(inputBuffer.ConsumeText(true, target));
+        VERIFY_ARE_EQUAL(2u, inputBuffer._textSegments.front().countedEnd);
+        VERIFY_ARE_EQUAL(countKeyEvents(L"llo, World!"), inputBuffer.GetNumberOfReadyEvents());
+
+        // Reading key events keeps it up to date, including for partially read characters.
+        InputEventQueue outEvents;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 5, false, false, true, false));
+        VERIFY_ARE_EQUAL(countKeyEvents(L"llo, World!") - 5, inputBuffer.GetNumberOfReadyEvents());
+
+        auto wch = L'\0';
+        DWORD keyState = 0;
+        VERIFY_IS_FALSE(inputBuffer.ReadTextChar(wch, keyState));
+        outEvents.clear();
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 1, false, false, true, false));
+        VERIFY_IS_TRUE(inputBuffer.ReadTextChar(wch, keyState));
+        VERIFY_ARE_EQUAL(L',', wch);
+
+        // Reading key events past the cached count restarts it after the last character read.
+        outEvents.clear();
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 3, false, false, true, false));
+        VERIFY_ARE_EQUAL(8u, inputBuffer._textSegments.front().countedEnd);
+        VERIFY_ARE_EQUAL(countKeyEvents(L" World!") - 3, inputBuffer.GetNumberOfReadyEvents());
+    }
+
+    TEST_METHOD(WrittenTextIsReadAsText)
+    {
+        InputBuffer inputBuffer;
+        inputBuffer.WriteText(L"foo", CP_USA);
+        inputBuffer.WriteText(L"bar\n", CP_USA);
+        inputBuffer.WriteText(L"baz", CP_USA);
+        // Consecutive writes are merged.
+        VERIFY_ARE_EQUAL(1u, inputBuffer._textSegments.size());
+
+        // Linefeeds may be ignored depending on the input mode, so the bulk read stops there.
+        wchar_t buffer[16]{};
+        std::span target{ reinterpret_cast<char*>(&buffer[0]), sizeof(buffer) };
+        VERIFY_IS_TRUE(inputBuffer.ConsumeText(true, target));
+        VERIFY_ARE_EQUAL(L"foobar"sv, (std::wstring_view{ &buffer[0], 6 }));
+        VERIFY_ARE_EQUAL(sizeof(buffer) - 6 * sizeof(wchar_t), target.size());
+        VERIFY_IS_FALSE(inputBuffer.ConsumeText(true, target));
+
+        // The linefeed is read as key events instead. Until its key-up event
+        // has been read as well, the following text can't be read as text.
+        InputEventQueue outEvents;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 1, false, false, true, true));
+        VERIFY_ARE_EQUAL(1u, outEvents.size());
+        VERIFY_IS_TRUE(outEvents[0].Event.KeyEvent.bKeyDown);
+        VERIFY_ARE_EQUAL(L'\n', outEvents[0].Event.KeyEvent.uChar.UnicodeChar);
+
+        auto wch = L'\0';
+        DWORD keyState = 0;
+        VERIFY_IS_FALSE(inputBuffer.ReadTextChar(wch, keyState));
+
+        outEvents.clear();
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 1, false, false, true, true));
+        VERIFY_ARE_EQUAL(1u, outEvents.size());
+        VERIFY_IS_FALSE(outEvents[0].Event.KeyEvent.bKeyDown);
+
+        for (const auto expected : L"baz"sv)
+        {
+            VERIFY_IS_TRUE(inputBuffer.ReadTextChar(wch, keyState));
+            VERIFY_ARE_EQUAL(expected, wch);
+        }
+
+        VERIFY_IS_FALSE(inputBuffer.ReadTextChar(wch, keyState));
+        VERIFY_ARE_EQUAL(0u, inputBuffer.GetNumberOfReadyEvents());
+        VERIFY_IS_TRUE(inputBuffer._storage.empty());
+    }
+
+    TEST_METHOD(WrittenTextIsReadWithKeyState)
+    {
+        InputBuffer inputBuffer;
+        const auto text = L"aB~\t"sv;
+        inputBuffer.WriteText(text, CP_USA);
+
+        for (const auto expected : text)
+        {
+            // The key state has to match the one of the key-down event that carries the character.
+            InputEventQueue events;
+            Microsoft::Console::Interactivity::CharToKeyEvents(expected, CP_USA, events);
+            const auto it = std::ranges::find_if(events, [&](const INPUT_RECORD& event) {
+                return event.Event.KeyEvent.bKeyDown && event.Event.KeyEvent.uChar.UnicodeChar == expected;
+            });
+            const auto expectedKeyState = it != events.end() ? it->Event.KeyEvent.dwControlKeyState : 0;
+
+            auto wch = L'\0';
+            DWORD keyState = 0;
+            VERIFY_IS_TRUE(inputBuffer.ReadTextChar(wch, keyState));
+            VERIFY_ARE_EQUAL(expected, wch);
+            VERIFY_ARE_EQUAL(expectedKeyState, keyState);
+        }
+
+        VERIFY_ARE_EQUAL(0u, inputBuffer.GetNumberOfReadyEvents());
+    }
+
+    TEST_METHOD(WrittenTextKeepsItsPlace)
+    {
+        InputBuffer inputBuffer;
+        INPUT_RECORD menuRecord{};
+        menuRecord.EventType = MENU_EVENT;
+        const auto keyRecord = MakeKeyEvent(TRUE, 1, L'X', 0, L'x', 0);
+
+        VERIFY_ARE_EQUAL(1u, inputBuffer.Write(keyRecord));
+        inputBuffer.WriteString(L"yz");
+        VERIFY_ARE_EQUAL(1u, inputBuffer.Write(menuRecord));
+        inputBuffer.WriteString(L"1");
+        VERIFY_ARE_EQUAL(2u, inputBuffer._textSegments.size());
+
+        // Both of these move the remaining records around.
+        VERIFY_ARE_EQUAL(1u, inputBuffer.Prepend(std::span{ &menuRecord, 1 }));
+        inputBuffer.FlushAllButKeys();
+        VERIFY_ARE_EQUAL(3u, inputBuffer._storage.size());
+
+        InputEventQueue outEvents;
+        VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 10, false, false, true, false));
+        VERIFY_ARE_EQUAL(4u, outEvents.size());
+        VERIFY_ARE_EQUAL(keyRecord, outEvents[0]);
+        VERIFY_ARE_EQUAL(MakeKeyEvent(TRUE, 1, 0, 0, L'y', 0), outEvents[1]);
+        VERIFY_ARE_EQUAL(MakeKeyEvent(TRUE, 1, 0, 0, L'z', 0), outEvents[2]);
+        VERIFY_ARE_EQUAL(MakeKeyEvent(TRUE, 1, 0, 0, L'1', 0), outEvents[3]);
+        VERIFY_IS_TRUE(inputBuffer._textSegments.empty());
+    }
+
+    TEST_METHOD(WrittenTextCanPauseOutput)
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        InputBuffer inputBuffer;
+
+        // Ctrl+S needs to be handled when it's written, so this text is written as key events.
+        // The key-down event of Ctrl+S is consumed, leaving 'a' down/up and Ctrl+S up.
+        inputBuffer.WriteText(L"a\x13", CP_USA);
+        VERIFY_IS_TRUE(WI_IsFlagSet(gci.Flags, CONSOLE_OUTPUT_SUSPENDED));
+        VERIFY_IS_TRUE(inputBuffer._textSegments.empty());
+        VERIFY_ARE_EQUAL(3u, inputBuffer.GetNumberOfReadyEvents());
+    }
 };
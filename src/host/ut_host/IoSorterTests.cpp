@@ -0,0 +1,573 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "CommonState.hpp"
+
+#include "../../server/IoSorter.h"
+#include "../../server/OutputWorker.h"
+
+using namespace std::string_view_literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+using Microsoft::Console::Interactivity::ServiceLocator;
+
+namespace
+{
+    // A message as the driver would hand it to us. `image` is what ReadInput() reads from.
+    struct RecordedMessage
+    {
+        ULONG function;
+        std::vector<BYTE> image;
+        ULONG apiDescriptorSize;
+    };
+
+    struct Completion
+    {
+        ULONG identifier;
+        NTSTATUS status;
+        ULONG_PTR information;
+    };
+
+    RecordedMessage MakeApiMessage(ULONG apiNumber, const void* body, ULONG bodySize, std::wstring_view payload = {})
+    {
+        const CONSOLE_MSG_HEADER header{ apiNumber, bodySize };
+        const auto payloadBytes = reinterpret_cast<const BYTE*>(payload.data());
+
+        RecordedMessage message{ CONSOLE_IO_USER_DEFINED, {}, bodySize };
+        message.image.insert(message.image.end(), reinterpret_cast<const BYTE*>(&header), reinterpret_cast<const BYTE*>(&header + 1));
+        message.image.insert(message.image.end(), static_cast<const BYTE*>(body), static_cast<const BYTE*>(body) + bodySize);
+        message.image.insert(message.image.end(), payloadBytes, payloadBytes + payload.size() * sizeof(wchar_t));
+        return message;
+    }
+
+    RecordedMessage MakeSetCursorPosition(til::CoordType x, til::CoordType y)
+    {
+        CONSOLE_SETCURSORPOSITION_MSG body{};
+        body.CursorPosition = til::unwrap_coord({ x, y });
+        return MakeApiMessage(ConsolepSetCursorPosition, &body, sizeof(body));
+    }
+
+    RecordedMessage MakeWriteConsoleW(std::wstring_view text)
+    {
+        CONSOLE_WRITECONSOLE_MSG body{};
+        body.NumBytes = gsl::narrow_cast<ULONG>(text.size() * sizeof(wchar_t));
+        body.Unicode = TRUE;
+        return MakeApiMessage(ConsolepWriteConsole, &body, sizeof(body), text);
+    }
+
+    // Raw writes are what a client gets when it calls WriteFile() on a console handle.
+    // They have no API header and their whole input is the (narrow) text.
+    RecordedMessage MakeRawWrite(std::string_view text)
+    {
+        return { CONSOLE_IO_RAW_WRITE, { text.begin(), text.end() }, 0 };
+    }
+
+    // Replays a recorded list of messages, handing out up to `batchSize` of them per read.
+    // A batch size of 1 uses the default IDeviceComm::ReadIoBatch(), just like ConDrv does.
+    // Messages may be serviced by an OutputWorker, which is why reading input and completing messages is thread-safe.
+    class ReplayDeviceComm final : public IDeviceComm
+    {
+    public:
+        ReplayDeviceComm(std::vector<RecordedMessage> stream, size_t batchSize, void* process, void* object) :
+            _stream{ std::move(stream) },
+            _batchSize{ batchSize },
+            _process{ process },
+            _object{ object }
+        {
+        }
+
+        [[nodiscard]] HRESULT SetServerInformation(CD_IO_SERVER_INFORMATION* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        [[nodiscard]] HRESULT ReadIo(PCONSOLE_API_MSG const pReplyMsg, CONSOLE_API_MSG* const pMessage) const override
+        {
+            if (pReplyMsg)
+            {
+                _Complete(pReplyMsg->Complete);
+            }
+            RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_PIPE_NOT_CONNECTED), _next == _stream.size());
+
+            _Deliver(*pMessage);
+            batchSizes.emplace_back(1);
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT CompleteIo(CD_IO_COMPLETE* const pCompletion) const override
+        {
+            _Complete(*pCompletion);
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT ReadIoBatch(const std::span<const PCONSOLE_API_MSG> replies,
+                                          const std::span<CONSOLE_API_MSG> messages,
+                                          size_t* const pRead) const override
+        {
+            if (_batchSize == 1)
+            {
+                return IDeviceComm::ReadIoBatch(replies, messages, pRead);
+            }
+
+            *pRead = 0;
+            for (const auto reply : replies)
+            {
+                _Complete(reply->Complete);
+            }
+            RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_PIPE_NOT_CONNECTED), _next == _stream.size());
+
+            const auto count = std::min({ _batchSize, messages.size(), _stream.size() - _next });
+            for (size_t i = 0; i < count; ++i)
+            {
+                _Deliver(messages[i]);
+            }
+            batchSizes.emplace_back(count);
+            *pRead = count;
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT ReadInput(CD_IO_OPERATION* const pIoOperation) const override
+        {
+            const auto& image = _stream.at(pIoOperation->Identifier.LowPart - 1).image;
+            const auto offset = pIoOperation->Buffer.Offset;
+            const auto size = pIoOperation->Buffer.Size;
+            RETURN_HR_IF(E_INVALIDARG, offset > image.size() || size > image.size() - offset);
+
+            memcpy(pIoOperation->Buffer.Data, image.data() + offset, size);
+            const std::lock_guard guard{ _mutex };
+            lockDepths.emplace_back(ServiceLocator::LocateGlobals().getConsoleInformation().GetCSRecursionCount());
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT WriteOutput(CD_IO_OPERATION* const) const override
+        {
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT AllowUIAccess() const override
+        {
+            return S_OK;
+        }
+
+        [[nodiscard]] ULONG_PTR PutHandle(const void* handle) override
+        {
+            return reinterpret_cast<ULONG_PTR>(handle);
+        }
+
+        [[nodiscard]] void* GetHandle(ULONG_PTR handle) const override
+        {
+            return reinterpret_cast<void*>(handle);
+        }
+
+        [[nodiscard]] HRESULT GetServerHandle(HANDLE* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        size_t CompletionCount() const
+        {
+            const std::lock_guard guard{ _mutex };
+            return completions.size();
+        }
+
+        mutable std::vector<Completion> completions;
+        mutable std::vector<size_t> batchSizes;
+        mutable std::vector<ULONG> lockDepths;
+
+    private:
+        void _Deliver(CONSOLE_API_MSG& message) const
+        {
+            const auto& recorded = _stream[_next++];
+
+            message.Descriptor = {};
+            message.Descriptor.Identifier.LowPart = gsl::narrow_cast<DWORD>(_next);
+            message.Descriptor.Function = recorded.function;
+            message.Descriptor.Process = reinterpret_cast<ULONG_PTR>(_process);
+            message.Descriptor.Object = reinterpret_cast<ULONG_PTR>(_object);
+            message.Descriptor.InputSize = gsl::narrow_cast<ULONG>(recorded.image.size());
+
+            // Just like the driver, copy as much of the message into the packet as fits.
+            if (recorded.function == CONSOLE_IO_USER_DEFINED)
+            {
+                memcpy(&message.msgHeader, recorded.image.data(), sizeof(CONSOLE_MSG_HEADER) + recorded.apiDescriptorSize);
+            }
+        }
+
+        void _Complete(const CD_IO_COMPLETE& completion) const
+        {
+            const std::lock_guard guard{ _mutex };
+            completions.push_back({ completion.Identifier.LowPart, completion.IoStatus.Status, completion.IoStatus.Information });
+        }
+
+        std::vector<RecordedMessage> _stream;
+        size_t _batchSize;
+        void* _process;
+        void* _object;
+        mutable size_t _next = 0;
+        mutable std::mutex _mutex;
+    };
+}
+
+class IoSorterTests
+{
+    CommonState* m_state;
+
+    TEST_CLASS(IoSorterTests);
+
+    TEST_CLASS_SETUP(ClassSetup)
+    {
+        m_state = new CommonState();
+
+        m_state->InitEvents();
+        m_state->PrepareGlobalFont();
+        m_state->PrepareGlobalInputBuffer();
+
+        return true;
+    }
+
+    TEST_CLASS_CLEANUP(ClassCleanup)
+    {
+        m_state->CleanupGlobalFont();
+        m_state->CleanupGlobalInputBuffer();
+
+        delete m_state;
+
+        return true;
+    }
+
+    TEST_METHOD_SETUP(MethodSetup)
+    {
+        m_state->PrepareGlobalScreenBuffer();
+        return true;
+    }
+
+    TEST_METHOD_CLEANUP(MethodCleanup)
+    {
+        m_state->CleanupGlobalScreenBuffer();
+        return true;
+    }
+
+    // Runs the messages through the IO thread's loop and returns the transport for inspection.
+    static std::unique_ptr<ReplayDeviceComm> _Replay(std::vector<RecordedMessage> stream, size_t batchSize, bool useOutputWorker = false)
+    {
+        auto& globals = ServiceLocator::LocateGlobals();
+        auto& screenInfo = globals.getConsoleInformation().GetActiveOutputBuffer();
+
+        std::unique_ptr<ConsoleHandleData> handle;
+        VERIFY_SUCCEEDED(screenInfo.AllocateIoHandle(ConsoleHandleData::HandleType::Output,
+                                                     GENERIC_READ | GENERIC_WRITE,
+                                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                     handle));
+        ConsoleProcessHandle process{ GetCurrentProcessId(), GetCurrentThreadId(), 0 };
+
+        auto deviceComm = std::make_unique<ReplayDeviceComm>(std::move(stream), batchSize, &process, handle.get());
+        const auto restoreDeviceComm = wil::scope_exit([&, previous = globals.pDeviceComm]() noexcept {
+            globals.pDeviceComm = previous;
+        });
+        globals.pDeviceComm = deviceComm.get();
+
+        static constexpr size_t maxBatchSize = 16;
+        const auto storage = std::make_unique<CONSOLE_API_MSG[]>(maxBatchSize);
+        const std::span messages{ storage.get(), maxBatchSize };
+        for (auto& message : messages)
+        {
+            message._pApiRoutines = globals.api;
+            message._pDeviceComm = deviceComm.get();
+        }
+
+        std::optional<OutputWorker> outputWorker;
+        if (useOutputWorker)
+        {
+            outputWorker.emplace(4u);
+        }
+
+        std::vector<PCONSOLE_API_MSG> replies;
+        HRESULT hr;
+        while (SUCCEEDED(hr = IoSorter::ServiceNextIoBatch(*deviceComm, messages, replies, outputWorker ? &*outputWorker : nullptr)))
+        {
+        }
+        VERIFY_ARE_EQUAL(HRESULT_FROM_WIN32(ERROR_PIPE_NOT_CONNECTED), hr);
+
+        // Destroying the worker waits until it has serviced all submitted messages.
+        outputWorker.reset();
+
+        handle.release(); // leak the pointer because destruction will attempt count decrement
+        return deviceComm;
+    }
+
+    static std::vector<RecordedMessage> _MakeStream()
+    {
+        return {
+            MakeSetCursorPosition(2, 3),
+            MakeWriteConsoleW(L"Hello"),
+            MakeRawWrite("World"),
+            MakeSetCursorPosition(0, 5),
+            MakeRawWrite("!"),
+        };
+    }
+
+    static void _VerifyResults(const ReplayDeviceComm& deviceComm, size_t messageCount)
+    {
+        // Messages serviced by an OutputWorker may complete out of order relative to the others.
+        auto completions = deviceComm.completions;
+        std::ranges::sort(completions, {}, &Completion::identifier);
+        VERIFY_ARE_EQUAL(messageCount, completions.size());
+        for (size_t i = 0; i < completions.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(i + 1, completions[i].identifier);
+            VERIFY_NT_SUCCESS(completions[i].status);
+        }
+
+        // Writes report back how many bytes they consumed.
+        VERIFY_ARE_EQUAL(10u, completions[1].information);
+        VERIFY_ARE_EQUAL(5u, completions[2].information);
+        VERIFY_ARE_EQUAL(1u, completions[4].information);
+
+        const auto& textBuffer = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetTextBuffer();
+        VERIFY_ARE_EQUAL(L"HelloWorld"sv, textBuffer.GetRowByOffset(3).GetText(2, 12));
+        VERIFY_ARE_EQUAL(L"!"sv, textBuffer.GetRowByOffset(5).GetText(0, 1));
+        VERIFY_ARE_EQUAL(til::point(1, 5), textBuffer.GetCursor().GetPosition());
+    }
+
+    TEST_METHOD(ServiceOneAtATime)
+    {
+        const auto deviceComm = _Replay(_MakeStream(), 1);
+        _VerifyResults(*deviceComm, 5);
+
+        VERIFY_ARE_EQUAL(5u, deviceComm->batchSizes.size());
+
+        // Nothing holds the console lock while reading the input of a lone message.
+        for (const auto depth : deviceComm->lockDepths)
+        {
+            VERIFY_ARE_EQUAL(0u, depth);
+        }
+    }
+
+    TEST_METHOD(ServiceInBatches)
+    {
+        const auto deviceComm = _Replay(_MakeStream(), 4);
+        _VerifyResults(*deviceComm, 5);
+
+        VERIFY_ARE_EQUAL((std::vector<size_t>{ 4, 1 }), deviceComm->batchSizes);
+
+        // The first batch reads the input of WriteConsole and one raw write while holding the lock
+        // across the batch. The last one only contains a single message, which doesn't take the lock.
+        VERIFY_ARE_EQUAL((std::vector<ULONG>{ 1, 1, 0 }), deviceComm->lockDepths);
+    }
+
+    TEST_METHOD(ServiceWithOutputWorker)
+    {
+        const auto deviceComm = _Replay(_MakeStream(), 4, true);
+        _VerifyResults(*deviceComm, 5);
+
+        // Once the first write was handed to the worker, the process is busy and everything after it
+        // has to go through the worker too, so that SetConsoleCursorPosition() applies after the write.
+        std::vector<RecordedMessage> stream;
+        for (auto i = 0; i < 40; ++i)
+        {
+            stream.emplace_back(MakeSetCursorPosition(i, 6));
+            stream.emplace_back(MakeRawWrite("ab"));
+        }
+
+        const auto interleaved = _Replay(stream, 16, true);
+        VERIFY_ARE_EQUAL(stream.size(), interleaved->completions.size());
+
+        const auto& textBuffer = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetTextBuffer();
+        std::wstring expected(40, L'a');
+        expected.push_back(L'b');
+        VERIFY_ARE_EQUAL(std::wstring_view{ expected }, textBuffer.GetRowByOffset(6).GetText(0, 41));
+    }
+
+    TEST_METHOD(BatchesMatchSingleMessages)
+    {
+        std::vector<RecordedMessage> stream;
+        for (auto i = 0; i < 40; ++i)
+        {
+            stream.emplace_back(MakeSetCursorPosition(i, i % 8));
+            stream.emplace_back(MakeRawWrite("x"));
+        }
+
+        std::wstring expected[8];
+        {
+            const auto deviceComm = _Replay(stream, 1);
+            VERIFY_ARE_EQUAL(stream.size(), deviceComm->completions.size());
+
+            const auto& textBuffer = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetTextBuffer();
+            for (auto y = 0; y < 8; ++y)
+            {
+                expected[y] = textBuffer.GetRowByOffset(y).GetText();
+            }
+        }
+
+        m_state->CleanupGlobalScreenBuffer();
+        m_state->PrepareGlobalScreenBuffer();
+
+        const auto deviceComm = _Replay(stream, 16);
+        VERIFY_ARE_EQUAL(stream.size(), deviceComm->completions.size());
+        VERIFY_ARE_EQUAL((std::vector<size_t>{ 16, 16, 16, 16, 16 }), deviceComm->batchSizes);
+
+        const auto& textBuffer = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetTextBuffer();
+        for (auto y = 0; y < 8; ++y)
+        {
+            VERIFY_ARE_EQUAL(std::wstring_view{ expected[y] }, textBuffer.GetRowByOffset(y).GetText());
+        }
+    }
+
+    TEST_METHOD(ApiCallsProceedDuringLargeWrite)
+    {
+        auto& globals = ServiceLocator::LocateGlobals();
+        auto& gci = globals.getConsoleInformation();
+        auto& screenInfo = gci.GetActiveOutputBuffer();
+        WI_SetFlag(screenInfo.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        gci.SetTitle(L"start");
+
+        // The write sets the title to 0, 1, 2, ..., which makes its progress observable.
+        // It's long enough to be processed in many slices (see DoWriteConsole()).
+        static constexpr auto titleCount = 20000;
+        std::wstring text;
+        for (auto i = 0; i < titleCount; ++i)
+        {
+            text.append(L"\x1b]0;").append(std::to_wstring(i)).push_back(L'\x07');
+        }
+        const auto finalTitle = std::to_wstring(titleCount - 1);
+
+        std::unique_ptr<ConsoleHandleData> handle;
+        VERIFY_SUCCEEDED(screenInfo.AllocateIoHandle(ConsoleHandleData::HandleType::Output,
+                                                     GENERIC_READ | GENERIC_WRITE,
+                                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                     handle));
+        ConsoleProcessHandle process{ GetCurrentProcessId(), GetCurrentThreadId(), 0 };
+
+        ReplayDeviceComm deviceComm{ { MakeWriteConsoleW(text) }, 1, &process, handle.get() };
+        const auto restoreDeviceComm = wil::scope_exit([&, previous = globals.pDeviceComm]() noexcept {
+            globals.pDeviceComm = previous;
+        });
+        globals.pDeviceComm = &deviceComm;
+
+        std::optional<OutputWorker> outputWorker{ std::in_place, 4u };
+
+        CONSOLE_API_MSG message;
+        message._pApiRoutines = globals.api;
+        message._pDeviceComm = &deviceComm;
+        std::vector<PCONSOLE_API_MSG> replies;
+        VERIFY_SUCCEEDED(deviceComm.ReadIo(nullptr, &message));
+        IoSorter::ServiceIoBatch({ &message, 1 }, replies, &*outputWorker);
+        VERIFY_IS_TRUE(replies.empty());
+
+        // While the worker is busy with the write, we act as the IO thread servicing another client.
+        auto observedPartialWrite = false;
+        while (deviceComm.CompletionCount() == 0)
+        {
+            wchar_t buffer[32];
+            size_t written = 0;
+            size_t needed = 0;
+            VERIFY_SUCCEEDED(globals.api->GetConsoleTitleWImpl(buffer, written, needed));
+
+            const std::wstring_view title{ &buffer[0], written };
+            observedPartialWrite |= title != L"start"sv && title != finalTitle;
+        }
+
+        outputWorker.reset();
+
+        VERIFY_IS_TRUE(observedPartialWrite);
+        VERIFY_ARE_EQUAL(std::wstring_view{ finalTitle }, gci.GetTitle());
+
+        handle.release(); // leak the pointer because destruction will attempt count decrement
+    }
+
+    TEST_METHOD(WritesFromTwoClientsInterleave)
+    {
+        auto& globals = ServiceLocator::LocateGlobals();
+        auto& gci = globals.getConsoleInformation();
+        auto& screenInfo = gci.GetActiveOutputBuffer();
+        WI_SetFlag(screenInfo.OutputMode, ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        gci.SetTitle(L"start");
+
+        // The first client's write consists of nothing but escape sequences, many of which straddle
+        // the boundaries of the slices that DoWriteConsole() processes under a single lock acquisition.
+        static constexpr auto titleCount = 20000;
+        std::wstring text;
+        for (auto i = 0; i < titleCount; ++i)
+        {
+            text.append(L"\x1b]0;").append(std::to_wstring(i)).push_back(L'\x07');
+        }
+        const auto finalTitle = std::to_wstring(titleCount - 1);
+
+        std::unique_ptr<ConsoleHandleData> handle;
+        VERIFY_SUCCEEDED(screenInfo.AllocateIoHandle(ConsoleHandleData::HandleType::Output,
+                                                     GENERIC_READ | GENERIC_WRITE,
+                                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                     handle));
+        ConsoleProcessHandle process{ GetCurrentProcessId(), GetCurrentThreadId(), 0 };
+
+        ReplayDeviceComm deviceComm{ { MakeWriteConsoleW(text) }, 1, &process, handle.get() };
+        const auto restoreDeviceComm = wil::scope_exit([&, previous = globals.pDeviceComm]() noexcept {
+            globals.pDeviceComm = previous;
+        });
+        globals.pDeviceComm = &deviceComm;
+
+        std::optional<OutputWorker> outputWorker{ std::in_place, 4u };
+
+        CONSOLE_API_MSG message;
+        message._pApiRoutines = globals.api;
+        message._pDeviceComm = &deviceComm;
+        std::vector<PCONSOLE_API_MSG> replies;
+        VERIFY_SUCCEEDED(deviceComm.ReadIo(nullptr, &message));
+        IoSorter::ServiceIoBatch({ &message, 1 }, replies, &*outputWorker);
+        VERIFY_IS_TRUE(replies.empty());
+
+        // Meanwhile, a second client writes to the same buffer. It enters and leaves the alternate buffer,
+        // which destroys the latter, and prints a "B" which must end up in the main buffer each time.
+        // If the first client's write yielded the lock in the middle of an escape sequence, our output
+        // would get parsed as part of it: the title would end up garbled and a "B" would go missing.
+        static constexpr size_t maxWrites = 2000;
+        const auto other = L"\x1b[?1049h\x1b[?1049lB"sv;
+        size_t writes = 0;
+        size_t interleavedWrites = 0;
+        while (deviceComm.CompletionCount() == 0 && writes < maxWrites)
+        {
+            size_t read = 0;
+            std::unique_ptr<IWaitRoutine> waiter;
+            VERIFY_SUCCEEDED(globals.api->WriteConsoleWImpl(screenInfo, other, read, false, waiter));
+            VERIFY_ARE_EQUAL(other.size(), read);
+            VERIFY_IS_NULL(waiter.get());
+            writes++;
+
+            wchar_t buffer[32];
+            size_t written = 0;
+            size_t needed = 0;
+            VERIFY_SUCCEEDED(globals.api->GetConsoleTitleWImpl(buffer, written, needed));
+
+            const std::wstring_view title{ &buffer[0], written };
+            if (title != L"start"sv)
+            {
+                VERIFY_IS_TRUE(std::ranges::all_of(title, [](wchar_t ch) { return ch >= L'0' && ch <= L'9'; }));
+                interleavedWrites += title != finalTitle;
+            }
+        }
+
+        outputWorker.reset();
+
+        VERIFY_ARE_EQUAL(1u, deviceComm.completions.size());
+        VERIFY_NT_SUCCESS(deviceComm.completions[0].status);
+        VERIFY_ARE_EQUAL(std::wstring_view{ finalTitle }, gci.GetTitle());
+        VERIFY_IS_GREATER_THAN(interleavedWrites, size_t{ 0 });
+
+        VERIFY_ARE_EQUAL(&screenInfo, &screenInfo.GetActiveBuffer());
+        const auto& textBuffer = screenInfo.GetTextBuffer();
+        size_t count = 0;
+        for (til::CoordType y = 0; y <= textBuffer.GetCursor().GetPosition().y; ++y)
+        {
+            const auto row = textBuffer.GetRowByOffset(y).GetText();
+            count += gsl::narrow_cast<size_t>(std::ranges::count(row, L'B'));
+        }
+        VERIFY_ARE_EQUAL(writes, count);
+
+        handle.release(); // leak the pointer because destruction will attempt count decrement
+    }
+};
@@ -140,6 +140,8 @@ class TextBufferTests
     TEST_METHOD(TestOverwriteChars);
     TEST_METHOD(TestReplace);
     TEST_METHOD(TestInsert);
+    TEST_METHOD(TestCharInfos);
+    TEST_METHOD(TestScrollRows);
 
     TEST_METHOD(TestAppendRTFText);
 
@@ -1983,34 +1985,149 @@ void TextBufferTests::TestInsert()
     VERIFY_ARE_EQUAL(expectedAttr, actualAttr);
 }
 
+void TextBufferTests::TestCharInfos()
+{
+    static constexpr til::size bufferSize{ 20, 1 };
+    static constexpr UINT cursorSize = 12;
+    TextBuffer buffer{ bufferSize, TextAttribute{ 0x07 }, cursorSize, false, &_renderer };
+    auto& row = buffer.GetMutableRowByOffset(0);
+
+    // Long enough for both the vectorized and the scalar code paths. The box drawing
+    // character isn't ASCII, but it must still end up in a single column of its own.
+    std::array<CHAR_INFO, 18> written{};
+    std::wstring expectedText{ L" " };
+    for (size_t i = 0; i < written.size(); ++i)
+    {
+        written[i].Char.UnicodeChar = i == 12 ? L'\x2500' : gsl::narrow_cast<wchar_t>(L'a' + i);
+        written[i].Attributes = gsl::narrow_cast<WORD>(i < 10 ? 0x1f : 0x2e);
+        expectedText.push_back(written[i].Char.UnicodeChar);
+    }
+    expectedText.push_back(L' ');
+
+    Log::Comment(L"Write a row of CHAR_INFOs with 2 colors");
+    VERIFY_IS_TRUE(row.WriteCharInfos(1, written));
+    VERIFY_ARE_EQUAL(expectedText, row.GetText());
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x07 }, row.GetAttrByColumn(0));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x1f }, row.GetAttrByColumn(10));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x2e }, row.GetAttrByColumn(11));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x07 }, row.GetAttrByColumn(19));
+
+    Log::Comment(L"Read them back");
+    std::array<CHAR_INFO, 18> read{};
+    row.ReadCharInfos(1, read);
+    for (size_t i = 0; i < read.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(written[i].Char.UnicodeChar, read[i].Char.UnicodeChar);
+        VERIFY_ARE_EQUAL(written[i].Attributes, read[i].Attributes);
+    }
+
+    Log::Comment(L"Halves of wide glyphs are rejected without modifying the row");
+    const std::array wide{ CHAR_INFO{ { L'\x30A2' }, 0x07 | COMMON_LVB_LEADING_BYTE }, CHAR_INFO{ { L'\x30A2' }, 0x07 | COMMON_LVB_TRAILING_BYTE } };
+    VERIFY_IS_FALSE(row.WriteCharInfos(0, wide));
+    VERIFY_ARE_EQUAL(expectedText, row.GetText());
+
+    Log::Comment(L"Wide glyphs are read as leading/trailing halves and surrogate pairs as U+FFFD");
+    row.ReplaceCharacters(2, 2, L"\x30A2");
+    row.ReplaceCharacters(5, 2, L"\U0001F600");
+    read = {};
+    row.ReadCharInfos(2, std::span{ read }.first(5));
+    VERIFY_ARE_EQUAL(L'\x30A2', read[0].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(0x1f | COMMON_LVB_LEADING_BYTE), read[0].Attributes);
+    VERIFY_ARE_EQUAL(L'\x30A2', read[1].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(0x1f | COMMON_LVB_TRAILING_BYTE), read[1].Attributes);
+    VERIFY_ARE_EQUAL(L'd', read[2].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(UNICODE_REPLACEMENT, read[3].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(0x1f | COMMON_LVB_LEADING_BYTE), read[3].Attributes);
+    VERIFY_ARE_EQUAL(UNICODE_REPLACEMENT, read[4].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(0x1f | COMMON_LVB_TRAILING_BYTE), read[4].Attributes);
+
+    Log::Comment(L"CHAR_INFOs past the end of the row are left untouched");
+    read = {};
+    row.ReadCharInfos(16, read);
+    VERIFY_ARE_EQUAL(L'\0', read[4].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(L' ', read[3].Char.UnicodeChar);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(0x07), read[3].Attributes);
+}
+
+void TextBufferTests::TestScrollRows()
+{
+    static constexpr til::size bufferSize{ 1, 10 };
+    static constexpr UINT cursorSize = 12;
+    TextBuffer buffer{ bufferSize, TextAttribute{ 0x07 }, cursorSize, false, &_renderer };
+
+    // Each row holds a single letter, which makes it easy to see where the rows ended up.
+    // They're separated by spaces to keep the expected strings readable.
+    const auto fill = [&]() {
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            const wchar_t ch = gsl::narrow_cast<wchar_t>(L'a' + y);
+            buffer.GetMutableRowByOffset(y).ReplaceCharacters(0, 1, { &ch, 1 });
+        }
+    };
+    const auto rows = [&]() {
+        std::wstring text;
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            if (y != 0)
+            {
+                text.push_back(L' ');
+            }
+            text.push_back(buffer.GetRowByOffset(y).GetText().front());
+        }
+        return text;
+    };
+
+    fill();
+
+    Log::Comment(L"Scrolling up leaves the last source row untouched");
+    buffer.ScrollRows(3, 5, -1);
+    VERIFY_ARE_EQUAL(std::wstring{ L"a b d e f g h h i j" }, rows());
+
+    Log::Comment(L"Scrolling down leaves the first source rows untouched");
+    buffer.ScrollRows(2, 5, 2);
+    VERIFY_ARE_EQUAL(std::wstring{ L"a b d e d e f g h j" }, rows());
+
+    Log::Comment(L"Non-overlapping ranges are copied");
+    buffer.ScrollRows(0, 2, 5);
+    VERIFY_ARE_EQUAL(std::wstring{ L"a b d e d a b g h j" }, rows());
+
+    Log::Comment(L"Ranges that wrap around the end of the circular buffer");
+    buffer._SetFirstRowIndex(7);
+    fill();
+    buffer.ScrollRows(1, 9, -1);
+    VERIFY_ARE_EQUAL(std::wstring{ L"b c d e f g h i j j" }, rows());
+    buffer.ScrollRows(0, 8, 2);
+    VERIFY_ARE_EQUAL(std::wstring{ L"b c b c d e f g h i" }, rows());
+}
+
 void TextBufferTests::TestAppendRTFText()
 {
     {
-        std::string contentStream;
+        std::pmr::string contentStream{ til::pmr::get_default_resource() };
         const auto ascii = L"This is some Ascii \\ {}";
         TextBuffer::_AppendRTFText(contentStream, ascii);
-        VERIFY_ARE_EQUAL("This is some Ascii \\\\ \\{\\}", contentStream);
+        VERIFY_ARE_EQUAL("This is some Ascii \\\\ \\{\\}", std::string_view{ contentStream });
     }
     {
-        std::string contentStream;
+        std::pmr::string contentStream{ til::pmr::get_default_resource() };
         // "Low code units: á é í ó ú ⮁ ⮂" in UTF-16
         const auto lowCodeUnits = L"Low code units: \x00E1 \x00E9 \x00ED \x00F3 \x00FA \x2B81 \x2B82";
         TextBuffer::_AppendRTFText(contentStream, lowCodeUnits);
-        VERIFY_ARE_EQUAL("Low code units: \\u225? \\u233? \\u237? \\u243? \\u250? \\u11137? \\u11138?", contentStream);
+        VERIFY_ARE_EQUAL("Low code units: \\u225? \\u233? \\u237? \\u243? \\u250? \\u11137? \\u11138?", std::string_view{ contentStream });
     }
     {
-        std::string contentStream;
+        std::pmr::string contentStream{ til::pmr::get_default_resource() };
         // "High code units: ꞵ ꞷ" in UTF-16
         const auto highCodeUnits = L"High code units: \xA7B5 \xA7B7";
         TextBuffer::_AppendRTFText(contentStream, highCodeUnits);
-        VERIFY_ARE_EQUAL("High code units: \\u-22603? \\u-22601?", contentStream);
+        VERIFY_ARE_EQUAL("High code units: \\u-22603? \\u-22601?", std::string_view{ contentStream });
     }
     {
-        std::string contentStream;
+        std::pmr::string contentStream{ til::pmr::get_default_resource() };
         // "Surrogates: 🍦 👾 👀" in UTF-16
         const auto surrogates = L"Surrogates: \xD83C\xDF66 \xD83D\xDC7E \xD83D\xDC40";
         TextBuffer::_AppendRTFText(contentStream, surrogates);
-        VERIFY_ARE_EQUAL("Surrogates: \\u-10180?\\u-8346? \\u-10179?\\u-9090? \\u-10179?\\u-9152?", contentStream);
+        VERIFY_ARE_EQUAL("Surrogates: \\u-10180?\\u-8346? \\u-10179?\\u-9090? \\u-10179?\\u-9152?", std::string_view{ contentStream });
     }
 }
 
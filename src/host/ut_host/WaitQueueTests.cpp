@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "CommonState.hpp"
+
+#include "../../server/ApiSorter.h"
+#include "../../server/ProcessHandle.h"
+#include "../../server/WaitQueue.h"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+using Microsoft::Console::Interactivity::ServiceLocator;
+
+namespace
+{
+    // Stands in for the driver. All we need is for it to resolve the handles of the messages and to record their completions.
+    class CompletionDeviceComm final : public IDeviceComm
+    {
+    public:
+        [[nodiscard]] HRESULT SetServerInformation(CD_IO_SERVER_INFORMATION* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        [[nodiscard]] HRESULT ReadIo(PCONSOLE_API_MSG const, CONSOLE_API_MSG* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        [[nodiscard]] HRESULT CompleteIo(CD_IO_COMPLETE* const pCompletion) const override
+        {
+            completions.emplace_back(pCompletion->Identifier.LowPart, pCompletion->IoStatus.Status);
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT ReadInput(CD_IO_OPERATION* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        [[nodiscard]] HRESULT WriteOutput(CD_IO_OPERATION* const) const override
+        {
+            return S_OK;
+        }
+
+        [[nodiscard]] HRESULT AllowUIAccess() const override
+        {
+            return S_OK;
+        }
+
+        [[nodiscard]] ULONG_PTR PutHandle(const void* handle) override
+        {
+            return reinterpret_cast<ULONG_PTR>(handle);
+        }
+
+        [[nodiscard]] void* GetHandle(ULONG_PTR handle) const override
+        {
+            return reinterpret_cast<void*>(handle);
+        }
+
+        [[nodiscard]] HRESULT GetServerHandle(HANDLE* const) const override
+        {
+            return E_NOTIMPL;
+        }
+
+        mutable std::vector<std::pair<ULONG, NTSTATUS>> completions;
+    };
+
+    // Stands in for a blocked ReadConsole. Just like RAW_READ_DATA it keeps waiting on ctrl-c and gives up on any other
+    // termination reason. Otherwise it's satisfied if `available` says that there's data left to consume.
+    class TestReader final : public IWaitRoutine
+    {
+    public:
+        TestReader(size_t& available, size_t& notifications) noexcept :
+            IWaitRoutine{ ReplyDataType::Read },
+            _available{ available },
+            _notifications{ notifications }
+        {
+        }
+
+        void MigrateUserBuffersOnTransitionToBackgroundWait(const void*, void*) override
+        {
+        }
+
+        bool Notify(const WaitTerminationReason TerminationReason,
+                    const bool,
+                    _Out_ NTSTATUS* const pReplyStatus,
+                    _Out_ size_t* const pNumBytes,
+                    _Out_ DWORD* const pControlKeyState,
+                    _Out_ void* const) override
+        {
+            _notifications++;
+            *pReplyStatus = STATUS_SUCCESS;
+            *pNumBytes = 0;
+            *pControlKeyState = 0;
+
+            if (WI_IsFlagSet(TerminationReason, WaitTerminationReason::CtrlC))
+            {
+                return false;
+            }
+            if (TerminationReason != WaitTerminationReason::NoReason)
+            {
+                *pReplyStatus = STATUS_ALERTED;
+                return true;
+            }
+            if (_available == 0)
+            {
+                return false;
+            }
+
+            _available--;
+            *pNumBytes = sizeof(wchar_t);
+            return true;
+        }
+
+    private:
+        size_t& _available;
+        size_t& _notifications;
+    };
+}
+
+class WaitQueueTests
+{
+    CommonState* m_state;
+
+    TEST_CLASS(WaitQueueTests);
+
+    TEST_CLASS_SETUP(ClassSetup)
+    {
+        m_state = new CommonState();
+
+        m_state->PrepareGlobalInputBuffer();
+
+        return true;
+    }
+
+    TEST_CLASS_CLEANUP(ClassCleanup)
+    {
+        m_state->CleanupGlobalInputBuffer();
+
+        delete m_state;
+
+        return true;
+    }
+
+    TEST_METHOD(TargetedWakeupsWithManyWaiters)
+    {
+        static constexpr ULONG processCount = 20;
+        static constexpr ULONG handleCount = 50;
+        static constexpr ULONG waiterCount = 500;
+
+        auto& globals = ServiceLocator::LocateGlobals();
+        auto& inputBuffer = *globals.getConsoleInformation().pInputBuffer;
+
+        CompletionDeviceComm deviceComm;
+        const auto restoreDeviceComm = wil::scope_exit([&, previous = globals.pDeviceComm]() noexcept {
+            globals.pDeviceComm = previous;
+        });
+        globals.pDeviceComm = &deviceComm;
+
+        // The processes are declared after the handles, because they complete all of their remaining waits with
+        // ThreadDying when they're destroyed. The handles on the other hand must not have any waits left at that point.
+        std::vector<std::unique_ptr<ConsoleHandleData>> handles(handleCount);
+        std::vector<std::unique_ptr<ConsoleProcessHandle>> processes(processCount);
+
+        for (auto& handle : handles)
+        {
+            VERIFY_SUCCEEDED(inputBuffer.AllocateIoHandle(ConsoleHandleData::HandleType::Input,
+                                                          GENERIC_READ | GENERIC_WRITE,
+                                                          FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                          handle));
+        }
+        for (auto& process : processes)
+        {
+            process = std::make_unique<ConsoleProcessHandle>(GetCurrentProcessId(), GetCurrentThreadId(), 0);
+        }
+
+        size_t available = 0;
+        size_t notifications = 0;
+
+        // Waiter i is issued by process i % processCount on handle i % handleCount and its message identifier is i + 1.
+        Log::Comment(L"Block a few hundred reads spread across processes and handles");
+        for (ULONG i = 0; i < waiterCount; ++i)
+        {
+            CONSOLE_API_MSG message;
+            message._pDeviceComm = &deviceComm;
+            message.Descriptor = {};
+            message.Descriptor.Identifier.LowPart = i + 1;
+            message.Descriptor.Process = reinterpret_cast<ULONG_PTR>(processes[i % processCount].get());
+            message.Descriptor.Object = reinterpret_cast<ULONG_PTR>(handles[i % handleCount].get());
+            message.msgHeader.ApiNumber = API_NUMBER_READCONSOLE;
+            message.u.consoleMsgL1.ReadConsole = {};
+            message.u.consoleMsgL1.ReadConsole.Unicode = TRUE;
+
+            VERIFY_SUCCEEDED(ConsoleWaitQueue::s_CreateWait(&message, new TestReader{ available, notifications }));
+        }
+        VERIFY_ARE_EQUAL(0u, deviceComm.completions.size());
+
+        Log::Comment(L"New input only ever notifies the longest waiting reader");
+        for (ULONG i = 0; i < 100; ++i)
+        {
+            available = 1;
+            inputBuffer.WakeUpReadersWaitingForData();
+        }
+        VERIFY_ARE_EQUAL(100u, notifications);
+        VERIFY_ARE_EQUAL(100u, deviceComm.completions.size());
+        for (ULONG i = 0; i < 100; ++i)
+        {
+            VERIFY_ARE_EQUAL(i + 1, deviceComm.completions[i].first);
+            VERIFY_ARE_EQUAL(STATUS_SUCCESS, deviceComm.completions[i].second);
+        }
+
+        Log::Comment(L"Closing a handle only alerts the reads that are waiting on it");
+        notifications = 0;
+        deviceComm.completions.clear();
+        const auto closing = handles[7].get();
+        VERIFY_IS_TRUE(inputBuffer.WaitQueue.NotifyWaiters(true, WaitTerminationReason::HandleClosing, closing));
+        // 10 of the 500 waiters were issued on this handle, but the first 100 have already been completed above.
+        VERIFY_ARE_EQUAL(8u, notifications);
+        VERIFY_ARE_EQUAL(8u, deviceComm.completions.size());
+        for (ULONG i = 0; i < 8; ++i)
+        {
+            VERIFY_ARE_EQUAL(107 + i * handleCount + 1, deviceComm.completions[i].first);
+            VERIFY_ARE_EQUAL(STATUS_ALERTED, deviceComm.completions[i].second);
+        }
+        VERIFY_IS_FALSE(inputBuffer.WaitQueue.NotifyWaiters(true, WaitTerminationReason::HandleClosing, closing));
+        VERIFY_ARE_EQUAL(8u, notifications);
+
+        Log::Comment(L"Ctrl+C is seen by everyone, but doesn't complete any of the reads");
+        notifications = 0;
+        deviceComm.completions.clear();
+        inputBuffer.TerminateRead(WaitTerminationReason::CtrlC);
+        VERIFY_ARE_EQUAL(392u, notifications);
+        VERIFY_ARE_EQUAL(0u, deviceComm.completions.size());
+
+        Log::Comment(L"A process going away only completes its own reads");
+        notifications = 0;
+        processes[3].reset();
+        VERIFY_ARE_EQUAL(20u, notifications);
+        VERIFY_ARE_EQUAL(20u, deviceComm.completions.size());
+        for (const auto& [identifier, status] : deviceComm.completions)
+        {
+            VERIFY_ARE_EQUAL(3u, (identifier - 1) % processCount);
+            VERIFY_ARE_EQUAL(STATUS_THREAD_IS_TERMINATING, status);
+        }
+
+        Log::Comment(L"The remaining reads are still served in the order they arrived in");
+        notifications = 0;
+        deviceComm.completions.clear();
+        available = 1;
+        inputBuffer.WakeUpReadersWaitingForData();
+        VERIFY_ARE_EQUAL(1u, notifications);
+        VERIFY_ARE_EQUAL(1u, deviceComm.completions.size());
+        VERIFY_ARE_EQUAL(101u, deviceComm.completions[0].first);
+
+        processes.clear();
+        VERIFY_ARE_EQUAL(0u, available);
+    }
+};
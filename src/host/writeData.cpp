@@ -85,6 +85,19 @@ void WriteData::SetUtf8ConsumedCharacters(const size_t cchUtf8Consumed)
     _cchUtf8Consumed = cchUtf8Consumed;
 }
 
+// Routine Description:
+// - Remembers how much of the text was written before the wait began. This happens when output gets suspended
+//   in the middle of a large write (see DoWriteConsole()). Notify() then only writes the remainder,
+//   but still reports the entire text as written, since that's what the client asked for.
+// Arguments:
+// - cbWritten - Count of bytes at the start of the text that have already been written.
+// Return Value:
+// - <none>
+void WriteData::SetBytesAlreadyWritten(const size_t cbWritten) noexcept
+{
+    _cbWritten = cbWritten;
+}
+
 // Routine Description:
 // - Called back at a later time to resume the writing operation when the output object becomes unblocked.
 // Arguments:
@@ -122,8 +135,8 @@ bool WriteData::Notify(const WaitTerminationReason TerminationReason,
     FAIL_FAST_IF(!(Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked()));
 
     std::unique_ptr<WriteData> waiter;
-    auto cbContext = _cbContext;
-    auto Status = DoWriteConsole(_pwchContext,
+    auto cbContext = _cbContext - _cbWritten;
+    auto Status = DoWriteConsole(_pwchContext + _cbWritten / sizeof(wchar_t),
                                  &cbContext,
                                  _siContext,
                                  _requiresVtQuirk,
@@ -136,6 +149,8 @@ bool WriteData::Notify(const WaitTerminationReason TerminationReason,
         return false;
     }
 
+    cbContext += _cbWritten;
+
     // There's extra work to do to correct the byte counts if the original call was an A-version call.
     // We always process and hold text in the waiter as W-version text, but the A call is expecting
     // a byte value in its own codepage of how much we have written in that codepage.
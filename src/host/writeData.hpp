@@ -36,6 +36,8 @@ public:
 
     void SetUtf8ConsumedCharacters(const size_t cchUtf8Consumed);
 
+    void SetBytesAlreadyWritten(const size_t cbWritten) noexcept;
+
     void MigrateUserBuffersOnTransitionToBackgroundWait(const void* oldBuffer, void* newBuffer) override;
     bool Notify(const WaitTerminationReason TerminationReason,
                 const bool fIsUnicode,
@@ -48,6 +50,7 @@ private:
     SCREEN_INFORMATION& _siContext;
     wchar_t* const _pwchContext;
     const size_t _cbContext;
+    size_t _cbWritten = 0;
     UINT const _uiOutputCodepage;
     bool _requiresVtQuirk;
     bool _fLeadByteCaptured;
@@ -0,0 +1,314 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <memory_resource>
+#include <span>
+
+namespace til
+{
+    // An arena (or "bump allocator") hands out memory by incrementing a position within a large block
+    // of memory and frees it all at once by resetting the position. This makes allocations about as
+    // cheap as they can be and is a good fit for scratch data whose lifetime is bound to a frame, a
+    // parse or a function call. Since nothing is freed individually, destructors aren't run either,
+    // which is why it only hands out memory for trivially destructible types.
+    //
+    // The memory is reserved upfront as a single range of virtual memory and only committed as needed.
+    // This means that the returned pointers stay valid until they're popped, unlike with a std::vector.
+    //
+    // In debug builds, newly allocated memory is filled with 0xCD and popped memory with 0xDD.
+    class arena
+    {
+    public:
+        // The reservation size of the arenas returned by get_scratch_arena().
+        static constexpr size_t default_reserve = sizeof(void*) >= 8 ? size_t{ 1 } << 30 : size_t{ 64 } << 20;
+
+        explicit arena(size_t reserve = default_reserve) :
+            _reserve{ (reserve + commit_granularity - 1) & ~(commit_granularity - 1) }
+        {
+            _base = static_cast<uint8_t*>(VirtualAlloc(nullptr, _reserve, MEM_RESERVE, PAGE_READWRITE));
+            if (!_base)
+            {
+                throw std::bad_alloc{};
+            }
+        }
+
+        ~arena()
+        {
+            if (_base)
+            {
+                VirtualFree(_base, 0, MEM_RELEASE);
+            }
+        }
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        arena(arena&& other) noexcept :
+            _base{ std::exchange(other._base, nullptr) },
+            _reserve{ std::exchange(other._reserve, 0) },
+            _commit{ std::exchange(other._commit, 0) },
+            _pos{ std::exchange(other._pos, 0) }
+        {
+        }
+
+        arena& operator=(arena&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_base)
+                {
+                    VirtualFree(_base, 0, MEM_RELEASE);
+                }
+                _base = std::exchange(other._base, nullptr);
+                _reserve = std::exchange(other._reserve, 0);
+                _commit = std::exchange(other._commit, 0);
+                _pos = std::exchange(other._pos, 0);
+            }
+            return *this;
+        }
+
+        // The number of bytes currently in use. Pass it to pop_to() to free everything allocated after this call.
+        size_t position() const noexcept
+        {
+            return _pos;
+        }
+
+        // The number of bytes currently backed by memory.
+        size_t committed() const noexcept
+        {
+            return _commit;
+        }
+
+        // Frees all allocations that were made after position() returned `pos`.
+        void pop_to(size_t pos) noexcept
+        {
+            if (pos >= _pos)
+            {
+                return;
+            }
+
+#ifndef NDEBUG
+            memset(_base + pos, 0xDD, _pos - pos);
+#endif
+            _pos = pos;
+
+            // Give memory back to the OS if an unusually large allocation left a lot of it behind.
+            // The retained amount ensures that we don't end up committing the same pages over
+            // and over again if the arena is used for similarly sized allocations.
+            const auto keep = (pos + decommit_retain + commit_granularity - 1) & ~(commit_granularity - 1);
+            if (_commit > keep)
+            {
+#pragma warning(suppress : 6250) // Calling 'VirtualFree' without the MEM_RELEASE flag might free memory but not address descriptors (VADs).
+                VirtualFree(_base + keep, _commit - keep, MEM_DECOMMIT);
+                _commit = keep;
+            }
+        }
+
+        // Frees all allocations.
+        void clear() noexcept
+        {
+            pop_to(0);
+        }
+
+        // Returns uninitialized memory of the given size and alignment. The alignment must be a power of two.
+        [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+        {
+            const auto mask = alignment - 1;
+            const auto beg = (_pos + mask) & ~mask;
+            const auto end = beg + bytes;
+
+            if (end > _commit || end < beg) [[unlikely]]
+            {
+                _grow(end, beg);
+            }
+
+            const auto ptr = _base + beg;
+            _pos = end;
+#ifndef NDEBUG
+            memset(ptr, 0xCD, bytes);
+#endif
+            return ptr;
+        }
+
+        template<typename T>
+        [[nodiscard]] std::span<T> push_uninitialized(size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>);
+            return { static_cast<T*>(allocate(_byte_size<T>(count), alignof(T))), count };
+        }
+
+        template<typename T>
+        [[nodiscard]] std::span<T> push_zeroed(size_t count)
+        {
+            const auto span = push_uninitialized<T>(count);
+            memset(span.data(), 0, span.size_bytes());
+            return span;
+        }
+
+        // Copies the given items into the arena.
+        template<typename T>
+        [[nodiscard]] std::span<T> push_copy(std::span<const T> items)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto span = push_uninitialized<T>(items.size());
+            if (!items.empty())
+            {
+                memcpy(span.data(), items.data(), items.size_bytes());
+            }
+            return span;
+        }
+
+        // Copies the given string into the arena. The result is not null-terminated.
+        template<typename T, typename Traits>
+        [[nodiscard]] std::basic_string_view<T, Traits> push_copy(std::basic_string_view<T, Traits> str)
+        {
+            const auto span = push_copy(std::span<const T>{ str.data(), str.size() });
+            return { span.data(), span.size() };
+        }
+
+    private:
+        // VirtualAlloc() reserves memory in 64KiB chunks and so do we.
+        static constexpr size_t commit_granularity = 64 * 1024;
+        static constexpr size_t decommit_retain = 4 * 1024 * 1024;
+
+        template<typename T>
+        static size_t _byte_size(size_t count)
+        {
+            if (count > SIZE_MAX / sizeof(T))
+            {
+                throw std::bad_array_new_length{};
+            }
+            return count * sizeof(T);
+        }
+
+        __declspec(noinline) void _grow(size_t end, size_t beg)
+        {
+            if (end < beg || end > _reserve)
+            {
+                throw std::bad_alloc{};
+            }
+
+            const auto commit = (end + commit_granularity - 1) & ~(commit_granularity - 1);
+            if (!VirtualAlloc(_base + _commit, commit - _commit, MEM_COMMIT, PAGE_READWRITE))
+            {
+                throw std::bad_alloc{};
+            }
+
+            _commit = commit;
+        }
+
+        uint8_t* _base = nullptr;
+        size_t _reserve = 0;
+        size_t _commit = 0;
+        size_t _pos = 0;
+    };
+
+    // Restores the position of an arena when it goes out of scope,
+    // which frees everything that was allocated in the meantime.
+    class arena_scope
+    {
+    public:
+        explicit arena_scope(til::arena& arena) noexcept :
+            _arena{ arena },
+            _pos{ arena.position() }
+        {
+        }
+
+        ~arena_scope()
+        {
+            _arena.pop_to(_pos);
+        }
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+        til::arena& get() const noexcept
+        {
+            return _arena;
+        }
+
+        operator til::arena&() const noexcept
+        {
+            return _arena;
+        }
+
+        til::arena* operator->() const noexcept
+        {
+            return &_arena;
+        }
+
+    private:
+        til::arena& _arena;
+        size_t _pos;
+    };
+
+    // Allows standard containers to allocate from an arena, for instance std::pmr::vector or std::pmr::wstring.
+    // Deallocations are ignored and the memory is only freed once the arena is popped.
+    // Unlike the arena itself, this supports types with destructors, because the containers run them.
+    class arena_resource final : public std::pmr::memory_resource
+    {
+    public:
+        explicit arena_resource(til::arena& arena) noexcept :
+            _arena{ arena }
+        {
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            return _arena.allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void*, size_t, size_t) noexcept override
+        {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        til::arena& _arena;
+    };
+
+    namespace details
+    {
+        // This is based on an idea publicly described by Ryan Fleury as "scratch arena".
+        // Assuming you have "persistent" data and "scratch" data, where the former is data that is returned to
+        // the caller (= upwards) and the latter is data that is used locally, including calls (= downwards).
+        // The fundamental realisation now is that regular, linear function calls (not coroutines) are sufficiently
+        // covered with just N+1 arenas, where N is the number of in-flight "persistent" arenas across a call stack.
+        // Often N is 1, because in most code, there's only 1 arena being passed as a parameter at a time.
+        // This is also what this code specializes for.
+        //
+        // For instance, imagine you call A, which calls B, which calls C, and all 3 of those want to
+        // return data and also allocate data for themselves, and that you have 2 arenas: 1 and 2.
+        // Down in C the two arenas now look like this:
+        //   1: [A (return)][B (local) ][C (return)]
+        //   2: [A (local) ][B (return)][C (local) ]
+        //
+        // Now when each call returns and the arena's position is popped to the state before the call, this
+        // interleaving ensures that you neither pop local data from, nor return data intended for a parent call.
+        inline arena_scope get_scratch_arena(const arena* conflict)
+        {
+            thread_local arena arenas[2];
+            return arena_scope{ arenas[conflict == &arenas[0]] };
+        }
+    }
+
+    // Returns one of two thread-local arenas for temporary allocations, which are freed when the returned scope ends.
+    // The memory stays committed across calls (up to a limit), which avoids heap traffic in hot paths.
+    [[nodiscard]] inline arena_scope get_scratch_arena()
+    {
+        return details::get_scratch_arena(nullptr);
+    }
+
+    // Same as get_scratch_arena(), but guaranteed to not return the given arena,
+    // which is usually the arena a function was given to allocate its return value in.
+    [[nodiscard]] inline arena_scope get_scratch_arena(const arena& conflict)
+    {
+        return details::get_scratch_arena(&conflict);
+    }
+}
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <bit>
+
 #include "rect.h"
 
 #ifdef UNIT_TESTING
@@ -13,6 +15,259 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 {
     namespace details
     {
+        // A fixed-size bitset that stores its bits in machine words. Unlike dynamic_bitset it offers the operations
+        // til::bitmap needs at word granularity: Filling ranges of bits, finding the next set and the next unset bit
+        // (using count-trailing-zeros) and combining two bitsets. All bits past size() are kept unset.
+        template<typename Allocator>
+        class bitmap_bits
+        {
+        public:
+            using word_type = size_t;
+            static constexpr size_t word_bits = sizeof(word_type) * CHAR_BIT;
+            static constexpr word_type all_ones = ~word_type{ 0 };
+
+            explicit bitmap_bits(const Allocator& allocator) noexcept :
+                _words{ allocator }
+            {
+            }
+
+            bitmap_bits(size_t size, bool value, const Allocator& allocator) :
+                _words((size + word_bits - 1) / word_bits, value ? all_ones : 0, allocator),
+                _size{ size }
+            {
+                _clear_unused_bits();
+            }
+
+            bool operator==(const bitmap_bits& other) const noexcept
+            {
+                return _size == other._size && std::equal(_words.begin(), _words.end(), other._words.begin(), other._words.end());
+            }
+
+            size_t size() const noexcept
+            {
+                return _size;
+            }
+
+            bool operator[](size_t pos) const noexcept
+            {
+                return (_words[pos / word_bits] >> (pos % word_bits)) & 1;
+            }
+
+            void set(size_t pos) noexcept
+            {
+                _words[pos / word_bits] |= word_type{ 1 } << (pos % word_bits);
+            }
+
+            // Sets the `count` bits starting at `pos`.
+            void set(size_t pos, size_t count) noexcept
+            {
+                if (count == 0)
+                {
+                    return;
+                }
+
+                const auto last = pos + count - 1;
+                const auto begWord = pos / word_bits;
+                const auto endWord = last / word_bits;
+                const auto begMask = all_ones << (pos % word_bits);
+                const auto endMask = all_ones >> (word_bits - 1 - last % word_bits);
+
+                if (begWord == endWord)
+                {
+                    _words[begWord] |= begMask & endMask;
+                    return;
+                }
+
+                _words[begWord] |= begMask;
+                std::fill(_words.begin() + begWord + 1, _words.begin() + endWord, all_ones);
+                _words[endWord] |= endMask;
+            }
+
+            void set_all() noexcept
+            {
+                std::fill(_words.begin(), _words.end(), all_ones);
+                _clear_unused_bits();
+            }
+
+            void reset_all() noexcept
+            {
+                std::fill(_words.begin(), _words.end(), word_type{ 0 });
+            }
+
+            bool none() const noexcept
+            {
+                return std::all_of(_words.begin(), _words.end(), [](word_type w) { return w == 0; });
+            }
+
+            bool all() const noexcept
+            {
+                if (_words.empty())
+                {
+                    return true;
+                }
+
+                const auto last = _words.end() - 1;
+                return std::all_of(_words.begin(), last, [](word_type w) { return w == all_ones; }) && *last == _last_word_mask();
+            }
+
+            size_t count() const noexcept
+            {
+                size_t count = 0;
+                for (const auto w : _words)
+                {
+                    count += std::popcount(w);
+                }
+                return count;
+            }
+
+            // Returns the position of the first set bit at or after `pos`, or size() if there is none.
+            size_t find_next(size_t pos) const noexcept
+            {
+                if (pos >= _size)
+                {
+                    return _size;
+                }
+
+                auto idx = pos / word_bits;
+                auto word = _words[idx] & (all_ones << (pos % word_bits));
+
+                while (!word)
+                {
+                    if (++idx >= _words.size())
+                    {
+                        return _size;
+                    }
+                    word = _words[idx];
+                }
+
+                return idx * word_bits + std::countr_zero(word);
+            }
+
+            // Returns the position of the first unset bit at or after `pos`, or `limit` if there's none before it.
+            size_t find_next_unset(size_t pos, size_t limit) const noexcept
+            {
+                if (pos >= limit)
+                {
+                    return limit;
+                }
+
+                auto idx = pos / word_bits;
+                auto word = ~_words[idx] & (all_ones << (pos % word_bits));
+
+                while (!word)
+                {
+                    if (++idx * word_bits >= limit)
+                    {
+                        return limit;
+                    }
+                    word = ~_words[idx];
+                }
+
+                return std::min(limit, idx * word_bits + std::countr_zero(word));
+            }
+
+            // Moves every bit `n` positions towards the end. The bits at the start become unset.
+            void shift_up(size_t n) noexcept
+            {
+                if (n >= _size)
+                {
+                    reset_all();
+                    return;
+                }
+
+                const auto wordShift = n / word_bits;
+                const auto bitShift = n % word_bits;
+                const auto words = _words.data();
+                const auto count = _words.size();
+
+                if (bitShift == 0)
+                {
+                    for (auto i = count; i-- > wordShift;)
+                    {
+                        words[i] = words[i - wordShift];
+                    }
+                }
+                else
+                {
+                    for (auto i = count - 1; i > wordShift; --i)
+                    {
+                        words[i] = (words[i - wordShift] << bitShift) | (words[i - wordShift - 1] >> (word_bits - bitShift));
+                    }
+                    words[wordShift] = words[0] << bitShift;
+                }
+
+                std::fill_n(words, wordShift, word_type{ 0 });
+                _clear_unused_bits();
+            }
+
+            // Moves every bit `n` positions towards the start. The bits at the end become unset.
+            void shift_down(size_t n) noexcept
+            {
+                if (n >= _size)
+                {
+                    reset_all();
+                    return;
+                }
+
+                const auto wordShift = n / word_bits;
+                const auto bitShift = n % word_bits;
+                const auto words = _words.data();
+                const auto count = _words.size();
+
+                if (bitShift == 0)
+                {
+                    for (size_t i = 0; i + wordShift < count; ++i)
+                    {
+                        words[i] = words[i + wordShift];
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i + wordShift + 1 < count; ++i)
+                    {
+                        words[i] = (words[i + wordShift] >> bitShift) | (words[i + wordShift + 1] << (word_bits - bitShift));
+                    }
+                    words[count - wordShift - 1] = words[count - 1] >> bitShift;
+                }
+
+                std::fill_n(words + count - wordShift, wordShift, word_type{ 0 });
+            }
+
+            // Both operands must be of the same size.
+            bitmap_bits& operator|=(const bitmap_bits& other) noexcept
+            {
+                assert(_size == other._size);
+                std::transform(_words.begin(), _words.end(), other._words.begin(), _words.begin(), std::bit_or<>{});
+                return *this;
+            }
+
+            // Both operands must be of the same size.
+            bitmap_bits& operator&=(const bitmap_bits& other) noexcept
+            {
+                assert(_size == other._size);
+                std::transform(_words.begin(), _words.end(), other._words.begin(), _words.begin(), std::bit_and<>{});
+                return *this;
+            }
+
+        private:
+            word_type _last_word_mask() const noexcept
+            {
+                const auto used = _size % word_bits;
+                return used ? all_ones >> (word_bits - used) : all_ones;
+            }
+
+            void _clear_unused_bits() noexcept
+            {
+                if (!_words.empty())
+                {
+                    _words.back() &= _last_word_mask();
+                }
+            }
+
+            std::vector<word_type, Allocator> _words;
+            size_t _size = 0;
+        };
+
         template<typename Allocator>
         class _bitmap_const_iterator
         {
@@ -23,11 +278,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             using pointer = const til::rect*;
             using reference = const til::rect&;
 
-            _bitmap_const_iterator(const dynamic_bitset<size_t, Allocator>& values, til::rect rc, ptrdiff_t pos) :
-                _values(values),
+            _bitmap_const_iterator(const bitmap_bits<Allocator>& values, til::rect rc, size_t pos) :
+                _values(&values),
                 _rc(rc),
                 _pos(pos),
-                _end(rc.size().area())
+                _end(rc.size().area<size_t>())
             {
                 _calculateArea();
             }
@@ -77,11 +332,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
         private:
-            const dynamic_bitset<size_t, Allocator>& _values;
-            const til::rect _rc;
+            const bitmap_bits<Allocator>* _values;
+            til::rect _rc;
             size_t _pos;
             size_t _nextPos;
-            const size_t _end;
+            size_t _end;
             til::rect _run;
 
             // Update _run to contain the next rectangle of consecutively set bits within this bitmap.
@@ -90,18 +345,13 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             {
                 // The following logic first finds the next set bit in this bitmap and the next unset bit past that.
                 // The area in between those positions are thus all set bits and will end up being the next _run.
-
-                // dynamic_bitset allows you to quickly find the next set bit using find_next(prev),
-                // where "prev" is the position _past_ which should be searched (i.e. excluding position "prev").
-                // If _pos is still 0, we thus need to use the counterpart find_first().
-                _nextPos = _pos == 0 ? _values.find_first() : _values.find_next(_pos - 1);
+                // Both searches skip over entire words of unset (or set) bits at a time.
+                _nextPos = _values->find_next(_pos);
 
                 // If we haven't reached the end yet...
                 if (_nextPos < _end)
                 {
                     // pos is now at the first on bit.
-                    // If no next set bit can be found, npos is returned, which is SIZE_T_MAX.
-                    // saturated_cast can ensure that this will be converted to CoordType's max (which is greater than _end).
                     const auto runStart = _rc.point_at(base::saturated_cast<CoordType>(_nextPos));
 
                     // We'll only count up until the end of this row.
@@ -109,22 +359,17 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                     const size_t rowEndIndex = _rc.index_of<size_t>(til::point(_rc.right - 1, runStart.y)) + 1;
 
                     // Find the length for the rectangle.
-                    size_t runLength = 0;
-
-                    // We have at least 1 so start with a do/while.
-                    do
-                    {
-                        ++_nextPos;
-                        ++runLength;
-                    } while (_nextPos < rowEndIndex && _values[_nextPos]);
                     // Keep going until we reach end of row, end of the buffer, or the next bit is off.
+                    const auto runEnd = _values->find_next_unset(_nextPos + 1, rowEndIndex);
+                    const auto runLength = runEnd - _nextPos;
+                    _nextPos = runEnd;
 
                     // Assemble and store that run.
                     _run = til::rect{ runStart, til::size{ base::saturated_cast<CoordType>(runLength), 1 } };
                 }
                 else
                 {
-                    // If we reached the end _nextPos may be >= _end (potentially even PTRDIFF_T_MAX).
+                    // If we reached the end _nextPos may be >= _end.
                     // ---> Mark the end of the iterator by updating the state with _end.
                     _pos = _end;
                     _nextPos = _end;
@@ -149,7 +394,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 _sz{},
                 _rc{},
                 _bits{ _alloc },
-                _runs{ _alloc }
+                _runs{}
             {
             }
 
@@ -172,8 +417,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 _alloc{ allocator },
                 _sz(sz),
                 _rc(sz),
-                _bits(_sz.area(), fill ? std::numeric_limits<unsigned long long>::max() : 0, _alloc),
-                _runs{ _alloc }
+                _bits(_sz.area<size_t>(), fill, _alloc),
+                _runs{}
             {
             }
 
@@ -241,7 +486,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 std::swap(_rc, other._rc);
             }
 
-            constexpr bool operator==(const bitmap& other) const noexcept
+            bool operator==(const bitmap& other) const noexcept
             {
                 return _sz == other._sz &&
                        _rc == other._rc &&
@@ -249,7 +494,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 // _runs excluded because it's a cache of generated state.
             }
 
-            constexpr bool operator!=(const bitmap& other) const noexcept
+            bool operator!=(const bitmap& other) const noexcept
             {
                 return !(*this == other);
             }
@@ -261,7 +506,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             const_iterator end() const
             {
-                return const_iterator(_bits, til::rect{ _sz }, _sz.area());
+                return const_iterator(_bits, til::rect{ _sz }, _sz.area<size_t>());
             }
 
             const std::span<const til::rect> runs() const
@@ -269,7 +514,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 // If we don't have cached runs, rebuild.
                 if (!_runs.has_value())
                 {
-                    _runs.emplace(begin(), end());
+                    _runs.emplace(begin(), end(), _alloc);
                 }
 
                 // Return the runs.
@@ -354,7 +599,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 if (_rc.contains(pt))
                 {
                     _runs.reset(); // reset cached runs on any non-const method
-                    _bits.set(_rc.index_of(pt));
+                    _bits.set(_rc.index_of<size_t>(pt));
                 }
             }
 
@@ -363,27 +608,80 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 _runs.reset(); // reset cached runs on any non-const method
 
                 rc &= _rc;
+                if (rc.empty())
+                {
+                    return;
+                }
+
+                const auto width = rc.narrow_width<size_t>();
+                const auto height = rc.narrow_height<size_t>();
+                const auto stride = _rc.narrow_width<size_t>();
+                auto idx = _rc.index_of<size_t>({ rc.left, rc.top });
 
-                const auto width = rc.width();
-                const auto stride = _rc.width();
-                auto idx = _rc.index_of({ rc.left, rc.top });
+                // Full-width rectangles are a single, contiguous range of bits.
+                if (width == stride)
+                {
+                    _bits.set(idx, width * height);
+                    return;
+                }
 
-                for (auto row = rc.top; row < rc.bottom; ++row, idx += stride)
+                for (size_t row = 0; row < height; ++row, idx += stride)
                 {
-                    _bits.set(idx, width, true);
+                    _bits.set(idx, width);
                 }
             }
 
             void set_all() noexcept
             {
                 _runs.reset(); // reset cached runs on any non-const method
-                _bits.set();
+                _bits.set_all();
             }
 
             void reset_all() noexcept
             {
                 _runs.reset(); // reset cached runs on any non-const method
-                _bits.reset();
+                _bits.reset_all();
+            }
+
+            // Sets all bits that are set in `other`. If the sizes differ, the parts of
+            // `other` that lie outside of this bitmap are ignored.
+            bitmap& operator|=(const bitmap& other)
+            {
+                _runs.reset(); // reset cached runs on any non-const method
+
+                if (_sz == other._sz)
+                {
+                    _bits |= other._bits;
+                }
+                else
+                {
+                    for (const auto& run : other)
+                    {
+                        set(run);
+                    }
+                }
+
+                return *this;
+            }
+
+            // Unsets all bits that aren't set in `other`. If the sizes differ, the
+            // parts of this bitmap that lie outside of `other` are unset.
+            bitmap& operator&=(const bitmap& other)
+            {
+                _runs.reset(); // reset cached runs on any non-const method
+
+                if (_sz == other._sz)
+                {
+                    _bits &= other._bits;
+                }
+                else
+                {
+                    bitmap<allocator_type> mask{ _sz, _alloc };
+                    mask |= other;
+                    _bits &= mask._bits;
+                }
+
+                return *this;
             }
 
             // True if we resized. False if it was the same size as before.
@@ -439,22 +737,22 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 }
             }
 
-            constexpr bool one() const noexcept
+            bool one() const noexcept
             {
                 return _bits.count() == 1;
             }
 
-            constexpr bool any() const noexcept
+            bool any() const noexcept
             {
                 return !none();
             }
 
-            constexpr bool none() const noexcept
+            bool none() const noexcept
             {
                 return _bits.none();
             }
 
-            constexpr bool all() const noexcept
+            bool all() const noexcept
             {
                 return _bits.all();
             }
@@ -506,24 +804,23 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
                 if (isLeftShift)
                 {
-                    // This operator doesn't modify the size of `_bits`: the
-                    // new bits are set to 0.
-                    _bits <<= newBits;
+                    // This doesn't modify the size of `_bits`: the new bits are set to 0.
+                    _bits.shift_up(newBits);
                 }
                 else
                 {
-                    _bits >>= newBits;
+                    _bits.shift_down(newBits);
                 }
 
                 if (fill)
                 {
                     if (isLeftShift)
                     {
-                        _bits.set(0, newBits, true);
+                        _bits.set(0, newBits);
                     }
                     else
                     {
-                        _bits.set(_bits.size() - newBits, newBits, true);
+                        _bits.set(_bits.size() - newBits, newBits);
                     }
                 }
 
@@ -533,7 +830,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             allocator_type _alloc;
             til::size _sz;
             til::rect _rc;
-            dynamic_bitset<size_t, allocator_type> _bits;
+            bitmap_bits<allocator_type> _bits;
 
             mutable std::optional<std::vector<til::rect, run_allocator_type>> _runs;
 
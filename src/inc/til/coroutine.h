@@ -0,0 +1,714 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <coroutine>
+
+#include "atomic.h"
+
+// A small coroutine layer on top of the Windows thread pool. The idea is that I/O heavy code, like our
+// connections, doesn't need to own a thread that spends most of its life blocked in ReadFile(). Instead
+// it can be written as a til::task<> that suspends while waiting and gets resumed by a pool thread,
+// which allows many of them to share a handful of threads.
+//
+// Unlike C++/WinRT's IAsyncAction, the types in here don't involve COM, apartments or heap allocated
+// completion handlers and are meant to be usable in conhost as well.
+namespace til
+{
+    using filetime_duration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+
+    template<typename T = void>
+    class task;
+
+    namespace details
+    {
+        class task_promise_base
+        {
+        public:
+            // Once a task is done, it resumes whoever co_await'ed it. Returning the handle from
+            // await_suspend() (= "symmetric transfer") avoids growing the stack with each nested task.
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    const auto continuation = handle.promise()._continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            // Tasks are lazy and only start running once they're awaited.
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            final_awaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                _exception = std::current_exception();
+            }
+
+            void set_continuation(std::coroutine_handle<> continuation) noexcept
+            {
+                _continuation = continuation;
+            }
+
+        protected:
+            void rethrow_if_exception() const
+            {
+                if (_exception)
+                {
+                    std::rethrow_exception(_exception);
+                }
+            }
+
+        private:
+            std::coroutine_handle<> _continuation;
+            std::exception_ptr _exception;
+        };
+
+        template<typename T>
+        class task_promise : public task_promise_base
+        {
+        public:
+            task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U&& value)
+            {
+                _value.emplace(std::forward<U>(value));
+            }
+
+            T result()
+            {
+                rethrow_if_exception();
+                return std::move(*_value);
+            }
+
+        private:
+            std::optional<T> _value;
+        };
+
+        template<>
+        class task_promise<void> : public task_promise_base
+        {
+        public:
+            task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept
+            {
+            }
+
+            void result() const
+            {
+                rethrow_if_exception();
+            }
+        };
+    }
+
+    // A lazily started coroutine that produces a T (or an exception).
+    // It can be co_await'ed from another coroutine, or started on the thread pool with til::spawn().
+    template<typename T>
+    class [[nodiscard]] task
+    {
+    public:
+        using promise_type = details::task_promise<T>;
+
+        task() = default;
+
+        explicit task(std::coroutine_handle<promise_type> handle) noexcept :
+            _handle{ handle }
+        {
+        }
+
+        ~task()
+        {
+            if (_handle)
+            {
+                _handle.destroy();
+            }
+        }
+
+        task(const task&) = delete;
+        task& operator=(const task&) = delete;
+
+        task(task&& other) noexcept :
+            _handle{ std::exchange(other._handle, nullptr) }
+        {
+        }
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_handle)
+                {
+                    _handle.destroy();
+                }
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(_handle);
+        }
+
+        auto operator co_await() const noexcept
+        {
+            struct awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept
+                {
+                    return handle.done();
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept
+                {
+                    handle.promise().set_continuation(awaiting);
+                    return handle;
+                }
+
+                T await_resume() const
+                {
+                    return handle.promise().result();
+                }
+            };
+            return awaiter{ _handle };
+        }
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    template<typename T>
+    task<T> details::task_promise<T>::get_return_object() noexcept
+    {
+        return task<T>{ std::coroutine_handle<task_promise>::from_promise(*this) };
+    }
+
+    inline task<void> details::task_promise<void>::get_return_object() noexcept
+    {
+        return task<void>{ std::coroutine_handle<task_promise>::from_promise(*this) };
+    }
+
+    // Suspends the coroutine and resumes it on a thread pool thread.
+    [[nodiscard]] inline auto resume_background() noexcept
+    {
+        struct awaiter
+        {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) const
+            {
+                THROW_LAST_ERROR_IF(!TrySubmitThreadpoolCallback(&_callback, handle.address(), nullptr));
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+
+        private:
+            static void CALLBACK _callback(PTP_CALLBACK_INSTANCE instance, void* context) noexcept
+            {
+                // The coroutine may go on to destroy thread pool objects that wait for their callbacks,
+                // which would deadlock if this callback still counted as one of them.
+                DisassociateCurrentThreadFromCallback(instance);
+                std::coroutine_handle<>::from_address(context).resume();
+            }
+        };
+        return awaiter{};
+    }
+
+    // Suspends the coroutine for the given duration and resumes it on a thread pool thread.
+    [[nodiscard]] inline auto resume_after(filetime_duration duration) noexcept
+    {
+        struct awaiter
+        {
+            explicit awaiter(filetime_duration duration) noexcept :
+                _duration{ duration }
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return _duration.count() <= 0;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                _handle = handle;
+                _timer.reset(CreateThreadpoolTimer(&_callback, this, nullptr));
+                THROW_LAST_ERROR_IF(!_timer);
+
+                // Negative due times are relative to now.
+                const auto relative = -_duration.count();
+                FILETIME dueTime;
+                memcpy(&dueTime, &relative, sizeof(dueTime));
+                SetThreadpoolTimer(_timer.get(), &dueTime, 0, 0);
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+
+        private:
+            static void CALLBACK _callback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_TIMER) noexcept
+            {
+                // See resume_background().
+                DisassociateCurrentThreadFromCallback(instance);
+                static_cast<awaiter*>(context)->_handle.resume();
+            }
+
+            filetime_duration _duration;
+            std::coroutine_handle<> _handle;
+            // The awaiter is destroyed by the resumed coroutine from within the callback,
+            // which is why we must not wait for the callback to finish.
+            wil::unique_threadpool_timer_nowait _timer;
+        };
+        return awaiter{ duration };
+    }
+
+    // Suspends the coroutine until the given handle is signaled and resumes it on a thread pool thread.
+    // Returns false if the timeout elapsed first. The handle must stay valid until then.
+    [[nodiscard]] inline auto resume_on_signal(HANDLE handle, std::optional<filetime_duration> timeout = std::nullopt) noexcept
+    {
+        struct awaiter
+        {
+            awaiter(HANDLE object, std::optional<filetime_duration> timeout) noexcept :
+                _object{ object },
+                _timeout{ timeout }
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return WaitForSingleObject(_object, 0) == WAIT_OBJECT_0;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                _handle = handle;
+                _wait.reset(CreateThreadpoolWait(&_callback, this, nullptr));
+                THROW_LAST_ERROR_IF(!_wait);
+
+                FILETIME dueTime{};
+                if (_timeout)
+                {
+                    const auto relative = -std::max<int64_t>(0, _timeout->count());
+                    memcpy(&dueTime, &relative, sizeof(dueTime));
+                }
+                SetThreadpoolWait(_wait.get(), _object, _timeout ? &dueTime : nullptr);
+            }
+
+            bool await_resume() const noexcept
+            {
+                return _result == WAIT_OBJECT_0;
+            }
+
+        private:
+            static void CALLBACK _callback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WAIT, TP_WAIT_RESULT result) noexcept
+            {
+                const auto self = static_cast<awaiter*>(context);
+                self->_result = result;
+                // See resume_background().
+                DisassociateCurrentThreadFromCallback(instance);
+                self->_handle.resume();
+            }
+
+            HANDLE _object;
+            std::optional<filetime_duration> _timeout;
+            std::coroutine_handle<> _handle;
+            TP_WAIT_RESULT _result = WAIT_OBJECT_0;
+            // See resume_after().
+            wil::unique_threadpool_wait_nowait _wait;
+        };
+        return awaiter{ handle, timeout };
+    }
+
+    // The outcome of an async_file operation. `error` is a Win32 error code.
+    struct io_result
+    {
+        DWORD error = ERROR_SUCCESS;
+        DWORD transferred = 0;
+    };
+
+    // Wraps a file handle that was opened with FILE_FLAG_OVERLAPPED (like a pipe from create_overlapped_pipe())
+    // and allows awaiting reads and writes without blocking a thread. Completions resume the awaiting coroutine
+    // on a thread pool thread. The file must not be destroyed, moved or reset() while an operation is pending.
+    // To stop a coroutine that is stuck in a read(), call cancel() and wait for the coroutine to finish.
+    class async_file
+    {
+    public:
+        async_file() = default;
+
+        explicit async_file(wil::unique_hfile file) :
+            _file{ std::move(file) },
+            _state{ std::make_shared<shared_state>() }
+        {
+            _io.reset(CreateThreadpoolIo(_file.get(), &_callback, nullptr, nullptr));
+            THROW_LAST_ERROR_IF(!_io);
+            _state->file = _file.get();
+        }
+
+        async_file(const async_file&) = delete;
+        async_file& operator=(const async_file&) = delete;
+
+        async_file(async_file&& other) noexcept :
+            _io{ std::move(other._io) },
+            _file{ std::move(other._file) },
+            _state{ std::move(other._state) }
+        {
+        }
+
+        async_file& operator=(async_file&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                _file = std::move(other._file);
+                _io = std::move(other._io);
+                _state = std::move(other._state);
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(_file);
+        }
+
+        HANDLE get() const noexcept
+        {
+            return _file.get();
+        }
+
+        void reset() noexcept
+        {
+            if (_state)
+            {
+                // Waits for an awaiter that is still in the middle of issuing its operation.
+                const auto guard = _state->lock.lock_exclusive();
+                _state->file = nullptr;
+            }
+            _state.reset();
+            // The file must be closed before the I/O object. See CloseThreadpoolIo().
+            _file.reset();
+            _io.reset();
+        }
+
+        // Aborts the pending operation, if any, and makes all future ones fail with ERROR_OPERATION_ABORTED.
+        // Unlike CancelIoEx() this can't race with a coroutine that's just about to issue its next read().
+        void cancel() noexcept
+        {
+            if (_state)
+            {
+                const auto guard = _state->lock.lock_exclusive();
+                _state->cancelled = true;
+                if (_state->file)
+                {
+                    CancelIoEx(_state->file, nullptr);
+                }
+            }
+        }
+
+        [[nodiscard]] auto read(void* buffer, DWORD size) noexcept
+        {
+            return awaiter{ *this, buffer, size, false };
+        }
+
+        [[nodiscard]] auto write(const void* buffer, DWORD size) noexcept
+        {
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
+            return awaiter{ *this, const_cast<void*>(buffer), size, true };
+        }
+
+    private:
+        // The awaiter doubles as the OVERLAPPED of its operation, which is how the completion
+        // callback finds its way back to the coroutine without any additional allocations.
+        class awaiter : OVERLAPPED
+        {
+        public:
+            awaiter(async_file& file, void* buffer, DWORD size, bool write) noexcept :
+                OVERLAPPED{},
+                _file{ &file },
+                _buffer{ buffer },
+                _size{ size },
+                _write{ write }
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) noexcept
+            {
+                // Once the operation is issued, the callback may resume the coroutine on another thread before
+                // ReadFile() even returns, and the coroutine is then free to destroy both `this` and the file.
+                // Everything needed afterwards is therefore captured up front: the state is reference counted
+                // and holding its lock in shared mode makes cancel() and reset() wait until the operation is
+                // issued, so that a cancel() can't slip in between the check below and the ReadFile() call.
+                const auto state = _file->_state;
+                const auto io = _file->_io.get();
+                if (!state || !io)
+                {
+                    _result.error = ERROR_INVALID_HANDLE;
+                    return false;
+                }
+
+                const auto guard = state->lock.lock_shared();
+                if (state->cancelled)
+                {
+                    _result.error = ERROR_OPERATION_ABORTED;
+                    return false;
+                }
+
+                const auto file = state->file;
+                const auto buffer = _buffer;
+                const auto size = _size;
+                _handle = handle;
+                StartThreadpoolIo(io);
+
+                const auto ok = _write ? WriteFile(file, buffer, size, nullptr, this) : ReadFile(file, buffer, size, nullptr, this);
+                if (!ok)
+                {
+                    const auto gle = GetLastError();
+                    if (gle != ERROR_IO_PENDING && gle != ERROR_MORE_DATA)
+                    {
+                        // The operation failed synchronously and no completion will be posted,
+                        // which means that `this` is still alive and owned by us.
+                        CancelThreadpoolIo(io);
+                        _result.error = gle;
+                        return false;
+                    }
+                }
+
+                // Neither `this` nor `_file` may be touched anymore. The guard unlocks `state`, which we keep alive.
+                return true;
+            }
+
+            io_result await_resume() const noexcept
+            {
+                return _result;
+            }
+
+        private:
+            friend class async_file;
+
+            async_file* _file;
+            void* _buffer;
+            DWORD _size;
+            bool _write;
+            std::coroutine_handle<> _handle;
+            io_result _result;
+        };
+
+        static void CALLBACK _callback(PTP_CALLBACK_INSTANCE instance, void*, void* overlapped, ULONG result, ULONG_PTR transferred, PTP_IO) noexcept
+        {
+            const auto self = static_cast<awaiter*>(static_cast<OVERLAPPED*>(overlapped));
+            self->_result = { result, gsl::narrow_cast<DWORD>(transferred) };
+            // The coroutine is free to destroy the async_file (or whatever owns it, like a ConptyConnection),
+            // whose _io waits for outstanding callbacks. Without this it would wait for this very callback.
+            DisassociateCurrentThreadFromCallback(instance);
+            self->_handle.resume();
+        }
+
+        // Shared between the async_file and its in-flight awaiters, so that cancel()
+        // and reset() can synchronize with an awaiter that's still issuing its operation.
+        struct shared_state
+        {
+            wil::srwlock lock;
+            HANDLE file = nullptr;
+            bool cancelled = false;
+        };
+
+        // Members are destroyed in reverse order, which ensures that _file is closed before _io.
+        // The I/O object waits for outstanding callbacks, but doesn't cancel them, since that would
+        // leave the coroutines that are waiting for them suspended forever.
+        wil::unique_threadpool_io_nocancel _io;
+        wil::unique_hfile _file;
+        std::shared_ptr<shared_state> _state;
+    };
+
+    // CreatePipe() can't create overlapped pipes, which async_file needs. This function creates
+    // an anonymous-like pipe where the read end is overlapped and the write end is not, since the
+    // latter is usually handed to another process (for instance ConPTY) which expects regular handles.
+    // Returns { read, write }.
+    inline std::pair<wil::unique_hfile, wil::unique_hfile> create_overlapped_pipe(DWORD bufferSize = 0)
+    {
+        static std::atomic<uint32_t> counter{ 0 };
+        wchar_t name[64];
+        swprintf_s(name, L"\\\\.\\pipe\\til-%lu-%lu", GetCurrentProcessId(), counter.fetch_add(1, std::memory_order_relaxed));
+
+        wil::unique_hfile read{ CreateNamedPipeW(
+            name,
+            PIPE_ACCESS_INBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1,
+            bufferSize,
+            bufferSize,
+            0,
+            nullptr) };
+        THROW_LAST_ERROR_IF(!read);
+
+        wil::unique_hfile write{ CreateFileW(name, GENERIC_WRITE | FILE_READ_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, 0, nullptr) };
+        THROW_LAST_ERROR_IF(!write);
+
+        return { std::move(read), std::move(write) };
+    }
+
+    namespace details
+    {
+        struct join_state
+        {
+            std::atomic<bool> done{ false };
+            std::exception_ptr exception;
+        };
+
+        // A fire-and-forget coroutine that runs to completion on its own and destroys itself afterwards.
+        struct detached_task
+        {
+            struct promise_type
+            {
+                detached_task get_return_object() const noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never initial_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                void return_void() const noexcept
+                {
+                }
+
+                void unhandled_exception() const noexcept
+                {
+                    std::terminate();
+                }
+            };
+        };
+
+        inline detached_task run_detached(task<void> work, std::shared_ptr<join_state> state)
+        {
+            try
+            {
+                co_await resume_background();
+
+                // The task is destroyed before we signal completion, which ensures that
+                // anything it holds on to (like a strong reference) is gone by then.
+                const auto local = std::move(work);
+                co_await local;
+            }
+            catch (...)
+            {
+                state->exception = std::current_exception();
+            }
+
+            state->done.store(true, std::memory_order_release);
+            til::atomic_notify_all(state->done);
+        }
+    }
+
+    // Returned by til::spawn() and used to wait for a task to finish.
+    class join_handle
+    {
+    public:
+        join_handle() = default;
+
+        explicit join_handle(std::shared_ptr<details::join_state> state) noexcept :
+            _state{ std::move(state) }
+        {
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(_state);
+        }
+
+        bool done() const noexcept
+        {
+            return !_state || _state->done.load(std::memory_order_acquire);
+        }
+
+        // Returns false if the task didn't finish within the given number of milliseconds.
+        bool wait(DWORD timeout = INFINITE) const noexcept
+        {
+            if (!_state)
+            {
+                return true;
+            }
+
+            const auto start = GetTickCount64();
+            auto remaining = timeout;
+
+            while (!_state->done.load(std::memory_order_acquire))
+            {
+                // WaitOnAddress() may return spuriously, so we need to keep track of the remaining time ourselves.
+                if (timeout != INFINITE)
+                {
+                    const auto elapsed = GetTickCount64() - start;
+                    if (elapsed >= timeout)
+                    {
+                        return false;
+                    }
+                    remaining = gsl::narrow_cast<DWORD>(timeout - elapsed);
+                }
+                til::atomic_wait(_state->done, false, remaining);
+            }
+
+            return true;
+        }
+
+        // Waits for the task to finish and rethrows the exception it finished with, if any.
+        void get() const
+        {
+            wait();
+            if (_state && _state->exception)
+            {
+                std::rethrow_exception(_state->exception);
+            }
+        }
+
+    private:
+        std::shared_ptr<details::join_state> _state;
+    };
+
+    // Starts running the given task on the thread pool.
+    inline join_handle spawn(task<void> work)
+    {
+        auto state = std::make_shared<details::join_state>();
+        details::run_detached(std::move(work), state);
+        return join_handle{ std::move(state) };
+    }
+}
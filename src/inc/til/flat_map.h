@@ -0,0 +1,756 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <bit>
+
+#include "flat_set.h"
+#include "hash.h"
+
+#pragma warning(push)
+#pragma warning(disable : 26432) // If you define or delete any default operation in the type '...', define or delete them all (c.21).
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26482) // Only index into arrays using constant expressions (bounds.2).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+#pragma warning(disable : 26495) // Variable '...' is uninitialized. Always initialize a member variable (type.6).
+
+namespace til
+{
+    // The default hash function of til::flat_map. Unlike std::hash it allows
+    // std::basic_string keys to be looked up with a std::basic_string_view.
+    template<typename T>
+    struct flat_map_hash
+    {
+        size_t operator()(const T& v) const noexcept
+        {
+            return til::hash(v);
+        }
+    };
+
+    // Integers don't need a full til::hash(). A multiplication followed by folding
+    // the high half down is enough to give all bits of the result some entropy.
+    template<typename T>
+        requires std::is_integral_v<T>
+    struct flat_map_hash<T>
+    {
+        size_t operator()(T v) const noexcept
+        {
+            const auto h = flat_set_hash_integer(static_cast<size_t>(v));
+            return h ^ (h >> (std::numeric_limits<size_t>::digits / 2));
+        }
+    };
+
+    template<typename T, typename Traits, typename Allocator>
+    struct flat_map_hash<std::basic_string<T, Traits, Allocator>>
+    {
+        using is_transparent = void;
+
+        size_t operator()(const std::basic_string_view<T, Traits>& v) const noexcept
+        {
+            return til::hash(v);
+        }
+    };
+
+    namespace details
+    {
+        // The control byte of an empty slot. Occupied slots store the lowest 7 bits of their hash instead.
+        inline constexpr uint8_t flat_map_empty = 0x80;
+
+        // A set of slots within a group. There's either 1 bit (SSE2) or 1 byte (everything else) per slot.
+        template<typename T, int Shift>
+        struct flat_map_bitmask
+        {
+            T mask;
+
+            explicit operator bool() const noexcept
+            {
+                return mask != 0;
+            }
+
+            size_t lowest() const noexcept
+            {
+                return static_cast<size_t>(std::countr_zero(mask)) >> Shift;
+            }
+
+            void clear_lowest() noexcept
+            {
+                mask &= mask - 1;
+            }
+        };
+
+        // A group is a window of control bytes that is compared against a hash in one go.
+        // The matches may contain false positives, but they never point at empty slots.
+#if defined(TIL_SSE_INTRINSICS)
+        struct flat_map_group
+        {
+            static constexpr size_t width = 16;
+            using bitmask = flat_map_bitmask<uint32_t, 0>;
+
+            explicit flat_map_group(const uint8_t* ctrl) noexcept :
+                _ctrl{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)) }
+            {
+            }
+
+            bitmask match(uint8_t h2) const noexcept
+            {
+                const auto eq = _mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(static_cast<char>(h2)));
+                return { static_cast<uint32_t>(_mm_movemask_epi8(eq)) };
+            }
+
+            bitmask match_empty() const noexcept
+            {
+                return { static_cast<uint32_t>(_mm_movemask_epi8(_ctrl)) };
+            }
+
+        private:
+            __m128i _ctrl;
+        };
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+        struct flat_map_group
+        {
+            static constexpr size_t width = 8;
+            using bitmask = flat_map_bitmask<uint64_t, 3>;
+
+            explicit flat_map_group(const uint8_t* ctrl) noexcept :
+                _ctrl{ vld1_u8(ctrl) }
+            {
+            }
+
+            bitmask match(uint8_t h2) const noexcept
+            {
+                const auto eq = vceq_u8(_ctrl, vdup_n_u8(h2));
+                return { vget_lane_u64(vreinterpret_u64_u8(eq), 0) & UINT64_C(0x8080808080808080) };
+            }
+
+            bitmask match_empty() const noexcept
+            {
+                return { vget_lane_u64(vreinterpret_u64_u8(_ctrl), 0) & UINT64_C(0x8080808080808080) };
+            }
+
+        private:
+            uint8x8_t _ctrl;
+        };
+#else
+        struct flat_map_group
+        {
+            static constexpr size_t width = 8;
+            using bitmask = flat_map_bitmask<uint64_t, 3>;
+
+            explicit flat_map_group(const uint8_t* ctrl) noexcept
+            {
+                memcpy(&_ctrl, ctrl, sizeof(_ctrl));
+            }
+
+            // The classic "has zero byte" trick. It may report a byte following a match as a false positive.
+            bitmask match(uint8_t h2) const noexcept
+            {
+                static constexpr uint64_t low_bits = UINT64_C(0x0101010101010101);
+                static constexpr uint64_t high_bits = UINT64_C(0x8080808080808080);
+                const auto x = _ctrl ^ (low_bits * h2);
+                return { (x - low_bits) & ~x & high_bits };
+            }
+
+            bitmask match_empty() const noexcept
+            {
+                return { _ctrl & UINT64_C(0x8080808080808080) };
+            }
+
+        private:
+            uint64_t _ctrl;
+        };
+#endif
+
+        // Allows find() & co. to accept any key type if both the hash and equality functions are transparent.
+        // Otherwise it evaluates to Key, which ensures that arguments get converted to the key type first.
+        template<bool Transparent>
+        struct flat_map_key_arg
+        {
+            template<typename K, typename Key>
+            using type = K;
+        };
+
+        template<>
+        struct flat_map_key_arg<false>
+        {
+            template<typename K, typename Key>
+            using type = Key;
+        };
+    }
+
+    // An open addressing hash map in the style of Google's "Swiss Tables". Each slot has a control byte
+    // that's either "empty" or holds 7 bits of the slot's hash. Lookups compare a whole group of control bytes
+    // against the hash at once using SIMD and only compare the keys of the few slots that match.
+    //
+    // Unlike Swiss Tables it probes linearly, which allows erase() to shift the following items back into
+    // the hole (backward shift deletion). This means there are no tombstones and no need to ever rehash the map
+    // after many erasures, as is common for caches. The downside is that erase() needs to rehash the keys of
+    // the items that follow the erased one, so it's best suited for keys that are cheap to hash.
+    //
+    // Other differences to std::unordered_map:
+    // * Iterators and references are invalidated by any insertion and erasure.
+    // * value_type is a std::pair<Key, T> and not std::pair<const Key, T>. Don't modify the key.
+    template<typename Key, typename T, typename Hash = flat_map_hash<Key>, typename KeyEqual = std::equal_to<>>
+    class flat_map
+    {
+        using group = details::flat_map_group;
+
+        static constexpr bool transparent = requires { typename Hash::is_transparent; typename KeyEqual::is_transparent; };
+
+        template<typename K>
+        using key_arg = typename details::flat_map_key_arg<transparent>::template type<K, Key>;
+
+        template<bool Const>
+        class basic_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<Key, T>;
+            using difference_type = ptrdiff_t;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+            basic_iterator() = default;
+
+            // Allows converting an iterator into a const_iterator.
+            template<bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other) noexcept :
+                _ctrl{ other._ctrl },
+                _slot{ other._slot },
+                _end{ other._end }
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return *_slot;
+            }
+
+            pointer operator->() const noexcept
+            {
+                return _slot;
+            }
+
+            basic_iterator& operator++() noexcept
+            {
+                ++_ctrl;
+                ++_slot;
+                _skip_empty();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            bool operator==(const basic_iterator& rhs) const noexcept
+            {
+                return _slot == rhs._slot;
+            }
+
+            bool operator!=(const basic_iterator& rhs) const noexcept
+            {
+                return _slot != rhs._slot;
+            }
+
+        private:
+            friend class flat_map;
+            template<bool>
+            friend class basic_iterator;
+
+            basic_iterator(const uint8_t* ctrl, pointer slot, const uint8_t* end) noexcept :
+                _ctrl{ ctrl },
+                _slot{ slot },
+                _end{ end }
+            {
+            }
+
+            void _skip_empty() noexcept
+            {
+                while (_ctrl != _end && *_ctrl == details::flat_map_empty)
+                {
+                    ++_ctrl;
+                    ++_slot;
+                }
+            }
+
+            const uint8_t* _ctrl = nullptr;
+            pointer _slot = nullptr;
+            const uint8_t* _end = nullptr;
+        };
+
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<Key, T>;
+        using size_type = size_t;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        flat_map() = default;
+
+        flat_map(const flat_map& other) :
+            flat_map{}
+        {
+            if (other._size)
+            {
+                _allocate(other._capacity);
+                memcpy(_ctrl, other._ctrl, _ctrl_size(_capacity));
+                // The control bytes are copied upfront, so we must construct the slots in order and keep
+                // _size up to date. That way the destructor cleans up if one of the copies throws.
+                for (size_t i = 0; i < _capacity; ++i)
+                {
+                    if (_ctrl[i] != details::flat_map_empty)
+                    {
+                        _construct_copy(i, other._slots[i]);
+                    }
+                }
+            }
+        }
+
+        flat_map(flat_map&& other) noexcept :
+            _ctrl{ std::exchange(other._ctrl, nullptr) },
+            _slots{ std::exchange(other._slots, nullptr) },
+            _capacity{ std::exchange(other._capacity, 0) },
+            _size{ std::exchange(other._size, 0) }
+        {
+        }
+
+        flat_map& operator=(const flat_map& other)
+        {
+            if (this != &other)
+            {
+                flat_map copy{ other };
+                swap(copy);
+            }
+            return *this;
+        }
+
+        flat_map& operator=(flat_map&& other) noexcept
+        {
+            if (this != &other)
+            {
+                flat_map tmp{ std::move(other) };
+                swap(tmp);
+            }
+            return *this;
+        }
+
+        ~flat_map()
+        {
+            _destroy_all();
+            _deallocate(_ctrl, _slots, _capacity);
+        }
+
+        void swap(flat_map& other) noexcept
+        {
+            std::swap(_ctrl, other._ctrl);
+            std::swap(_slots, other._slots);
+            std::swap(_capacity, other._capacity);
+            std::swap(_size, other._size);
+        }
+
+        iterator begin() noexcept
+        {
+            iterator it{ _ctrl, _slots, _ctrl + _capacity };
+            it._skip_empty();
+            return it;
+        }
+
+        const_iterator begin() const noexcept
+        {
+            const_iterator it{ _ctrl, _slots, _ctrl + _capacity };
+            it._skip_empty();
+            return it;
+        }
+
+        iterator end() noexcept
+        {
+            return { _ctrl + _capacity, _slots + _capacity, _ctrl + _capacity };
+        }
+
+        const_iterator end() const noexcept
+        {
+            return { _ctrl + _capacity, _slots + _capacity, _ctrl + _capacity };
+        }
+
+        bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        size_t capacity() const noexcept
+        {
+            return _capacity;
+        }
+
+        // Removes all items, but keeps the memory around.
+        void clear() noexcept
+        {
+            if (_size)
+            {
+                _destroy_all();
+                memset(_ctrl, details::flat_map_empty, _ctrl_size(_capacity));
+            }
+        }
+
+        // Ensures that `count` items can be inserted without reallocating.
+        void reserve(size_t count)
+        {
+            const auto capacity = _capacity_for(count);
+            if (capacity > _capacity)
+            {
+                _rehash(capacity);
+            }
+        }
+
+        template<typename K = key_type>
+        iterator find(const key_arg<K>& key) noexcept
+        {
+            const auto idx = _find(key);
+            return idx == npos ? end() : _iterator_at(idx);
+        }
+
+        template<typename K = key_type>
+        const_iterator find(const key_arg<K>& key) const noexcept
+        {
+            const auto idx = _find(key);
+            return idx == npos ? end() : _iterator_at(idx);
+        }
+
+        template<typename K = key_type>
+        bool contains(const key_arg<K>& key) const noexcept
+        {
+            return _find(key) != npos;
+        }
+
+        template<typename K = key_type>
+        T& at(const key_arg<K>& key)
+        {
+            const auto idx = _find(key);
+            if (idx == npos)
+            {
+                throw std::out_of_range{ "til::flat_map::at: key not found" };
+            }
+            return _slots[idx].second;
+        }
+
+        template<typename K = key_type>
+        const T& at(const key_arg<K>& key) const
+        {
+            const auto idx = _find(key);
+            if (idx == npos)
+            {
+                throw std::out_of_range{ "til::flat_map::at: key not found" };
+            }
+            return _slots[idx].second;
+        }
+
+        T& operator[](const key_type& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        T& operator[](key_type&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        // Inserts the item if the key doesn't exist yet. If the map is transparent, the key is only
+        // converted to a key_type if it's inserted. `args` are only used to construct a T in that case.
+        template<typename K = key_type, typename... Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+        {
+            if constexpr (!transparent && !std::is_same_v<std::remove_cvref_t<K>, key_type>)
+            {
+                return try_emplace(key_type(std::forward<K>(key)), std::forward<Args>(args)...);
+            }
+            else
+            {
+                const auto hash = _hash(key);
+                if (const auto idx = _find(key, hash); idx != npos)
+                {
+                    return { _iterator_at(idx), false };
+                }
+
+                if (_size + 1 > _capacity - _capacity / 8) [[unlikely]]
+                {
+                    _rehash(_capacity_for(_size + 1));
+                }
+
+                const auto idx = _find_empty(hash);
+                std::construct_at(&_slots[idx], std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+                _set_ctrl(idx, _h2(hash));
+                _size++;
+                return { _iterator_at(idx), true };
+            }
+        }
+
+        template<typename K = key_type, typename M>
+        std::pair<iterator, bool> insert_or_assign(K&& key, M&& value)
+        {
+            auto result = try_emplace(std::forward<K>(key), std::forward<M>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<M>(value);
+            }
+            return result;
+        }
+
+        // Returns the number of erased items (0 or 1).
+        template<typename K = key_type>
+        size_t erase(const key_arg<K>& key) noexcept
+        {
+            const auto idx = _find(key);
+            if (idx == npos)
+            {
+                return 0;
+            }
+            _erase_at(idx);
+            return 1;
+        }
+
+        // Removes all items for which `pred(item)` returns true and returns the number of removed items.
+        template<typename Pred>
+        size_t erase_if(Pred&& pred) noexcept(std::is_nothrow_invocable_v<Pred&, const value_type&>)
+        {
+            size_t removed = 0;
+            for (size_t i = 0; i < _capacity;)
+            {
+                if (_ctrl[i] != details::flat_map_empty && pred(std::as_const(_slots[i])))
+                {
+                    // _erase_at() may have shifted another item into slot i, so we need to look at it again.
+                    // It may also wrap around and move an item from the start of the map into slot i,
+                    // in which case `pred` gets called for it twice. That's harmless.
+                    _erase_at(i);
+                    removed++;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            return removed;
+        }
+
+    private:
+        static constexpr size_t npos = SIZE_MAX;
+
+        // Returns the size of the control byte array. The first group::width - 1 bytes are mirrored
+        // at the end, so that a group can be loaded at any slot without having to wrap around.
+        static constexpr size_t _ctrl_size(size_t capacity) noexcept
+        {
+            return capacity + group::width - 1;
+        }
+
+        // The map grows once it's 7/8 full. It's the same limit Swiss Tables use.
+        static constexpr size_t _capacity_for(size_t count)
+        {
+            if (count > SIZE_MAX / 16)
+            {
+                throw std::bad_array_new_length{};
+            }
+            const auto minCapacity = count + count / 7;
+            return std::max(group::width, std::bit_ceil(minCapacity + 1));
+        }
+
+        // We use the top bits of the hash to find the slot and the low 7 bits as the control byte.
+        static size_t _h1(size_t hash) noexcept
+        {
+            return hash >> 7;
+        }
+
+        static uint8_t _h2(size_t hash) noexcept
+        {
+            return static_cast<uint8_t>(hash & 0x7f);
+        }
+
+        template<typename K>
+        static size_t _hash(const K& key) noexcept
+        {
+            return Hash{}(key);
+        }
+
+        template<typename K>
+        size_t _find(const K& key) const noexcept
+        {
+            return _size ? _find(key, _hash(key)) : npos;
+        }
+
+        template<typename K>
+        size_t _find(const K& key, size_t hash) const noexcept
+        {
+            if (!_size)
+            {
+                return npos;
+            }
+
+            const auto h2 = _h2(hash);
+            const auto mask = _capacity - 1;
+
+            for (auto pos = _h1(hash) & mask;; pos = (pos + group::width) & mask)
+            {
+                const group g{ _ctrl + pos };
+
+                for (auto m = g.match(h2); m; m.clear_lowest())
+                {
+                    const auto idx = (pos + m.lowest()) & mask;
+                    if (KeyEqual{}(_slots[idx].first, key)) [[likely]]
+                    {
+                        return idx;
+                    }
+                }
+
+                // With linear probing all slots between an item's ideal slot and its actual one are occupied.
+                // If this window contains an empty slot and the key wasn't found before it, it doesn't exist.
+                if (g.match_empty())
+                {
+                    return npos;
+                }
+            }
+        }
+
+        // Returns the index of the first empty slot in the probe sequence of `hash`.
+        size_t _find_empty(size_t hash) const noexcept
+        {
+            const auto mask = _capacity - 1;
+
+            for (auto pos = _h1(hash) & mask;; pos = (pos + group::width) & mask)
+            {
+                if (const auto m = group{ _ctrl + pos }.match_empty())
+                {
+                    return (pos + m.lowest()) & mask;
+                }
+            }
+        }
+
+        void _set_ctrl(size_t idx, uint8_t value) noexcept
+        {
+            _ctrl[idx] = value;
+            // This writes the mirrored byte at the end for the first group::width - 1 slots,
+            // and otherwise idx itself again, which is cheaper than a branch.
+            _ctrl[((idx - (group::width - 1)) & (_capacity - 1)) + (group::width - 1)] = value;
+        }
+
+        iterator _iterator_at(size_t idx) noexcept
+        {
+            return { _ctrl + idx, _slots + idx, _ctrl + _capacity };
+        }
+
+        const_iterator _iterator_at(size_t idx) const noexcept
+        {
+            return { _ctrl + idx, _slots + idx, _ctrl + _capacity };
+        }
+
+        void _construct_copy(size_t idx, const value_type& value)
+        {
+            std::construct_at(&_slots[idx], value);
+            _size++;
+        }
+
+        // Backward shift deletion: Moves the following items of the same probe sequence
+        // back by one slot each, if that doesn't move them before their ideal slot.
+        void _erase_at(size_t hole) noexcept
+        {
+            static_assert(std::is_nothrow_move_constructible_v<value_type>);
+
+            const auto mask = _capacity - 1;
+            std::destroy_at(&_slots[hole]);
+
+            for (auto idx = (hole + 1) & mask; _ctrl[idx] != details::flat_map_empty; idx = (idx + 1) & mask)
+            {
+                const auto ideal = _h1(_hash(_slots[idx].first)) & mask;
+                // The item at idx may move into the hole if its ideal slot isn't within (hole, idx].
+                if (((idx - ideal) & mask) >= ((idx - hole) & mask))
+                {
+                    std::construct_at(&_slots[hole], std::move(_slots[idx]));
+                    std::destroy_at(&_slots[idx]);
+                    _set_ctrl(hole, _ctrl[idx]);
+                    hole = idx;
+                }
+            }
+
+            _set_ctrl(hole, details::flat_map_empty);
+            _size--;
+        }
+
+        __declspec(noinline) void _rehash(size_t capacity)
+        {
+            static_assert(std::is_nothrow_move_constructible_v<value_type>);
+
+            const auto oldCtrl = _ctrl;
+            const auto oldSlots = _slots;
+            const auto oldCapacity = _capacity;
+
+            _allocate(capacity);
+
+            for (size_t i = 0; i < oldCapacity; ++i)
+            {
+                if (oldCtrl[i] != details::flat_map_empty)
+                {
+                    const auto idx = _find_empty(_hash(oldSlots[i].first));
+                    std::construct_at(&_slots[idx], std::move(oldSlots[i]));
+                    std::destroy_at(&oldSlots[i]);
+                    _set_ctrl(idx, oldCtrl[i]);
+                }
+            }
+
+            _deallocate(oldCtrl, oldSlots, oldCapacity);
+        }
+
+        // Replaces the arrays with empty ones of the given capacity. Doesn't free or move the old ones.
+        void _allocate(size_t capacity)
+        {
+            std::unique_ptr<uint8_t[]> ctrl{ new uint8_t[_ctrl_size(capacity)] };
+            const auto slots = std::allocator<value_type>{}.allocate(capacity);
+            memset(ctrl.get(), details::flat_map_empty, _ctrl_size(capacity));
+
+            _ctrl = ctrl.release();
+            _slots = slots;
+            _capacity = capacity;
+        }
+
+        static void _deallocate(uint8_t* ctrl, value_type* slots, size_t capacity) noexcept
+        {
+            if (ctrl)
+            {
+                delete[] ctrl;
+                std::allocator<value_type>{}.deallocate(slots, capacity);
+            }
+        }
+
+        void _destroy_all() noexcept
+        {
+            if constexpr (!std::is_trivially_destructible_v<value_type>)
+            {
+                for (size_t i = 0; i < _capacity && _size; ++i)
+                {
+                    if (_ctrl[i] != details::flat_map_empty)
+                    {
+                        std::destroy_at(&_slots[i]);
+                        _size--;
+                    }
+                }
+            }
+            _size = 0;
+        }
+
+        uint8_t* _ctrl = nullptr;
+        value_type* _slots = nullptr;
+        size_t _capacity = 0;
+        size_t _size = 0;
+    };
+}
+
+#pragma warning(pop)
@@ -149,6 +149,51 @@ namespace til
             }
         }
 
+        // Removes all items for which `pred(item)` returns true and returns the number of removed items.
+        // Linear probing doesn't allow us to simply punch holes into the map, because that would break
+        // the probe sequence of any item that collided with a removed one. Instead, this function rebuilds
+        // the map in place at the same capacity. It's O(capacity) and intended for infrequent bulk removals.
+        template<typename Pred>
+        size_t erase_if(Pred&& pred)
+        {
+            if (!_map)
+            {
+                return 0;
+            }
+
+            auto newMap = std::make_unique<T[]>(_capacity);
+            size_t removed = 0;
+
+            for (auto& oldSlot : container())
+            {
+                if (!Traits::occupied(oldSlot))
+                {
+                    continue;
+                }
+                if (pred(std::as_const(oldSlot)))
+                {
+                    removed++;
+                    continue;
+                }
+
+                const auto hash = Traits::hash(oldSlot) >> _shift;
+
+                for (auto i = hash;; ++i)
+                {
+                    auto& slot = newMap[i & _mask];
+                    if (!Traits::occupied(slot))
+                    {
+                        slot = std::move_if_noexcept(oldSlot);
+                        break;
+                    }
+                }
+            }
+
+            _map = std::move(newMap);
+            _load -= removed * LoadFactor;
+            return removed;
+        }
+
     private:
         __declspec(noinline) void _bumpSize()
         {
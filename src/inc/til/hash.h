@@ -12,6 +12,10 @@
 #pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
 #pragma warning(disable : 26494) // Variable '...' is uninitialized. Always initialize an object (type.5).
 #pragma warning(disable : 26496) // The variable '...' does not change after construction, mark it as const (con.4).
+// stream_hasher processes raw bytes with SIMD intrinsics and indexes its lanes in tight loops.
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26482) // Only index into arrays using constant expressions (bounds.2).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
 
 #if defined(_M_X64) && !defined(_M_ARM64EC)
 #define TIL_HASH_X64
@@ -23,6 +27,19 @@
 #error "Unsupported architecture for til::hash"
 #endif
 
+#if defined(TIL_SSE_INTRINSICS)
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <isa_availability.h>
+extern "C" int __isa_available;
+#define _TIL_HASH_AVX2 (__isa_available >= __ISA_AVAILABLE_AVX2)
+#elif defined(__AVX2__)
+#define _TIL_HASH_AVX2 true
+#endif
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
 namespace til
 {
     template<typename T>
@@ -206,6 +223,305 @@ namespace til
         size_t _hash = 0;
     };
 
+    // A hasher for large inputs like whole rows of text or file contents. It processes 64 bytes at a time
+    // using 8 independent lanes (the long-input loop of XXH3, but not compatible with it), which maps well
+    // onto SSE2, AVX2 and NEON. For small keys til::hasher is faster, because this one has a fixed finalization cost.
+    //
+    // Unlike til::hasher, the result is the same on all architectures, with or without SIMD, and independent of how
+    // the input was split up into write() calls. As long as you use stable_seed (the default) the result is also
+    // guaranteed to never change and safe to persist on disk. The StreamTestVectors in HashTests ensure this.
+    class stream_hasher
+    {
+    public:
+        static constexpr uint64_t stable_seed = 0;
+
+        explicit constexpr stream_hasher(uint64_t seed = stable_seed) noexcept :
+            _acc{
+                prime32_3 + seed,
+                prime64_1 - seed,
+                prime64_2 + seed,
+                prime64_3 - seed,
+                prime64_4 + seed,
+                prime32_2 - seed,
+                prime64_5 + seed,
+                prime32_1 - seed,
+            }
+        {
+        }
+
+        template<typename T, typename = std::enable_if_t<std::has_unique_object_representations_v<T>>>
+        stream_hasher& write(const T* data, size_t count) noexcept
+        {
+            return write(static_cast<const void*>(data), sizeof(T) * count);
+        }
+
+        template<typename T, typename CharTraits>
+        stream_hasher& write(const std::basic_string_view<T, CharTraits>& str) noexcept
+        {
+            return write(str.data(), str.size());
+        }
+
+        stream_hasher& write(const void* data, size_t len) noexcept
+        {
+            auto p = static_cast<const uint8_t*>(data);
+            _total += len;
+
+            if (_buffered)
+            {
+                const auto fill = std::min(len, stripe_size - _buffered);
+                memcpy(&_buffer[_buffered], p, fill);
+                _buffered += fill;
+                p += fill;
+                len -= fill;
+
+                if (_buffered < stripe_size)
+                {
+                    return *this;
+                }
+
+                _consume(&_buffer[0], 1);
+                _buffered = 0;
+            }
+
+            if (const auto stripes = len / stripe_size)
+            {
+                _consume(p, stripes);
+                p += stripes * stripe_size;
+                len -= stripes * stripe_size;
+            }
+
+            if (len)
+            {
+                memcpy(&_buffer[0], p, len);
+                _buffered = len;
+            }
+
+            return *this;
+        }
+
+        uint64_t finalize() const noexcept
+        {
+            alignas(32) uint64_t acc[8];
+            memcpy(&acc[0], &_acc[0], sizeof(acc));
+
+            // The trailing partial stripe is padded with zeroes. The total length
+            // is mixed in below, so this doesn't make "a" and "a\0" collide.
+            if (_buffered)
+            {
+                alignas(16) uint8_t last[stripe_size]{};
+                memcpy(&last[0], &_buffer[0], _buffered);
+                _accumulate(&acc[0], &last[0], 1, &secret[_stripes]);
+            }
+
+            auto h = _total * prime64_1;
+            for (size_t i = 0; i < 8; i += 2)
+            {
+                h += _mul128_fold64(acc[i] ^ secret[11 + i], acc[i + 1] ^ secret[12 + i]);
+            }
+
+            h ^= h >> 37;
+            h *= UINT64_C(0x165667919E3779F9);
+            h ^= h >> 32;
+            return h;
+        }
+
+    private:
+        static constexpr size_t stripe_size = 64;
+        // The accumulators get scrambled every 16 stripes (1KiB), because the multiplications in
+        // _accumulate() only use 32 bits of their inputs and would otherwise lose entropy over time.
+        static constexpr size_t stripes_per_block = 16;
+        // Stripe n of a block uses the secret words [n, n+8) and the scrambling uses the last 8 words.
+        static constexpr size_t secret_count = stripes_per_block + 8;
+
+        static constexpr uint64_t prime32_1 = UINT64_C(0x9E3779B1);
+        static constexpr uint64_t prime32_2 = UINT64_C(0x85EBCA77);
+        static constexpr uint64_t prime32_3 = UINT64_C(0xC2B2AE3D);
+        static constexpr uint64_t prime64_1 = UINT64_C(0x9E3779B185EBCA87);
+        static constexpr uint64_t prime64_2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+        static constexpr uint64_t prime64_3 = UINT64_C(0x165667B19E3779F9);
+        static constexpr uint64_t prime64_4 = UINT64_C(0x85EBCA77C2B2AE63);
+        static constexpr uint64_t prime64_5 = UINT64_C(0x27D4EB2F165667C5);
+
+        // The secret is generated with splitmix64, so that there's no large table of magic numbers
+        // in this header. Changing the generator or its seed changes all persisted hashes.
+        static constexpr std::array<uint64_t, secret_count> secret = []() {
+            std::array<uint64_t, secret_count> s{};
+            uint64_t state = prime64_1;
+            for (auto& v : s)
+            {
+                state += UINT64_C(0x9E3779B97F4A7C15);
+                auto z = state;
+                z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+                z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+                v = z ^ (z >> 31);
+            }
+            return s;
+        }();
+
+        static uint64_t _mul128_fold64(uint64_t lhs, uint64_t rhs) noexcept
+        {
+#if defined(TIL_HASH_X64)
+            uint64_t hi;
+            const uint64_t lo = _umul128(lhs, rhs, &hi);
+            return lo ^ hi;
+#elif defined(TIL_HASH_ARM64)
+            return (lhs * rhs) ^ __umulh(lhs, rhs);
+#else
+            const auto ll = (lhs & 0xffffffff) * (rhs & 0xffffffff);
+            const auto hl = (lhs >> 32) * (rhs & 0xffffffff);
+            const auto lh = (lhs & 0xffffffff) * (rhs >> 32);
+            const auto hh = (lhs >> 32) * (rhs >> 32);
+            const auto cross = (ll >> 32) + (hl & 0xffffffff) + lh;
+            const auto lo = (cross << 32) | (ll & 0xffffffff);
+            const auto hi = (hl >> 32) + (cross >> 32) + hh;
+            return lo ^ hi;
+#endif
+        }
+
+        // Processes `stripes` consecutive stripes of 64 bytes, where stripe n uses the secret words [key + n, key + n + 8).
+        // For each of the 8 lanes: acc[i] += lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i]) and acc[i ^ 1] += data[i].
+        // Adding the unmodified data to the neighboring lane ensures that no input is lost if the multiplication is 0.
+        static void _accumulate(uint64_t* __restrict acc, const uint8_t* __restrict data, size_t stripes, const uint64_t* key) noexcept
+        {
+#if defined(TIL_SSE_INTRINSICS)
+#if defined(_TIL_HASH_AVX2)
+            if (_TIL_HASH_AVX2)
+            {
+                auto a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + 0));
+                auto a1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + 4));
+                for (; stripes; --stripes, data += stripe_size, ++key)
+                {
+                    const auto d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0));
+                    const auto d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+                    const auto dk0 = _mm256_xor_si256(d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 0)));
+                    const auto dk1 = _mm256_xor_si256(d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4)));
+                    const auto p0 = _mm256_mul_epu32(dk0, _mm256_shuffle_epi32(dk0, _MM_SHUFFLE(0, 3, 0, 1)));
+                    const auto p1 = _mm256_mul_epu32(dk1, _mm256_shuffle_epi32(dk1, _MM_SHUFFLE(0, 3, 0, 1)));
+                    a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+                    a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+                }
+                _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 0), a0);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 4), a1);
+                return;
+            }
+#endif
+            __m128i a[4];
+            for (size_t i = 0; i < 4; ++i)
+            {
+                a[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i * 2));
+            }
+            for (; stripes; --stripes, data += stripe_size, ++key)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16));
+                    const auto dk = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i * 2)));
+                    const auto product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+                    const auto swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+                }
+            }
+            for (size_t i = 0; i < 4; ++i)
+            {
+                _mm_store_si128(reinterpret_cast<__m128i*>(acc + i * 2), a[i]);
+            }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+            uint64x2_t a[4];
+            for (size_t i = 0; i < 4; ++i)
+            {
+                a[i] = vld1q_u64(acc + i * 2);
+            }
+            for (; stripes; --stripes, data += stripe_size, ++key)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    const auto d = vreinterpretq_u64_u8(vld1q_u8(data + i * 16));
+                    const auto dk = veorq_u64(d, vld1q_u64(key + i * 2));
+                    const auto product = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+                    const auto swapped = vextq_u64(d, d, 1);
+                    a[i] = vaddq_u64(a[i], vaddq_u64(product, swapped));
+                }
+            }
+            for (size_t i = 0; i < 4; ++i)
+            {
+                vst1q_u64(acc + i * 2, a[i]);
+            }
+#else
+            for (; stripes; --stripes, data += stripe_size, ++key)
+            {
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    uint64_t d;
+                    memcpy(&d, data + i * 8, 8);
+                    const auto dk = d ^ key[i];
+                    acc[i ^ 1] += d;
+                    acc[i] += (dk & 0xffffffff) * (dk >> 32);
+                }
+            }
+#endif
+        }
+
+        // For each of the 8 lanes: acc[i] = (acc[i] ^ (acc[i] >> 47) ^ key[i]) * prime32_1
+        static void _scramble(uint64_t* __restrict acc, const uint64_t* key) noexcept
+        {
+#if defined(TIL_SSE_INTRINSICS)
+            const auto prime = _mm_set1_epi32(static_cast<int>(prime32_1));
+            for (size_t i = 0; i < 8; i += 2)
+            {
+                auto a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+                a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+                a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i)));
+                const auto lo = _mm_mul_epu32(a, prime);
+                const auto hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+                _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+            }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+            const auto prime = vdup_n_u32(static_cast<uint32_t>(prime32_1));
+            for (size_t i = 0; i < 8; i += 2)
+            {
+                auto a = vld1q_u64(acc + i);
+                a = veorq_u64(a, vshrq_n_u64(a, 47));
+                a = veorq_u64(a, vld1q_u64(key + i));
+                const auto lo = vmull_u32(vmovn_u64(a), prime);
+                const auto hi = vmull_u32(vshrn_n_u64(a, 32), prime);
+                vst1q_u64(acc + i, vaddq_u64(lo, vshlq_n_u64(hi, 32)));
+            }
+#else
+            for (size_t i = 0; i < 8; ++i)
+            {
+                auto a = acc[i];
+                a ^= a >> 47;
+                a ^= key[i];
+                acc[i] = a * prime32_1;
+            }
+#endif
+        }
+
+        void _consume(const uint8_t* data, size_t stripes) noexcept
+        {
+            while (stripes)
+            {
+                const auto n = std::min(stripes, stripes_per_block - _stripes);
+                _accumulate(&_acc[0], data, n, &secret[_stripes]);
+                data += n * stripe_size;
+                stripes -= n;
+                _stripes += n;
+
+                if (_stripes == stripes_per_block)
+                {
+                    _scramble(&_acc[0], &secret[secret_count - 8]);
+                    _stripes = 0;
+                }
+            }
+        }
+
+        alignas(32) uint64_t _acc[8];
+        alignas(16) uint8_t _buffer[stripe_size]{};
+        uint64_t _total = 0;
+        size_t _buffered = 0;
+        size_t _stripes = 0;
+    };
+
     namespace details
     {
         template<typename T, bool enable>
@@ -0,0 +1,685 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <bit>
+
+#include "spsc.h"
+
+// til: Terminal Implementation Library. Also: "Today I Learned".
+// mpsc: Multi Producer Single Consumer. A MPSC queue/channel sends data from any number of senders to one receiver.
+// mpmc: Multi Producer Multi Consumer. A MPMC queue/channel sends data from any number of senders to any number of receivers.
+//
+// Both share the same API as til::spsc, except that their producers (and for mpmc their consumers) can be copied.
+// Each copy can be moved to a different thread. The channel is closed once all copies of one side are gone.
+namespace til
+{
+    namespace details::mpmc
+    {
+        using spsc::details::alloc_raw_memory;
+        using spsc::details::enable_if_wait_policy_t;
+        using spsc::details::free_raw_memory;
+
+        // Return immediately if nothing can be written into the sender / read from the receiver.
+        struct non_blocking_policy
+        {
+            using _spsc_policy = int;
+            static constexpr bool _block_forever = false;
+        };
+
+        template<typename WaitPolicy>
+        inline constexpr bool blocks_initially = !std::is_same_v<std::remove_cvref_t<WaitPolicy>, non_blocking_policy>;
+
+        // Producers and consumers each modify their own position. Keeping them
+        // on separate cache lines prevents them from slowing each other down.
+        inline constexpr size_t cache_line_size = 64;
+
+        struct alignas(cache_line_size) position
+        {
+            std::atomic<size_t> value{ 0 };
+        };
+
+        // signal allows one side to wait for the other without missing wakeups and without making
+        // the other side pay for a syscall on every release() when nobody is waiting.
+        //
+        // The waiting side must call prepare(), check again whether it still needs to wait
+        // and if it does, call wait() with the epoch returned by prepare().
+        //
+        // prepare() marks the epoch as being waited on. notify() increments the epoch and clears the mark.
+        // If the mark was set before the increment, notify() wakes up the waiters. Otherwise the increment
+        // happened before prepare() and the waiter is guaranteed to see the new state during its check.
+        // Since the mark is cleared, further notify() calls won't wake anyone until the next prepare().
+        struct alignas(cache_line_size) signal
+        {
+            uint32_t prepare() noexcept
+            {
+                return _epoch.fetch_or(waiting_flag, std::memory_order_seq_cst) | waiting_flag;
+            }
+
+            void wait(uint32_t epoch) const noexcept
+            {
+                _epoch.wait(epoch, std::memory_order_relaxed);
+            }
+
+            void notify() noexcept
+            {
+                auto epoch = _epoch.load(std::memory_order_relaxed);
+                // (epoch | waiting_flag) + 1 is always different from epoch and never has the waiting_flag set.
+                while (!_epoch.compare_exchange_weak(epoch, (epoch | waiting_flag) + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                }
+                if (epoch & waiting_flag)
+                {
+                    _epoch.notify_all();
+                }
+            }
+
+        private:
+            static constexpr uint32_t waiting_flag = 1;
+
+            std::atomic<uint32_t> _epoch{ 0 };
+        };
+
+        struct acquisition
+        {
+            // The index range [begin, end) is the range of slots in the array returned by
+            // arc<T>::data() that may be written to / read from respectively.
+            // If a range has been successfully acquired "end > begin" is true. end thus can't be 0.
+            size_t begin;
+            size_t end;
+
+            // The unwrapped position of begin. release() uses it to compute the slot sequence numbers.
+            size_t position;
+
+            // If the other side of the queue hasn't been destroyed yet, alive will be true.
+            bool alive;
+        };
+
+        // arc is a bounded ring buffer in the style of Dmitry Vyukov's MPMC queue:
+        //   https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+        //
+        // Producers and consumers claim slots by advancing _tail and _head respectively.
+        // Unlike til::spsc this doesn't tell them whether the slots have actually been written
+        // to / read from yet, because the other producers/consumers may still be busy with them.
+        // Every slot thus has an additional sequence number which is derived from the unwrapped
+        // position of the slot, whenever the slot is handed over to the other side:
+        // * pos:            the slot is empty and can be written by the producer that claims pos
+        // * pos + 1:        the slot contains an item which can be read by the consumer that claims pos
+        // * pos + capacity: the slot is empty again and can be written by the producer that claims pos + capacity
+        //
+        // A side may claim multiple consecutive slots at once, as long as all of them are ready and
+        // the range doesn't wrap around the end of the ring buffer. This is what allows push_n() and
+        // pop_n() to copy entire batches of items while only touching _tail/_head once.
+        //
+        // If MultiConsumer is false the consumer doesn't need to compete for _head and can
+        // simply store its new position instead of using a compare-exchange loop.
+        template<typename T, bool MultiConsumer>
+        struct arc
+        {
+            explicit arc(size_t capacity) :
+                _sequences(std::make_unique<std::atomic<size_t>[]>(capacity)),
+                _data(alloc_raw_memory<T>(capacity * sizeof(T))),
+                _mask(capacity - 1)
+            {
+                for (size_t i = 0; i < capacity; ++i)
+                {
+                    _sequences[i].store(i, std::memory_order_relaxed);
+                }
+            }
+
+            ~arc()
+            {
+                // Both sides are gone and all acquisitions have been released by now.
+                // Everything between _head and _tail is thus a valid item.
+                const auto head = _head.value.load(std::memory_order_relaxed);
+                const auto tail = _tail.value.load(std::memory_order_relaxed);
+
+                for (auto pos = head; pos != tail; ++pos)
+                {
+                    std::destroy_at(_data + (pos & _mask));
+                }
+
+                free_raw_memory(_data);
+            }
+
+            void add_producer() noexcept
+            {
+                _producers.fetch_add(1, std::memory_order_relaxed);
+                _references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void add_consumer() noexcept
+            {
+                _consumers.fetch_add(1, std::memory_order_relaxed);
+                _references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void drop_producer() noexcept
+            {
+                // The last producer wakes up all consumers, so that they can notice that they're done.
+                if (_producers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    _produced.notify();
+                }
+                drop();
+            }
+
+            void drop_consumer() noexcept
+            {
+                if (_consumers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    _consumed.notify();
+                }
+                drop();
+            }
+
+            acquisition producer_acquire(size_t slots, bool blocking) noexcept
+            {
+                while (true)
+                {
+                    // The producer stops immediately if the consumers are gone.
+                    if (_consumers.load(std::memory_order_acquire) == 0)
+                    {
+                        return { 0, 0, 0, false };
+                    }
+
+                    if (const auto acquisition = claim<true>(_tail.value, 0, slots); acquisition.end)
+                    {
+                        return acquisition;
+                    }
+
+                    if (!blocking)
+                    {
+                        return { 0, 0, 0, true };
+                    }
+
+                    const auto epoch = _consumed.prepare();
+                    if (_consumers.load(std::memory_order_acquire) != 0 && !ready(_tail.value, 0))
+                    {
+                        _consumed.wait(epoch);
+                    }
+                }
+            }
+
+            void producer_release(acquisition acquisition) noexcept
+            {
+                release(acquisition, 1);
+                _produced.notify();
+            }
+
+            acquisition consumer_acquire(size_t slots, bool blocking) noexcept
+            {
+                while (true)
+                {
+                    if (const auto acquisition = claim<MultiConsumer>(_head.value, 1, slots); acquisition.end)
+                    {
+                        return acquisition;
+                    }
+
+                    // The consumer finishes consuming all values before it stops.
+                    // Each producer releases its slots before it drops, so if we see that
+                    // they're all gone, checking the queue once more is sufficient.
+                    if (_producers.load(std::memory_order_acquire) == 0)
+                    {
+                        if (ready(_head.value, 1))
+                        {
+                            continue;
+                        }
+                        return { 0, 0, 0, false };
+                    }
+
+                    if (!blocking)
+                    {
+                        return { 0, 0, 0, true };
+                    }
+
+                    const auto epoch = _produced.prepare();
+                    if (_producers.load(std::memory_order_acquire) != 0 && !ready(_head.value, 1))
+                    {
+                        _produced.wait(epoch);
+                    }
+                }
+            }
+
+            void consumer_release(acquisition acquisition) noexcept
+            {
+                release(acquisition, _mask + 1);
+                _consumed.notify();
+            }
+
+            T* data() const noexcept
+            {
+                return _data;
+            }
+
+        private:
+            void drop() noexcept
+            {
+                // The contents are only deleted when all producers and consumers have been dropped.
+                if (_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete this;
+                }
+            }
+
+            // Returns whether the slot at `position` has the sequence number
+            // the side owning `position` is waiting for (see the arc comment).
+            bool ready(const std::atomic<size_t>& position, size_t offset) const noexcept
+            {
+                const auto pos = position.load(std::memory_order_relaxed);
+                return _sequences[pos & _mask].load(std::memory_order_acquire) == pos + offset;
+            }
+
+            // Claims up to `slots` consecutive slots starting at `position`,
+            // whose sequence numbers must be equal to their position + `offset`.
+            // Returns an empty acquisition if the first slot isn't ready yet.
+            template<bool Shared>
+            acquisition claim(std::atomic<size_t>& position, size_t offset, size_t slots) noexcept
+            {
+                auto pos = position.load(std::memory_order_relaxed);
+
+                while (true)
+                {
+                    const auto begin = pos & _mask;
+                    const auto limit = std::min(slots, _mask + 1 - begin);
+                    size_t count = 0;
+
+                    // This acquire read synchronizes with the release write in release().
+                    while (count < limit && _sequences[begin + count].load(std::memory_order_acquire) == pos + count + offset)
+                    {
+                        ++count;
+                    }
+
+                    if (count == 0)
+                    {
+                        // If `position` didn't change, the first slot simply isn't ready yet.
+                        // Otherwise another thread claimed it and we need to try again.
+                        const auto current = position.load(std::memory_order_relaxed);
+                        if (current == pos)
+                        {
+                            return { 0, 0, 0, true };
+                        }
+                        pos = current;
+                        continue;
+                    }
+
+                    if constexpr (Shared)
+                    {
+                        // On failure, this will update `pos` with the current value.
+                        if (!position.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                        {
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        position.store(pos + count, std::memory_order_relaxed);
+                    }
+
+                    return { begin, begin + count, pos, true };
+                }
+            }
+
+            void release(acquisition acquisition, size_t offset) noexcept
+            {
+                for (auto i = acquisition.begin; i < acquisition.end; ++i)
+                {
+                    // This release write synchronizes with the acquire read in claim().
+                    _sequences[i].store(acquisition.position + (i - acquisition.begin) + offset, std::memory_order_release);
+                }
+            }
+
+            const std::unique_ptr<std::atomic<size_t>[]> _sequences;
+            T* const _data;
+            const size_t _mask;
+
+            std::atomic<uint32_t> _producers{ 1 };
+            std::atomic<uint32_t> _consumers{ 1 };
+            std::atomic<uint32_t> _references{ 2 };
+
+            position _tail;
+            position _head;
+            signal _produced;
+            signal _consumed;
+        };
+
+        template<typename T, bool MultiConsumer>
+        struct producer
+        {
+            explicit producer(arc<T, MultiConsumer>* arc) noexcept :
+                _arc(arc) {}
+
+            producer(const producer& other) noexcept :
+                _arc(other._arc)
+            {
+                if (_arc)
+                {
+                    _arc->add_producer();
+                }
+            }
+
+            producer& operator=(const producer& other) noexcept
+            {
+                if (this != &other)
+                {
+                    *this = producer{ other };
+                }
+                return *this;
+            }
+
+            producer(producer&& other) noexcept :
+                _arc(std::exchange(other._arc, nullptr))
+            {
+            }
+
+            producer& operator=(producer&& other) noexcept
+            {
+                drop();
+                _arc = std::exchange(other._arc, nullptr);
+                return *this;
+            }
+
+            ~producer()
+            {
+                drop();
+            }
+
+            // emplace constructs an item in-place at the end of the queue.
+            // It returns true, if the item was successfully placed within the queue.
+            // The return value will be false, if the consumers are gone.
+            template<typename... Args>
+            bool emplace(Args&&... args) const
+            {
+                return _emplace(true, std::forward<Args>(args)...);
+            }
+
+            // try_emplace is like emplace, but returns false instead of blocking if the queue is full.
+            template<typename... Args>
+            bool try_emplace(Args&&... args) const
+            {
+                return _emplace(false, std::forward<Args>(args)...);
+            }
+
+            template<typename InputIt>
+            std::pair<size_t, bool> push(InputIt first, InputIt last) const
+            {
+                return push_n(spsc::block_forever, first, std::distance(first, last));
+            }
+
+            // push writes the items between first and last into the queue.
+            // The amount of successfully written items is returned as the first pair field.
+            // The second pair field will be false if the consumers are gone.
+            template<typename WaitPolicy, typename InputIt, enable_if_wait_policy_t<WaitPolicy> = 0>
+            std::pair<size_t, bool> push(WaitPolicy&& policy, InputIt first, InputIt last) const
+            {
+                return push_n(std::forward<WaitPolicy>(policy), first, std::distance(first, last));
+            }
+
+            template<typename InputIt>
+            std::pair<size_t, bool> push_n(InputIt first, size_t count) const
+            {
+                return push_n(spsc::block_forever, first, count);
+            }
+
+            // push_n writes count items from first into the queue.
+            // The amount of successfully written items is returned as the first pair field.
+            // The second pair field will be false if the consumers are gone.
+            // Other producers may interleave their items with these if the queue is too small to fit all of them at once.
+            template<typename WaitPolicy, typename InputIt, enable_if_wait_policy_t<WaitPolicy> = 0>
+            std::pair<size_t, bool> push_n(WaitPolicy&&, InputIt first, size_t count) const
+            {
+                const auto data = _arc->data();
+                auto remaining = count;
+                auto blocking = blocks_initially<WaitPolicy>;
+                auto ok = true;
+
+                while (remaining != 0)
+                {
+                    auto acquisition = _arc->producer_acquire(remaining, blocking);
+                    if (!acquisition.end)
+                    {
+                        ok = acquisition.alive;
+                        break;
+                    }
+
+                    const auto begin = data + acquisition.begin;
+                    const auto got = acquisition.end - acquisition.begin;
+                    std::uninitialized_copy_n(first, got, begin);
+                    first += got;
+                    remaining -= got;
+
+                    _arc->producer_release(acquisition);
+
+                    if constexpr (!std::remove_reference_t<WaitPolicy>::_block_forever)
+                    {
+                        blocking = false;
+                    }
+                }
+
+                return { count - remaining, ok };
+            }
+
+        private:
+            template<typename... Args>
+            bool _emplace(bool blocking, Args&&... args) const
+            {
+                auto acquisition = _arc->producer_acquire(1, blocking);
+                if (!acquisition.end)
+                {
+                    return false;
+                }
+
+                auto data = _arc->data();
+                auto begin = data + acquisition.begin;
+                new (begin) T(std::forward<Args>(args)...);
+
+                _arc->producer_release(acquisition);
+                return true;
+            }
+
+            void drop() noexcept
+            {
+                if (_arc)
+                {
+                    _arc->drop_producer();
+                }
+            }
+
+            arc<T, MultiConsumer>* _arc = nullptr;
+        };
+
+        template<typename T, bool MultiConsumer>
+        struct consumer
+        {
+            explicit consumer(arc<T, MultiConsumer>* arc) noexcept :
+                _arc(arc) {}
+
+            // Only mpmc consumers can be copied. A mpsc channel has exactly one.
+            consumer(const consumer& other) noexcept
+                requires MultiConsumer
+                : _arc(other._arc)
+            {
+                if (_arc)
+                {
+                    _arc->add_consumer();
+                }
+            }
+
+            consumer& operator=(const consumer& other) noexcept
+                requires MultiConsumer
+            {
+                if (this != &other)
+                {
+                    *this = consumer{ other };
+                }
+                return *this;
+            }
+
+            consumer(consumer&& other) noexcept :
+                _arc(std::exchange(other._arc, nullptr))
+            {
+            }
+
+            consumer& operator=(consumer&& other) noexcept
+            {
+                drop();
+                _arc = std::exchange(other._arc, nullptr);
+                return *this;
+            }
+
+            ~consumer()
+            {
+                drop();
+            }
+
+            // pop returns the next item in the queue, or std::nullopt if the producers are gone.
+            std::optional<T> pop() const
+            {
+                return _pop(true);
+            }
+
+            // try_pop is like pop, but returns std::nullopt instead of blocking if the queue is empty.
+            std::optional<T> try_pop() const
+            {
+                return _pop(false);
+            }
+
+            template<typename OutputIt>
+            std::pair<size_t, bool> pop_n(OutputIt first, size_t count) const
+            {
+                return pop_n(spsc::block_forever, first, count);
+            }
+
+            // pop_n reads up to count items into first.
+            // The amount of successfully read items is returned as the first pair field.
+            // The second pair field will be false if the producers are gone.
+            template<typename WaitPolicy, typename OutputIt, enable_if_wait_policy_t<WaitPolicy> = 0>
+            std::pair<size_t, bool> pop_n(WaitPolicy&&, OutputIt first, size_t count) const
+            {
+                const auto data = _arc->data();
+                auto remaining = count;
+                auto blocking = blocks_initially<WaitPolicy>;
+                auto ok = true;
+
+                while (remaining != 0)
+                {
+                    auto acquisition = _arc->consumer_acquire(remaining, blocking);
+                    if (!acquisition.end)
+                    {
+                        ok = acquisition.alive;
+                        break;
+                    }
+
+                    auto beg = data + acquisition.begin;
+                    auto end = data + acquisition.end;
+                    auto got = acquisition.end - acquisition.begin;
+                    first = std::move(beg, end, first);
+                    std::destroy(beg, end);
+                    remaining -= got;
+
+                    _arc->consumer_release(acquisition);
+
+                    if constexpr (!std::remove_reference_t<WaitPolicy>::_block_forever)
+                    {
+                        blocking = false;
+                    }
+                }
+
+                return { count - remaining, ok };
+            }
+
+        private:
+            std::optional<T> _pop(bool blocking) const
+            {
+                auto acquisition = _arc->consumer_acquire(1, blocking);
+                if (!acquisition.end)
+                {
+                    return std::nullopt;
+                }
+
+                auto data = _arc->data();
+                auto begin = data + acquisition.begin;
+
+                auto item = std::move(*begin);
+                std::destroy_at(begin);
+
+                _arc->consumer_release(acquisition);
+                return item;
+            }
+
+            void drop() noexcept
+            {
+                if (_arc)
+                {
+                    _arc->drop_consumer();
+                }
+            }
+
+            arc<T, MultiConsumer>* _arc = nullptr;
+        };
+
+        template<typename T, bool MultiConsumer>
+        std::pair<producer<T, MultiConsumer>, consumer<T, MultiConsumer>> channel(uint32_t capacity)
+        {
+            if (capacity == 0)
+            {
+                throw std::invalid_argument{ "invalid capacity" };
+            }
+
+            // The slot sequence numbers are only unambiguous if the capacity is a power of two.
+            // It must also be at least 2: With a single slot "full" (pos + 1) and "empty again" (pos + capacity)
+            // are the same sequence number and the consumers would never see the items written by the producers.
+            const auto arc = new details::mpmc::arc<T, MultiConsumer>(std::bit_ceil(std::max<size_t>(capacity, 2)));
+            return { std::piecewise_construct, std::forward_as_tuple(arc), std::forward_as_tuple(arc) };
+        }
+    }
+
+    namespace mpsc
+    {
+        using spsc::block_forever;
+        using spsc::block_initially;
+
+        // Don't block at all. Only write / read as many items as fit into / are in the queue right now.
+        inline constexpr details::mpmc::non_blocking_policy non_blocking{};
+
+        template<typename T>
+        using producer = details::mpmc::producer<T, false>;
+
+        template<typename T>
+        using consumer = details::mpmc::consumer<T, false>;
+
+        // channel returns a bounded, lock-free, multi-producer, single-consumer
+        // FIFO queue ("channel") with at least the given capacity.
+        // The producer can be copied to give each thread its own.
+        template<typename T>
+        std::pair<producer<T>, consumer<T>> channel(uint32_t capacity)
+        {
+            return details::mpmc::channel<T, false>(capacity);
+        }
+    }
+
+    namespace mpmc
+    {
+        using spsc::block_forever;
+        using spsc::block_initially;
+
+        // Don't block at all. Only write / read as many items as fit into / are in the queue right now.
+        inline constexpr details::mpmc::non_blocking_policy non_blocking{};
+
+        template<typename T>
+        using producer = details::mpmc::producer<T, true>;
+
+        template<typename T>
+        using consumer = details::mpmc::consumer<T, true>;
+
+        // channel returns a bounded, lock-free, multi-producer, multi-consumer
+        // FIFO queue ("channel") with at least the given capacity.
+        // Both the producer and consumer can be copied to give each thread its own.
+        template<typename T>
+        std::pair<producer<T>, consumer<T>> channel(uint32_t capacity)
+        {
+            return details::mpmc::channel<T, true>(capacity);
+        }
+    }
+}
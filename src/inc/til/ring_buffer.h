@@ -0,0 +1,414 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <bit>
+#include <span>
+
+#pragma warning(push)
+// ring_buffer manages a _capacity of potentially uninitialized data. We can't use regular new/delete.
+#pragma warning(disable : 26409) // Avoid calling new and delete explicitly, use std::make_unique<T> instead (r.11).
+// Functions like front()/back()/operator[]() are explicitly unchecked, just like the std::deque equivalents.
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+
+namespace til
+{
+    // A double-ended queue of trivially copyable items, backed by a single growable allocation.
+    //
+    // std::deque is a poor fit for queues of small items that are pushed and popped in bulk: MSVC's implementation
+    // allocates blocks of just 16 bytes (or a single item if it's larger than that) and every item has to be
+    // moved in and out individually. A ring buffer on the other hand can append, prepend and pop any
+    // number of items with at most two memcpy() calls, because its contents are at most two contiguous slices.
+    //
+    // The capacity is always a power of two, which turns the wrap-around into a simple bit mask.
+    template<typename T>
+    class ring_buffer
+    {
+    public:
+        static_assert(std::is_trivially_copyable_v<T>, "ring_buffer moves its items around with memcpy()");
+
+        using value_type = T;
+        using size_type = size_t;
+        using reference = T&;
+        using const_reference = const T&;
+
+        ring_buffer() = default;
+
+        ring_buffer(const ring_buffer& other) :
+            ring_buffer{}
+        {
+            append(other);
+        }
+
+        ring_buffer& operator=(const ring_buffer& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                append(other);
+            }
+            return *this;
+        }
+
+        ring_buffer(ring_buffer&& other) noexcept :
+            _data{ std::exchange(other._data, nullptr) },
+            _capacity{ std::exchange(other._capacity, 0) },
+            _head{ std::exchange(other._head, 0) },
+            _size{ std::exchange(other._size, 0) }
+        {
+        }
+
+        ring_buffer& operator=(ring_buffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                _deallocate(_data);
+                _data = std::exchange(other._data, nullptr);
+                _capacity = std::exchange(other._capacity, 0);
+                _head = std::exchange(other._head, 0);
+                _size = std::exchange(other._size, 0);
+            }
+            return *this;
+        }
+
+        ~ring_buffer()
+        {
+            _deallocate(_data);
+        }
+
+        void swap(ring_buffer& other) noexcept
+        {
+            std::swap(_data, other._data);
+            std::swap(_capacity, other._capacity);
+            std::swap(_head, other._head);
+            std::swap(_size, other._size);
+        }
+
+        constexpr size_type max_size() const noexcept { return (static_cast<size_t>(-1) / 2 + 1) / sizeof(T); }
+        constexpr size_type capacity() const noexcept { return _capacity; }
+        constexpr size_type size() const noexcept { return _size; }
+        constexpr bool empty() const noexcept { return _size == 0; }
+
+        reference operator[](size_type off) noexcept { return _data[_wrap(_head + off)]; }
+        const_reference operator[](size_type off) const noexcept { return _data[_wrap(_head + off)]; }
+
+        reference at(size_type off)
+        {
+            if (off >= _size)
+            {
+                _throw_invalid_subscript();
+            }
+            return operator[](off);
+        }
+
+        const_reference at(size_type off) const
+        {
+            if (off >= _size)
+            {
+                _throw_invalid_subscript();
+            }
+            return operator[](off);
+        }
+
+        reference front() noexcept { return operator[](0); }
+        const_reference front() const noexcept { return operator[](0); }
+        reference back() noexcept { return operator[](_size - 1); }
+        const_reference back() const noexcept { return operator[](_size - 1); }
+
+        // Returns the items in the range [off, off+count) as two contiguous slices, the second of which
+        // is only non-empty if the range wraps around the end of the allocation. The range is clamped to size().
+        std::pair<std::span<T>, std::span<T>> spans(size_type off = 0, size_type count = static_cast<size_t>(-1)) noexcept
+        {
+            off = std::min(off, _size);
+            count = std::min(count, _size - off);
+            if (!count)
+            {
+                return {};
+            }
+
+            const auto beg = _wrap(_head + off);
+            const auto first = std::min(count, _capacity - beg);
+            return { { _data + beg, first }, { _data, count - first } };
+        }
+
+        std::pair<std::span<const T>, std::span<const T>> spans(size_type off = 0, size_type count = static_cast<size_t>(-1)) const noexcept
+        {
+            const auto [a, b] = const_cast<ring_buffer*>(this)->spans(off, count);
+            return { a, b };
+        }
+
+        void clear() noexcept
+        {
+            _head = 0;
+            _size = 0;
+        }
+
+        void reserve(size_type new_cap)
+        {
+            if (new_cap > _capacity)
+            {
+                _grow(new_cap);
+            }
+        }
+
+        // Releases the allocation if the ring buffer is empty, or shrinks it down to the next power of two.
+        void shrink_to_fit()
+        {
+            if (!_size)
+            {
+                _deallocate(_data);
+                _data = nullptr;
+                _capacity = 0;
+                _head = 0;
+            }
+            else if (const auto cap = std::bit_ceil(_size); cap < _capacity)
+            {
+                _reallocate(cap);
+            }
+        }
+
+        void push_back(const T& value)
+        {
+            // `value` may point into this ring buffer, which is why it's copied before we (potentially) grow.
+            const auto copy = value;
+            _ensure_fits(1);
+            _data[_wrap(_head + _size)] = copy;
+            _size++;
+        }
+
+        void push_front(const T& value)
+        {
+            const auto copy = value;
+            _ensure_fits(1);
+            _head = _wrap(_head - 1);
+            _data[_head] = copy;
+            _size++;
+        }
+
+        void pop_back() noexcept
+        {
+            _size--;
+        }
+
+        void pop_front() noexcept
+        {
+            pop_front(1);
+        }
+
+        // Removes the first `count` items. `count` is clamped to size().
+        void pop_front(size_type count) noexcept
+        {
+            count = std::min(count, _size);
+            _size -= count;
+            // Returning to the start of the allocation while empty means that the next
+            // append() is more likely to be a single memcpy() and the same for reading it.
+            _head = _size ? _wrap(_head + count) : 0;
+        }
+
+        void append(std::span<const T> items)
+        {
+            if (items.empty())
+            {
+                return;
+            }
+
+            _check_aliasing(items);
+            _ensure_fits(items.size());
+            _copy_in(_wrap(_head + _size), items);
+            _size += items.size();
+        }
+
+        void append(const ring_buffer& other)
+        {
+            if (this == &other)
+            {
+                auto copy = other;
+                append(copy);
+                return;
+            }
+
+            const auto [a, b] = other.spans();
+            reserve(_size + other._size);
+            append(a);
+            append(b);
+        }
+
+        // Inserts the items before the first item, preserving their order.
+        void prepend(std::span<const T> items)
+        {
+            if (items.empty())
+            {
+                return;
+            }
+
+            _check_aliasing(items);
+            _ensure_fits(items.size());
+            _head = _wrap(_head - items.size());
+            _copy_in(_head, items);
+            _size += items.size();
+        }
+
+        void prepend(const ring_buffer& other)
+        {
+            if (this == &other)
+            {
+                auto copy = other;
+                prepend(copy);
+                return;
+            }
+
+            const auto [a, b] = other.spans();
+            reserve(_size + other._size);
+            prepend(b);
+            prepend(a);
+        }
+
+        // Copies up to dest.size() items starting at `off` into `dest` and returns the number of copied items.
+        size_type copy_to(size_type off, std::span<T> dest) const noexcept
+        {
+            const auto [a, b] = spans(off, dest.size());
+            if (!a.empty())
+            {
+                memcpy(dest.data(), a.data(), a.size_bytes());
+            }
+            if (!b.empty())
+            {
+                memcpy(dest.data() + a.size(), b.data(), b.size_bytes());
+            }
+            return a.size() + b.size();
+        }
+
+        // Removes all items for which `pred` returns true, preserving the order of the remaining ones.
+        template<typename Predicate>
+        size_type erase_if(Predicate&& pred)
+        {
+            size_type kept = 0;
+            for (size_type i = 0; i < _size; ++i)
+            {
+                auto& item = operator[](i);
+                if (!pred(std::as_const(item)))
+                {
+                    if (kept != i)
+                    {
+                        operator[](kept) = item;
+                    }
+                    kept++;
+                }
+            }
+
+            const auto removed = _size - kept;
+            _size = kept;
+            if (!_size)
+            {
+                _head = 0;
+            }
+            return removed;
+        }
+
+    private:
+        [[noreturn]] static void _throw_invalid_subscript()
+        {
+            throw std::out_of_range("invalid ring_buffer subscript");
+        }
+
+        [[noreturn]] static void _throw_too_long()
+        {
+            throw std::length_error("ring_buffer too long");
+        }
+
+        static T* _allocate(size_t size)
+        {
+            if constexpr (alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                return static_cast<T*>(::operator new(size * sizeof(T)));
+            }
+            else
+            {
+                return static_cast<T*>(::operator new(size * sizeof(T), static_cast<std::align_val_t>(alignof(T))));
+            }
+        }
+
+        static void _deallocate(T* data) noexcept
+        {
+            if constexpr (alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                ::operator delete(data);
+            }
+            else
+            {
+                ::operator delete(data, static_cast<std::align_val_t>(alignof(T)));
+            }
+        }
+
+        constexpr size_t _wrap(size_t index) const noexcept
+        {
+            return index & (_capacity - 1);
+        }
+
+        // Items that point into the ring buffer itself would be invalidated by _grow().
+        void _check_aliasing(std::span<const T> items) const noexcept
+        {
+            assert(items.data() + items.size() <= _data || items.data() >= _data + _capacity);
+        }
+
+        void _ensure_fits(size_type add)
+        {
+            const auto new_size = _size + add;
+            if (new_size < _size)
+            {
+                _throw_too_long();
+            }
+            if (new_size > _capacity)
+            {
+                _grow(new_size);
+            }
+        }
+
+        // Copies the items into the allocation starting at `beg`, wrapping around its end if needed.
+        void _copy_in(size_t beg, std::span<const T> items) noexcept
+        {
+            const auto first = std::min(items.size(), _capacity - beg);
+            memcpy(_data + beg, items.data(), first * sizeof(T));
+            memcpy(_data, items.data() + first, (items.size() - first) * sizeof(T));
+        }
+
+        __declspec(noinline) void _grow(size_type min_cap)
+        {
+            if (min_cap > max_size())
+            {
+                _throw_too_long();
+            }
+            // Grow by at least 2x and to no less than 64 bytes worth of items to avoid frequent tiny reallocations.
+            const auto min_items = std::max<size_t>(1, 64 / sizeof(T));
+            _reallocate(std::bit_ceil(std::max({ min_cap, _capacity * 2, min_items })));
+        }
+
+        void _reallocate(size_type new_cap)
+        {
+            const auto data = _allocate(new_cap);
+            const auto [a, b] = spans();
+            if (!a.empty())
+            {
+                memcpy(data, a.data(), a.size_bytes());
+            }
+            if (!b.empty())
+            {
+                memcpy(data + a.size(), b.data(), b.size_bytes());
+            }
+
+            _deallocate(_data);
+            _data = data;
+            _capacity = new_cap;
+            _head = 0;
+        }
+
+        T* _data = nullptr;
+        size_t _capacity = 0;
+        size_t _head = 0;
+        size_t _size = 0;
+    };
+}
+
+#pragma warning(pop)
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <bit>
+
 #ifdef UNIT_TESTING
 class RunLengthEncodingTests;
 #endif
@@ -231,6 +233,68 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             ParentIt _it;
             size_type _pos;
         };
+
+        // The number of elements past the end of a basic_rle index that rle_find_run() may read (but ignores).
+        inline constexpr size_t rle_index_padding = 16;
+
+        // Returns the index of the first element in the sorted array `ends` that's greater than `position`,
+        // or `count` if there's none. The memory must extend rle_index_padding elements past `count`.
+        template<typename S>
+        size_t rle_find_run(const S* ends, size_t count, S position) noexcept
+        {
+            auto first = ends;
+            auto len = count;
+
+            // This is a branchless binary search, which narrows the range down to rle_index_padding elements.
+            // The answer is always within [first, first + len].
+            while (len > rle_index_padding)
+            {
+                const auto half = len / 2;
+                first = first[half] <= position ? first + half : first;
+                len -= half;
+            }
+
+            // Since the array is sorted, the answer is the number of elements in the remaining window
+            // that are less or equal to `position`. We can compare them all at once with SIMD.
+            size_t n = 0;
+#if defined(TIL_SSE_INTRINSICS)
+            if constexpr (sizeof(S) == 2)
+            {
+                // SSE2 only has signed comparisons. Flipping the sign bit maps unsigned to signed order.
+                const auto bias = _mm_set1_epi16(INT16_MIN);
+                const auto needle = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(position)), bias);
+                const auto a = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), bias);
+                const auto b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 8)), bias);
+                const auto gt = _mm_packs_epi16(_mm_cmpgt_epi16(a, needle), _mm_cmpgt_epi16(b, needle));
+                // The elements past `len` are treated as if they're greater than `position`.
+                const auto mask = static_cast<unsigned>(_mm_movemask_epi8(gt)) | (~0u << len);
+                n = std::countr_zero(mask);
+            }
+            else
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+            if constexpr (sizeof(S) == 2)
+            {
+                static constexpr uint16_t lanes[16]{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+                const auto data = reinterpret_cast<const uint16_t*>(first);
+                const auto needle = vdupq_n_u16(position);
+                const auto limit = vdupq_n_u16(static_cast<uint16_t>(len));
+                // The elements past `len` are masked out.
+                const auto a = vandq_u16(vcleq_u16(vld1q_u16(data), needle), vcltq_u16(vld1q_u16(&lanes[0]), limit));
+                const auto b = vandq_u16(vcleq_u16(vld1q_u16(data + 8), needle), vcltq_u16(vld1q_u16(&lanes[8]), limit));
+                const auto sum = vpaddlq_u32(vpaddlq_u16(vaddq_u16(vshrq_n_u16(a, 15), vshrq_n_u16(b, 15))));
+                n = static_cast<size_t>(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+            }
+            else
+#endif
+            {
+                for (size_t i = 0; i < len; ++i)
+                {
+                    n += first[i] <= position;
+                }
+            }
+
+            return static_cast<size_t>(first - ends) + n;
+        }
     } // namespace details
 
     // rle_pair is a simple clone of std::pair, with one difference:
@@ -286,6 +350,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         return !(lhs == rhs);
     }
 
+    // The range [begin, end) and the value it should be filled with. See basic_rle::replace_ranges().
+    template<typename T, typename S>
+    struct rle_range
+    {
+        S begin{};
+        S end{};
+        T value{};
+    };
+
     template<typename T, typename S = std::size_t, typename Container = std::vector<rle_pair<T, S>>>
     class basic_rle
     {
@@ -303,8 +376,14 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
         using rle_type = rle_pair<value_type, size_type>;
+        using range_type = rle_range<value_type, size_type>;
         using container = Container;
 
+        // Once there are this many runs, lookups by position use a prefix sum of the run lengths (the "index")
+        // and a binary search instead of a linear scan. This is mostly relevant for attribute-heavy rows.
+        // Below this threshold, a linear scan is just as fast and we save ourselves the memory.
+        static constexpr size_t index_threshold = 32;
+
         // We don't check anywhere whether a size_type value is negative.
         // Having signed integers would break that.
         static_assert(std::is_unsigned_v<size_type>, "the run length S must be unsigned");
@@ -317,7 +396,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         basic_rle& operator=(const basic_rle& other) = default;
 
         basic_rle(basic_rle&& other) noexcept :
-            _runs(std::move(other._runs)), _total_length(other._total_length)
+            _runs(std::move(other._runs)),
+            _total_length(other._total_length),
+            _index(std::move(other._index)),
+            _index_valid(std::exchange(other._index_valid, 0))
         {
             // C++ fun fact:
             // "std::move" actually doesn't actually promise to _really_ move stuff from A to B,
@@ -339,6 +421,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             _runs = std::move(other._runs);
             _total_length = other._total_length;
+            _index = std::move(other._index);
+            _index_valid = std::exchange(other._index_valid, 0);
 
             // See basic_rle(basic_rle&&) for why this is necessary.
             if (other._runs.empty())
@@ -380,6 +464,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             std::swap(_runs, other._runs);
             std::swap(_total_length, other._total_length);
+            std::swap(_index, other._index);
+            std::swap(_index_valid, other._index_valid);
         }
 
         bool empty() const noexcept
@@ -400,8 +486,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             return _runs;
         }
 
+        // Since the runs may be modified arbitrarily, this discards the index.
         container& runs() noexcept
         {
+            _index_valid = 0;
             return _runs;
         }
 
@@ -411,7 +499,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             const auto begin = _runs.begin();
             const auto end = _runs.end();
 
-            rle_scanner scanner(begin, end);
+            rle_scanner scanner(begin, end, _prepare_index(), &_index_valid);
             auto it = scanner.scan(position).first;
 
             if (it == end)
@@ -443,7 +531,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             //
             // --> It's safe to subtract 1 from end_index
 
-            rle_scanner scanner(_runs.begin(), _runs.end());
+            rle_scanner scanner(_runs.begin(), _runs.end(), _prepare_index(), &_index_valid);
             const auto [begin_run, start_run_pos] = scanner.scan(start_index);
             const auto [end_run, end_run_pos] = scanner.scan(end_index - 1);
 
@@ -491,6 +579,80 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             _replace_unchecked(start_index, end_index, replacements._runs);
         }
 
+        // Fills each of the given ranges with its value. The ranges must be sorted and must not overlap.
+        // If the end of a range is larger than size() it's set to size().
+        // Unlike calling replace() for each range, this rebuilds the runs in a single pass.
+        void replace_ranges(const std::span<const range_type> ranges)
+        {
+            size_type previous_end = 0;
+            for (const auto& range : ranges)
+            {
+                if (range.begin < previous_end || range.begin > std::min(range.end, _total_length))
+                {
+                    throw std::out_of_range("ranges must be sorted and must not overlap");
+                }
+                previous_end = std::min(range.end, _total_length);
+            }
+
+            if (ranges.empty())
+            {
+                return;
+            }
+
+            container runs;
+            // Each range can split up at most one existing run into two.
+            runs.reserve(_runs.size() + 2 * ranges.size());
+
+            auto it = _runs.begin();
+            size_type pos = 0; // The position we've processed so far.
+            size_type run_pos = 0; // How much of *it we've processed so far.
+
+            const auto append = [&](const value_type& value, size_type length) {
+                if (!length)
+                {
+                    return;
+                }
+                if (!runs.empty() && runs.back().value == value)
+                {
+                    runs.back().length += length;
+                }
+                else
+                {
+                    runs.emplace_back(value, length);
+                }
+            };
+            // Advances to `target` and copies the existing runs on the way, if `copy` is true.
+            const auto advance = [&](size_type target, bool copy) {
+                while (pos < target)
+                {
+                    const auto length = std::min<size_type>(it->length - run_pos, target - pos);
+                    if (copy)
+                    {
+                        append(it->value, length);
+                    }
+                    pos += length;
+                    run_pos += length;
+                    if (run_pos == it->length)
+                    {
+                        ++it;
+                        run_pos = 0;
+                    }
+                }
+            };
+
+            for (const auto& range : ranges)
+            {
+                const auto end = std::min(range.end, _total_length);
+                advance(range.begin, true);
+                append(range.value, gsl::narrow_cast<size_type>(end - range.begin));
+                advance(end, false);
+            }
+            advance(_total_length, true);
+
+            _runs = std::move(runs);
+            _index_valid = 0;
+        }
+
         // Replaces every instance of old_value in this vector with new_value.
         void replace_values(const value_type& old_value, const value_type& new_value)
         {
@@ -503,6 +665,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
             _compact();
+            _index_valid = 0;
         }
 
         // Adjust the size of the vector.
@@ -513,13 +676,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (new_size == 0)
             {
                 _runs.clear();
+                _index_valid = 0;
             }
             else if (new_size < _total_length)
             {
-                rle_scanner scanner(_runs.begin(), _runs.end());
+                rle_scanner scanner(_runs.begin(), _runs.end(), _prepare_index(), &_index_valid);
                 auto [run, pos] = scanner.scan(new_size - 1);
 
                 run->length = ++pos;
+                _invalidate_index(run - _runs.begin());
 
                 _runs.erase(++run, _runs.end());
             }
@@ -529,6 +694,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 auto& run = _runs.back();
 
                 run.length += new_size - _total_length;
+                _invalidate_index(_runs.size() - 1);
             }
 
             _total_length = new_size;
@@ -617,14 +783,22 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 #endif
 
     private:
+        // Finds the run at a given position. Subsequent calls must be made with increasing positions.
+        // If an index (see _prepare_index()) is given, it's used to binary search the runs it covers.
+        // Past that, the runs are scanned linearly and the index is extended along the way.
         template<typename It>
         struct rle_scanner
         {
-            explicit rle_scanner(It begin, It end) noexcept :
-                it(std::move(begin)), end(std::move(end)) {}
+            explicit rle_scanner(It begin, It end, size_type* ends = nullptr, size_t* ends_valid = nullptr) noexcept :
+                begin(begin), it(std::move(begin)), end(std::move(end)), ends(ends), ends_valid(ends_valid) {}
 
             std::pair<It, size_type> scan(size_type index) noexcept
             {
+                if (ends)
+                {
+                    return scan_indexed(index);
+                }
+
                 run_pos = 0;
 
                 for (; it != end; ++it)
@@ -643,12 +817,79 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
         private:
+            std::pair<It, size_type> scan_indexed(size_type index) noexcept
+            {
+                auto valid = *ends_valid;
+                run_pos = 0;
+
+                if (valid && index < ends[valid - 1])
+                {
+                    const auto i = details::rle_find_run<size_type>(ends, valid, index);
+                    run_pos = gsl::narrow_cast<size_type>(index - (i ? ends[i - 1] : 0));
+                    return { begin + i, run_pos };
+                }
+
+                if (valid && it - begin < gsl::narrow_cast<ptrdiff_t>(valid))
+                {
+                    it = begin + valid;
+                    total = ends[valid - 1];
+                }
+
+                // Same as in scan(), but records the position of each run we pass in the index.
+                for (; it != end; ++it)
+                {
+                    const size_type new_total = total + it->length;
+                    ends[valid++] = new_total;
+                    if (new_total > index)
+                    {
+                        run_pos = index - total;
+                        break;
+                    }
+
+                    total = new_total;
+                }
+
+                *ends_valid = valid;
+                return { it, run_pos };
+            }
+
+            const It begin;
             It it;
             const It end;
+            size_type* const ends;
+            size_t* const ends_valid;
             size_type run_pos = 0;
             size_type total = 0;
         };
 
+        // Returns the index for rle_scanner, or nullptr if there are too few runs to warrant one.
+        // _index[i] is the position just past the end of _runs[i] and _index_valid is the number of
+        // entries that are up to date. Modifications only discard the entries from the first modified run
+        // onwards (see _invalidate_index()) and rle_scanner recomputes them as it scans past them.
+        // This way the common case of writing a row from left to right doesn't need to rebuild it.
+        //
+        // NOTE: This modifies mutable members. Like the rest of the text buffer, concurrent
+        // access to a basic_rle, including const access, must be synchronized.
+        size_type* _prepare_index() const
+        {
+            const auto count = _runs.size();
+            if (count < index_threshold)
+            {
+                return nullptr;
+            }
+            if (_index.size() < count + details::rle_index_padding)
+            {
+                _index.resize(count + details::rle_index_padding);
+            }
+            return _index.data();
+        }
+
+        // Discards the index entries of the given run and all runs after it.
+        void _invalidate_index(ptrdiff_t run) noexcept
+        {
+            _index_valid = std::min(_index_valid, gsl::narrow_cast<size_t>(std::max<ptrdiff_t>(run, 0)));
+        }
+
         basic_rle(container&& runs, size_type size) noexcept :
             _runs(std::forward<container>(runs)),
             _total_length(size)
@@ -866,10 +1107,14 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             // TODO GH#10135: Ensure replacements contains no runs with .length == 0.
 
-            rle_scanner scanner{ _runs.begin(), _runs.end() };
+            rle_scanner scanner{ _runs.begin(), _runs.end(), _prepare_index(), &_index_valid };
             auto [begin, begin_pos] = scanner.scan(start_index);
             auto [end, end_pos] = scanner.scan(end_index);
 
+            // The run preceding start_index may get joined with the replacements and
+            // any run after it may change. Everything before that stays the same.
+            _invalidate_index(begin - _runs.begin() - 1);
+
             // This condition handles pure removals, where replacements.size() == 0.
             //
             // But this isn't just a shortcut optimization...
@@ -1023,6 +1268,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         container _runs;
         S _total_length{ 0 };
+        mutable std::vector<S> _index;
+        mutable size_t _index_valid = 0;
 
 #ifdef UNIT_TESTING
         friend class ::RunLengthEncodingTests;
@@ -1030,6 +1277,9 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         template<typename It>
         rle_scanner(It b, It e) -> rle_scanner<It>;
+
+        template<typename It>
+        rle_scanner(It b, It e, size_type* ends, size_t* ends_valid) -> rle_scanner<It>;
     };
 
     template<typename T, typename S = std::size_t>
@@ -9,11 +9,13 @@ Abstract:
 - Defines classes which hold the status of the current partials handling.
 - Defines functions for converting between UTF-8 and UTF-16 strings.
 
-Tests have been made in order to investigate whether or not own algorithms
-could overcome disadvantages of syscalls. Test results can be read up
-in PR #4093 and the test algorithms are available in src\tools\U8U16Test.
-Based on the results the decision was made to keep using the platform
-functions MultiByteToWideChar and WideCharToMultiByte.
+Originally these functions used MultiByteToWideChar and WideCharToMultiByte,
+because tests in PR #4093 showed that simple scalar algorithms couldn't beat them.
+The transcoders in til::details now use SIMD to process runs of ASCII, which make up
+the vast majority of terminal output, 16 or 32 code units at a time. Everything else
+is decoded and validated one code point at a time. This makes them considerably faster
+than the platform functions for typical input and at least on par for the rest.
+src\tools\U8U16Test benchmarks them against the platform functions.
 
 Author(s):
 - Steffen Illhardt (german-one), Leonard Hecker (lhecker) 2020-2021
@@ -21,8 +23,274 @@ Author(s):
 
 #pragma once
 
+#if defined(TIL_SSE_INTRINSICS)
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <isa_availability.h>
+extern "C" int __isa_available;
+#define _TIL_U8U16_AVX2 (__isa_available >= __ISA_AVAILABLE_AVX2)
+#elif defined(__AVX2__)
+#define _TIL_U8U16_AVX2 true
+#endif
+#endif
+
 namespace til // Terminal Implementation Library. Also: "Today I Learned"
 {
+    namespace details
+    {
+#pragma warning(push)
+#pragma warning(disable : 26429 26446 26481 26490) // use not_null, subscript operator, pointer arithmetic, reinterpret_cast
+        // Routine Description:
+        // - Converts UTF-8 to UTF-16. Ill-formed sequences are replaced with U+FFFD, one per "maximal subpart"
+        //   as recommended by the Unicode Standard (chapter 3.9, "U+FFFD Substitution of Maximal Subparts").
+        //   This matches what MultiByteToWideChar does.
+        // Arguments:
+        // - in - pointer to the UTF-8 string
+        // - len - length of the UTF-8 string
+        // - out - pointer to a buffer of at least `len` UTF-16 code units
+        // Return Value:
+        // - the number of UTF-16 code units written to `out`
+        inline size_t u8u16_convert(const char* const in, const size_t len, wchar_t* const out) noexcept
+        {
+            auto src = reinterpret_cast<const uint8_t*>(in);
+            const auto end = src + len;
+            auto dst = out;
+
+            while (src < end)
+            {
+                // Convert ASCII in bulk. If a block contains any non-ASCII bytes, we fall through to
+                // the scalar loop below, which processes at least the remainder of the block.
+#if defined(TIL_SSE_INTRINSICS)
+#if defined(_TIL_U8U16_AVX2)
+                if (_TIL_U8U16_AVX2)
+                {
+                    for (; end - src >= 32; src += 32, dst += 32)
+                    {
+                        const auto vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+                        if (_mm256_movemask_epi8(vec))
+                        {
+                            break;
+                        }
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 0), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(vec)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(vec, 1)));
+                    }
+                }
+#endif
+                for (; end - src >= 16; src += 16, dst += 16)
+                {
+                    const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                    if (_mm_movemask_epi8(vec))
+                    {
+                        break;
+                    }
+                    const auto zero = _mm_setzero_si128();
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), _mm_unpacklo_epi8(vec, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(vec, zero));
+                }
+#else
+                for (; end - src >= 8; src += 8, dst += 8)
+                {
+                    uint64_t vec;
+                    memcpy(&vec, src, sizeof(vec));
+                    if (vec & 0x8080808080808080)
+                    {
+                        break;
+                    }
+                    for (size_t i = 0; i < 8; ++i)
+                    {
+                        dst[i] = src[i];
+                    }
+                }
+#endif
+
+                const auto blockEnd = std::min(end, src + 16);
+                while (src < blockEnd)
+                {
+                    const auto lead = *src;
+                    if (lead < 0x80)
+                    {
+                        *dst++ = lead;
+                        ++src;
+                        continue;
+                    }
+
+                    // The valid ranges of the first continuation byte are limited to prevent
+                    // overlong encodings (E0, F0), surrogates (ED) and code points beyond U+10FFFF (F4).
+                    uint32_t cp;
+                    size_t count;
+                    uint8_t lo = 0x80;
+                    uint8_t hi = 0xBF;
+                    if (lead >= 0xC2 && lead <= 0xDF)
+                    {
+                        cp = lead & 0x1F;
+                        count = 2;
+                    }
+                    else if (lead >= 0xE0 && lead <= 0xEF)
+                    {
+                        cp = lead & 0x0F;
+                        count = 3;
+                        lo = lead == 0xE0 ? 0xA0 : 0x80;
+                        hi = lead == 0xED ? 0x9F : 0xBF;
+                    }
+                    else if (lead >= 0xF0 && lead <= 0xF4)
+                    {
+                        cp = lead & 0x07;
+                        count = 4;
+                        lo = lead == 0xF0 ? 0x90 : 0x80;
+                        hi = lead == 0xF4 ? 0x8F : 0xBF;
+                    }
+                    else
+                    {
+                        *dst++ = 0xFFFD;
+                        ++src;
+                        continue;
+                    }
+
+                    size_t i = 1;
+                    for (; i < count && src + i < end; ++i)
+                    {
+                        const auto b = src[i];
+                        if (b < lo || b > hi)
+                        {
+                            break;
+                        }
+                        cp = (cp << 6) | (b & 0x3F);
+                        lo = 0x80;
+                        hi = 0xBF;
+                    }
+
+                    // The bytes we consumed so far form the maximal subpart. The offending byte (if any) starts the next sequence.
+                    src += i;
+
+                    if (i != count)
+                    {
+                        *dst++ = 0xFFFD;
+                    }
+                    else if (cp < 0x10000)
+                    {
+                        *dst++ = static_cast<wchar_t>(cp);
+                    }
+                    else
+                    {
+                        cp -= 0x10000;
+                        *dst++ = static_cast<wchar_t>(0xD800 | (cp >> 10));
+                        *dst++ = static_cast<wchar_t>(0xDC00 | (cp & 0x3FF));
+                    }
+                }
+            }
+
+            return static_cast<size_t>(dst - out);
+        }
+
+        // Routine Description:
+        // - Converts UTF-16 to UTF-8. Unpaired surrogates are replaced with U+FFFD.
+        //   This matches what WideCharToMultiByte does.
+        // Arguments:
+        // - in - pointer to the UTF-16 string
+        // - len - length of the UTF-16 string
+        // - out - pointer to a buffer of at least `len * 3` UTF-8 code units
+        // Return Value:
+        // - the number of UTF-8 code units written to `out`
+        inline size_t u16u8_convert(const wchar_t* const in, const size_t len, char* const out) noexcept
+        {
+            auto src = reinterpret_cast<const uint16_t*>(in);
+            const auto end = src + len;
+            auto dst = reinterpret_cast<uint8_t*>(out);
+
+            while (src < end)
+            {
+                // Convert ASCII in bulk. See u8u16_convert().
+#if defined(TIL_SSE_INTRINSICS)
+#if defined(_TIL_U8U16_AVX2)
+                if (_TIL_U8U16_AVX2)
+                {
+                    const auto mask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+                    for (; end - src >= 16; src += 16, dst += 16)
+                    {
+                        const auto vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+                        if (!_mm256_testz_si256(vec, mask))
+                        {
+                            break;
+                        }
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(_mm256_castsi256_si128(vec), _mm256_extracti128_si256(vec, 1)));
+                    }
+                }
+#endif
+                {
+                    const auto mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+                    const auto zero = _mm_setzero_si128();
+                    for (; end - src >= 8; src += 8, dst += 8)
+                    {
+                        const auto vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(vec, mask), zero)) != 0xFFFF)
+                        {
+                            break;
+                        }
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(vec, vec));
+                    }
+                }
+#else
+                for (; end - src >= 4; src += 4, dst += 4)
+                {
+                    uint64_t vec;
+                    memcpy(&vec, src, sizeof(vec));
+                    if (vec & 0xFF80FF80FF80FF80)
+                    {
+                        break;
+                    }
+                    for (size_t i = 0; i < 4; ++i)
+                    {
+                        dst[i] = static_cast<uint8_t>(src[i]);
+                    }
+                }
+#endif
+
+                const auto blockEnd = std::min(end, src + 8);
+                while (src < blockEnd)
+                {
+                    uint32_t cp = *src++;
+
+                    if (cp < 0x80)
+                    {
+                        *dst++ = static_cast<uint8_t>(cp);
+                        continue;
+                    }
+
+                    if (cp < 0x800)
+                    {
+                        dst[0] = static_cast<uint8_t>(0xC0 | (cp >> 6));
+                        dst[1] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                        dst += 2;
+                        continue;
+                    }
+
+                    if (cp >= 0xD800 && cp <= 0xDFFF)
+                    {
+                        if (cp <= 0xDBFF && src < end && *src >= 0xDC00 && *src <= 0xDFFF)
+                        {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (*src++ - 0xDC00);
+                            dst[0] = static_cast<uint8_t>(0xF0 | (cp >> 18));
+                            dst[1] = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+                            dst[2] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+                            dst[3] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                            dst += 4;
+                            continue;
+                        }
+                        cp = 0xFFFD;
+                    }
+
+                    dst[0] = static_cast<uint8_t>(0xE0 | (cp >> 12));
+                    dst[1] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+                    dst[2] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                    dst += 3;
+                }
+            }
+
+            return static_cast<size_t>(dst - reinterpret_cast<uint8_t*>(out));
+        }
+#pragma warning(pop)
+    }
+
     // state structure for maintenance of UTF-8 partials
     struct u8state
     {
@@ -55,8 +323,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out) noexcept
@@ -66,14 +332,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int lengthRequired{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthRequired));
-            out.resize(in.length()); // avoid to call MultiByteToWideChar twice only to get the required size
-            const int lengthOut = MultiByteToWideChar(CP_UTF8, 0ul, in.data(), lengthRequired, out.data(), lengthRequired);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
-
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            out.resize(in.length());
+            const auto lengthOut = details::u8u16_convert(in.data(), in.length(), out.data());
+            out.resize(lengthOut);
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -89,8 +352,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
+    // - E_ABORT       - the resulting string length would exceed the upper boundary of a size_t and thus, the conversion was aborted before the conversion has been completed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out, u8state& state) noexcept
@@ -100,40 +362,43 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int capa16{};
+            size_t capa16{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
             RETURN_HR_IF(E_ABORT, !base::CheckAdd(in.length(), state.have).AssignIfValid(&capa16));
 
-            out.resize(gsl::narrow_cast<size_t>(capa16));
-            auto len8{ gsl::narrow_cast<int>(in.length()) };
-            int len16{};
+            out.resize(capa16);
+            auto len8{ in.length() };
+            size_t len16{};
             auto cursor8{ in.data() };
             if (state.have)
             {
-                const auto copyable{ std::min<int>(state.want, len8) };
+                // Only continuation bytes can complete the cached partial. Anything else starts the next
+                // code point, in which case the incomplete partial gets converted to U+FFFD on its own.
+                size_t copyable{};
+                while (copyable < state.want && copyable < len8 && (cursor8[copyable] & 0b11'000000) == 0b10'000000)
+                {
+                    ++copyable;
+                }
                 std::move(cursor8, cursor8 + copyable, &state.partials[state.have]);
                 state.have += gsl::narrow_cast<uint8_t>(copyable);
                 state.want -= gsl::narrow_cast<uint8_t>(copyable);
-                if (state.want) // we still didn't get enough data to complete the code point, however this is not an error
+                if (state.want && copyable == len8) // we still didn't get enough data to complete the code point, however this is not an error
                 {
                     out.clear();
                     return S_OK;
                 }
 
-                len16 = MultiByteToWideChar(CP_UTF8, 0UL, &state.partials[0], gsl::narrow_cast<int>(state.have), out.data(), capa16);
-                RETURN_HR_IF(E_UNEXPECTED, !len16);
+                len16 = details::u8u16_convert(&state.partials[0], state.have, out.data());
 
-                capa16 -= len16;
                 len8 -= copyable;
                 cursor8 += copyable;
-                // state.want is already zero at this point
-                state.have = 0;
+                state.reset();
             }
 
             if (len8)
             {
                 auto backIter{ cursor8 + len8 - 1 };
-                int sequenceLen{ 1 };
+                size_t sequenceLen{ 1 };
 
                 // skip UTF8 continuation bytes
                 while (backIter != cursor8 && (*backIter & 0b11'000000) == 0b10'000000)
@@ -158,13 +423,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len8)
             {
-                const auto convLen{ MultiByteToWideChar(CP_UTF8, 0UL, cursor8, len8, out.data() + len16, capa16) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len16 += convLen;
+                len16 += details::u8u16_convert(cursor8, len8, out.data() + len16);
             }
 
-            out.resize(gsl::narrow_cast<size_t>(len16));
+            out.resize(len16);
             return S_OK;
         }
         CATCH_RETURN();
@@ -179,8 +441,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
+    // - E_ABORT       - the resulting string length would exceed the upper boundary of a size_t and thus, the conversion was aborted before the conversion has been completed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out) noexcept
@@ -190,17 +451,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int lengthIn{};
-            int lengthRequired{};
+            size_t lengthRequired{};
             // Code Point U+0000..U+FFFF: 1 UTF-16 code unit --> 1..3 UTF-8 code units.
             // Code Points >U+FFFF: 2 UTF-16 code units --> 4 UTF-8 code units.
             // Thus, the worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthIn) || !base::CheckMul(lengthIn, 3).AssignIfValid(&lengthRequired));
-            out.resize(gsl::narrow_cast<size_t>(lengthRequired)); // avoid to call WideCharToMultiByte twice only to get the required size
-            const int lengthOut = WideCharToMultiByte(CP_UTF8, 0ul, in.data(), lengthIn, out.data(), lengthRequired, nullptr, nullptr);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
-
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            RETURN_HR_IF(E_ABORT, !base::CheckMul(in.length(), 3).AssignIfValid(&lengthRequired));
+            out.resize(lengthRequired);
+            const auto lengthOut = details::u16u8_convert(in.data(), in.length(), out.data());
+            out.resize(lengthOut);
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -216,8 +475,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded without any change of the represented code points
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
+    // - E_ABORT       - the resulting string length would exceed the upper boundary of a size_t and thus, the conversion was aborted before the conversion has been completed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out, u16state& state) noexcept
@@ -227,24 +485,28 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int len16{};
-            int capa8{};
+            auto len16{ in.length() };
+            size_t capa8{};
             // The worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&len16) || !base::CheckAdd(len16, gsl::narrow_cast<int>(state.partials[0]) != 0).AssignIfValid(&capa8) || !base::CheckMul(capa8, 3).AssignIfValid(&capa8));
+            RETURN_HR_IF(E_ABORT, !(base::CheckAdd(len16, state.partials[0] != 0) * 3).AssignIfValid(&capa8));
 
-            out.resize(gsl::narrow_cast<size_t>(capa8));
-            int len8{};
+            out.resize(capa8);
+            size_t len8{};
             auto cursor16{ in.data() };
             if (state.partials[0])
             {
+                // The 2 code units either form a surrogate pair, or the cached high surrogate gets replaced with U+FFFD.
+                // In the latter case we must not consume the second code unit, as it's the start of the next code point.
                 state.partials[1] = *cursor16;
-                len8 = WideCharToMultiByte(CP_UTF8, 0UL, &state.partials[0], 2, out.data(), capa8, nullptr, nullptr);
-                RETURN_HR_IF(E_UNEXPECTED, !len8);
+                const auto paired = state.partials[1] >= 0xDC00 && state.partials[1] <= 0xDFFF;
+                len8 = details::u16u8_convert(&state.partials[0], paired ? 2 : 1, out.data());
 
                 state.reset();
-                capa8 -= len8;
-                --len16;
-                ++cursor16;
+                if (paired)
+                {
+                    --len16;
+                    ++cursor16;
+                }
             }
 
             if (len16)
@@ -259,13 +521,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len16)
             {
-                const auto convLen{ WideCharToMultiByte(CP_UTF8, 0UL, cursor16, len16, out.data() + len8, capa8, nullptr, nullptr) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len8 += convLen;
+                len8 += details::u16u8_convert(cursor16, len16, out.data() + len8);
             }
 
-            out.resize(gsl::narrow_cast<size_t>(len8));
+            out.resize(len8);
             return S_OK;
         }
         CATCH_RETURN();
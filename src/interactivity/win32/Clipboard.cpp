@@ -159,8 +159,19 @@ void Clipboard::StringPaste(_In_reads_(cchData) const wchar_t* const pData,
 
         const auto vtInputMode = gci.pInputBuffer->IsInVirtualTerminalInputMode();
         const auto bracketedPasteMode = gci.GetBracketedPasteMode();
-        auto inEvents = TextToKeyEvents(pData, cchData, vtInputMode && bracketedPasteMode);
-        gci.pInputBuffer->Write(inEvents);
+
+        if (vtInputMode)
+        {
+            // Each key event gets translated into a VT sequence individually.
+            auto inEvents = TextToKeyEvents(pData, cchData, bracketedPasteMode);
+            gci.pInputBuffer->Write(inEvents);
+        }
+        else
+        {
+            // The input buffer stores the text as-is and only synthesizes key events for it if they're asked for.
+            const auto text = FilterPastedText(pData, cchData);
+            gci.pInputBuffer->WriteText(text, gci.OutputCP);
+        }
     }
     catch (...)
     {
@@ -250,6 +261,39 @@ InputEventQueue Clipboard::TextToKeyEvents(_In_reads_(cchData) const wchar_t* co
         pushControlSequence(L"\x1b[200~");
     }
 
+    const auto codepage = ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP;
+    for (const auto& wch : FilterPastedText(pData, cchData, bracketedPaste))
+    {
+        CharToKeyEvents(wch, codepage, keyEvents);
+    }
+
+    if (bracketedPaste)
+    {
+        pushControlSequence(L"\x1b[201~");
+    }
+
+    return keyEvents;
+}
+
+// Routine Description:
+// - returns the part of the text that is actually input when it's pasted
+// Arguments:
+// - pData - the text to filter
+// - cchData - the size of pData, in wchars
+// - bracketedPaste - whether the text will be bracketed with paste control sequences
+// Return Value:
+// - the filtered text
+// Note:
+// - will throw exception on error
+std::wstring Clipboard::FilterPastedText(_In_reads_(cchData) const wchar_t* const pData,
+                                         const size_t cchData,
+                                         const bool bracketedPaste)
+{
+    THROW_HR_IF_NULL(E_INVALIDARG, pData);
+
+    std::wstring text;
+    text.reserve(cchData);
+
     for (size_t i = 0; i < cchData; ++i)
     {
         auto currentChar = pData[i];
@@ -288,16 +332,10 @@ InputEventQueue Clipboard::TextToKeyEvents(_In_reads_(cchData) const wchar_t* co
             currentChar = UNICODE_CARRIAGERETURN;
         }
 
-        const auto codepage = ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP;
-        CharToKeyEvents(currentChar, codepage, keyEvents);
-    }
-
-    if (bracketedPaste)
-    {
-        pushControlSequence(L"\x1b[201~");
+        text.push_back(currentChar);
     }
 
-    return keyEvents;
+    return text;
 }
 
 // Routine Description:
@@ -4,6 +4,7 @@
 #include "pch.h"
 #include "AtlasEngine.h"
 
+#include <til/hash.h>
 #include <til/unicode.h>
 
 #include "Backend.h"
@@ -269,6 +270,7 @@ try
     _api.invalidatedCursorArea = invalidatedAreaNone;
     _api.invalidatedRows = invalidatedRowsNone;
     _api.scrollOffset = 0;
+
     return S_OK;
 }
 CATCH_RETURN()
@@ -663,6 +665,10 @@ void AtlasEngine::_recreateFontDependentResources()
     _api.replacementCharacterGlyphIndex = 0;
     _api.replacementCharacterLookedUp = false;
 
+    // The cached shaping results hold glyph indices of the previous font faces.
+    _api.shapingCache.clear();
+    _api.shapingCachePrevious.clear();
+
     {
         wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
 
@@ -715,6 +721,10 @@ void AtlasEngine::_recreateCellCountDependentResources()
     _api.bufferLine = std::vector<wchar_t>{};
     _api.bufferLine.reserve(projectedTextSize);
     _api.bufferLineColumn.reserve(projectedTextSize + 1);
+    _api.glyphColumns.reserve(projectedGlyphSize);
+    _api.shapingCacheColumns.reserve(projectedTextSize + 1);
+    // Each row usually results in 1 to a few _flushBufferLine() calls. This allows the cache to hold a couple viewports worth of text.
+    _api.shapingCacheCapacity = std::max<size_t>(256, static_cast<size_t>(_p.s->viewportCellCount.y) * 8);
 
     _api.analysisResults = std::vector<TextAnalysisSinkResult>{};
     _api.clusterMap = Buffer<u16>{ projectedTextSize };
@@ -754,14 +764,61 @@ void AtlasEngine::_flushBufferLine()
         return;
     }
 
-    const auto cleanup = wil::scope_exit([this]() noexcept {
+    auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
+    const auto glyphsBeg = row.glyphIndices.size();
+    const RenderStopwatch stopwatch;
+
+    const auto cleanup = wil::scope_exit([&]() noexcept {
+        _p.stats.shaping += stopwatch.elapsed();
         _api.bufferLine.clear();
         _api.bufferLineColumn.clear();
+        _api.glyphColumns.clear();
+
+        // If shaping failed half-way through, the row contains glyphs without colors.
+        // Drop them so that the backends don't read past the end of the colors vector.
+        if (const auto count = row.colors.size(); row.glyphIndices.size() != count)
+        {
+            row.glyphIndices.erase(row.glyphIndices.begin() + count, row.glyphIndices.end());
+            row.glyphAdvances.erase(row.glyphAdvances.begin() + count, row.glyphAdvances.end());
+            row.glyphOffsets.erase(row.glyphOffsets.begin() + count, row.glyphOffsets.end());
+            while (!row.mappings.empty() && row.mappings.back().glyphsFrom >= count)
+            {
+                row.mappings.pop_back();
+            }
+            if (!row.mappings.empty())
+            {
+                row.mappings.back().glyphsTo = std::min(row.mappings.back().glyphsTo, count);
+            }
+        }
     });
 
     // This would seriously blow us up otherwise.
     Expects(_api.bufferLineColumn.size() == _api.bufferLine.size() + 1);
 
+    ShapingCacheKey key;
+    {
+        const auto baseColumn = _api.bufferLineColumn.front();
+        _api.shapingCacheColumns.clear();
+        for (const auto col : _api.bufferLineColumn)
+        {
+            _api.shapingCacheColumns.emplace_back(gsl::narrow_cast<u16>(col - baseColumn));
+        }
+
+        key.text = { _api.bufferLine.data(), _api.bufferLine.size() };
+        key.columns = _api.shapingCacheColumns;
+        key.attributes = _api.attributes;
+        key.hash = til::hasher{ static_cast<size_t>(_api.attributes) }
+                       .write(key.text)
+                       .write(key.columns.data(), key.columns.size())
+                       .finalize();
+    }
+
+    if (_flushBufferLineFromCache(key))
+    {
+        _flushBufferLineColors(glyphsBeg);
+        return;
+    }
+
     const auto builtinGlyphs = _p.s->font->builtinGlyphs;
     const auto beg = _api.bufferLine.data();
     const auto len = _api.bufferLine.size();
@@ -805,6 +862,139 @@ void AtlasEngine::_flushBufferLine()
         segmentBeg = segmentEnd;
         custom = !custom;
     }
+
+    _flushBufferLineToCache(key, glyphsBeg);
+    _flushBufferLineColors(glyphsBeg);
+}
+
+// Appends the shaping results of a previous, identical _flushBufferLine() call to the current row, if any.
+// This skips the expensive font fallback and text analysis and is common when rows get invalidated without
+// their contents changing (for instance due to cursor blinking or selections) or when text repeats.
+bool AtlasEngine::_flushBufferLineFromCache(const ShapingCacheKey& key)
+{
+    auto entry = _api.shapingCache.entries.lookup(key);
+
+    if (!entry)
+    {
+        const auto previous = _api.shapingCachePrevious.entries.lookup(key);
+        if (!previous)
+        {
+            _p.stats.shapingCacheMisses++;
+            return false;
+        }
+
+        // Promote the entry to the current generation. Its data needs to be copied, because the
+        // previous generation (and its arena) gets dropped once the current one is full.
+        auto& cache = _api.shapingCache;
+        entry = cache.insert(key);
+        entry->mappings = cache.arena.push_copy(previous->mappings);
+        entry->glyphIndices = cache.arena.push_copy(previous->glyphIndices);
+        entry->glyphAdvances = cache.arena.push_copy(previous->glyphAdvances);
+        entry->glyphOffsets = cache.arena.push_copy(previous->glyphOffsets);
+        entry->glyphColumns = cache.arena.push_copy(previous->glyphColumns);
+
+        for (const auto& m : entry->mappings)
+        {
+            cache.retain(m.fontFace);
+        }
+    }
+
+    _p.stats.shapingCacheHits++;
+
+    auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
+    const auto glyphsBeg = row.glyphIndices.size();
+    const auto baseColumn = _api.bufferLineColumn.front();
+
+    row.glyphIndices.insert(row.glyphIndices.end(), entry->glyphIndices.begin(), entry->glyphIndices.end());
+    row.glyphAdvances.insert(row.glyphAdvances.end(), entry->glyphAdvances.begin(), entry->glyphAdvances.end());
+    row.glyphOffsets.insert(row.glyphOffsets.end(), entry->glyphOffsets.begin(), entry->glyphOffsets.end());
+
+    for (const auto col : entry->glyphColumns)
+    {
+        _api.glyphColumns.emplace_back(gsl::narrow_cast<u16>(col + baseColumn));
+    }
+
+    for (const auto& m : entry->mappings)
+    {
+        const auto from = glyphsBeg + m.glyphsFrom;
+        const auto to = glyphsBeg + m.glyphsTo;
+
+        // This mirrors the mapping coalescing in _mapRegularText().
+        if (m.fontFace && !row.mappings.empty() && row.mappings.back().fontFace.get() == m.fontFace)
+        {
+            row.mappings.back().glyphsTo = to;
+        }
+        else
+        {
+            row.mappings.emplace_back(m.fontFace, from, to);
+        }
+    }
+
+    return true;
+}
+
+// Stores the glyphs that the current _flushBufferLine() call appended to the row (starting at glyphsBeg) in the shaping cache.
+void AtlasEngine::_flushBufferLineToCache(const ShapingCacheKey& key, size_t glyphsBeg)
+{
+    // The arena limit is far above what the entry limit results in for regular
+    // text, but protects us from running out of address space for very long lines.
+    if (_api.shapingCache.entries.size() >= _api.shapingCacheCapacity || _api.shapingCache.arena.position() >= 32 * 1024 * 1024)
+    {
+        std::swap(_api.shapingCache, _api.shapingCachePrevious);
+        _api.shapingCache.clear();
+    }
+
+    auto& cache = _api.shapingCache;
+    const auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
+    const auto glyphsEnd = row.glyphIndices.size();
+    const auto baseColumn = _api.bufferLineColumn.front();
+    const auto entry = cache.insert(key);
+
+    // The first mapping may have been extended from a previous _flushBufferLine() call on the same row,
+    // which is why we need to skip the ones before glyphsBeg and clamp the glyph ranges of the others.
+    {
+        const auto mappingsBeg = std::find_if(row.mappings.begin(), row.mappings.end(), [=](const auto& m) { return m.glyphsTo > glyphsBeg; });
+        const auto mappings = cache.arena.push_uninitialized<ShapingCacheMapping>(gsl::narrow_cast<size_t>(row.mappings.end() - mappingsBeg));
+        auto out = mappings.begin();
+
+        for (auto it = mappingsBeg; it != row.mappings.end(); ++it, ++out)
+        {
+            const auto fontFace = it->fontFace.get();
+            *out = { fontFace, std::max(it->glyphsFrom, glyphsBeg) - glyphsBeg, it->glyphsTo - glyphsBeg };
+            cache.retain(fontFace);
+        }
+
+        entry->mappings = mappings;
+    }
+
+    entry->glyphIndices = cache.arena.push_copy<u16>({ row.glyphIndices.data() + glyphsBeg, row.glyphIndices.data() + glyphsEnd });
+    entry->glyphAdvances = cache.arena.push_copy<f32>({ row.glyphAdvances.data() + glyphsBeg, row.glyphAdvances.data() + glyphsEnd });
+    entry->glyphOffsets = cache.arena.push_copy<DWRITE_GLYPH_OFFSET>({ row.glyphOffsets.data() + glyphsBeg, row.glyphOffsets.data() + glyphsEnd });
+
+    {
+        const auto glyphColumns = cache.arena.push_uninitialized<u16>(_api.glyphColumns.size());
+        std::transform(_api.glyphColumns.begin(), _api.glyphColumns.end(), glyphColumns.begin(), [=](u16 col) {
+            return gsl::narrow_cast<u16>(col - baseColumn);
+        });
+        entry->glyphColumns = glyphColumns;
+    }
+}
+
+// The colors of a row can change without its text changing, which is why they aren't part of the shaping
+// results and are instead filled in based on the column each glyph originated from (_api.glyphColumns).
+void AtlasEngine::_flushBufferLineColors(size_t glyphsBeg)
+{
+    auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
+    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
+    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
+
+    assert(row.colors.size() == glyphsBeg);
+    assert(_api.glyphColumns.size() == row.glyphIndices.size() - glyphsBeg);
+
+    for (const auto col : _api.glyphColumns)
+    {
+        row.colors.emplace_back(colors[static_cast<size_t>(col) << shift]);
+    }
 }
 
 void AtlasEngine::_mapRegularText(size_t offBeg, size_t offEnd)
@@ -849,19 +1039,15 @@ void AtlasEngine::_mapRegularText(size_t offBeg, size_t offEnd)
 
                 if (isTextSimple)
                 {
-                    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-                    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
-
                     for (size_t i = 0; i < complexityLength; ++i)
                     {
                         const auto col1 = _api.bufferLineColumn[idx + i + 0];
                         const auto col2 = _api.bufferLineColumn[idx + i + 1];
                         const auto glyphAdvance = (col2 - col1) * _p.s->font->cellSize.x;
-                        const auto fg = colors[static_cast<size_t>(col1) << shift];
                         row.glyphIndices.emplace_back(_api.glyphIndices[i]);
                         row.glyphAdvances.emplace_back(static_cast<f32>(glyphAdvance));
                         row.glyphOffsets.emplace_back();
-                        row.colors.emplace_back(fg);
+                        _api.glyphColumns.emplace_back(col1);
                     }
                 }
                 else
@@ -896,20 +1082,13 @@ void AtlasEngine::_mapBuiltinGlyphs(size_t offBeg, size_t offEnd)
 {
     auto& row = *_p.rows[_api.lastPaintBufferLineCoord.y];
     auto initialIndicesCount = row.glyphIndices.size();
-    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
     const auto base = reinterpret_cast<const u16*>(_api.bufferLine.data());
     const auto len = offEnd - offBeg;
 
     row.glyphIndices.insert(row.glyphIndices.end(), base + offBeg, base + offEnd);
     row.glyphAdvances.insert(row.glyphAdvances.end(), len, static_cast<f32>(_p.s->font->cellSize.x));
     row.glyphOffsets.insert(row.glyphOffsets.end(), len, {});
-
-    for (size_t i = offBeg; i < offEnd; ++i)
-    {
-        const auto col = _api.bufferLineColumn[i];
-        row.colors.emplace_back(colors[static_cast<size_t>(col) << shift]);
-    }
+    _api.glyphColumns.insert(_api.glyphColumns.end(), _api.bufferLineColumn.begin() + offBeg, _api.bufferLineColumn.begin() + offEnd);
 
     row.mappings.emplace_back(nullptr, gsl::narrow_cast<u32>(initialIndicesCount), gsl::narrow_cast<u32>(row.glyphIndices.size()));
 }
@@ -1077,8 +1256,6 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
 
         _api.clusterMap[a.textLength] = gsl::narrow_cast<u16>(actualGlyphCount);
 
-        const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-        const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
         auto prevCluster = _api.clusterMap[0];
         size_t beg = 0;
 
@@ -1090,9 +1267,8 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
                 continue;
             }
 
-            const size_t col1 = _api.bufferLineColumn[a.textPosition + beg];
-            const size_t col2 = _api.bufferLineColumn[a.textPosition + i];
-            const auto fg = colors[col1 << shift];
+            const auto col1 = _api.bufferLineColumn[a.textPosition + beg];
+            const auto col2 = _api.bufferLineColumn[a.textPosition + i];
 
             const auto expectedAdvance = (col2 - col1) * _p.s->font->cellSize.x;
             f32 actualAdvance = 0;
@@ -1102,7 +1278,7 @@ void AtlasEngine::_mapComplex(IDWriteFontFace2* mappedFontFace, u32 idx, u32 len
             }
             _api.glyphAdvances[nextCluster - 1] += expectedAdvance - actualAdvance;
 
-            row.colors.insert(row.colors.end(), nextCluster - prevCluster, fg);
+            _api.glyphColumns.insert(_api.glyphColumns.end(), nextCluster - prevCluster, col1);
 
             prevCluster = nextCluster;
             beg = i;
@@ -1146,8 +1322,6 @@ void AtlasEngine::_mapReplacementCharacter(u32 from, u32 to, ShapedRow& row)
     auto pos = from;
     auto col1 = _api.bufferLineColumn[from];
     auto initialIndicesCount = row.glyphIndices.size();
-    const auto shift = gsl::narrow_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
-    const auto colors = _p.foregroundBitmap.begin() + _p.colorBitmapRowStride * _api.lastPaintBufferLineCoord.y;
 
     while (pos < to)
     {
@@ -1160,7 +1334,7 @@ void AtlasEngine::_mapReplacementCharacter(u32 from, u32 to, ShapedRow& row)
         row.glyphIndices.emplace_back(_api.replacementCharacterGlyphIndex);
         row.glyphAdvances.emplace_back(static_cast<f32>((col2 - col1) * _p.s->font->cellSize.x));
         row.glyphOffsets.emplace_back();
-        row.colors.emplace_back(colors[static_cast<size_t>(col1) << shift]);
+        _api.glyphColumns.emplace_back(col1);
 
         col1 = col2;
     }
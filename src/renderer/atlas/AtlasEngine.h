@@ -6,9 +6,15 @@
 #include <dwrite_3.h>
 #include <d3d11_2.h>
 #include <dxgi1_3.h>
+#include <til/arena.h>
+#include <til/flat_set.h>
 
 #include "common.h"
 
+#ifdef UNIT_TESTING
+class AtlasEngineTests;
+#endif
+
 namespace Microsoft::Console::Render::Atlas
 {
     struct TextAnalysisSinkResult;
@@ -58,6 +64,7 @@ namespace Microsoft::Console::Render::Atlas
         [[nodiscard]] HRESULT IsGlyphWideByFont(std::wstring_view glyph, _Out_ bool* pResult) noexcept override;
         [[nodiscard]] HRESULT UpdateTitle(std::wstring_view newTitle) noexcept override;
         void UpdateHyperlinkHoveredId(uint16_t hoveredId) noexcept override;
+        void CollectFrameStats(RenderFrameStats& stats) noexcept override;
 
         // getter
         [[nodiscard]] std::wstring_view GetPixelShaderPath() noexcept;
@@ -81,11 +88,121 @@ namespace Microsoft::Console::Render::Atlas
         [[nodiscard]] HRESULT UpdateFont(const FontInfoDesired& pfiFontInfoDesired, FontInfo& fiFontInfo, const std::unordered_map<std::wstring_view, float>& features, const std::unordered_map<std::wstring_view, float>& axes) noexcept;
 
     private:
+#ifdef UNIT_TESTING
+        friend class ::AtlasEngineTests;
+#endif
+
+        // The text of a _flushBufferLine() call and the information that determines how it gets shaped.
+        // Columns are stored relative to the first one, so that the same text shaped at a different
+        // position in the row (or in a different row entirely) results in a cache hit.
+        struct ShapingCacheKey
+        {
+            size_t hash = 0;
+            std::wstring_view text;
+            std::span<const u16> columns;
+            FontRelevantAttributes attributes = FontRelevantAttributes::None;
+        };
+
+        // Same as FontMapping, but the font face is kept alive by the ShapingCacheGeneration instead.
+        struct ShapingCacheMapping
+        {
+            IDWriteFontFace2* fontFace = nullptr;
+            size_t glyphsFrom = 0;
+            size_t glyphsTo = 0;
+        };
+
+        // All views point into the arena of the ShapingCacheGeneration that holds the entry.
+        struct ShapingCacheEntry
+        {
+            size_t hash = 0;
+            std::wstring_view text;
+            std::span<const u16> columns;
+            FontRelevantAttributes attributes = FontRelevantAttributes::None;
+
+            // The shaping results. The glyph ranges in `mappings` are relative to the start of `glyphIndices`.
+            std::span<const ShapingCacheMapping> mappings;
+            std::span<const u16> glyphIndices;
+            std::span<const f32> glyphAdvances;
+            std::span<const DWRITE_GLYPH_OFFSET> glyphOffsets;
+            // The column (relative to the first one) each glyph gets its foreground color from.
+            std::span<const u16> glyphColumns;
+        };
+
+        struct ShapingCacheEntryHashTrait
+        {
+            static bool occupied(const ShapingCacheEntry& entry) noexcept
+            {
+                return !entry.text.empty();
+            }
+
+            static constexpr size_t hash(const ShapingCacheKey& key) noexcept
+            {
+                return key.hash;
+            }
+
+            static constexpr size_t hash(const ShapingCacheEntry& entry) noexcept
+            {
+                return entry.hash;
+            }
+
+            static bool equals(const ShapingCacheEntry& entry, const ShapingCacheKey& key) noexcept
+            {
+                return entry.hash == key.hash &&
+                       entry.attributes == key.attributes &&
+                       entry.text == key.text &&
+                       std::equal(entry.columns.begin(), entry.columns.end(), key.columns.begin(), key.columns.end());
+            }
+
+            // This only copies the views. ShapingCacheGeneration::insert() copies their contents into its arena.
+            static void assign(ShapingCacheEntry& entry, const ShapingCacheKey& key) noexcept
+            {
+                entry.hash = key.hash;
+                entry.text = key.text;
+                entry.columns = key.columns;
+                entry.attributes = key.attributes;
+            }
+        };
+
+        // A generation of the shaping cache. The entries are plain views into the arena, which turns
+        // caching a line into a couple of pointer bumps and dropping a generation into a single reset.
+        struct ShapingCacheGeneration
+        {
+            ShapingCacheEntry* insert(const ShapingCacheKey& key)
+            {
+                const auto entry = entries.insert(key).first;
+                entry->text = arena.push_copy(key.text);
+                entry->columns = arena.push_copy(key.columns);
+                return entry;
+            }
+
+            void retain(IDWriteFontFace2* fontFace)
+            {
+                if (fontFace && std::none_of(fontFaces.begin(), fontFaces.end(), [=](const auto& f) { return f.get() == fontFace; }))
+                {
+                    fontFaces.emplace_back(fontFace);
+                }
+            }
+
+            void clear() noexcept
+            {
+                entries.clear();
+                arena.clear();
+                fontFaces.clear();
+            }
+
+            til::linear_flat_set<ShapingCacheEntry, ShapingCacheEntryHashTrait> entries;
+            til::arena arena{ 64 * 1024 * 1024 };
+            std::vector<wil::com_ptr<IDWriteFontFace2>> fontFaces;
+        };
+
         // AtlasEngine.cpp
         ATLAS_ATTR_COLD void _handleSettingsUpdate();
         void _recreateFontDependentResources();
         void _recreateCellCountDependentResources();
         void _flushBufferLine();
+        bool _flushBufferLineFromCache(const ShapingCacheKey& key);
+        void _flushBufferLineToCache(const ShapingCacheKey& key, size_t glyphsBeg);
+        void _flushBufferLineColors(size_t glyphsBeg);
         void _mapRegularText(size_t offBeg, size_t offEnd);
         void _mapBuiltinGlyphs(size_t offBeg, size_t offEnd);
         void _mapCharacters(const wchar_t* text, u32 textLength, u32* mappedLength, IDWriteFontFace2** mappedFontFace) const;
@@ -110,6 +227,8 @@ namespace Microsoft::Console::Render::Atlas
         void _updateMatrixTransform();
         void _waitUntilCanRender() noexcept;
         void _present();
+        void _uploadSoftwareFramebuffer(const RECT& dirtyRect) const;
+        [[nodiscard]] HRESULT _renderForTests(std::vector<u32>& pixels) noexcept;
 
         static constexpr u16 u16min = 0x0000;
         static constexpr u16 u16max = 0xffff;
@@ -142,6 +261,16 @@ namespace Microsoft::Console::Render::Atlas
 
             std::vector<wchar_t> bufferLine;
             std::vector<u16> bufferLineColumn;
+            // The column of each glyph produced by _flushBufferLine(). Used to look up the foreground color.
+            std::vector<u16> glyphColumns;
+
+            // Caches the shaping results of _flushBufferLine() across frames. It's a 2-generation cache:
+            // Once the current generation is full it becomes the previous one and the old previous one is dropped.
+            // Entries that are hit in the previous generation get promoted to the current one. It's cleared on font changes.
+            ShapingCacheGeneration shapingCache;
+            ShapingCacheGeneration shapingCachePrevious;
+            std::vector<u16> shapingCacheColumns;
+            size_t shapingCacheCapacity = 0;
 
             std::array<Buffer<DWRITE_FONT_AXIS_VALUE>, 4> textFormatAxes;
             std::vector<TextAnalysisSinkResult> analysisResults;
@@ -6,6 +6,7 @@
 
 #include "BackendD2D.h"
 #include "BackendD3D.h"
+#include "BackendSoftware.h"
 
 // #### NOTE ####
 // If you see any code in here that contains "_api." you might be seeing a race condition.
@@ -47,7 +48,12 @@ try
         _handleSwapChainUpdate();
     }
 
-    _b->Render(_p);
+    {
+        const RenderStopwatch stopwatch;
+        _b->Render(_p);
+        _p.stats.draw += stopwatch.elapsed();
+    }
+
     _present();
     return S_OK;
 }
@@ -80,6 +86,11 @@ CATCH_RETURN()
     return ATLAS_DEBUG_CONTINUOUS_REDRAW || (_b && _b->RequiresContinuousRedraw());
 }
 
+void AtlasEngine::CollectFrameStats(RenderFrameStats& stats) noexcept
+{
+    stats += std::exchange(_p.stats, {});
+}
+
 void AtlasEngine::WaitUntilCanRender() noexcept
 {
     if constexpr (ATLAS_DEBUG_RENDER_DELAY)
@@ -91,6 +102,68 @@ void AtlasEngine::WaitUntilCanRender() noexcept
 
 #pragma endregion
 
+// Renders the pending frame the same way Present() does, but instead of presenting it, the back buffer
+// is copied into `pixels` (BGRA, row-major). This allows tests to compare the output of different backends.
+// The frame can't be read back after Present(), because buffer 0 then refers to the next back buffer.
+[[nodiscard]] HRESULT AtlasEngine::_renderForTests(std::vector<u32>& pixels) noexcept
+try
+{
+    if (!_p.dxgi.adapter)
+    {
+        _recreateAdapter();
+    }
+
+    if (!_b)
+    {
+        _recreateBackend();
+    }
+
+    if (_p.swapChain.generation != _p.s.generation())
+    {
+        _handleSwapChainUpdate();
+    }
+
+    _b->Render(_p);
+
+    const size_t width = _p.swapChain.targetSize.x;
+    const size_t height = _p.swapChain.targetSize.y;
+
+    if (_p.softwareFramebuffer)
+    {
+        _uploadSoftwareFramebuffer({ 0, 0, _p.swapChain.targetSize.x, _p.swapChain.targetSize.y });
+    }
+
+    wil::com_ptr<ID3D11Texture2D> buffer;
+    THROW_IF_FAILED(_p.swapChain.swapChain->GetBuffer(0, __uuidof(buffer), buffer.put_void()));
+
+    D3D11_TEXTURE2D_DESC desc{};
+    buffer->GetDesc(&desc);
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+
+    wil::com_ptr<ID3D11Texture2D> staging;
+    THROW_IF_FAILED(_p.device->CreateTexture2D(&desc, nullptr, staging.addressof()));
+    _p.deviceContext->CopyResource(staging.get(), buffer.get());
+
+    D3D11_MAPPED_SUBRESOURCE mapped{};
+    THROW_IF_FAILED(_p.deviceContext->Map(staging.get(), 0, D3D11_MAP_READ, 0, &mapped));
+    const auto unmap = wil::scope_exit([&]() noexcept {
+        _p.deviceContext->Unmap(staging.get(), 0);
+    });
+
+    pixels.resize(width * height);
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto src = static_cast<const u8*>(mapped.pData) + y * mapped.RowPitch;
+        memcpy(pixels.data() + y * width, src, width * sizeof(u32));
+    }
+
+    return S_OK;
+}
+CATCH_RETURN()
+
 void AtlasEngine::_recreateAdapter()
 {
 #ifndef NDEBUG
@@ -134,7 +207,9 @@ void AtlasEngine::_recreateAdapter()
     DXGI_ADAPTER_DESC1 desc{};
 
     {
-        const auto useWARP = _p.s->target->useWARP;
+        // BackendSoftware doesn't need a GPU and only uses D3D to present its framebuffer.
+        // A hardware adapter would only waste memory on a device that doesn't do anything.
+        const auto useWARP = _p.s->target->useWARP || _p.s->target->graphicsAPI == GraphicsAPI::Software;
         UINT index = 0;
 
         do
@@ -167,6 +242,7 @@ void AtlasEngine::_recreateBackend()
     _destroySwapChain();
 
     auto graphicsAPI = _p.s->target->graphicsAPI;
+    _p.softwareFramebuffer = {};
 
     auto deviceFlags =
         D3D11_CREATE_DEVICE_SINGLETHREADED
@@ -283,6 +359,9 @@ void AtlasEngine::_recreateBackend()
     case GraphicsAPI::Direct2D:
         _b = std::make_unique<BackendD2D>();
         break;
+    case GraphicsAPI::Software:
+        _b = std::make_unique<BackendSoftware>();
+        break;
     default:
         _b = std::make_unique<BackendD3D>(_p);
         break;
@@ -465,6 +544,11 @@ void AtlasEngine::_present()
         return;
     }
 
+    if (_p.softwareFramebuffer)
+    {
+        _uploadSoftwareFramebuffer(dirtyRect);
+    }
+
 #pragma warning(suppress : 4127) // conditional expression is constant
     if (!ATLAS_DEBUG_SHOW_DIRTY && !_p.s->target->disablePresent1 && memcmp(&dirtyRect, &fullRect, sizeof(RECT)) != 0)
     {
@@ -502,3 +586,41 @@ void AtlasEngine::_present()
 
     _p.swapChain.waitForPresentation = true;
 }
+
+// BackendSoftware renders into _p.softwareFramebuffer on the CPU. This copies the dirty rows into the back buffer.
+// Only the dirty rows need to be copied, because Present1() retains the rest of the previous frame,
+// including the scrolled area. That's not the case with DXGI_SWAP_EFFECT_FLIP_DISCARD however.
+//
+// Blitting the framebuffer with GDI (SetDIBitsToDevice() or a DIB section + BitBlt()) isn't an option:
+// * Windows Terminal renders into a SwapChainPanel via a composition surface handle (see _createSwapChain()).
+//   There's no HWND or HDC to draw into, so a DXGI swap chain is needed regardless of the backend.
+// * Where there is an HWND, GDI drawing into it would compete with the flip model swap chain that's already
+//   bound to it, and switching between the two when the GraphicsAPI setting changes would require recreating the window.
+// * Going through the swap chain keeps Present1() with its dirty and scroll rects, the frame latency waitable
+//   object and the premultiplied alpha for transparent backgrounds, all of which GDI lacks.
+// The device for this is always available, because GraphicsAPI::Software makes _recreateAdapter() pick WARP.
+void AtlasEngine::_uploadSoftwareFramebuffer(const RECT& dirtyRect) const
+{
+    const auto width = _p.swapChain.targetSize.x;
+    const auto height = _p.swapChain.targetSize.y;
+
+    // The framebuffer may be stale if the swap chain got resized but BackendSoftware hasn't rendered since.
+    if (_p.softwareFramebuffer.size() != static_cast<size_t>(width) * height)
+    {
+        return;
+    }
+
+    D3D11_BOX box{ 0, 0, 0, width, height, 1 };
+    if (!_p.s->target->disablePresent1)
+    {
+        box.top = gsl::narrow_cast<UINT>(dirtyRect.top);
+        box.bottom = gsl::narrow_cast<UINT>(dirtyRect.bottom);
+    }
+
+    wil::com_ptr<ID3D11Texture2D> buffer;
+    THROW_IF_FAILED(_p.swapChain.swapChain->GetBuffer(0, __uuidof(buffer), buffer.put_void()));
+
+    const auto stride = static_cast<size_t>(width) * sizeof(u32);
+    const auto data = _p.softwareFramebuffer.data() + static_cast<size_t>(box.top) * width;
+    _p.deviceContext->UpdateSubresource(buffer.get(), 0, &box, data, gsl::narrow_cast<UINT>(stride), 0);
+}
@@ -740,7 +740,7 @@ void BackendD3D::_d2dEndDrawing()
     }
 }
 
-void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
+u16x2 BackendD3D::_calculateGlyphAtlasSize(const RenderingPayload& p) const noexcept
 {
     // The index returned by _BitScanReverse is undefined when the input is 0. We can simultaneously guard
     // against that and avoid unreasonably small textures, by clamping the min. texture size to `minArea`.
@@ -752,7 +752,7 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     const auto targetArea = static_cast<u32>(p.s->targetSize.x) * p.s->targetSize.y;
 
     const auto minAreaByFont = cellArea * 95; // Covers all printable ASCII characters
-    const auto minAreaByGrowth = static_cast<u32>(_rectPacker.width) * _rectPacker.height * 2;
+    const auto minAreaByGrowth = static_cast<u32>(_glyphAtlasSize.x) * _glyphAtlasSize.y * 2;
 
     // It's hard to say what the max. size of the cache should be. Optimally I think we should use as much
     // memory as is available, but the rendering code in this project is a big mess and so integrating
@@ -773,13 +773,29 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     _BitScanReverse(&index, area - 1);
     const auto u = static_cast<u16>(1u << ((index + 2) / 2));
     const auto v = static_cast<u16>(1u << ((index + 1) / 2));
+    return { u, v };
+}
+
+void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
+{
+    const auto size = _calculateGlyphAtlasSize(p);
+
+    if (size != _glyphAtlasSize)
+    {
+        _resizeGlyphAtlas(p, size.x, size.y);
+    }
 
-    if (u != _rectPacker.width || v != _rectPacker.height)
+    // Each page should be able to hold at least a couple rows of double-height (DECDHL) glyphs,
+    // otherwise we'd end up evicting pages all the time. Since the atlas height is a power of 2,
+    // halving the page size repeatedly guarantees that all pages are of equal size.
+    const auto minPageHeight = std::max(128u, p.s->font->cellSize.y * 4u);
+    size_t pageCount = 1;
+    while (pageCount < GlyphAtlasMaxPages && size.y / (pageCount * 2) >= minPageHeight)
     {
-        _resizeGlyphAtlas(p, u, v);
+        pageCount *= 2;
     }
 
-    stbrp_init_target(&_rectPacker, u, v, _rectPackerData.data(), _rectPackerData.size());
+    _initGlyphAtlasPages(pageCount);
 
     // This is a little imperfect, because it only releases the memory of the glyph mappings, not the memory held by
     // any DirectWrite fonts. On the other side, the amount of fonts on a system is always finite, where "finite"
@@ -796,6 +812,7 @@ void BackendD3D::_resetGlyphAtlas(const RenderingPayload& p)
     {
         glyphs.clear();
     }
+    _builtinGlyphRects.clear();
 
     _d2dBeginDrawing();
     _d2dRenderTarget->Clear();
@@ -875,7 +892,70 @@ void BackendD3D::_resizeGlyphAtlas(const RenderingPayload& p, const u16 u, const
     ID3D11ShaderResourceView* resources[]{ _backgroundBitmapView.get(), _glyphAtlasView.get() };
     p.deviceContext->PSSetShaderResources(0, 2, &resources[0]);
 
-    _rectPackerData = Buffer<stbrp_node>{ u };
+    // stb_rect_pack requires as many nodes as the target is wide. Each page has its own packer.
+    _rectPackerData = Buffer<stbrp_node>{ size_t{ u } * GlyphAtlasMaxPages };
+    _glyphAtlasSize = { u, v };
+}
+
+// Splits the glyph atlas into `pageCount` horizontal bands of equal height and resets their rect packers.
+// This doesn't clear the texture or the glyph cache. That's the responsibility of the caller.
+void BackendD3D::_initGlyphAtlasPages(size_t pageCount)
+{
+    assert(pageCount >= 1 && pageCount <= GlyphAtlasMaxPages);
+
+    const auto u = _glyphAtlasSize.x;
+    const auto pageHeight = static_cast<u16>(_glyphAtlasSize.y / pageCount);
+
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        auto& page = _glyphAtlasPages[i];
+        page.top = static_cast<u16>(i * pageHeight);
+        page.height = pageHeight;
+        page.lastUsed = _glyphAtlasFrame;
+        stbrp_init_target(&page.packer, u, pageHeight, _rectPackerData.data() + i * u, u);
+    }
+
+    _glyphAtlasPageCount = pageCount;
+    _glyphAtlasPageCurrent = 0;
+}
+
+// Clears a single page of the glyph atlas and removes all glyphs from the cache that referenced it.
+// The caller must ensure that no pending quads reference the page anymore (= call _flushQuads first).
+void BackendD3D::_evictGlyphAtlasPage(size_t page)
+{
+    const auto u = _glyphAtlasSize.x;
+    auto& entry = _glyphAtlasPages[page];
+    stbrp_init_target(&entry.packer, u, entry.height, _rectPackerData.data() + page * u, u);
+    entry.lastUsed = _glyphAtlasFrame;
+
+    // Glyphs with ShadingType::Default are whitespace and ShadingType::BuiltinGlyphRects
+    // are drawn without the atlas. Neither of them occupy any space in the atlas.
+    const auto pred = [=](const AtlasGlyphEntry& glyph) noexcept {
+        return glyph.shadingType != ShadingType::Default && glyph.shadingType != ShadingType::BuiltinGlyphRects && glyph.atlasPage == page;
+    };
+    for (auto& slot : _glyphAtlasMap.container())
+    {
+        for (auto& glyphs : slot.glyphs)
+        {
+            glyphs.erase_if(pred);
+        }
+    }
+    for (auto& glyphs : _builtinGlyphs.glyphs)
+    {
+        glyphs.erase_if(pred);
+    }
+
+    const D2D1_RECT_F rect{ 0, static_cast<f32>(entry.top), static_cast<f32>(u), static_cast<f32>(entry.top + entry.height) };
+    // Axis aligned clips are subject to the current transform, which _drawGlyph() may have already set up.
+    D2D1_MATRIX_3X2_F transform;
+    _d2dRenderTarget->GetTransform(&transform);
+    _d2dRenderTarget->SetTransform(&identityTransform);
+
+    _d2dBeginDrawing();
+    _d2dRenderTarget->PushAxisAlignedClip(&rect, D2D1_ANTIALIAS_MODE_ALIASED);
+    _d2dRenderTarget->Clear();
+    _d2dRenderTarget->PopAxisAlignedClip();
+    _d2dRenderTarget->SetTransform(&transform);
 }
 
 // MacType is a popular 3rd party system to give the font rendering on Windows a softer look.
@@ -1090,6 +1170,8 @@ void BackendD3D::_drawText(RenderingPayload& p)
         _resetGlyphAtlas(p);
     }
 
+    _glyphAtlasFrame++;
+
     til::CoordType dirtyTop = til::CoordTypeMax;
     til::CoordType dirtyBottom = til::CoordTypeMin;
 
@@ -1148,7 +1230,10 @@ void BackendD3D::_drawText(RenderingPayload& p)
                 auto glyphEntry = glyphs.lookup(glyphIndex);
                 if (!glyphEntry)
                 {
+                    const RenderStopwatch stopwatch;
                     glyphEntry = _drawGlyph(p, *row, *fontFaceEntry, glyphIndex);
+                    p.stats.atlasUpload += stopwatch.elapsed();
+                    p.stats.glyphCacheMisses++;
                 }
 
                 // A shadingType of 0 (ShadingType::Default) indicates a glyph that is whitespace.
@@ -1163,18 +1248,27 @@ void BackendD3D::_drawText(RenderingPayload& p)
                     row->dirtyTop = std::min(row->dirtyTop, t);
                     row->dirtyBottom = std::max(row->dirtyBottom, t + glyphEntry->size.y);
 
-                    _appendQuad() = {
-                        .shadingType = static_cast<u16>(glyphEntry->shadingType),
-                        .renditionScale = renditionScale,
-                        .position = { static_cast<i16>(l), static_cast<i16>(t) },
-                        .size = glyphEntry->size,
-                        .texcoord = glyphEntry->texcoord,
-                        .color = row->colors[x],
-                    };
-
-                    if (glyphEntry->overlapSplit)
+                    if (glyphEntry->shadingType == ShadingType::BuiltinGlyphRects)
+                    {
+                        _drawBuiltinGlyphRects(*glyphEntry, l, t, renditionScale, row->colors[x]);
+                    }
+                    else
                     {
-                        _drawTextOverlapSplit(p, y);
+                        _glyphAtlasPages[glyphEntry->atlasPage].lastUsed = _glyphAtlasFrame;
+
+                        _appendQuad() = {
+                            .shadingType = static_cast<u16>(glyphEntry->shadingType),
+                            .renditionScale = renditionScale,
+                            .position = { static_cast<i16>(l), static_cast<i16>(t) },
+                            .size = glyphEntry->size,
+                            .texcoord = glyphEntry->texcoord,
+                            .color = row->colors[x],
+                        };
+
+                        if (glyphEntry->overlapSplit)
+                        {
+                            _drawTextOverlapSplit(p, y);
+                        }
                     }
                 }
 
@@ -1203,7 +1297,14 @@ void BackendD3D::_drawText(RenderingPayload& p)
         p.dirtyRectInPx.bottom = std::max(p.dirtyRectInPx.bottom, dirtyBottom);
     }
 
-    _d2dEndDrawing();
+    {
+        // The glyphs drawn by _drawGlyph() are only submitted to the GPU here.
+        const RenderStopwatch stopwatch;
+        _d2dEndDrawing();
+        p.stats.atlasUpload += stopwatch.elapsed();
+    }
+
+    p.stats.atlasResets += std::exchange(_glyphAtlasResets, 0);
 }
 
 // There are a number of coding-oriented fonts that feature ligatures which (for instance)
@@ -1537,6 +1638,7 @@ BackendD3D::AtlasGlyphEntry* BackendD3D::_drawGlyph(const RenderingPayload& p, c
     const auto glyphEntry = _drawGlyphAllocateEntry(row, fontFaceEntry, glyphIndex);
     glyphEntry->shadingType = isColorGlyph ? ShadingType::TextPassthrough : _textShadingType;
     glyphEntry->overlapSplit = overlapSplit;
+    glyphEntry->atlasPage = static_cast<u8>(rect.id);
     glyphEntry->offset.x = bl;
     glyphEntry->offset.y = bt;
     glyphEntry->size.x = rect.w;
@@ -1567,6 +1669,40 @@ BackendD3D::AtlasGlyphEntry* BackendD3D::_drawBuiltinGlyph(const RenderingPayloa
         baseline <<= heightShift;
     }
 
+    // Most box-drawing and block characters are just a couple of axis-aligned rectangles. Those can be
+    // evaluated for any cell size in a fraction of the time it takes to draw them with Direct2D and
+    // don't need any space in the glyph atlas either, which makes font size and DPI changes cheaper.
+    if (!BuiltinGlyphs::IsSoftFontChar(glyphIndex))
+    {
+        BuiltinGlyphs::Rect rectangles[BuiltinGlyphs::MaxRectangleCount];
+        const auto count = BuiltinGlyphs::GetRectangles(glyphIndex, { static_cast<u16>(rect.w), static_cast<u16>(rect.h) }, rectangles);
+
+        if (count)
+        {
+            const auto glyphEntry = _drawGlyphAllocateEntry(row, fontFaceEntry, glyphIndex);
+            glyphEntry->shadingType = ShadingType::BuiltinGlyphRects;
+            glyphEntry->overlapSplit = 0;
+            // For BuiltinGlyphRects the atlasPage and texcoord.x members are repurposed
+            // to store the number of rectangles and their offset into _builtinGlyphRects.
+            glyphEntry->atlasPage = static_cast<u8>(count);
+            glyphEntry->offset.x = 0;
+            glyphEntry->offset.y = -baseline;
+            glyphEntry->size.x = static_cast<u16>(rect.w);
+            glyphEntry->size.y = static_cast<u16>(rect.h);
+            glyphEntry->texcoord.x = gsl::narrow<u16>(_builtinGlyphRects.size());
+            glyphEntry->texcoord.y = 0;
+
+            _builtinGlyphRects.insert(_builtinGlyphRects.end(), &rectangles[0], &rectangles[count]);
+
+            if (row.lineRendition >= LineRendition::DoubleHeightTop)
+            {
+                _splitDoubleHeightGlyph(p, row, fontFaceEntry, glyphEntry);
+            }
+
+            return glyphEntry;
+        }
+    }
+
     _drawGlyphAtlasAllocate(p, rect);
     _d2dBeginDrawing();
 
@@ -1603,6 +1739,7 @@ BackendD3D::AtlasGlyphEntry* BackendD3D::_drawBuiltinGlyph(const RenderingPayloa
     const auto glyphEntry = _drawGlyphAllocateEntry(row, fontFaceEntry, glyphIndex);
     glyphEntry->shadingType = shadingType;
     glyphEntry->overlapSplit = 0;
+    glyphEntry->atlasPage = static_cast<u8>(rect.id);
     glyphEntry->offset.x = 0;
     glyphEntry->offset.y = -baseline;
     glyphEntry->size.x = rect.w;
@@ -1618,6 +1755,43 @@ BackendD3D::AtlasGlyphEntry* BackendD3D::_drawBuiltinGlyph(const RenderingPayloa
     return glyphEntry;
 }
 
+// Draws a builtin glyph that _drawBuiltinGlyph() turned into a list of rectangles.
+// `left` and `top` are the position of the glyph entry, just like for glyphs from the atlas.
+void BackendD3D::_drawBuiltinGlyphRects(const AtlasGlyphEntry& glyphEntry, i32 left, i32 top, u8x2 renditionScale, u32 color)
+{
+    static constexpr ShadingType shadeShadingTypes[] = {
+        ShadingType::Shade025,
+        ShadingType::Shade050,
+        ShadingType::Shade075,
+        ShadingType::SolidLine,
+    };
+
+    // For double-height glyphs the entry only refers to the top or bottom half of the rectangles.
+    // texcoord.y is the start of that half, just like it would be for a glyph in the atlas.
+    const i32 clipTop = glyphEntry.texcoord.y;
+    const i32 clipBottom = clipTop + glyphEntry.size.y;
+    const auto beg = _builtinGlyphRects.data() + glyphEntry.texcoord.x;
+    const auto end = beg + glyphEntry.atlasPage;
+
+    for (auto it = beg; it != end; ++it)
+    {
+        const auto& r = it->rect;
+        const auto t = std::max<i32>(r.top, clipTop);
+        const auto b = std::min<i32>(r.bottom, clipBottom);
+
+        if (t < b)
+        {
+            _appendQuad() = {
+                .shadingType = static_cast<u16>(shadeShadingTypes[it->shade]),
+                .renditionScale = renditionScale,
+                .position = { static_cast<i16>(left + r.left), static_cast<i16>(top + t - clipTop) },
+                .size = { static_cast<u16>(r.right - r.left), static_cast<u16>(b - t) },
+                .color = color,
+            };
+        }
+    }
+}
+
 BackendD3D::ShadingType BackendD3D::_drawSoftFontGlyph(const RenderingPayload& p, const D2D1_RECT_F& rect, u32 glyphIndex)
 {
     const auto width = static_cast<size_t>(p.s->font->softFontCellSize.width);
@@ -1675,21 +1849,70 @@ BackendD3D::ShadingType BackendD3D::_drawSoftFontGlyph(const RenderingPayload& p
     return ShadingType::TextGrayscale;
 }
 
+// Allocates space for `rect` in the glyph atlas. On return, `rect.x` and `rect.y` contain
+// the position inside the atlas texture and `rect.id` contains the index of the page.
 void BackendD3D::_drawGlyphAtlasAllocate(const RenderingPayload& p, stbrp_rect& rect)
 {
-    if (stbrp_pack_rects(&_rectPacker, &rect, 1))
+    // Try the page we're currently filling first, followed by all the others, since small
+    // glyphs may still fit into the gaps of a page that was previously considered full.
+    for (size_t i = 0; i < _glyphAtlasPageCount; ++i)
     {
-        return;
+        const auto idx = (_glyphAtlasPageCurrent + i) % _glyphAtlasPageCount;
+        const auto& page = _glyphAtlasPages[idx];
+
+        if (stbrp_pack_rects(&_glyphAtlasPages[idx].packer, &rect, 1))
+        {
+            rect.y += page.top;
+            rect.id = static_cast<int>(idx);
+            _glyphAtlasPageCurrent = idx;
+            return;
+        }
     }
 
     _d2dEndDrawing();
     _flushQuads(p);
-    _resetGlyphAtlas(p);
 
-    if (!stbrp_pack_rects(&_rectPacker, &rect, 1))
+    const auto fitsIntoPage = rect.w <= _glyphAtlasSize.x && rect.h <= _glyphAtlasPages[0].height;
+    _glyphAtlasResets++;
+
+    if (!fitsIntoPage || _calculateGlyphAtlasSize(p) != _glyphAtlasSize)
+    {
+        // The atlas can still grow (or the glyph is too large for a single page):
+        // Resize the texture and start over with an empty cache, same as on a font change.
+        _resetGlyphAtlas(p);
+
+        if (rect.h > _glyphAtlasPages[0].height)
+        {
+            _initGlyphAtlasPages(1);
+        }
+    }
+    else
+    {
+        // The atlas is at its maximum size. Instead of throwing away every glyph and
+        // causing a burst of rasterization on the next frames, only evict the page that
+        // was used the longest time ago. Frequently used glyphs in other pages survive.
+        size_t lru = 0;
+        for (size_t i = 1; i < _glyphAtlasPageCount; ++i)
+        {
+            // Comparing the distance to the current frame is robust against the counter wrapping around.
+            if (_glyphAtlasFrame - _glyphAtlasPages[i].lastUsed > _glyphAtlasFrame - _glyphAtlasPages[lru].lastUsed)
+            {
+                lru = i;
+            }
+        }
+
+        _evictGlyphAtlasPage(lru);
+        _glyphAtlasPageCurrent = lru;
+    }
+
+    auto& page = _glyphAtlasPages[_glyphAtlasPageCurrent];
+    if (!stbrp_pack_rects(&page.packer, &rect, 1))
     {
         THROW_HR(HRESULT_FROM_WIN32(ERROR_POSSIBLE_DEADLOCK));
     }
+
+    rect.y += page.top;
+    rect.id = static_cast<int>(_glyphAtlasPageCurrent);
 }
 
 BackendD3D::AtlasGlyphEntry* BackendD3D::_drawGlyphAllocateEntry(const ShapedRow& row, AtlasFontFaceEntry& fontFaceEntry, u32 glyphIndex)
@@ -7,6 +7,7 @@
 #include <til/flat_set.h>
 
 #include "Backend.h"
+#include "BuiltinGlyphs.h"
 
 namespace Microsoft::Console::Render::Atlas
 {
@@ -72,12 +73,19 @@ namespace Microsoft::Console::Render::Atlas
             DottedLine,
             DashedLine,
             CurlyLine,
+            Shade025,
+            Shade050,
+            Shade075,
             // All items starting here will be drawing as a solid RGBA color
             SolidLine,
 
             Cursor,
             Selection,
 
+            // This one is never passed to the shader. It marks builtin glyphs in the glyph cache which aren't
+            // stored in the atlas, but rather as a list of rectangles in _builtinGlyphRects. See _drawBuiltinGlyph().
+            BuiltinGlyphRects,
+
             TextDrawingFirst = TextGrayscale,
             TextDrawingLast = SolidLine,
         };
@@ -106,7 +114,9 @@ namespace Microsoft::Console::Render::Atlas
             u32 glyphIndex;
             u8 occupied;
             ShadingType shadingType;
-            u16 overlapSplit;
+            u8 overlapSplit;
+            // The index into _glyphAtlasPages that contains this glyph's texels.
+            u8 atlasPage;
             i16x2 offset;
             u16x2 size;
             u16x2 texcoord;
@@ -181,6 +191,21 @@ namespace Microsoft::Console::Render::Atlas
         };
 
     private:
+        // The glyph atlas is split up into up to this many horizontal bands ("pages").
+        // Once the atlas can't grow anymore, a full atlas only evicts the least recently used
+        // page instead of throwing away every single cached glyph. See _drawGlyphAtlasAllocate.
+        static constexpr size_t GlyphAtlasMaxPages = 4;
+
+        struct GlyphAtlasPage
+        {
+            stbrp_context packer{};
+            // The vertical offset of the page inside the glyph atlas texture in pixels.
+            u16 top = 0;
+            u16 height = 0;
+            // The value of _glyphAtlasFrame when a glyph in this page was last drawn.
+            u32 lastUsed = 0;
+        };
+
         struct CursorRect
         {
             i16x2 position;
@@ -202,8 +227,11 @@ namespace Microsoft::Console::Render::Atlas
         void _debugDumpRenderTarget(const RenderingPayload& p);
         void _d2dBeginDrawing() noexcept;
         void _d2dEndDrawing();
+        u16x2 _calculateGlyphAtlasSize(const RenderingPayload& p) const noexcept;
         ATLAS_ATTR_COLD void _resetGlyphAtlas(const RenderingPayload& p);
         ATLAS_ATTR_COLD void _resizeGlyphAtlas(const RenderingPayload& p, u16 u, u16 v);
+        void _initGlyphAtlasPages(size_t pageCount);
+        ATLAS_ATTR_COLD void _evictGlyphAtlasPage(size_t page);
         static bool _checkMacTypeVersion(const RenderingPayload& p);
         QuadInstance& _getLastQuad() noexcept;
         QuadInstance& _appendQuad();
@@ -216,6 +244,7 @@ namespace Microsoft::Console::Render::Atlas
         ATLAS_ATTR_COLD void _drawTextOverlapSplit(const RenderingPayload& p, u16 y);
         [[nodiscard]] ATLAS_ATTR_COLD AtlasGlyphEntry* _drawGlyph(const RenderingPayload& p, const ShapedRow& row, AtlasFontFaceEntry& fontFaceEntry, u32 glyphIndex);
         AtlasGlyphEntry* _drawBuiltinGlyph(const RenderingPayload& p, const ShapedRow& row, AtlasFontFaceEntry& fontFaceEntry, u32 glyphIndex);
+        void _drawBuiltinGlyphRects(const AtlasGlyphEntry& glyphEntry, i32 left, i32 top, u8x2 renditionScale, u32 color);
         ShadingType _drawSoftFontGlyph(const RenderingPayload& p, const D2D1_RECT_F& rect, u32 glyphIndex);
         void _drawGlyphAtlasAllocate(const RenderingPayload& p, stbrp_rect& rect);
         static AtlasGlyphEntry* _drawGlyphAllocateEntry(const ShapedRow& row, AtlasFontFaceEntry& fontFaceEntry, u32 glyphIndex);
@@ -261,8 +290,18 @@ namespace Microsoft::Console::Render::Atlas
         wil::com_ptr<ID3D11ShaderResourceView> _glyphAtlasView;
         til::linear_flat_set<AtlasFontFaceEntry, AtlasFontFaceEntryHashTrait> _glyphAtlasMap;
         AtlasFontFaceEntry _builtinGlyphs;
+        // Builtin glyphs that consist only of axis-aligned rectangles skip the atlas and are drawn from this list instead.
+        std::vector<BuiltinGlyphs::Rect> _builtinGlyphRects;
         Buffer<stbrp_node> _rectPackerData;
-        stbrp_context _rectPacker{};
+        GlyphAtlasPage _glyphAtlasPages[GlyphAtlasMaxPages];
+        size_t _glyphAtlasPageCount = 0;
+        // The page that new glyphs are preferably packed into.
+        size_t _glyphAtlasPageCurrent = 0;
+        // Incremented on each _drawText call. Used for the LRU eviction of glyph atlas pages.
+        u32 _glyphAtlasFrame = 0;
+        // Number of resets/evictions since the last frame. Reported via RenderingPayload::stats.
+        u32 _glyphAtlasResets = 0;
+        u16x2 _glyphAtlasSize{};
         til::CoordType _ligatureOverhangTriggerLeft = 0;
         til::CoordType _ligatureOverhangTriggerRight = 0;
 
@@ -0,0 +1,1122 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "BackendSoftware.h"
+
+#include <til/unicode.h>
+
+#include "BuiltinGlyphs.h"
+
+TIL_FAST_MATH_BEGIN
+
+// Disable a bunch of warnings which get in the way of writing performant code.
+#pragma warning(disable : 26429) // Symbol 'data' is never tested for nullness, it can be marked as not_null (f.23).
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26459) // You called an STL function '...' with a raw pointer parameter at position '...' that may be unsafe [...].
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26482) // Only index into arrays using constant expressions (bounds.2).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+using namespace Microsoft::Console::Render::Atlas;
+
+static constexpr D2D1_MATRIX_3X2_F identityTransform{ .m11 = 1, .m22 = 1 };
+
+// The colors used throughout AtlasEngine are straight alpha RGBA, whereas the framebuffer is
+// premultiplied BGRA, because that's what both DXGI swap chains and GDI DIBs are happy with.
+static constexpr u32 rgbaToBgra(u32 rgba) noexcept
+{
+    return (rgba & 0xff00ff00) | ((rgba & 0xff) << 16) | ((rgba >> 16) & 0xff);
+}
+
+static constexpr u32 bgraPremultiply(u32 rgba) noexcept
+{
+    return rgbaToBgra(u32ColorPremultiply(rgba));
+}
+
+// Returns a * b / 255 rounded to the nearest integer. This is exact for all a, b in [0, 255].
+static constexpr u32 mulDiv255(u32 a, u32 b) noexcept
+{
+    const auto x = a * b + 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Multiplies each of the 4 channels of `a` with the corresponding channel of `b`.
+static constexpr u32 multiply(u32 a, u32 b) noexcept
+{
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8)
+    {
+        result |= mulDiv255((a >> shift) & 0xff, (b >> shift) & 0xff) << shift;
+    }
+    return result;
+}
+
+// Porter-Duff "source over" for premultiplied colors: src + dst * (1 - src.a)
+static constexpr u32 blendOver(u32 dst, u32 src) noexcept
+{
+    const auto ia = 255 - (src >> 24);
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8)
+    {
+        const auto c = mulDiv255((dst >> shift) & 0xff, ia) + ((src >> shift) & 0xff);
+        result |= std::min<u32>(c, 255) << shift;
+    }
+    return result;
+}
+
+#if defined(TIL_SSE_INTRINSICS)
+
+// The same as the scalar mulDiv255() above, but for 8 u16 lanes at once.
+static __m128i mulDiv255(__m128i a, __m128i b) noexcept
+{
+    auto x = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+    x = _mm_add_epi16(x, _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(x, 8);
+}
+
+// The same as the scalar multiply() above, but for 4 pixels at once.
+// `b` is expected to be a single color that was unpacked via _mm_unpacklo_epi8 into 16-bit lanes.
+static __m128i multiply(__m128i a, __m128i b16) noexcept
+{
+    const auto zero = _mm_setzero_si128();
+    const auto lo = mulDiv255(_mm_unpacklo_epi8(a, zero), b16);
+    const auto hi = mulDiv255(_mm_unpackhi_epi8(a, zero), b16);
+    return _mm_packus_epi16(lo, hi);
+}
+
+// The same as the scalar blendOver() above, but for 4 pixels at once.
+static __m128i blendOver(__m128i dst, __m128i src) noexcept
+{
+    const auto zero = _mm_setzero_si128();
+    // Broadcast the inverted alpha of each pixel into all 4 of its (16-bit) channels.
+    auto ia = _mm_sub_epi32(_mm_set1_epi32(255), _mm_srli_epi32(src, 24));
+    ia = _mm_or_si128(ia, _mm_slli_epi32(ia, 16));
+    const auto iaLo = _mm_unpacklo_epi32(ia, ia);
+    const auto iaHi = _mm_unpackhi_epi32(ia, ia);
+    const auto lo = mulDiv255(_mm_unpacklo_epi8(dst, zero), iaLo);
+    const auto hi = mulDiv255(_mm_unpackhi_epi8(dst, zero), iaHi);
+    return _mm_adds_epu8(_mm_packus_epi16(lo, hi), src);
+}
+
+#endif
+
+// Blends a grayscale glyph (premultiplied white, as rasterized by Direct2D) tinted with `color` onto `dst`.
+static void blendSpanTinted(u32* dst, const u32* src, size_t count, u32 color) noexcept
+{
+    size_t i = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    const auto zero = _mm_setzero_si128();
+    const auto color16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Most of a glyph's bounding box is empty. Skipping those pixels is a lot cheaper than blending them.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+        {
+            continue;
+        }
+        const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blendOver(d, multiply(s, color16)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (src[i])
+        {
+            dst[i] = blendOver(dst[i], multiply(src[i], color));
+        }
+    }
+}
+
+// Blends a premultiplied color glyph onto `dst`.
+static void blendSpanPassthrough(u32* dst, const u32* src, size_t count) noexcept
+{
+    size_t i = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blendOver(d, s));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = blendOver(dst[i], src[i]);
+    }
+}
+
+// Blends the premultiplied `color` onto `dst`.
+static void blendSpanSolid(u32* dst, size_t count, u32 color) noexcept
+{
+    if ((color >> 24) == 0xff)
+    {
+        std::fill_n(dst, count, color);
+        return;
+    }
+
+    size_t i = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    const auto s = _mm_set1_epi32(static_cast<int>(color));
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blendOver(d, s));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = blendOver(dst[i], color);
+    }
+}
+
+// Inverts the color of `dst`, just like D2D1_COMPOSITE_MODE_MASK_INVERT does for BackendD2D's cursor.
+static void invertSpan(u32* dst, size_t count) noexcept
+{
+    size_t i = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    const auto mask = _mm_set1_epi32(0x00ffffff);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, mask));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] ^= 0x00ffffff;
+    }
+}
+
+void BackendSoftware::ReleaseResources() noexcept
+{
+    // Ensure _handleSettingsUpdate() is called so that the framebuffer gets fully redrawn.
+    _generation = {};
+}
+
+void BackendSoftware::Render(RenderingPayload& p)
+{
+    if (_generation != p.s.generation())
+    {
+        _handleSettingsUpdate(p);
+    }
+
+    // The quads reference the cached glyphs by offset into _glyphPixels,
+    // which is why the cache can only be flushed in between frames.
+    if (_glyphPixels.size() > GlyphCacheMaxPixels)
+    {
+        _resetGlyphCache();
+        p.stats.atlasResets++;
+    }
+
+    if (_framebufferInvalid)
+    {
+        p.MarkAllAsDirty();
+    }
+    else if (p.scrollOffset)
+    {
+        _scrollFramebuffer(p);
+    }
+
+    _quads.clear();
+
+    const auto cursorColor = p.s->cursor->cursorColor;
+    if (cursorColor != 0xffffffff)
+    {
+        _drawCursor(p, ShadingType::Cursor, cursorColor);
+    }
+    _drawText(p);
+    if (cursorColor == 0xffffffff)
+    {
+        _drawCursor(p, ShadingType::CursorInvert, 0);
+    }
+    _drawSelection(p);
+
+    // Only the dirty rows need to be composited again. Everything else in the framebuffer is still
+    // up to date, the same way Present1() relies on the contents of the previous frame.
+    // This has to happen after _drawText(), because glyphs may overhang their rows.
+    const auto top = clamp<i32>(p.dirtyRectInPx.top, 0, _targetSize.y);
+    const auto bottom = clamp<i32>(p.dirtyRectInPx.bottom, 0, _targetSize.y);
+    if (top < bottom)
+    {
+        _renderBands(p, top, bottom);
+    }
+
+    _framebufferInvalid = false;
+}
+
+bool BackendSoftware::RequiresContinuousRedraw() noexcept
+{
+    return false;
+}
+
+void BackendSoftware::_handleSettingsUpdate(RenderingPayload& p)
+{
+    if (!_glyphRenderTarget)
+    {
+        _createGlyphRenderTarget(p);
+    }
+
+    if (_fontGeneration != p.s->font.generation())
+    {
+        _updateFontDependents(p);
+    }
+
+    const auto pixelCount = static_cast<size_t>(p.s->targetSize.x) * p.s->targetSize.y;
+    if (p.softwareFramebuffer.size() != pixelCount)
+    {
+        // The contents are left uninitialized, because _framebufferInvalid causes a full redraw anyway.
+        p.softwareFramebuffer = Buffer<u32, 32>{ pixelCount };
+    }
+
+    // Any setting may affect any pixel (colors, cursor, font, etc.), so we just redraw everything.
+    _framebufferInvalid = true;
+    _targetSize = p.s->targetSize;
+    _generation = p.s.generation();
+    _fontGeneration = p.s->font.generation();
+}
+
+void BackendSoftware::_updateFontDependents(const RenderingPayload& p)
+{
+    const auto& font = *p.s->font;
+
+    // This is the same calculation that BackendD3D::_updateFontDependents() does for its curly line.
+    {
+        const int cellHeight = font.cellSize.y;
+        const int duTop = font.doubleUnderline[0].position;
+        const int duBottom = font.doubleUnderline[1].position;
+        const int duHeight = font.doubleUnderline[0].height;
+
+        const auto height = std::max(3, duBottom + duHeight - duTop);
+        const auto position = std::min(duTop, cellHeight - height - duHeight);
+
+        _curlyLineHalfHeight = height * 0.5f;
+        _curlyUnderline.position = gsl::narrow_cast<u16>(position);
+        _curlyUnderline.height = gsl::narrow_cast<u16>(height);
+    }
+
+    const auto dpi = static_cast<f32>(font.dpi);
+    _glyphDeviceContext->SetDpi(dpi, dpi);
+    // The glyphs are blended on top of arbitrary backgrounds later on, which rules out ClearType.
+    _glyphDeviceContext->SetTextAntialiasMode(font.antialiasingMode == AntialiasingMode::Aliased ? D2D1_TEXT_ANTIALIAS_MODE_ALIASED : D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+
+    _resetGlyphCache();
+}
+
+void BackendSoftware::_createGlyphRenderTarget(const RenderingPayload& p)
+{
+    // D2D1_RENDER_TARGET_TYPE_SOFTWARE ensures that we don't accidentally end up on the GPU after all.
+    static constexpr D2D1_RENDER_TARGET_PROPERTIES props{
+        .type = D2D1_RENDER_TARGET_TYPE_SOFTWARE,
+        .pixelFormat = { DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED },
+    };
+    THROW_IF_FAILED(p.d2dFactory->CreateDCRenderTarget(&props, _glyphRenderTarget.put()));
+
+    _glyphDeviceContext = _glyphRenderTarget.query<ID2D1DeviceContext>();
+    _glyphDeviceContext->SetUnitMode(D2D1_UNIT_MODE_PIXELS);
+    _glyphDeviceContext.try_query_to(_glyphDeviceContext4.put());
+
+    {
+        static constexpr D2D1_COLOR_F white{ 1, 1, 1, 1 };
+        static constexpr D2D1_COLOR_F transparent{};
+        THROW_IF_FAILED(_glyphDeviceContext->CreateSolidColorBrush(&white, nullptr, _brush.put()));
+        THROW_IF_FAILED(_glyphDeviceContext->CreateSolidColorBrush(&transparent, nullptr, _emojiBrush.put()));
+    }
+
+    _glyphDC.reset(CreateCompatibleDC(nullptr));
+    THROW_LAST_ERROR_IF(!_glyphDC);
+}
+
+void BackendSoftware::_resetGlyphCache() noexcept
+{
+    _glyphCache = {};
+    for (auto& glyphs : _builtinGlyphs.glyphs)
+    {
+        glyphs = {};
+    }
+    _glyphPixels = {};
+}
+
+void BackendSoftware::_scrollFramebuffer(const RenderingPayload& p) const noexcept
+{
+    // This mirrors the scroll rect that AtlasEngine::_present() passes to Present1():
+    // The rows in [top, bottom) get their contents from the rows at [top - offset, bottom - offset).
+    const auto offsetInPx = p.scrollOffset * p.s->font->cellSize.y;
+    const auto height = std::min<i32>(p.s->viewportCellCount.y * p.s->font->cellSize.y, _targetSize.y);
+    const auto top = std::max(0, offsetInPx);
+    const auto bottom = height + std::min(0, offsetInPx);
+
+    if (top < bottom)
+    {
+        const size_t stride = _targetSize.x;
+        const auto data = p.softwareFramebuffer.data();
+        memmove(data + top * stride, data + (top - offsetInPx) * stride, (bottom - top) * stride * sizeof(u32));
+    }
+}
+
+void BackendSoftware::_drawText(RenderingPayload& p)
+{
+    const auto& font = *p.s->font;
+    til::CoordType dirtyTop = til::CoordTypeMax;
+    til::CoordType dirtyBottom = til::CoordTypeMin;
+
+    u16 y = 0;
+    for (const auto row : p.rows)
+    {
+        const i32 rowTop = font.cellSize.y * y;
+        const i32 rowBottom = rowTop + font.cellSize.y;
+        f32 baselineX = 0;
+        f32 baselineY = static_cast<f32>(rowTop + font.baseline);
+        f32 scaleX = 1;
+        f32 scaleY = 1;
+        i32 clipTop = 0;
+        i32 clipBottom = _targetSize.y;
+
+        if (row->lineRendition != LineRendition::SingleWidth)
+        {
+            scaleX = 2;
+
+            if (row->lineRendition >= LineRendition::DoubleHeightTop)
+            {
+                scaleY = 2;
+                // Twice the line height, twice the descender gap. See BackendD3D::_splitDoubleHeightGlyph().
+                baselineY -= font.descender;
+
+                if (row->lineRendition == LineRendition::DoubleHeightTop)
+                {
+                    baselineY += font.cellSize.y;
+                    clipBottom = rowBottom;
+                }
+                else
+                {
+                    clipTop = rowTop;
+                }
+            }
+        }
+
+        const auto renditionIndex = std::min<size_t>(WI_EnumValue(row->lineRendition), 2);
+
+        for (const auto& m : row->mappings)
+        {
+            auto x = m.glyphsFrom;
+            const auto glyphsTo = m.glyphsTo;
+            const auto fontFace = m.fontFace.get();
+
+            // The lack of a fontFace indicates a builtin glyph.
+            FontFaceEntry* fontFaceEntry = &_builtinGlyphs;
+            if (fontFace) [[likely]]
+            {
+                fontFaceEntry = _glyphCache.insert(fontFace).first;
+            }
+
+            while (x < glyphsTo)
+            {
+                size_t dx = 1;
+                u32 glyphIndex = row->glyphIndices[x];
+
+                // Note: !fontFace is only nullptr for builtin glyphs which then use glyphIndices for UTF16 code points.
+                // In other words, this doesn't accidentally corrupt any actual glyph indices.
+                if (!fontFace && til::is_leading_surrogate(glyphIndex))
+                {
+                    glyphIndex = til::combine_surrogates(glyphIndex, row->glyphIndices[x + 1]);
+                    dx = 2;
+                }
+
+                auto glyphEntry = fontFaceEntry->glyphs[renditionIndex].lookup(glyphIndex);
+                if (!glyphEntry)
+                {
+                    const RenderStopwatch stopwatch;
+                    glyphEntry = _drawGlyph(p, *row, *fontFaceEntry, glyphIndex);
+                    p.stats.atlasUpload += stopwatch.elapsed();
+                    p.stats.glyphCacheMisses++;
+                }
+
+                // A shadingType of 0 (ShadingType::Default) indicates a glyph that is whitespace.
+                if (glyphEntry->shadingType != ShadingType::Default)
+                {
+                    auto l = static_cast<i32>(lrintf((baselineX + row->glyphOffsets[x].advanceOffset) * scaleX));
+                    auto t = static_cast<i32>(lrintf(baselineY - row->glyphOffsets[x].ascenderOffset * scaleY));
+
+                    l += glyphEntry->offset.x;
+                    t += glyphEntry->offset.y;
+
+                    row->dirtyTop = std::min(row->dirtyTop, t);
+                    row->dirtyBottom = std::max(row->dirtyBottom, t + glyphEntry->size.y);
+
+                    _appendQuad(
+                        {
+                            .shadingType = glyphEntry->shadingType,
+                            .rect = { l, t, l + glyphEntry->size.x, t + glyphEntry->size.y },
+                            .pixels = glyphEntry->pixels,
+                            .stride = glyphEntry->size.x,
+                            .color = row->colors[x],
+                        },
+                        clipTop,
+                        clipBottom);
+                }
+
+                baselineX += row->glyphAdvances[x];
+                x += dx;
+            }
+        }
+
+        if (!row->gridLineRanges.empty())
+        {
+            _drawGridlines(p, y);
+        }
+
+        if (p.invalidatedRows.contains(y))
+        {
+            dirtyTop = std::min(dirtyTop, row->dirtyTop);
+            dirtyBottom = std::max(dirtyBottom, row->dirtyBottom);
+        }
+
+        ++y;
+    }
+
+    if (dirtyTop < dirtyBottom)
+    {
+        p.dirtyRectInPx.top = std::min(p.dirtyRectInPx.top, dirtyTop);
+        p.dirtyRectInPx.bottom = std::max(p.dirtyRectInPx.bottom, dirtyBottom);
+    }
+}
+
+BackendSoftware::GlyphEntry* BackendSoftware::_drawGlyph(const RenderingPayload& p, const ShapedRow& row, FontFaceEntry& fontFaceEntry, u32 glyphIndex)
+{
+    if (!fontFaceEntry.fontFace)
+    {
+        return _drawBuiltinGlyph(p, row, fontFaceEntry, glyphIndex);
+    }
+
+    const auto glyphIndexU16 = static_cast<u16>(glyphIndex);
+    const DWRITE_GLYPH_RUN glyphRun{
+        .fontFace = fontFaceEntry.fontFace.get(),
+        .fontEmSize = p.s->font->fontSize,
+        .glyphCount = 1,
+        .glyphIndices = &glyphIndexU16,
+    };
+
+    D2D1_MATRIX_3X2_F transform = identityTransform;
+    if (row.lineRendition != LineRendition::SingleWidth)
+    {
+        transform.m11 = 2.0f;
+        transform.m22 = row.lineRendition >= LineRendition::DoubleHeightTop ? 2.0f : 1.0f;
+        _glyphDeviceContext->SetTransform(&transform);
+    }
+
+    const auto restoreTransform = wil::scope_exit([&]() noexcept {
+        _glyphDeviceContext->SetTransform(&identityTransform);
+    });
+
+    // See BackendD3D::_drawGlyph() for an illustration of the glyph bounds.
+    bool isColorGlyph = false;
+    D2D1_RECT_F bounds = GlyphRunEmptyBounds;
+
+    {
+        wil::com_ptr<IDWriteColorGlyphRunEnumerator1> enumerator;
+
+        // ColorGlyphRunDraw() requires ID2D1DeviceContext4 for bitmap and SVG glyphs.
+        if (p.s->font->colorGlyphs && _glyphDeviceContext4)
+        {
+            enumerator = TranslateColorGlyphRun(p.dwriteFactory4.get(), {}, &glyphRun);
+        }
+
+        if (!enumerator)
+        {
+            THROW_IF_FAILED(_glyphDeviceContext->GetGlyphRunWorldBounds({}, &glyphRun, DWRITE_MEASURING_MODE_NATURAL, &bounds));
+        }
+        else
+        {
+            isColorGlyph = true;
+
+            while (ColorGlyphRunMoveNext(enumerator.get()))
+            {
+                const auto colorGlyphRun = ColorGlyphRunGetCurrentRun(enumerator.get());
+                ColorGlyphRunAccumulateBounds(_glyphDeviceContext.get(), colorGlyphRun, bounds);
+            }
+        }
+    }
+
+    auto shadingType = ShadingType::Default;
+    i16x2 offset{};
+    u16x2 size{};
+    u32 pixels = 0;
+
+    // The bounds may be empty if the glyph is whitespace.
+    if (bounds.left < bounds.right && bounds.top < bounds.bottom)
+    {
+        const auto bl = lrintf(bounds.left);
+        const auto bt = lrintf(bounds.top);
+        const auto br = lrintf(bounds.right);
+        const auto bb = lrintf(bounds.bottom);
+
+        shadingType = isColorGlyph ? ShadingType::TextPassthrough : ShadingType::TextGrayscale;
+        offset = { gsl::narrow_cast<i16>(bl), gsl::narrow_cast<i16>(bt) };
+        size = { gsl::narrow<u16>(br - bl), gsl::narrow<u16>(bb - bt) };
+
+        const D2D1_POINT_2F baselineOrigin{
+            static_cast<f32>(-bl),
+            static_cast<f32>(-bt),
+        };
+
+        transform.dx = (1.0f - transform.m11) * baselineOrigin.x;
+        transform.dy = (1.0f - transform.m22) * baselineOrigin.y;
+
+        _glyphRenderTargetBegin(size.x, size.y);
+        try
+        {
+            _glyphDeviceContext->SetTransform(&transform);
+
+            if (!isColorGlyph)
+            {
+                _glyphDeviceContext->DrawGlyphRun(baselineOrigin, &glyphRun, _brush.get(), DWRITE_MEASURING_MODE_NATURAL);
+            }
+            else
+            {
+                const auto enumerator = TranslateColorGlyphRun(p.dwriteFactory4.get(), baselineOrigin, &glyphRun);
+                while (ColorGlyphRunMoveNext(enumerator.get()))
+                {
+                    const auto colorGlyphRun = ColorGlyphRunGetCurrentRun(enumerator.get());
+                    ColorGlyphRunDraw(_glyphDeviceContext4.get(), _emojiBrush.get(), _brush.get(), colorGlyphRun);
+                }
+            }
+        }
+        catch (...)
+        {
+            LOG_IF_FAILED(_glyphRenderTarget->EndDraw());
+            throw;
+        }
+        pixels = _glyphRenderTargetEnd(size.x, size.y);
+    }
+
+    const auto renditionIndex = std::min<size_t>(WI_EnumValue(row.lineRendition), 2);
+    const auto glyphEntry = fontFaceEntry.glyphs[renditionIndex].insert(glyphIndex).first;
+    glyphEntry->shadingType = shadingType;
+    glyphEntry->offset = offset;
+    glyphEntry->size = size;
+    glyphEntry->pixels = pixels;
+    return glyphEntry;
+}
+
+BackendSoftware::GlyphEntry* BackendSoftware::_drawBuiltinGlyph(const RenderingPayload& p, const ShapedRow& row, FontFaceEntry& fontFaceEntry, u32 glyphIndex)
+{
+    const auto horizontalShift = static_cast<u8>(row.lineRendition != LineRendition::SingleWidth);
+    const auto verticalShift = static_cast<u8>(row.lineRendition >= LineRendition::DoubleHeightTop);
+    const auto width = static_cast<u16>(p.s->font->cellSize.x << horizontalShift);
+    const auto height = static_cast<u16>(p.s->font->cellSize.y << verticalShift);
+    const auto baseline = static_cast<i16>(p.s->font->baseline << verticalShift);
+
+    auto shadingType = ShadingType::Default;
+    u32 pixels = 0;
+
+    // Just like BackendD2D, this backend doesn't support soft fonts (DRCS) and draws them as whitespace.
+    if (BuiltinGlyphs::GetBitmapCellIndex(glyphIndex) >= 0)
+    {
+        static constexpr D2D1_COLOR_F shadeColorMap[] = {
+            { 1, 1, 1, 0.25f }, // Shape_Filled025
+            { 1, 1, 1, 0.50f }, // Shape_Filled050
+            { 1, 1, 1, 0.75f }, // Shape_Filled075
+            { 1, 1, 1, 1.00f }, // Shape_Filled100
+        };
+        const D2D1_RECT_F rect{ 0, 0, static_cast<f32>(width), static_cast<f32>(height) };
+
+        _glyphRenderTargetBegin(width, height);
+        try
+        {
+            BuiltinGlyphs::DrawBuiltinGlyph(p.d2dFactory.get(), _glyphDeviceContext.get(), _brush.get(), shadeColorMap, rect, glyphIndex);
+        }
+        catch (...)
+        {
+            LOG_IF_FAILED(_glyphRenderTarget->EndDraw());
+            throw;
+        }
+        pixels = _glyphRenderTargetEnd(width, height);
+        shadingType = ShadingType::TextGrayscale;
+    }
+
+    const auto renditionIndex = std::min<size_t>(WI_EnumValue(row.lineRendition), 2);
+    const auto glyphEntry = fontFaceEntry.glyphs[renditionIndex].insert(glyphIndex).first;
+    glyphEntry->shadingType = shadingType;
+    glyphEntry->offset = { 0, static_cast<i16>(-baseline) };
+    glyphEntry->size = { width, height };
+    glyphEntry->pixels = pixels;
+    return glyphEntry;
+}
+
+// Binds the glyph render target to a `width` x `height` area of our DIB section and begins drawing.
+void BackendSoftware::_glyphRenderTargetBegin(u16 width, u16 height)
+{
+    if (width > _glyphBitmapSize.x || height > _glyphBitmapSize.y)
+    {
+        // Growing in powers of two avoids reallocating the DIB section for every slightly larger glyph.
+        const auto w = std::bit_ceil(std::max<u32>({ width, _glyphBitmapSize.x, 64 }));
+        const auto h = std::bit_ceil(std::max<u32>({ height, _glyphBitmapSize.y, 64 }));
+
+        BITMAPINFO info{};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = gsl::narrow_cast<LONG>(w);
+        // A negative height results in a top-down DIB.
+        info.bmiHeader.biHeight = -gsl::narrow_cast<LONG>(h);
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+
+        void* bits = nullptr;
+        wil::unique_hbitmap bitmap{ CreateDIBSection(_glyphDC.get(), &info, DIB_RGB_COLORS, &bits, nullptr, 0) };
+        THROW_LAST_ERROR_IF(!bitmap);
+
+        SelectObject(_glyphDC.get(), bitmap.get());
+        _glyphBitmap = std::move(bitmap);
+        _glyphBitmapPixels = static_cast<const u32*>(bits);
+        _glyphBitmapSize = { gsl::narrow_cast<u16>(w), gsl::narrow_cast<u16>(h) };
+    }
+
+    const RECT rect{ 0, 0, width, height };
+    THROW_IF_FAILED(_glyphRenderTarget->BindDC(_glyphDC.get(), &rect));
+    _glyphRenderTarget->BeginDraw();
+    _glyphRenderTarget->Clear();
+}
+
+// Ends drawing and copies the `width` x `height` glyph into _glyphPixels. Returns the offset of the copy.
+u32 BackendSoftware::_glyphRenderTargetEnd(u16 width, u16 height)
+{
+    THROW_IF_FAILED(_glyphRenderTarget->EndDraw());
+    // The DIB section may still have pending GDI operations, which need to complete before we can read it.
+    GdiFlush();
+
+    const auto offset = gsl::narrow<u32>(_glyphPixels.size());
+    _glyphPixels.resize(offset + static_cast<size_t>(width) * height);
+
+    auto dst = _glyphPixels.data() + offset;
+    auto src = _glyphBitmapPixels;
+
+    for (u16 y = 0; y < height; ++y)
+    {
+        memcpy(dst, src, width * sizeof(u32));
+        dst += width;
+        src += _glyphBitmapSize.x;
+    }
+
+    return offset;
+}
+
+void BackendSoftware::_drawGridlines(const RenderingPayload& p, u16 y)
+{
+    const auto row = p.rows[y];
+
+    const auto horizontalShift = static_cast<u8>(row->lineRendition != LineRendition::SingleWidth);
+    const auto verticalShift = static_cast<u8>(row->lineRendition >= LineRendition::DoubleHeightTop);
+
+    const auto cellSize = p.s->font->cellSize;
+    const i32 rowTop = cellSize.y * y;
+    const i32 rowBottom = rowTop + cellSize.y;
+
+    auto textCellTop = rowTop;
+    if (row->lineRendition == LineRendition::DoubleHeightBottom)
+    {
+        textCellTop -= cellSize.y;
+    }
+
+    const i32 clipTop = row->lineRendition == LineRendition::DoubleHeightBottom ? rowTop : 0;
+    const i32 clipBottom = row->lineRendition == LineRendition::DoubleHeightTop ? rowBottom : _targetSize.y;
+    const u8x2 renditionScale{ static_cast<u8>(1 << horizontalShift), static_cast<u8>(1 << verticalShift) };
+
+    const auto appendVerticalLines = [&](const GridLineRange& r, FontDecorationPosition pos) {
+        const auto textCellWidth = cellSize.x << horizontalShift;
+        const auto offset = pos.position << horizontalShift;
+        const auto width = pos.height << horizontalShift;
+
+        auto posX = r.from * cellSize.x + offset;
+        const auto end = r.to * cellSize.x;
+
+        for (; posX < end; posX += textCellWidth)
+        {
+            _appendQuad({ .shadingType = ShadingType::SolidLine, .rect = { posX, rowTop, posX + width, rowBottom }, .color = r.gridlineColor }, 0, _targetSize.y);
+        }
+    };
+    const auto appendHorizontalLine = [&](const GridLineRange& r, FontDecorationPosition pos, ShadingType shadingType, const u32 color) {
+        const auto offset = pos.position << verticalShift;
+        const auto height = pos.height << verticalShift;
+
+        const i32 left = r.from * cellSize.x;
+        const i32 right = r.to * cellSize.x;
+        const auto top = textCellTop + offset;
+
+        _appendQuad({ .shadingType = shadingType, .renditionScale = renditionScale, .rect = { left, top, right, top + height }, .color = color }, clipTop, clipBottom);
+    };
+
+    for (const auto& r : row->gridLineRanges)
+    {
+        // AtlasEngine.cpp shouldn't add any gridlines if they don't do anything.
+        assert(r.lines.any());
+
+        if (r.lines.test(GridLines::Left))
+        {
+            appendVerticalLines(r, p.s->font->gridLeft);
+        }
+        if (r.lines.test(GridLines::Right))
+        {
+            appendVerticalLines(r, p.s->font->gridRight);
+        }
+        if (r.lines.test(GridLines::Top))
+        {
+            appendHorizontalLine(r, p.s->font->gridTop, ShadingType::SolidLine, r.gridlineColor);
+        }
+        if (r.lines.test(GridLines::Bottom))
+        {
+            appendHorizontalLine(r, p.s->font->gridBottom, ShadingType::SolidLine, r.gridlineColor);
+        }
+        if (r.lines.test(GridLines::Strikethrough))
+        {
+            appendHorizontalLine(r, p.s->font->strikethrough, ShadingType::SolidLine, r.gridlineColor);
+        }
+
+        if (r.lines.test(GridLines::Underline))
+        {
+            appendHorizontalLine(r, p.s->font->underline, ShadingType::SolidLine, r.underlineColor);
+        }
+        else if (r.lines.any(GridLines::DottedUnderline, GridLines::HyperlinkUnderline))
+        {
+            appendHorizontalLine(r, p.s->font->underline, ShadingType::DottedLine, r.underlineColor);
+        }
+        else if (r.lines.test(GridLines::DashedUnderline))
+        {
+            appendHorizontalLine(r, p.s->font->underline, ShadingType::DashedLine, r.underlineColor);
+        }
+        else if (r.lines.test(GridLines::CurlyUnderline))
+        {
+            appendHorizontalLine(r, _curlyUnderline, ShadingType::CurlyLine, r.underlineColor);
+        }
+        else if (r.lines.test(GridLines::DoubleUnderline))
+        {
+            for (const auto pos : p.s->font->doubleUnderline)
+            {
+                appendHorizontalLine(r, pos, ShadingType::SolidLine, r.underlineColor);
+            }
+        }
+    }
+}
+
+// The cursor shapes are the same as BackendD2D::_drawCursor(), just broken down into rectangles.
+// The rectangles must not overlap, because otherwise CursorInvert would invert some pixels twice.
+void BackendSoftware::_drawCursor(const RenderingPayload& p, ShadingType shadingType, u32 color)
+{
+    if (p.cursorRect.empty())
+    {
+        return;
+    }
+
+    const auto& font = *p.s->font;
+    i32r rect{
+        p.cursorRect.left * font.cellSize.x,
+        p.cursorRect.top * font.cellSize.y,
+        p.cursorRect.right * font.cellSize.x,
+        p.cursorRect.bottom * font.cellSize.y,
+    };
+    const auto append = [&](const i32r& r) {
+        _appendQuad({ .shadingType = shadingType, .rect = r, .color = color }, 0, _targetSize.y);
+    };
+
+    switch (static_cast<CursorType>(p.s->cursor->cursorType))
+    {
+    case CursorType::Legacy:
+    {
+        const auto height = p.s->cursor->heightPercentage / 100.0f;
+        rect.top = static_cast<i32>(lrintf((rect.top - rect.bottom) * height + rect.bottom));
+        append(rect);
+        break;
+    }
+    case CursorType::VerticalBar:
+        rect.right = rect.left + font.thinLineWidth;
+        append(rect);
+        break;
+    case CursorType::Underscore:
+        rect.top += font.underline.position;
+        rect.bottom = rect.top + font.underline.height;
+        append(rect);
+        break;
+    case CursorType::EmptyBox:
+    {
+        const i32 w = font.thinLineWidth;
+        append({ rect.left, rect.top, rect.right, rect.top + w });
+        append({ rect.left, rect.bottom - w, rect.right, rect.bottom });
+        append({ rect.left, rect.top + w, rect.left + w, rect.bottom - w });
+        append({ rect.right - w, rect.top + w, rect.right, rect.bottom - w });
+        break;
+    }
+    case CursorType::FullBox:
+        append(rect);
+        break;
+    case CursorType::DoubleUnderscore:
+    {
+        const auto top = rect.top;
+        for (const auto pos : font.doubleUnderline)
+        {
+            rect.top = top + pos.position;
+            rect.bottom = rect.top + font.thinLineWidth;
+            append(rect);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void BackendSoftware::_drawSelection(const RenderingPayload& p)
+{
+    const auto& font = *p.s->font;
+
+    u16 y = 0;
+    for (const auto& row : p.rows)
+    {
+        if (row->selectionTo > row->selectionFrom)
+        {
+            const i32r rect{
+                font.cellSize.x * row->selectionFrom,
+                font.cellSize.y * y,
+                font.cellSize.x * row->selectionTo,
+                font.cellSize.y * (y + 1),
+            };
+            _appendQuad({ .shadingType = ShadingType::Selection, .rect = rect, .color = p.s->misc->selectionColor }, 0, _targetSize.y);
+        }
+
+        y++;
+    }
+}
+
+// Clips `quad.rect` to the target and [clipTop, clipBottom) and appends the result, unless it's empty.
+void BackendSoftware::_appendQuad(QuadInstance quad, i32 clipTop, i32 clipBottom)
+{
+    quad.origin = { quad.rect.left, quad.rect.top };
+    quad.rect.left = std::max(quad.rect.left, 0);
+    quad.rect.top = std::max({ quad.rect.top, clipTop, 0 });
+    quad.rect.right = std::min<i32>(quad.rect.right, _targetSize.x);
+    quad.rect.bottom = std::min<i32>({ quad.rect.bottom, clipBottom, _targetSize.y });
+
+    if (quad.rect.non_empty())
+    {
+        _quads.emplace_back(quad);
+    }
+}
+
+// Composites the rows [top, bottom) of the framebuffer. The area gets split up into horizontal bands
+// which are rendered in parallel on the thread pool. This works because every quad is simply clipped
+// to each band and so no two threads ever touch the same pixel.
+void BackendSoftware::_renderBands(RenderingPayload& p, i32 top, i32 bottom)
+{
+    static const auto maxBandCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), MaxBandCount);
+
+    const auto height = bottom - top;
+    const auto bandCount = clamp<u32>(static_cast<u32>(height / MinBandHeight), 1, maxBandCount);
+
+    _bandPayload = &p;
+    _bandNext.store(0, std::memory_order_relaxed);
+    _bandCount = bandCount;
+    _bandTop = top;
+    _bandBottom = bottom;
+    _bandHeight = (height + static_cast<i32>(bandCount) - 1) / static_cast<i32>(bandCount);
+
+    if (bandCount > 1)
+    {
+        if (!_bandWork)
+        {
+            _bandWork.reset(CreateThreadpoolWork(&_renderBandsCallback, this, nullptr));
+            THROW_LAST_ERROR_IF(!_bandWork);
+        }
+
+        // The calling thread renders bands as well, which is why it's one less than bandCount.
+        for (u32 i = 1; i < bandCount; ++i)
+        {
+            SubmitThreadpoolWork(_bandWork.get());
+        }
+    }
+
+    _renderBandsWorker();
+
+    if (bandCount > 1)
+    {
+        WaitForThreadpoolWorkCallbacks(_bandWork.get(), FALSE);
+    }
+
+    _bandPayload = nullptr;
+}
+
+void CALLBACK BackendSoftware::_renderBandsCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_WORK) noexcept
+{
+    static_cast<BackendSoftware*>(context)->_renderBandsWorker();
+}
+
+void BackendSoftware::_renderBandsWorker() noexcept
+{
+    for (;;)
+    {
+        const auto i = _bandNext.fetch_add(1, std::memory_order_relaxed);
+        if (i >= _bandCount)
+        {
+            break;
+        }
+
+        const auto top = _bandTop + static_cast<i32>(i) * _bandHeight;
+        const auto bottom = std::min(top + _bandHeight, _bandBottom);
+        _renderBand(top, bottom);
+    }
+}
+
+void BackendSoftware::_renderBand(i32 top, i32 bottom) const noexcept
+{
+    const size_t stride = _targetSize.x;
+    const auto data = _bandPayload->softwareFramebuffer.data();
+
+    for (auto y = top; y < bottom; ++y)
+    {
+        _renderBackground(data + y * stride, y);
+    }
+
+    for (const auto& q : _quads)
+    {
+        const auto t = std::max(q.rect.top, top);
+        const auto b = std::min(q.rect.bottom, bottom);
+        if (t < b)
+        {
+            _renderQuad(q, t, b);
+        }
+    }
+}
+
+// Fills the pixel row `y` with the background color of each cell.
+void BackendSoftware::_renderBackground(u32* dst, i32 y) const noexcept
+{
+    const auto& p = *_bandPayload;
+    const i32 cellWidth = p.s->font->cellSize.x;
+    const i32 width = _targetSize.x;
+    const auto cellY = y / p.s->font->cellSize.y;
+    i32 x = 0;
+
+    if (cellY < p.s->viewportCellCount.y)
+    {
+        const auto src = &p.backgroundBitmap[p.colorBitmapRowStride * cellY];
+
+        for (u16 cellX = 0; cellX < p.s->viewportCellCount.x && x < width; ++cellX)
+        {
+            const auto count = std::min(cellWidth, width - x);
+            std::fill_n(dst + x, count, rgbaToBgra(src[cellX]));
+            x += count;
+        }
+    }
+
+    // Just like BackendD3D, the area outside of the viewport is filled with the background color.
+    std::fill_n(dst + x, width - x, bgraPremultiply(p.s->misc->backgroundColor));
+}
+
+void BackendSoftware::_renderQuad(const QuadInstance& q, i32 top, i32 bottom) const noexcept
+{
+    const auto& p = *_bandPayload;
+    const size_t stride = _targetSize.x;
+    const size_t width = q.rect.right - q.rect.left;
+    auto dst = _bandPayload->softwareFramebuffer.data() + top * stride + q.rect.left;
+
+    switch (q.shadingType)
+    {
+    case ShadingType::TextGrayscale:
+    case ShadingType::TextPassthrough:
+    {
+        auto src = _glyphPixels.data() + q.pixels + (top - q.origin.y) * q.stride + (q.rect.left - q.origin.x);
+        const auto color = bgraPremultiply(q.color);
+
+        for (auto y = top; y < bottom; ++y, dst += stride, src += q.stride)
+        {
+            if (q.shadingType == ShadingType::TextGrayscale)
+            {
+                blendSpanTinted(dst, src, width, color);
+            }
+            else
+            {
+                blendSpanPassthrough(dst, src, width);
+            }
+        }
+        break;
+    }
+    case ShadingType::DottedLine:
+    case ShadingType::DashedLine:
+    case ShadingType::CurlyLine:
+    {
+        // These mirror the corresponding cases in shader_ps.hlsl, except that they're evaluated per pixel
+        // on the CPU. Since underlines are thin and rare, it's not worth vectorizing them.
+        const auto underlineWidth = static_cast<f32>(p.s->font->underline.height);
+        const auto doubleUnderlineWidth = static_cast<f32>(p.s->font->doubleUnderline[0].height);
+        const auto scaleX = static_cast<f32>(q.renditionScale.x);
+        const auto scaleY = static_cast<f32>(q.renditionScale.y);
+        const auto color = bgraPremultiply(q.color);
+
+        for (auto y = top; y < bottom; ++y, dst += stride)
+        {
+            const auto texcoordY = static_cast<f32>(y - q.origin.y) + 0.5f;
+
+            for (size_t i = 0; i < width; ++i)
+            {
+                const auto positionX = static_cast<f32>(q.rect.left + static_cast<i32>(i)) + 0.5f;
+                f32 alpha;
+
+                if (q.shadingType == ShadingType::DottedLine)
+                {
+                    const auto period = 3.0f * underlineWidth * scaleX;
+                    const auto frac = positionX / period - floorf(positionX / period);
+                    alpha = frac < (1.0f / 3.0f) ? 1.0f : 0.0f;
+                }
+                else if (q.shadingType == ShadingType::DashedLine)
+                {
+                    const auto period = 6.0f * underlineWidth * scaleX;
+                    const auto frac = positionX / period - floorf(positionX / period);
+                    alpha = frac < (4.0f / 6.0f) ? 1.0f : 0.0f;
+                }
+                else
+                {
+                    const auto strokeWidthHalf = doubleUnderlineWidth * scaleY * 0.5f;
+                    const auto amp = (_curlyLineHalfHeight - strokeWidthHalf) * scaleY;
+                    const auto freq = scaleX / _curlyLineHalfHeight * 1.57079632679489661923f;
+                    const auto s = sinf(positionX * freq) * amp;
+                    const auto d = fabsf(_curlyLineHalfHeight - texcoordY - s);
+                    alpha = 1.0f - clamp(d - strokeWidthHalf, 0.0f, 1.0f);
+                }
+
+                if (alpha > 0.0f)
+                {
+                    const auto a = static_cast<u32>(lrintf(alpha * 255.0f));
+                    dst[i] = blendOver(dst[i], multiply(color, a * 0x01010101));
+                }
+            }
+        }
+        break;
+    }
+    case ShadingType::CursorInvert:
+        for (auto y = top; y < bottom; ++y, dst += stride)
+        {
+            invertSpan(dst, width);
+        }
+        break;
+    default:
+    {
+        const auto color = bgraPremultiply(q.color);
+        for (auto y = top; y < bottom; ++y, dst += stride)
+        {
+            blendSpanSolid(dst, width, color);
+        }
+        break;
+    }
+    }
+}
+
+TIL_FAST_MATH_END
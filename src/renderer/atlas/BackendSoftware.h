@@ -0,0 +1,202 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <til/flat_set.h>
+
+#include "Backend.h"
+
+namespace Microsoft::Console::Render::Atlas
+{
+    // A backend that rasterizes the viewport on the CPU into RenderingPayload::softwareFramebuffer.
+    // It's meant for hosts without a usable GPU (VMs, RDP sessions, etc.) and for pixel-exact,
+    // reproducible rendering. It works similar to BackendD3D: Glyphs are rasterized once and cached,
+    // and every frame is turned into a list of quads, which are then composited in horizontal
+    // bands on the thread pool. Presentation is handled by AtlasEngine::_present().
+    struct BackendSoftware : IBackend
+    {
+        void ReleaseResources() noexcept override;
+        void Render(RenderingPayload& payload) override;
+        bool RequiresContinuousRedraw() noexcept override;
+
+    private:
+        // Unlike BackendD3D there's no need to keep this in sync with a shader,
+        // but the values intentionally mirror BackendD3D::ShadingType.
+        enum class ShadingType : u8
+        {
+            Default = 0,
+
+            TextGrayscale,
+            TextPassthrough,
+            DottedLine,
+            DashedLine,
+            CurlyLine,
+            SolidLine,
+
+            Cursor,
+            CursorInvert,
+            Selection,
+        };
+
+        // NOTE: Don't initialize any members in this struct. This ensures that no
+        // zero-initialization needs to occur when we allocate large buffers of this object.
+        struct QuadInstance
+        {
+            ShadingType shadingType;
+            u8x2 renditionScale;
+            // The destination rectangle in pixels, already clipped to the target.
+            i32r rect;
+            // The unclipped top-left corner of the quad. Glyphs use it to map
+            // destination pixels back to their source pixels in _glyphPixels.
+            i32x2 origin;
+            // Offset of the first pixel of the glyph in _glyphPixels and the glyph's row stride.
+            u32 pixels;
+            u32 stride;
+            // Straight alpha RGBA. Ignored by TextPassthrough and CursorInvert.
+            u32 color;
+        };
+
+        // NOTE: Don't initialize any members in this struct. This ensures that no
+        // zero-initialization needs to occur when we allocate large buffers of this object.
+        struct GlyphEntry
+        {
+            u32 glyphIndex;
+            u8 occupied;
+            ShadingType shadingType;
+            i16x2 offset;
+            u16x2 size;
+            // Offset of the first pixel of the glyph in _glyphPixels.
+            u32 pixels;
+        };
+
+        struct GlyphEntryHashTrait
+        {
+            static constexpr bool occupied(const GlyphEntry& entry) noexcept
+            {
+                return entry.occupied != 0;
+            }
+
+            static constexpr size_t hash(const u32 glyphIndex) noexcept
+            {
+                return til::flat_set_hash_integer(glyphIndex);
+            }
+
+            static constexpr size_t hash(const GlyphEntry& entry) noexcept
+            {
+                return til::flat_set_hash_integer(entry.glyphIndex);
+            }
+
+            static constexpr bool equals(const GlyphEntry& entry, u32 glyphIndex) noexcept
+            {
+                return entry.glyphIndex == glyphIndex;
+            }
+
+            static constexpr void assign(GlyphEntry& entry, u32 glyphIndex) noexcept
+            {
+                entry.glyphIndex = glyphIndex;
+                entry.occupied = 1;
+            }
+        };
+
+        struct FontFaceEntry
+        {
+            // See BackendD3D::AtlasFontFaceEntry for why it's fine to hash the pointer.
+            wil::com_ptr<IDWriteFontFace2> fontFace;
+
+            // Single width, double width and double height glyphs. Both halves of a double
+            // height row share the same glyphs, as we simply clip them to the row when drawing.
+            til::linear_flat_set<GlyphEntry, GlyphEntryHashTrait> glyphs[3];
+        };
+
+        struct FontFaceEntryHashTrait
+        {
+            static bool occupied(const FontFaceEntry& entry) noexcept
+            {
+                return static_cast<bool>(entry.fontFace);
+            }
+
+            static constexpr size_t hash(const IDWriteFontFace2* fontFace) noexcept
+            {
+                return til::flat_set_hash_integer(std::bit_cast<uintptr_t>(fontFace));
+            }
+
+            static size_t hash(const FontFaceEntry& entry) noexcept
+            {
+                return hash(entry.fontFace.get());
+            }
+
+            static bool equals(const FontFaceEntry& entry, const IDWriteFontFace2* fontFace) noexcept
+            {
+                return entry.fontFace.get() == fontFace;
+            }
+
+            static void assign(FontFaceEntry& entry, IDWriteFontFace2* fontFace) noexcept
+            {
+                entry.fontFace = fontFace;
+            }
+        };
+
+        // The glyph cache gets flushed at the start of a frame once it holds more pixels than this (16 MiB).
+        static constexpr size_t GlyphCacheMaxPixels = 4 * 1024 * 1024;
+        // Bands smaller than this aren't worth the overhead of handing them to the thread pool.
+        static constexpr i32 MinBandHeight = 64;
+        static constexpr u32 MaxBandCount = 16;
+
+        ATLAS_ATTR_COLD void _handleSettingsUpdate(RenderingPayload& p);
+        void _updateFontDependents(const RenderingPayload& p);
+        void _createGlyphRenderTarget(const RenderingPayload& p);
+        void _resetGlyphCache() noexcept;
+        void _scrollFramebuffer(const RenderingPayload& p) const noexcept;
+        void _drawText(RenderingPayload& p);
+        ATLAS_ATTR_COLD GlyphEntry* _drawGlyph(const RenderingPayload& p, const ShapedRow& row, FontFaceEntry& fontFaceEntry, u32 glyphIndex);
+        ATLAS_ATTR_COLD GlyphEntry* _drawBuiltinGlyph(const RenderingPayload& p, const ShapedRow& row, FontFaceEntry& fontFaceEntry, u32 glyphIndex);
+        void _glyphRenderTargetBegin(u16 width, u16 height);
+        u32 _glyphRenderTargetEnd(u16 width, u16 height);
+        ATLAS_ATTR_COLD void _drawGridlines(const RenderingPayload& p, u16 y);
+        void _drawCursor(const RenderingPayload& p, ShadingType shadingType, u32 color);
+        void _drawSelection(const RenderingPayload& p);
+        void _appendQuad(QuadInstance quad, i32 clipTop, i32 clipBottom);
+        void _renderBands(RenderingPayload& p, i32 top, i32 bottom);
+        static void CALLBACK _renderBandsCallback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WORK work) noexcept;
+        void _renderBandsWorker() noexcept;
+        void _renderBand(i32 top, i32 bottom) const noexcept;
+        void _renderBackground(u32* dst, i32 y) const noexcept;
+        void _renderQuad(const QuadInstance& q, i32 top, i32 bottom) const noexcept;
+
+        std::vector<QuadInstance> _quads;
+
+        til::linear_flat_set<FontFaceEntry, FontFaceEntryHashTrait> _glyphCache;
+        FontFaceEntry _builtinGlyphs;
+        // Premultiplied BGRA pixels of all cached glyphs, back to back.
+        std::vector<u32> _glyphPixels;
+
+        // Glyphs get rasterized with Direct2D's software rasterizer into a DIB section.
+        // The DC must be destroyed before the bitmap that's selected into it.
+        wil::unique_hbitmap _glyphBitmap;
+        wil::unique_hdc _glyphDC;
+        const u32* _glyphBitmapPixels = nullptr;
+        u16x2 _glyphBitmapSize{};
+        wil::com_ptr<ID2D1DCRenderTarget> _glyphRenderTarget;
+        wil::com_ptr<ID2D1DeviceContext> _glyphDeviceContext;
+        wil::com_ptr<ID2D1DeviceContext4> _glyphDeviceContext4; // Optional. Supported since Windows 10 14393.
+        wil::com_ptr<ID2D1SolidColorBrush> _emojiBrush;
+        wil::com_ptr<ID2D1SolidColorBrush> _brush;
+
+        wil::unique_threadpool_work _bandWork;
+        RenderingPayload* _bandPayload = nullptr;
+        std::atomic<u32> _bandNext{ 0 };
+        u32 _bandCount = 0;
+        i32 _bandTop = 0;
+        i32 _bandBottom = 0;
+        i32 _bandHeight = 0;
+
+        FontDecorationPosition _curlyUnderline;
+        f32 _curlyLineHalfHeight = 0;
+        u16x2 _targetSize{};
+        bool _framebufferInvalid = true;
+
+        til::generation_t _generation;
+        til::generation_t _fontGeneration;
+    };
+}
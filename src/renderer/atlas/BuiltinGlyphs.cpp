@@ -1054,6 +1054,64 @@ bool BuiltinGlyphs::IsBuiltinGlyph(char32_t codepoint) noexcept
     return BoxDrawing_IsMapped(codepoint) || Powerline_IsMapped(codepoint);
 }
 
+// The positions of an Instruction within a glyph of a given size, relative to its top-left corner.
+struct InstructionGeometry
+{
+    // Unrounded, as given by the Pos enum.
+    f32 begX;
+    f32 begY;
+    f32 endX;
+    f32 endY;
+    // Rounded to whole pixels, offset by half the stroke width where needed.
+    f32 begXrounded;
+    f32 begYrounded;
+    f32 endXrounded;
+    f32 endYrounded;
+    f32 lineWidth;
+    bool isLineX;
+    bool isLineY;
+};
+
+static InstructionGeometry ResolveInstruction(const Instruction& instruction, f32 rectW, f32 rectH, f32 lightLineWidth) noexcept
+{
+    const auto shape = static_cast<Shape>(instruction.shape);
+    InstructionGeometry g{};
+
+    g.begX = Pos_Lut[instruction.begX][0] * rectW;
+    g.begY = Pos_Lut[instruction.begY][0] * rectH;
+    g.endX = Pos_Lut[instruction.endX][0] * rectW;
+    g.endY = Pos_Lut[instruction.endY][0] * rectH;
+
+    g.begX += Pos_Lut[instruction.begX][1] * lightLineWidth;
+    g.begY += Pos_Lut[instruction.begY][1] * lightLineWidth;
+    g.endX += Pos_Lut[instruction.endX][1] * lightLineWidth;
+    g.endY += Pos_Lut[instruction.endY][1] * lightLineWidth;
+
+    g.lineWidth = shape == Shape_HeavyLine ? lightLineWidth * 2.0f : lightLineWidth;
+    const auto lineWidthHalf = g.lineWidth * 0.5f;
+    const auto isHollowRect = shape == Shape_EmptyRect || shape == Shape_RoundRect;
+    const auto isLine = shape == Shape_LightLine || shape == Shape_HeavyLine;
+    g.isLineX = isLine && g.begX == g.endX;
+    g.isLineY = isLine && g.begY == g.endY;
+    const auto lineOffsetX = isHollowRect || g.isLineX ? lineWidthHalf : 0.0f;
+    const auto lineOffsetY = isHollowRect || g.isLineY ? lineWidthHalf : 0.0f;
+
+    // Direct2D draws strokes centered on the path. In order to make them pixel-perfect we need to round the
+    // coordinates to whole pixels, but offset by half the stroke width (= the radius of the stroke).
+    //
+    // All floats up to this point will be highly "consistent" between different `rect`s of identical size and
+    // different shapes, because the above calculations work with only a small set of constant floats.
+    // However, the addition of a potentially fractional begX/Y with a highly variable `rect` position is different.
+    // Rounding beg/endX/Y first ensures that we continue to get a consistent behavior between calls.
+    // This is particularly noticeable at smaller font sizes, where the line width is just a pixel or two.
+    g.begXrounded = roundf(g.begX - lineOffsetX) + lineOffsetX;
+    g.begYrounded = roundf(g.begY - lineOffsetY) + lineOffsetY;
+    g.endXrounded = roundf(g.endX + lineOffsetX) - lineOffsetX;
+    g.endYrounded = roundf(g.endY + lineOffsetY) - lineOffsetY;
+
+    return g;
+}
+
 static const Instruction* GetInstructions(char32_t codepoint) noexcept
 {
     if (BoxDrawing_IsMapped(codepoint))
@@ -1080,6 +1138,211 @@ i32 BuiltinGlyphs::GetBitmapCellIndex(char32_t codepoint) noexcept
     return -1;
 }
 
+static_assert(BuiltinGlyphs::MaxShapeCount == 4 * InstructionsPerGlyph);
+
+size_t BuiltinGlyphs::GetShapes(char32_t codepoint, u16x2 size, Rect (&shapes)[MaxShapeCount]) noexcept
+{
+    const auto instructions = GetInstructions(codepoint);
+    if (!instructions)
+    {
+        return 0;
+    }
+
+    const auto rectW = static_cast<f32>(size.x);
+    const auto rectH = static_cast<f32>(size.y);
+    const auto lightLineWidth = std::max(1.0f, roundf(rectW / 8.0f));
+
+    // Each instruction results in at most 4 rectangles (Shape_EmptyRect).
+    size_t shapeCount = 0;
+
+    const auto push = [&](f32 l, f32 t, f32 r, f32 b, u8 shade) noexcept {
+        shapes[shapeCount] = {
+            .rect = {
+                static_cast<u16>(std::clamp(l, 0.0f, rectW)),
+                static_cast<u16>(std::clamp(t, 0.0f, rectH)),
+                static_cast<u16>(std::clamp(r, 0.0f, rectW)),
+                static_cast<u16>(std::clamp(b, 0.0f, rectH)),
+            },
+            .shade = shade,
+        };
+        shapeCount += shapes[shapeCount].rect.non_empty();
+    };
+
+    for (size_t i = 0; i < InstructionsPerGlyph; ++i)
+    {
+        const auto& instruction = instructions[i];
+        if (instruction.value == 0)
+        {
+            break;
+        }
+
+        const auto shape = static_cast<Shape>(instruction.shape);
+        const auto g = ResolveInstruction(instruction, rectW, rectH, lightLineWidth);
+        const auto lineWidthHalf = g.lineWidth * 0.5f;
+
+        switch (shape)
+        {
+        case Shape_Filled025:
+        case Shape_Filled050:
+        case Shape_Filled075:
+        case Shape_Filled100:
+            push(g.begXrounded, g.begYrounded, g.endXrounded, g.endYrounded, static_cast<u8>(shape));
+            break;
+        case Shape_LightLine:
+        case Shape_HeavyLine:
+            // Direct2D draws lines with flat caps, so an axis-aligned line is simply a rectangle.
+            if (g.isLineX)
+            {
+                const auto x = g.begXrounded - lineWidthHalf;
+                push(x, std::min(g.begYrounded, g.endYrounded), x + g.lineWidth, std::max(g.begYrounded, g.endYrounded), 3);
+            }
+            else if (g.isLineY)
+            {
+                const auto y = g.begYrounded - lineWidthHalf;
+                push(std::min(g.begXrounded, g.endXrounded), y, std::max(g.begXrounded, g.endXrounded), y + g.lineWidth, 3);
+            }
+            else
+            {
+                return 0;
+            }
+            break;
+        case Shape_EmptyRect:
+        {
+            // The stroke is centered on the rectangle and has mitered (= square) corners.
+            const auto l = g.begXrounded - lineWidthHalf;
+            const auto t = g.begYrounded - lineWidthHalf;
+            const auto r = g.endXrounded + lineWidthHalf;
+            const auto b = g.endYrounded + lineWidthHalf;
+            const auto w = g.lineWidth;
+            push(l, t, r, t + w, 3);
+            push(l, b - w, r, b, 3);
+            push(l, t + w, l + w, b - w, 3);
+            push(r - w, t + w, r, b - w, 3);
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    return shapeCount;
+}
+
+size_t BuiltinGlyphs::GetRectangles(char32_t codepoint, u16x2 size, Rect (&rectangles)[MaxRectangleCount]) noexcept
+{
+    Rect shapes[MaxShapeCount];
+    const auto shapeCount = GetShapes(codepoint, size, shapes);
+
+    // Turn the (potentially overlapping) shapes into non-overlapping rectangles, because overlapping
+    // quads would be blended twice. This splits the glyph into horizontal bands at every top/bottom edge.
+    // Within each band, each span between two left/right edges gets the shade of the topmost shape.
+    i32 edgesY[2 * MaxShapeCount]{};
+    i32 edgesX[2 * MaxShapeCount]{};
+    size_t edgesYCount = 0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < shapeCount; ++i)
+    {
+        edgesY[edgesYCount++] = shapes[i].rect.top;
+        edgesY[edgesYCount++] = shapes[i].rect.bottom;
+    }
+    std::sort(&edgesY[0], &edgesY[edgesYCount]);
+    edgesYCount = static_cast<size_t>(std::unique(&edgesY[0], &edgesY[edgesYCount]) - &edgesY[0]);
+
+    for (size_t iy = 1; iy < edgesYCount; ++iy)
+    {
+        const auto y0 = edgesY[iy - 1];
+        const auto y1 = edgesY[iy];
+        size_t edgesXCount = 0;
+
+        for (size_t i = 0; i < shapeCount; ++i)
+        {
+            if (shapes[i].rect.top <= y0 && shapes[i].rect.bottom >= y1)
+            {
+                edgesX[edgesXCount++] = shapes[i].rect.left;
+                edgesX[edgesXCount++] = shapes[i].rect.right;
+            }
+        }
+        std::sort(&edgesX[0], &edgesX[edgesXCount]);
+        edgesXCount = static_cast<size_t>(std::unique(&edgesX[0], &edgesX[edgesXCount]) - &edgesX[0]);
+
+        for (size_t ix = 1; ix < edgesXCount; ++ix)
+        {
+            const auto x0 = edgesX[ix - 1];
+            const auto x1 = edgesX[ix];
+            int shade = -1;
+
+            for (size_t i = 0; i < shapeCount; ++i)
+            {
+                const auto& s = shapes[i].rect;
+                if (s.top <= y0 && s.bottom >= y1 && s.left <= x0 && s.right >= x1)
+                {
+                    shade = shapes[i].shade;
+                }
+            }
+
+            if (shade < 0)
+            {
+                continue;
+            }
+
+            // Extend the previous span in this band to the right, or a span in the band above downwards.
+            // This keeps the rectangle count low, as most glyphs are made up of a couple lines.
+            auto merged = false;
+            for (size_t i = count; i-- > 0;)
+            {
+                auto& r = rectangles[i];
+                if (r.shade != shade)
+                {
+                    continue;
+                }
+                if (r.rect.top == y0 && r.rect.bottom == y1 && r.rect.right == x0)
+                {
+                    r.rect.right = static_cast<u16>(x1);
+                    merged = true;
+                    break;
+                }
+            }
+            if (merged)
+            {
+                continue;
+            }
+            if (count >= MaxRectangleCount)
+            {
+                return 0;
+            }
+
+            rectangles[count++] = {
+                .rect = { static_cast<u16>(x0), static_cast<u16>(y0), static_cast<u16>(x1), static_cast<u16>(y1) },
+                .shade = static_cast<u8>(shade),
+            };
+        }
+
+        // Now that the band is complete, merge its rectangles with identical ones directly above it.
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& r = rectangles[i];
+            if (r.rect.top != y0)
+            {
+                continue;
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                auto& above = rectangles[j];
+                if (above.rect.bottom == y0 && above.rect.left == r.rect.left && above.rect.right == r.rect.right && above.shade == r.shade)
+                {
+                    above.rect.bottom = r.rect.bottom;
+                    rectangles[i] = rectangles[--count];
+                    --i;
+                    break;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
 void BuiltinGlyphs::DrawBuiltinGlyph(ID2D1Factory* factory, ID2D1DeviceContext* renderTarget, ID2D1SolidColorBrush* brush, const D2D1_COLOR_F (&shadeColorMap)[4], const D2D1_RECT_F& rect, char32_t codepoint)
 {
     renderTarget->PushAxisAlignedClip(&rect, D2D1_ANTIALIAS_MODE_ALIASED);
@@ -1112,37 +1375,16 @@ void BuiltinGlyphs::DrawBuiltinGlyph(ID2D1Factory* factory, ID2D1DeviceContext*
         }
 
         const auto shape = static_cast<Shape>(instruction.shape);
-        auto begX = Pos_Lut[instruction.begX][0] * rectW;
-        auto begY = Pos_Lut[instruction.begY][0] * rectH;
-        auto endX = Pos_Lut[instruction.endX][0] * rectW;
-        auto endY = Pos_Lut[instruction.endY][0] * rectH;
-
-        begX += Pos_Lut[instruction.begX][1] * lightLineWidth;
-        begY += Pos_Lut[instruction.begY][1] * lightLineWidth;
-        endX += Pos_Lut[instruction.endX][1] * lightLineWidth;
-        endY += Pos_Lut[instruction.endY][1] * lightLineWidth;
-
-        const auto lineWidth = shape == Shape_HeavyLine ? lightLineWidth * 2.0f : lightLineWidth;
-        const auto lineWidthHalf = lineWidth * 0.5f;
-        const auto isHollowRect = shape == Shape_EmptyRect || shape == Shape_RoundRect;
-        const auto isLine = shape == Shape_LightLine || shape == Shape_HeavyLine;
-        const auto isLineX = isLine && begX == endX;
-        const auto isLineY = isLine && begY == endY;
-        const auto lineOffsetX = isHollowRect || isLineX ? lineWidthHalf : 0.0f;
-        const auto lineOffsetY = isHollowRect || isLineY ? lineWidthHalf : 0.0f;
-
-        // Direct2D draws strokes centered on the path. In order to make them pixel-perfect we need to round the
-        // coordinates to whole pixels, but offset by half the stroke width (= the radius of the stroke).
-        //
-        // All floats up to this point will be highly "consistent" between different `rect`s of identical size and
-        // different shapes, because the above calculations work with only a small set of constant floats.
-        // However, the addition of a potentially fractional begX/Y with a highly variable `rect` position is different.
-        // Rounding beg/endX/Y first ensures that we continue to get a consistent behavior between calls.
-        // This is particularly noticeable at smaller font sizes, where the line width is just a pixel or two.
-        const auto begXabs = rectX + roundf(begX - lineOffsetX) + lineOffsetX;
-        const auto begYabs = rectY + roundf(begY - lineOffsetY) + lineOffsetY;
-        const auto endXabs = rectX + roundf(endX + lineOffsetX) - lineOffsetX;
-        const auto endYabs = rectY + roundf(endY + lineOffsetY) - lineOffsetY;
+        const auto g = ResolveInstruction(instruction, rectW, rectH, lightLineWidth);
+        const auto begX = g.begX;
+        const auto begY = g.begY;
+        const auto endX = g.endX;
+        const auto endY = g.endY;
+        const auto lineWidth = g.lineWidth;
+        const auto begXabs = rectX + g.begXrounded;
+        const auto begYabs = rectY + g.begYrounded;
+        const auto endXabs = rectX + g.endXrounded;
+        const auto endYabs = rectY + g.endYrounded;
 
         switch (shape)
         {
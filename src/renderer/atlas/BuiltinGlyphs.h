@@ -20,6 +20,27 @@ namespace Microsoft::Console::Render::Atlas::BuiltinGlyphs
 
     i32 GetBitmapCellIndex(char32_t codepoint) noexcept;
 
+    // An axis-aligned rectangle in pixels, relative to the top-left corner of the glyph.
+    // `shade` is an index into the shadeColorMap that DrawBuiltinGlyph() takes.
+    struct Rect
+    {
+        u16r rect;
+        u8 shade;
+    };
+
+    inline constexpr size_t MaxRectangleCount = 16;
+    inline constexpr size_t MaxShapeCount = 16;
+
+    // Evaluates the glyph's instructions for the given size into the rectangles they paint, in painting order.
+    // Unlike the result of GetRectangles(), these may overlap, in which case the later one wins.
+    // Returns 0 under the same conditions as GetRectangles(), except for the rectangle count limit.
+    size_t GetShapes(char32_t codepoint, u16x2 size, Rect (&shapes)[MaxShapeCount]) noexcept;
+
+    // Evaluates the glyph analytically for the given size into non-overlapping rectangles that look identical
+    // to what DrawBuiltinGlyph() would draw. Returns 0 if the glyph contains shapes that aren't axis-aligned
+    // (diagonals, arcs, etc.) or that need too many rectangles. DrawBuiltinGlyph() must be used for those.
+    size_t GetRectangles(char32_t codepoint, u16x2 size, Rect (&rectangles)[MaxRectangleCount]) noexcept;
+
     // This is just an extra. It's not actually implemented as part of BuiltinGlyphs.cpp.
     constexpr bool IsSoftFontChar(char32_t ch) noexcept
     {
@@ -320,6 +320,7 @@ namespace Microsoft::Console::Render::Atlas
         Automatic,
         Direct2D,
         Direct3D11,
+        Software,
     };
 
     struct TargetSettings
@@ -569,6 +570,12 @@ namespace Microsoft::Console::Render::Atlas
         range<u16> invalidatedRows{};
         // In pixel.
         i16 scrollOffset = 0;
+        // Only used by BackendSoftware. Contains the targetSize.x * targetSize.y pixels of the
+        // current frame in premultiplied BGRA. AtlasEngine::_present() uploads it into the swap chain.
+        Buffer<u32, 32> softwareFramebuffer;
+        // Filled in by AtlasEngine and the backends during the frame.
+        // AtlasEngine::CollectFrameStats() hands them over to the Renderer and resets them.
+        RenderFrameStats stats;
 
         void MarkAllAsDirty() noexcept
         {
@@ -14,9 +14,12 @@
 #define SHADING_TYPE_DOTTED_LINE        5
 #define SHADING_TYPE_DASHED_LINE        6
 #define SHADING_TYPE_CURLY_LINE         7
-#define SHADING_TYPE_SOLID_LINE         8
-#define SHADING_TYPE_CURSOR             9
-#define SHADING_TYPE_SELECTION          10
+#define SHADING_TYPE_SHADE_025          8
+#define SHADING_TYPE_SHADE_050          9
+#define SHADING_TYPE_SHADE_075          10
+#define SHADING_TYPE_SOLID_LINE         11
+#define SHADING_TYPE_CURSOR             12
+#define SHADING_TYPE_SELECTION          13
 
 struct VSData
 {
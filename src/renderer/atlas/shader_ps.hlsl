@@ -149,6 +149,23 @@ Output main(PSData data) : SV_Target
         weights = color.aaaa;
         break;
     }
+    case SHADING_TYPE_SHADE_025:
+    case SHADING_TYPE_SHADE_050:
+    case SHADING_TYPE_SHADE_075:
+    {
+        // These are the shaded blocks U+2591..U+2593 when BackendD3D draws builtin glyphs without the glyph atlas.
+        // It's the same as SHADING_TYPE_TEXT_BUILTIN_GLYPH above, but the .r (stretch) and .g (invert)
+        // components are derived from the shading type instead of being read from the atlas.
+        const float stretch = data.shadingType != SHADING_TYPE_SHADE_050;
+        const float invert = data.shadingType == SHADING_TYPE_SHADE_075;
+        float2 pos = floor(data.position.xy / (shadedGlyphDotSize * data.renditionScale));
+        float stretched = step(frac(dot(pos, float2(stretch * -0.25f + 0.5f, 0.5f))), 0);
+        float filled = abs(invert - stretched);
+
+        color = premultiplyColor(data.color) * filled;
+        weights = color.aaaa;
+        break;
+    }
     case SHADING_TYPE_TEXT_PASSTHROUGH:
     {
         color = glyphAtlas[data.texcoord];
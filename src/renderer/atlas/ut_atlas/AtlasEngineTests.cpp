@@ -0,0 +1,225 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include <wextestclass.h>
+#include "../../../inc/consoletaeftemplates.hpp"
+
+#include "../AtlasEngine.h"
+#include "../../inc/IRenderData.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Render::Atlas;
+
+static constexpr til::CoordType columns = 20;
+static constexpr til::CoordType rows = 4;
+
+namespace
+{
+    // AtlasEngine doesn't use the render data, but UpdateDrawingBrushes() requires some.
+    class MockRenderData final : public IRenderData
+    {
+    public:
+        Microsoft::Console::Types::Viewport GetViewport() noexcept override { return {}; }
+        til::point GetTextBufferEndPosition() const noexcept override { return {}; }
+        TextBuffer& GetTextBuffer() const noexcept override { FAIL_FAST_HR(E_NOTIMPL); }
+        const FontInfo& GetFontInfo() const noexcept override { FAIL_FAST_HR(E_NOTIMPL); }
+        std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override { return {}; }
+        std::span<const til::point_span> GetSearchHighlights() const noexcept override { return {}; }
+        const til::point_span* GetSearchHighlightFocused() const noexcept override { return nullptr; }
+        void LockConsole() noexcept override {}
+        void UnlockConsole() noexcept override {}
+        til::point GetCursorPosition() const noexcept override { return {}; }
+        bool IsCursorVisible() const noexcept override { return false; }
+        bool IsCursorOn() const noexcept override { return false; }
+        ULONG GetCursorHeight() const noexcept override { return 0; }
+        CursorType GetCursorStyle() const noexcept override { return CursorType::Legacy; }
+        ULONG GetCursorPixelWidth() const noexcept override { return 0; }
+        bool IsCursorDoubleWidth() const override { return false; }
+        const bool IsGridLineDrawingAllowed() noexcept override { return false; }
+        const std::wstring_view GetConsoleTitle() const noexcept override { return {}; }
+        const std::wstring GetHyperlinkUri(uint16_t /*id*/) const override { return {}; }
+        const std::wstring GetHyperlinkCustomId(uint16_t /*id*/) const override { return {}; }
+        const std::vector<size_t> GetPatternId(const til::point /*location*/) const override { return {}; }
+        std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& /*attr*/) const noexcept override { return {}; }
+        const bool IsSelectionActive() const override { return false; }
+        const bool IsBlockSelection() const override { return false; }
+        void ClearSelection() override {}
+        void SelectNewRegion(const til::point /*coordStart*/, const til::point /*coordEnd*/) override {}
+        const til::point GetSelectionAnchor() const noexcept override { return {}; }
+        const til::point GetSelectionEnd() const noexcept override { return {}; }
+        const bool IsUiaDataInitialized() const noexcept override { return true; }
+    };
+}
+
+class AtlasEngineTests
+{
+    TEST_CLASS(AtlasEngineTests);
+
+    TEST_CLASS_SETUP(ClassSetup)
+    {
+        // AtlasEngine creates a composition swap chain when it isn't given an HWND,
+        // which requires dcomp.dll to be loaded already (see AtlasEngine::_createSwapChain).
+        _dcomp.reset(LoadLibraryExW(L"dcomp.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32));
+        return static_cast<bool>(_dcomp);
+    }
+
+    TEST_CLASS_CLEANUP(ClassCleanup)
+    {
+        _dcomp.reset();
+        return true;
+    }
+
+    // BackendSoftware is meant to be a drop-in replacement for BackendD3D. This renders the same frame with both
+    // (BackendD3D on WARP, so that it works without a GPU) and compares the results pixel by pixel.
+    // The text is allowed to differ slightly at the edges of glyphs, because BackendD3D applies the
+    // DirectWrite gamma and contrast adjustments in its shader. Backgrounds, the cursor and the selection
+    // are solid fills and need to be practically identical.
+    TEST_METHOD(SoftwareMatchesD3D)
+    {
+        til::size cellSize;
+        const auto d3d = _render(GraphicsAPI::Direct3D11, cellSize);
+        const auto software = _render(GraphicsAPI::Software, cellSize);
+
+        VERIFY_ARE_EQUAL(d3d.size(), software.size());
+        VERIFY_ARE_EQUAL(d3d.size(), static_cast<size_t>(columns * cellSize.width) * static_cast<size_t>(rows * cellSize.height));
+
+        const auto cellWidth = static_cast<size_t>(cellSize.width);
+        const auto cellHeight = static_cast<size_t>(cellSize.height);
+        const auto width = columns * cellWidth;
+        size_t textCells = 0;
+
+        for (til::CoordType row = 0; row < rows; ++row)
+        {
+            for (til::CoordType column = 0; column < columns; ++column)
+            {
+                const auto top = static_cast<size_t>(row) * cellHeight;
+                const auto left = static_cast<size_t>(column) * cellWidth;
+                // A cell is considered to contain text if it isn't a single solid color.
+                const auto corner = software[top * width + left] & 0xffffff;
+
+                int maxDelta = 0;
+                int sumDelta = 0;
+                bool hasText = false;
+
+                for (auto y = top; y < top + cellHeight; ++y)
+                {
+                    for (auto x = left; x < left + cellWidth; ++x)
+                    {
+                        const auto i = y * width + x;
+                        const auto delta = _channelDelta(d3d[i], software[i]);
+                        maxDelta = std::max(maxDelta, delta);
+                        sumDelta += delta;
+                        hasText |= (software[i] & 0xffffff) != corner;
+                    }
+                }
+
+                const auto averageDelta = sumDelta / gsl::narrow_cast<int>(cellWidth * cellHeight);
+                if (hasText)
+                {
+                    textCells++;
+                }
+
+                // The cell backgrounds, the cursor and the selection are compared strictly.
+                // Cells with glyphs get a tolerance for the differing antialiasing.
+                const auto limit = hasText ? 96 : 2;
+                if (maxDelta > limit || averageDelta > 8)
+                {
+                    VERIFY_FAIL(NoThrowString().Format(L"cell %d,%d differs: max delta %d, average delta %d", column, row, maxDelta, averageDelta));
+                }
+            }
+        }
+
+        // Guard against both backends rendering nothing at all.
+        VERIFY_IS_GREATER_THAN(textCells, size_t{ 0 });
+    }
+
+private:
+    wil::unique_hmodule _dcomp;
+
+    static int _channelDelta(const uint32_t a, const uint32_t b) noexcept
+    {
+        int delta = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            const auto ca = static_cast<int>((a >> shift) & 0xff);
+            const auto cb = static_cast<int>((b >> shift) & 0xff);
+            delta = std::max(delta, std::abs(ca - cb));
+        }
+        return delta;
+    }
+
+    // Paints the same frame as Renderer would for a buffer with two lines of text,
+    // a full-box cursor and a selection spanning text and empty cells.
+    static std::vector<uint32_t> _render(const GraphicsAPI graphicsAPI, til::size& cellSize)
+    {
+        RenderSettings renderSettings;
+        MockRenderData renderData;
+
+        AtlasEngine engine;
+        engine.SetGraphicsAPI(graphicsAPI);
+        engine.SetSoftwareRendering(true);
+        engine.SetAntialiasingMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+        engine.SetSelectionBackground(RGB(0x80, 0x80, 0xff));
+
+        FontInfoDesired fontInfoDesired{ L"Consolas", 0, FW_NORMAL, 12.0f, CP_UTF8 };
+        FontInfo fontInfo{ L"Consolas", 0, FW_NORMAL, { 0, 12 }, CP_UTF8 };
+        VERIFY_SUCCEEDED(engine.UpdateDpi(USER_DEFAULT_SCREEN_DPI));
+        VERIFY_SUCCEEDED(engine.UpdateFont(fontInfoDesired, fontInfo));
+        VERIFY_SUCCEEDED(engine.GetFontSize(&cellSize));
+        VERIFY_SUCCEEDED(engine.SetWindowSize({ columns * cellSize.width, rows * cellSize.height }));
+        VERIFY_SUCCEEDED(engine.UpdateViewport({ 0, 0, columns - 1, rows - 1 }));
+        VERIFY_SUCCEEDED(engine.UpdateDrawingBrushes({}, renderSettings, &renderData, false, true));
+
+        VERIFY_SUCCEEDED(engine.StartPaint());
+        VERIFY_SUCCEEDED(engine.PaintBackground());
+
+        const std::array<std::wstring_view, rows> lines{ L"Hello, World!", L"$ echo 0123456789", L"", L"" };
+        const std::array<TextAttribute, rows> attributes{
+            TextAttribute{},
+            TextAttribute{ FOREGROUND_GREEN | FOREGROUND_INTENSITY | BACKGROUND_BLUE },
+            TextAttribute{},
+            TextAttribute{},
+        };
+
+        for (til::CoordType y = 0; y < rows; ++y)
+        {
+            const auto line = lines.at(y);
+            const auto& attr = attributes.at(y);
+
+            std::vector<Cluster> clusters;
+            for (til::CoordType x = 0; x < columns; ++x)
+            {
+                const auto text = static_cast<size_t>(x) < line.size() ? line.substr(x, 1) : std::wstring_view{ L" " };
+                clusters.emplace_back(text, 1);
+            }
+
+            VERIFY_SUCCEEDED(engine.PrepareLineTransform(LineRendition::SingleWidth, y, 0));
+            VERIFY_SUCCEEDED(engine.UpdateDrawingBrushes(attr, renderSettings, &renderData, false, false));
+            VERIFY_SUCCEEDED(engine.PaintBufferLine(clusters, { 0, y }, false, false));
+        }
+
+        VERIFY_SUCCEEDED(engine.PaintSelection({ 2, 0, 5, 1 }));
+        VERIFY_SUCCEEDED(engine.PaintSelection({ 4, 3, 12, 4 }));
+
+        CursorOptions cursorOptions{};
+        cursorOptions.coordCursor = { 6, 2 };
+        cursorOptions.ulCursorHeightPercent = 100;
+        cursorOptions.cursorPixelWidth = 1;
+        cursorOptions.cursorType = CursorType::FullBox;
+        cursorOptions.isVisible = true;
+        cursorOptions.isOn = true;
+        cursorOptions.inViewport = true;
+        VERIFY_SUCCEEDED(engine.PaintCursor(cursorOptions));
+
+        VERIFY_SUCCEEDED(engine.EndPaint());
+
+        std::vector<uint32_t> pixels;
+        VERIFY_SUCCEEDED(engine._renderForTests(pixels));
+        return pixels;
+    }
+};
@@ -0,0 +1,109 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include <wextestclass.h>
+#include "../../../inc/consoletaeftemplates.hpp"
+
+#include "../BuiltinGlyphs.h"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Render::Atlas;
+
+static constexpr u16 maxCellSize = 64;
+
+class BuiltinGlyphsTests
+{
+    TEST_CLASS(BuiltinGlyphsTests);
+
+    // GetRectangles() is only useful if its result paints exactly the same pixels as the (overlapping)
+    // shapes of the instruction list do. This rasterizes both into a per-pixel shade map and compares them.
+    TEST_METHOD(RectanglesMatchShapes)
+    {
+        // Each pixel is either 0 (not painted) or 1 + the shade index of the rectangle that painted it.
+        u8 expected[maxCellSize * maxCellSize];
+        u8 actual[maxCellSize * maxCellSize];
+        size_t glyphsWithRectangles = 0;
+
+        const auto verifyGlyph = [&](char32_t codepoint, u16 w, u16 h) {
+            BuiltinGlyphs::Rect shapes[BuiltinGlyphs::MaxShapeCount];
+            BuiltinGlyphs::Rect rectangles[BuiltinGlyphs::MaxRectangleCount];
+            const auto shapeCount = BuiltinGlyphs::GetShapes(codepoint, { w, h }, shapes);
+            const auto count = BuiltinGlyphs::GetRectangles(codepoint, { w, h }, rectangles);
+
+            // A return value of 0 means that the glyph must be drawn with Direct2D instead.
+            if (count == 0)
+            {
+                return;
+            }
+            glyphsWithRectangles++;
+
+            memset(&expected[0], 0, w * h);
+            memset(&actual[0], 0, w * h);
+
+            // The later shapes paint over the earlier ones.
+            for (size_t i = 0; i < shapeCount; ++i)
+            {
+                const auto& r = shapes[i].rect;
+                for (auto y = r.top; y < r.bottom; ++y)
+                {
+                    memset(&expected[y * w + r.left], shapes[i].shade + 1, r.right - r.left);
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto& r = rectangles[i].rect;
+                if (r.empty() || r.right > w || r.bottom > h)
+                {
+                    VERIFY_FAIL(NoThrowString().Format(L"U+%04X at %ux%u: rectangle %zu (%u,%u,%u,%u) is empty or outside of the cell", codepoint, w, h, i, r.left, r.top, r.right, r.bottom));
+                }
+
+                for (auto y = r.top; y < r.bottom; ++y)
+                {
+                    for (auto x = r.left; x < r.right; ++x)
+                    {
+                        auto& pixel = actual[y * w + x];
+                        if (pixel)
+                        {
+                            VERIFY_FAIL(NoThrowString().Format(L"U+%04X at %ux%u: rectangle %zu overlaps another one at %u,%u", codepoint, w, h, i, x, y));
+                        }
+                        pixel = rectangles[i].shade + 1;
+                    }
+                }
+            }
+
+            if (memcmp(&expected[0], &actual[0], w * h) != 0)
+            {
+                for (size_t i = 0; i < size_t{ w } * h; ++i)
+                {
+                    if (actual[i] != expected[i])
+                    {
+                        VERIFY_FAIL(NoThrowString().Format(L"U+%04X at %ux%u: pixel %zu,%zu has shade %d instead of %d", codepoint, w, h, i % w, i / w, actual[i] - 1, expected[i] - 1));
+                    }
+                }
+            }
+        };
+
+        for (u16 h = 1; h <= maxCellSize; ++h)
+        {
+            for (u16 w = 1; w <= maxCellSize; ++w)
+            {
+                for (u32 i = 0; i < BuiltinGlyphs::BoxDrawing_CharCount; ++i)
+                {
+                    verifyGlyph(BuiltinGlyphs::BoxDrawing_FirstChar + i, w, h);
+                }
+                for (u32 i = 0; i < BuiltinGlyphs::Powerline_CharCount; ++i)
+                {
+                    verifyGlyph(BuiltinGlyphs::Powerline_FirstChar + i, w, h);
+                }
+            }
+        }
+
+        // Most box-drawing characters are made up of lines and blocks, which GetRectangles() must not give up on.
+        VERIFY_IS_GREATER_THAN(glyphsWithRectangles, size_t{ BuiltinGlyphs::BoxDrawing_CharCount } * maxCellSize * maxCellSize / 2);
+    }
+};
@@ -86,6 +86,14 @@ void RenderEngineBase::UpdateHyperlinkHoveredId(const uint16_t /*hoveredId*/) no
 {
 }
 
+// Method Description:
+// - Adds the engine specific parts of the statistics of the last frame to `stats`.
+// - The default implementation is to do nothing, as most engines have
+//   no phases worth measuring beyond what the Renderer already measures.
+void RenderEngineBase::CollectFrameStats(RenderFrameStats& /*stats*/) noexcept
+{
+}
+
 // Routine Description:
 // - Notifies us that we're about to circle the buffer, giving us a chance to
 //   force a repaint before the buffer contents are lost.
@@ -112,10 +112,16 @@ IRenderData* Renderer::GetRenderData() const noexcept
 
 [[nodiscard]] HRESULT Renderer::_PaintFrame() noexcept
 {
+    _frameStats = {};
+    _framePainted = false;
+
     {
+        RenderStopwatch lockStopwatch;
         _pData->LockConsole();
+        _frameStats.lockWait = lockStopwatch.lap();
         auto unlock = wil::scope_exit([&]() {
             _pData->UnlockConsole();
+            _frameStats.lock = lockStopwatch.lap();
         });
 
         // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
@@ -129,18 +135,24 @@ IRenderData* Renderer::GetRenderData() const noexcept
 
         _invalidateCurrentCursor(); // Invalidate the new cursor position.
         _prepareNewComposition();
+        _prepareStatsOverlay();
 
+        const RenderStopwatch bufferWalkStopwatch;
         FOREACH_ENGINE(pEngine)
         {
             RETURN_IF_FAILED(_PaintFrameForEngine(pEngine));
         }
+        _frameStats.bufferWalk = bufferWalkStopwatch.elapsed();
     }
 
+    const RenderStopwatch presentStopwatch;
     FOREACH_ENGINE(pEngine)
     {
         RETURN_IF_FAILED(pEngine->Present());
     }
+    _frameStats.present = presentStopwatch.elapsed();
 
+    _publishFrameStats();
     return S_OK;
 }
 
@@ -161,6 +173,8 @@ try
         return S_OK;
     }
 
+    _framePainted = true;
+
     auto endPaint = wil::scope_exit([&]() {
         LOG_IF_FAILED(pEngine->EndPaint());
 
@@ -188,6 +202,9 @@ try
     // 2. Paint Rows of Text
     _PaintBufferOutput(pEngine);
 
+    // 3. Paint the stats overlay on top of the text
+    _PaintStatsOverlay(pEngine);
+
     // 4. Paint Selection
     _PaintSelection(pEngine);
 
@@ -729,9 +746,15 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
     std::span<const til::rect> dirtyAreas;
     LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
 
+    // The stats overlay covers the right end of the first row. There's no point in painting the text below it.
+    const auto overlayColumns = pEngine == _statsOverlayEngine ? std::min(gsl::narrow_cast<til::CoordType>(_statsOverlayText.size()), view.Width()) : 0;
+    til::CoordType dirtyRows = 0;
+
     // This is to make sure any transforms are reset when this paint is finished.
     auto resetLineTransform = wil::scope_exit([&]() {
         LOG_IF_FAILED(pEngine->ResetLineTransform());
+        // With multiple engines (e.g. a display and UIA), report the one that repainted the most.
+        _frameStats.dirtyRows = std::max(_frameStats.dirtyRows, gsl::narrow_cast<uint32_t>(dirtyRows));
     });
 
     for (const auto& dirtyRect : dirtyAreas)
@@ -754,12 +777,21 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
 
         // Retrieve the text buffer so we can read information out of it.
         auto& buffer = _pData->GetTextBuffer();
+        dirtyRows += redraw.Height();
         // Now walk through each row of text that we need to redraw.
         for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
         {
             // Calculate the boundaries of a single line. This is from the left to right edge of the dirty
             // area in width and exactly 1 tall.
-            const auto screenLine = til::inclusive_rect{ redraw.Left(), row, redraw.RightInclusive(), row };
+            auto screenLine = til::inclusive_rect{ redraw.Left(), row, redraw.RightInclusive(), row };
+            if (row == view.Top() && overlayColumns > 0)
+            {
+                screenLine.right = std::min(screenLine.right, view.RightExclusive() - overlayColumns - 1);
+                if (screenLine.right < screenLine.left)
+                {
+                    continue;
+                }
+            }
             const auto& r = buffer.GetRowByOffset(row);
 
             // Draw the active composition.
@@ -1404,6 +1436,8 @@ std::vector<til::rect> Renderer::_GetSelectionRects() const
 //   as the previously selected area. If the whole viewport scrolls,
 //   we need to scroll these areas also to ensure they're invalidated
 //   properly when the selection further changes.
+// - The same applies to the stats overlay, which the engines scroll along
+//   with the text, even though it's anchored to the viewport.
 // Arguments:
 // - delta - The scroll delta
 // Return Value:
@@ -1418,6 +1452,7 @@ void Renderer::_ScrollPreviousSelection(const til::point delta)
         }
 
         _currentCursorOptions.coordCursor += delta;
+        _statsOverlayRect += delta;
     }
 }
 
@@ -1451,6 +1486,12 @@ void Renderer::RemoveRenderEngine(_In_ IRenderEngine* const pEngine)
 {
     THROW_HR_IF_NULL(E_INVALIDARG, pEngine);
 
+    if (_statsOverlayEngine == pEngine)
+    {
+        _statsOverlayEngine = nullptr;
+        _statsOverlayRect = {};
+    }
+
     for (auto& p : _engines)
     {
         if (p == pEngine)
@@ -1517,6 +1558,135 @@ void Renderer::UpdateLastHoveredInterval(const std::optional<PointTree::interval
     _hoveredInterval = newInterval;
 }
 
+// Method Description:
+// - Returns the timings and counters of the most recent frame and the totals of all frames so far.
+// - Unlike most other Renderer methods, this may be called from any thread without holding the console lock.
+RenderStats Renderer::GetStats() const noexcept
+{
+    return *_stats.lock_shared();
+}
+
+// Method Description:
+// - Shows the statistics of the previous frame in the top right corner of the viewport.
+// - Only the given engine draws the overlay, because drawing it into e.g. a VT or UIA engine makes no sense.
+// - This must be called with the console lock held.
+// Arguments:
+// - pEngine: The engine that should draw the overlay, or nullptr to hide it.
+void Renderer::SetStatsOverlay(IRenderEngine* const pEngine)
+{
+    if (_statsOverlayEngine != pEngine)
+    {
+        _statsOverlayEngine = pEngine;
+        _statsOverlayText.clear();
+        _statsOverlayRect = {};
+        TriggerRedrawAll();
+    }
+}
+
+// Routine Description:
+// - Formats the statistics of the previous frame for the stats overlay and invalidates the first row so that it gets repainted.
+// - If the viewport scrolled since, the engine scrolled the previous overlay along with the text. That copy is invalidated as well.
+// - This doesn't request a new frame on its own, so the overlay only refreshes when something else
+//   gets painted anyway. Otherwise, it would cause the terminal to redraw continuously.
+void Renderer::_prepareStatsOverlay() noexcept
+try
+{
+    if (!_statsOverlayEngine)
+    {
+        return;
+    }
+
+    static constexpr auto ms = [](RenderFrameStats::duration d) noexcept {
+        return std::chrono::duration<float, std::milli>{ d }.count();
+    };
+
+    const auto stats = _stats.lock_shared()->lastFrame;
+    _statsOverlayText.clear();
+    fmt::format_to(
+        std::back_inserter(_statsOverlayText),
+        FMT_COMPILE(L" lock {:.2f} (wait {:.2f}) walk {:.2f} shape {:.2f} ({}/{} cached) | present {:.2f} draw {:.2f} atlas {:.2f} ms | {} rows {} misses {} resets "),
+        ms(stats.lock),
+        ms(stats.lockWait),
+        ms(stats.bufferWalk),
+        ms(stats.shaping),
+        stats.shapingCacheHits,
+        stats.shapingCacheHits + stats.shapingCacheMisses,
+        ms(stats.present),
+        ms(stats.draw),
+        ms(stats.atlasUpload),
+        stats.dirtyRows,
+        stats.glyphCacheMisses,
+        stats.atlasResets);
+
+    const til::rect viewport{ _pData->GetViewport().Dimensions() };
+    const til::rect firstRow{ 0, 0, viewport.right, 1 };
+    LOG_IF_FAILED(_statsOverlayEngine->Invalidate(&firstRow));
+
+    if (const auto scrolled = _statsOverlayRect & viewport; scrolled && scrolled.top != 0)
+    {
+        LOG_IF_FAILED(_statsOverlayEngine->Invalidate(&scrolled));
+    }
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Paints the text prepared by _prepareStatsOverlay() right-aligned into the first row of the viewport.
+//   _PaintBufferOutput() leaves that area empty for us.
+// Arguments:
+// - pEngine - The render engine that we're targeting.
+void Renderer::_PaintStatsOverlay(_In_ IRenderEngine* const pEngine) noexcept
+try
+{
+    if (pEngine != _statsOverlayEngine)
+    {
+        return;
+    }
+
+    const auto view = _pData->GetViewport();
+    const auto columns = std::min(gsl::narrow_cast<til::CoordType>(_statsOverlayText.size()), view.Width());
+    if (columns <= 0)
+    {
+        return;
+    }
+
+    _clusterBuffer.clear();
+    for (const auto& ch : std::wstring_view{ _statsOverlayText }.substr(0, columns))
+    {
+        _clusterBuffer.emplace_back(std::wstring_view{ &ch, 1 }, 1);
+    }
+
+    TextAttribute attr;
+    attr.SetReverseVideo(true);
+    LOG_IF_FAILED(_UpdateDrawingBrushes(pEngine, attr, false, false));
+    LOG_IF_FAILED(pEngine->PrepareLineTransform(LineRendition::SingleWidth, 0, view.Left()));
+    LOG_IF_FAILED(pEngine->PaintBufferLine(_clusterBuffer, { view.RightExclusive() - columns, 0 }, false, false));
+    LOG_IF_FAILED(pEngine->ResetLineTransform());
+
+    _statsOverlayRect = { view.Width() - columns, 0, view.Width(), 1 };
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Completes the statistics of the current frame with the engines' share and makes them available via GetStats().
+void Renderer::_publishFrameStats() noexcept
+{
+    // Frames where no engine had anything to paint would only dilute the averages.
+    if (!_framePainted)
+    {
+        return;
+    }
+
+    FOREACH_ENGINE(pEngine)
+    {
+        pEngine->CollectFrameStats(_frameStats);
+    }
+
+    const auto stats = _stats.lock();
+    stats->frameCount++;
+    stats->lastFrame = _frameStats;
+    stats->total += _frameStats;
+}
+
 // Method Description:
 // - Blocks until the engines are able to render without blocking.
 void Renderer::WaitUntilCanRender()
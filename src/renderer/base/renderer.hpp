@@ -21,6 +21,8 @@ Author(s):
 
 #include "thread.hpp"
 
+#include <til/mutex.h>
+
 #include "../../buffer/out/textBuffer.hpp"
 
 // fwdecl unittest classes
@@ -94,6 +96,9 @@ namespace Microsoft::Console::Render
         void UpdateHyperlinkHoveredId(uint16_t id) noexcept;
         void UpdateLastHoveredInterval(const std::optional<interval_tree::IntervalTree<til::point, size_t>::interval>& newInterval);
 
+        RenderStats GetStats() const noexcept;
+        void SetStatsOverlay(IRenderEngine* const pEngine);
+
     private:
         // Caches some essential information about the active composition.
         // This allows us to properly invalidate it between frames, etc.
@@ -127,6 +132,9 @@ namespace Microsoft::Console::Render
         void _invalidateOldComposition() const;
         void _prepareNewComposition();
         [[nodiscard]] HRESULT _PrepareRenderInfo(_In_ IRenderEngine* const pEngine);
+        void _prepareStatsOverlay() noexcept;
+        void _PaintStatsOverlay(_In_ IRenderEngine* const pEngine) noexcept;
+        void _publishFrameStats() noexcept;
 
         const RenderSettings& _renderSettings;
         std::array<IRenderEngine*, 2> _engines{};
@@ -144,8 +152,14 @@ namespace Microsoft::Console::Render
         std::function<void()> _pfnBackgroundColorChanged;
         std::function<void()> _pfnFrameColorChanged;
         std::function<void()> _pfnRendererEnteredErrorState;
+        til::shared_mutex<RenderStats> _stats;
+        RenderFrameStats _frameStats;
+        IRenderEngine* _statsOverlayEngine = nullptr; // Non-ownership pointer
+        std::wstring _statsOverlayText;
+        til::rect _statsOverlayRect; // Where the overlay was last painted, relative to the viewport (see _ScrollPreviousSelection).
         bool _destructing = false;
         bool _forceUpdateViewport = false;
+        bool _framePainted = false;
 
 #ifdef UNIT_TESTING
         friend class ConptyOutputTests;
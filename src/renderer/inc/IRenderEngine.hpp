@@ -20,6 +20,7 @@ Author(s):
 #include "Cluster.hpp"
 #include "FontInfoDesired.hpp"
 #include "IRenderData.hpp"
+#include "RenderStats.hpp"
 #include "RenderSettings.hpp"
 #include "../../buffer/out/LineRendition.hpp"
 
@@ -92,6 +93,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] virtual HRESULT IsGlyphWideByFont(std::wstring_view glyph, _Out_ bool* pResult) noexcept = 0;
         [[nodiscard]] virtual HRESULT UpdateTitle(std::wstring_view newTitle) noexcept = 0;
         virtual void UpdateHyperlinkHoveredId(const uint16_t hoveredId) noexcept = 0;
+        virtual void CollectFrameStats(RenderFrameStats& stats) noexcept = 0;
     };
 }
 #pragma warning(pop)
@@ -48,6 +48,7 @@ namespace Microsoft::Console::Render
 
         void WaitUntilCanRender() noexcept override;
         void UpdateHyperlinkHoveredId(const uint16_t hoveredId) noexcept override;
+        void CollectFrameStats(RenderFrameStats& stats) noexcept override;
 
     protected:
         [[nodiscard]] virtual HRESULT _DoUpdateTitle(const std::wstring_view newTitle) noexcept = 0;
@@ -0,0 +1,97 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RenderStats.hpp
+
+Abstract:
+- Timings and counters describing where the time of a frame went.
+- The Renderer measures the engine-agnostic phases (console lock, buffer walk, present)
+  and every engine adds its own via IRenderEngine::CollectFrameStats().
+- This is always on and cheap enough to be so: A handful of steady_clock::now()
+  calls (= QueryPerformanceCounter) per frame and a few counter increments.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Render
+{
+    struct RenderFrameStats
+    {
+        using duration = std::chrono::steady_clock::duration;
+
+        // Renderer: Time spent waiting to acquire the console lock.
+        duration lockWait{};
+        // Renderer: Time spent holding the console lock. Includes bufferWalk.
+        duration lock{};
+        // Renderer: Time spent translating the text buffer into IRenderEngine calls. Includes shaping.
+        duration bufferWalk{};
+        // Engine: Time spent turning text into glyphs.
+        duration shaping{};
+        // Engine: Time spent rasterizing glyphs into the glyph atlas. Includes the upload to the GPU, if any.
+        duration atlasUpload{};
+        // Engine: Time spent turning the frame into pixels. Includes atlasUpload.
+        duration draw{};
+        // Renderer: Time spent in IRenderEngine::Present(), outside the console lock.
+        // Engines that draw during Present() (like AtlasEngine) include draw in this.
+        duration present{};
+
+        // Renderer: Number of viewport rows that were repainted.
+        uint32_t dirtyRows = 0;
+        // Engine: Number of text runs whose glyphs were reused from the shaping cache.
+        uint32_t shapingCacheHits = 0;
+        // Engine: Number of text runs that weren't cached yet and had to be shaped.
+        uint32_t shapingCacheMisses = 0;
+        // Engine: Number of glyphs that weren't cached yet and had to be rasterized.
+        uint32_t glyphCacheMisses = 0;
+        // Engine: Number of times (parts of) the glyph atlas had to be cleared to make room.
+        uint32_t atlasResets = 0;
+
+        RenderFrameStats& operator+=(const RenderFrameStats& other) noexcept
+        {
+            lockWait += other.lockWait;
+            lock += other.lock;
+            bufferWalk += other.bufferWalk;
+            shaping += other.shaping;
+            atlasUpload += other.atlasUpload;
+            draw += other.draw;
+            present += other.present;
+            dirtyRows += other.dirtyRows;
+            shapingCacheHits += other.shapingCacheHits;
+            shapingCacheMisses += other.shapingCacheMisses;
+            glyphCacheMisses += other.glyphCacheMisses;
+            atlasResets += other.atlasResets;
+            return *this;
+        }
+    };
+
+    struct RenderStats
+    {
+        // Number of frames painted since the Renderer was created.
+        uint64_t frameCount = 0;
+        // The most recently painted frame.
+        RenderFrameStats lastFrame;
+        // The sum of all frames. Divide it by frameCount to get the average.
+        RenderFrameStats total;
+    };
+
+    // Measures the time since its construction or the last call to lap().
+    class RenderStopwatch
+    {
+    public:
+        RenderFrameStats::duration elapsed() const noexcept
+        {
+            return std::chrono::steady_clock::now() - _start;
+        }
+
+        RenderFrameStats::duration lap() noexcept
+        {
+            const auto now = std::chrono::steady_clock::now();
+            return now - std::exchange(_start, now);
+        }
+
+    private:
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+    };
+}
@@ -28,6 +28,33 @@ public:
                                          _Out_ CONSOLE_API_MSG* const pMessage) const = 0;
     [[nodiscard]] virtual HRESULT CompleteIo(_In_ CD_IO_COMPLETE* const pCompletion) const = 0;
 
+    // Completes the given replies and reads up to messages.size() pending messages, returning how many were read.
+    // Transports that can return multiple messages per round trip should override this. The replies may point
+    // into `messages`, which is why all of them must be completed before the first message is overwritten.
+    // ConDrv only ever returns a single message, which is what this default implementation does.
+    [[nodiscard]] virtual HRESULT ReadIoBatch(const std::span<const PCONSOLE_API_MSG> replies,
+                                              const std::span<CONSOLE_API_MSG> messages,
+                                              _Out_ size_t* const pRead) const
+    {
+        *pRead = 0;
+        RETURN_HR_IF(E_INVALIDARG, messages.empty());
+
+        // ReadIo() can only complete a single reply, so any others need to be completed separately.
+        PCONSOLE_API_MSG lastReply = nullptr;
+        if (!replies.empty())
+        {
+            for (const auto reply : replies.first(replies.size() - 1))
+            {
+                LOG_IF_FAILED(CompleteIo(&reply->Complete));
+            }
+            lastReply = replies.back();
+        }
+
+        RETURN_IF_FAILED(ReadIo(lastReply, messages.data()));
+        *pRead = 1;
+        return S_OK;
+    }
+
     [[nodiscard]] virtual HRESULT ReadInput(_In_ CD_IO_OPERATION* const pIoOperation) const = 0;
     [[nodiscard]] virtual HRESULT WriteOutput(_In_ CD_IO_OPERATION* const pIoOperation) const = 0;
 
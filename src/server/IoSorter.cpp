@@ -7,12 +7,15 @@
 
 #include "IoDispatchers.h"
 #include "ApiDispatchers.h"
+#include "OutputWorker.h"
+#include "ProcessHandle.h"
 
 #include "ApiSorter.h"
 
 #include "../host/globals.h"
 
 #include "../host/getset.h"
+#include "../host/handle.h"
 #include "../host/stream.h"
 
 void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
@@ -98,3 +101,103 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
         *ReplyMsg = pMsg;
     }
 }
+
+// Routine Description:
+// - Services messages that were read from the driver in a single batch.
+// - API calls and raw reads/writes are dispatched under a single acquisition of the console lock.
+//   The lock is recursive, so the APIs taking it again don't contend with the renderer or input threads.
+// - Connects, disconnects and object creation/destruction run outside of it, just like they do
+//   in ServiceIoOperation(), since they may create windows, hand off the session or exit the process.
+// - If an output worker is given, writes are handed off to it instead. So are all other API calls of a process
+//   whose writes are still in flight, which keeps them in order. Connects, disconnects and object creation/destruction
+//   of such a process aren't handed off, but wait until the worker has caught up with the process instead.
+// Arguments:
+// - messages - The messages to service.
+// - replies - Receives the messages to be completed (those that didn't pend).
+// - pOutputWorker - Optionally, the worker to hand off writes to.
+void IoSorter::ServiceIoBatch(const std::span<CONSOLE_API_MSG> messages,
+                              std::vector<PCONSOLE_API_MSG>& replies,
+                              OutputWorker* const pOutputWorker)
+{
+    // A batch of one doesn't benefit from holding the lock across it.
+    const auto canBatch = messages.size() > 1;
+    auto locked = false;
+
+    for (auto& message : messages)
+    {
+        const auto function = message.Descriptor.Function;
+        const auto isApiCall = function == CONSOLE_IO_USER_DEFINED ||
+                               function == CONSOLE_IO_RAW_WRITE ||
+                               function == CONSOLE_IO_RAW_READ ||
+                               function == CONSOLE_IO_RAW_FLUSH;
+        // Connection requests are the only messages that don't have a process handle yet.
+        const auto pProcess = pOutputWorker && function != CONSOLE_IO_CONNECT ? message.GetProcessHandle() : nullptr;
+
+        if (pProcess && isApiCall && (OutputWorker::s_IsOutputWrite(message) || pOutputWorker->IsBusy(*pProcess)))
+        {
+            // Submit() blocks if the worker's queue is full and the worker can't drain it without the lock.
+            if (locked)
+            {
+                UnlockConsole();
+                locked = false;
+            }
+            pOutputWorker->Submit(message);
+            continue;
+        }
+
+        const auto batched = canBatch && isApiCall;
+
+        if (batched != locked)
+        {
+            // UnlockConsole() also processes any control events that were queued up while we held the lock.
+            batched ? LockConsole() : UnlockConsole();
+            locked = batched;
+        }
+
+        if (pProcess && !isApiCall)
+        {
+            // This is where the lock isn't held, which the worker needs to catch up.
+            pOutputWorker->WaitForProcess(*pProcess);
+        }
+
+        PCONSOLE_API_MSG reply = nullptr;
+        ServiceIoOperation(&message, &reply);
+        if (reply)
+        {
+            replies.emplace_back(reply);
+        }
+    }
+
+    if (locked)
+    {
+        UnlockConsole();
+    }
+}
+
+// Routine Description:
+// - Completes the replies of the previous batch, reads the next batch of messages and services them.
+// Arguments:
+// - deviceComm - The transport to read messages from.
+// - messages - The storage for the read messages. Its size is the maximum batch size.
+// - replies - The replies of the previous batch. Receives the replies of the new one.
+// - pOutputWorker - Optionally, the worker to hand off writes to. See ServiceIoBatch().
+// Return Value:
+// - The failure returned by the transport, in which case no messages were serviced.
+[[nodiscard]] HRESULT IoSorter::ServiceNextIoBatch(const IDeviceComm& deviceComm,
+                                                   const std::span<CONSOLE_API_MSG> messages,
+                                                   std::vector<PCONSOLE_API_MSG>& replies,
+                                                   OutputWorker* const pOutputWorker)
+{
+    for (const auto reply : replies)
+    {
+        LOG_IF_FAILED(reply->ReleaseMessageBuffers());
+    }
+
+    size_t read = 0;
+    const auto hr = deviceComm.ReadIoBatch(replies, messages, &read);
+    replies.clear();
+    RETURN_IF_FAILED_EXPECTED(hr);
+
+    ServiceIoBatch(messages.first(read), replies, pOutputWorker);
+    return S_OK;
+}
@@ -18,6 +18,9 @@ Revision History:
 #pragma once
 
 #include "ApiMessage.h"
+#include "DeviceComm.h"
+
+class OutputWorker;
 
 class IoSorter
 {
@@ -25,4 +28,13 @@ public:
     // TODO: MSFT: 9115192 - probably not void.
     static void ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
                                    _Out_ CONSOLE_API_MSG** ReplyMsg);
+
+    static void ServiceIoBatch(const std::span<CONSOLE_API_MSG> messages,
+                               std::vector<PCONSOLE_API_MSG>& replies,
+                               OutputWorker* const pOutputWorker = nullptr);
+
+    [[nodiscard]] static HRESULT ServiceNextIoBatch(const IDeviceComm& deviceComm,
+                                                    const std::span<CONSOLE_API_MSG> messages,
+                                                    std::vector<PCONSOLE_API_MSG>& replies,
+                                                    OutputWorker* const pOutputWorker = nullptr);
 };
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "OutputWorker.h"
+
+#include "ApiSorter.h"
+#include "IoSorter.h"
+#include "ProcessHandle.h"
+
+#include <til/atomic.h>
+
+// Routine Description:
+// - Creates the worker and starts its thread.
+// Arguments:
+// - capacity - The maximum number of messages that may be queued up. Submit() blocks once it's reached.
+OutputWorker::OutputWorker(const uint32_t capacity) :
+    _channel{ til::spsc::channel<Item>(capacity) },
+    _thread{ THROW_LAST_ERROR_IF_NULL(CreateThread(nullptr, 0, s_ThreadProc, this, 0, nullptr)) }
+{
+    LOG_IF_FAILED(SetThreadDescription(_thread.get(), L"Console Output Thread"));
+}
+
+// Routine Description:
+// - Services the remaining messages and waits for the worker thread to exit.
+OutputWorker::~OutputWorker()
+{
+    // Dropping the producer makes the consumer return std::nullopt once the queue is empty.
+    _channel.first = til::spsc::producer<Item>{ nullptr };
+    WaitForSingleObject(_thread.get(), INFINITE);
+}
+
+// Routine Description:
+// - Returns true for the messages that write output: WriteConsole and raw writes (WriteFile).
+bool OutputWorker::s_IsOutputWrite(const CONSOLE_API_MSG& message) noexcept
+{
+    switch (message.Descriptor.Function)
+    {
+    case CONSOLE_IO_RAW_WRITE:
+        return true;
+    case CONSOLE_IO_USER_DEFINED:
+        return message.msgHeader.ApiNumber == API_NUMBER_WRITECONSOLE;
+    default:
+        return false;
+    }
+}
+
+// Routine Description:
+// - Queues a copy of the message to be serviced and completed by the worker thread.
+// - The message is serviced after all previously submitted ones, which is what keeps the API calls
+//   of a process in order, if they're submitted while output of the process is still in flight.
+// - Blocks if the queue is full. The console lock must not be held, as the worker needs it to make progress.
+// Arguments:
+// - message - The message to service. It must not have been serviced yet.
+void OutputWorker::Submit(const CONSOLE_API_MSG& message)
+{
+    auto item = std::make_unique<CONSOLE_API_MSG>(message);
+    const auto pProcess = message.GetProcessHandle();
+    FAIL_FAST_IF_NULL(pProcess);
+
+    pProcess->outputSequence = ++_submitted;
+    _channel.first.emplace(std::move(item));
+}
+
+// Routine Description:
+// - Returns true if messages of the given process are still waiting to be serviced by the worker.
+bool OutputWorker::IsBusy(const ConsoleProcessHandle& process) const noexcept
+{
+    return process.outputSequence > _completed.load(std::memory_order_acquire);
+}
+
+// Routine Description:
+// - Blocks until the worker has serviced all messages that were submitted for the given process.
+// - The console lock must not be held, as the worker needs it to make progress.
+void OutputWorker::WaitForProcess(const ConsoleProcessHandle& process) const noexcept
+{
+    for (auto completed = _completed.load(std::memory_order_acquire); completed < process.outputSequence; completed = _completed.load(std::memory_order_acquire))
+    {
+        til::atomic_wait(_completed, completed);
+    }
+}
+
+DWORD WINAPI OutputWorker::s_ThreadProc(_In_ LPVOID lpParameter) noexcept
+{
+    static_cast<OutputWorker*>(lpParameter)->_Run();
+    return 0;
+}
+
+// Routine Description:
+// - The worker thread's loop. It services the submitted messages one at a time.
+// - The console lock isn't held across a message. Reading the client's text happens without it and
+//   WriteConsole only takes it for one slice of the text at a time (see DoWriteConsole()). In between,
+//   the IO thread can service other clients and the renderer and input threads get their turn.
+void OutputWorker::_Run() noexcept
+{
+    while (const auto item = _channel.second.pop())
+    {
+        const auto pMessage = item->get();
+        PCONSOLE_API_MSG reply = nullptr;
+
+        IoSorter::ServiceIoOperation(pMessage, &reply);
+
+        if (reply)
+        {
+            LOG_IF_FAILED(reply->ReleaseMessageBuffers());
+            LOG_IF_FAILED(reply->_pDeviceComm->CompleteIo(&reply->Complete));
+        }
+
+        _completed.fetch_add(1, std::memory_order_release);
+        til::atomic_notify_all(_completed);
+    }
+}
@@ -0,0 +1,57 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- OutputWorker.h
+
+Abstract:
+- This file defines a worker thread that services output writes on behalf of the IO thread.
+- Parsing VT output can take a long time. Moving it off the IO thread allows the IO thread to keep servicing
+  the API calls of other clients in the meantime, instead of making them wait until the output is processed.
+--*/
+
+#pragma once
+
+#include "ApiMessage.h"
+
+#include <til/spsc.h>
+
+class ConsoleProcessHandle;
+
+class OutputWorker
+{
+public:
+    explicit OutputWorker(const uint32_t capacity);
+
+    ~OutputWorker();
+
+    OutputWorker(const OutputWorker&) = delete;
+    OutputWorker(OutputWorker&&) = delete;
+    OutputWorker& operator=(const OutputWorker&) & = delete;
+    OutputWorker& operator=(OutputWorker&&) & = delete;
+
+    static bool s_IsOutputWrite(const CONSOLE_API_MSG& message) noexcept;
+
+    void Submit(const CONSOLE_API_MSG& message);
+
+    bool IsBusy(const ConsoleProcessHandle& process) const noexcept;
+    void WaitForProcess(const ConsoleProcessHandle& process) const noexcept;
+
+private:
+    static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter) noexcept;
+    void _Run() noexcept;
+
+    // Messages are copied onto the heap, because the IO thread reuses its message storage for the next batch.
+    using Item = std::unique_ptr<CONSOLE_API_MSG>;
+
+    std::pair<til::spsc::producer<Item>, til::spsc::consumer<Item>> _channel;
+
+    // The sequence number of the last submitted message. Only accessed by the IO thread.
+    uint64_t _submitted = 0;
+    // The sequence number of the last serviced message. The channel is a FIFO, so this is also the
+    // sequence number up to which all messages have been serviced. Written by the worker thread.
+    std::atomic<uint64_t> _completed{ 0 };
+
+    wil::unique_handle _thread;
+};
@@ -46,6 +46,10 @@ public:
     DWORD const dwProcessId;
     DWORD const dwThreadId;
 
+    // The sequence number of the last message of this process that was handed to the OutputWorker.
+    // It's only accessed by the IO thread.
+    uint64_t outputSequence = 0;
+
     const ConsoleProcessPolicy GetPolicy() const;
     const ConsoleShimPolicy GetShimPolicy() const;
 
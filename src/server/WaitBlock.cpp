@@ -20,14 +20,17 @@
 // Arguments:
 // - pProcessQueue - The queue attached to the client process ID that requested this action
 // - pObjectQueue - The queue attached to the console object that will service the action when data arrives
+// - pObjectHandle - The handle to the console object that the client process issued the request on
 // - pWaitReplyMessage - The original API message related to the client process's service request
 // - pWaiter - The context to return to later when the wait is satisfied.
 ConsoleWaitBlock::ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
                                    _In_ ConsoleWaitQueue* const pObjectQueue,
+                                   const ConsoleHandleData* const pObjectHandle,
                                    const CONSOLE_API_MSG* const pWaitReplyMessage,
                                    _In_ IWaitRoutine* const pWaiter) :
     _pProcessQueue(THROW_HR_IF_NULL(E_INVALIDARG, pProcessQueue)),
     _pObjectQueue(THROW_HR_IF_NULL(E_INVALIDARG, pObjectQueue)),
+    _pObjectHandle(THROW_HR_IF_NULL(E_INVALIDARG, pObjectHandle)),
     _WaitReplyMessage(*pWaitReplyMessage),
     _pWaiter(THROW_HR_IF_NULL(E_INVALIDARG, pWaiter))
 {
@@ -72,6 +75,17 @@ ConsoleWaitBlock::~ConsoleWaitBlock()
 {
     _pProcessQueue->_blocks.erase(_itProcessQueue);
     _pObjectQueue->_blocks.erase(_itObjectQueue);
+
+    auto& blocksByHandle = _pObjectQueue->_blocksByHandle;
+    if (const auto it = blocksByHandle.find(_pObjectHandle); it != blocksByHandle.end())
+    {
+        it->second.erase(_itObjectHandleQueue);
+        if (it->second.empty())
+        {
+            blocksByHandle.erase(it);
+        }
+    }
+
     delete _pWaiter;
 }
 
@@ -98,20 +112,47 @@ ConsoleWaitBlock::~ConsoleWaitBlock()
     LOG_IF_FAILED(pHandleData->GetWaitQueue(&pObjectQueue));
     FAIL_FAST_IF_NULL(pObjectQueue);
 
-    ConsoleWaitBlock* pWaitBlock;
+    auto& blocksByHandle = pObjectQueue->_blocksByHandle;
+
     try
     {
-        pWaitBlock = new ConsoleWaitBlock(pProcessQueue,
-                                          pObjectQueue,
-                                          pWaitReplyMessage,
-                                          pWaiter);
+        // The wait block unlinks itself from all queues on destruction. Everything that may throw thus
+        // happens before it gets linked into any of them: The list nodes are allocated up front and
+        // spliced into the queues below, which can't fail, and the wait block itself is created last.
+        std::list<ConsoleWaitBlock*> processNode(1);
+        std::list<ConsoleWaitBlock*> objectNode(1);
+        std::list<ConsoleWaitBlock*> handleNode(1);
+        auto& handleBlocks = blocksByHandle[pHandleData];
+
+        const auto pWaitBlock = new ConsoleWaitBlock(pProcessQueue,
+                                                     pObjectQueue,
+                                                     pHandleData,
+                                                     pWaitReplyMessage,
+                                                     pWaiter);
 
         // Set the iterators on the wait block so that it can remove itself later.
-        pWaitBlock->_itProcessQueue = pProcessQueue->_blocks.insert(pProcessQueue->_blocks.end(), pWaitBlock);
-        pWaitBlock->_itObjectQueue = pObjectQueue->_blocks.insert(pObjectQueue->_blocks.end(), pWaitBlock);
+        processNode.front() = pWaitBlock;
+        objectNode.front() = pWaitBlock;
+        handleNode.front() = pWaitBlock;
+        pWaitBlock->_itProcessQueue = processNode.begin();
+        pWaitBlock->_itObjectQueue = objectNode.begin();
+        pWaitBlock->_itObjectHandleQueue = handleNode.begin();
+
+        pProcessQueue->_blocks.splice(pProcessQueue->_blocks.end(), processNode);
+        pObjectQueue->_blocks.splice(pObjectQueue->_blocks.end(), objectNode);
+        handleBlocks.splice(handleBlocks.end(), handleNode);
     }
     catch (...)
     {
+        // Nothing has been linked, but we may have left an empty list behind for the handle.
+        if (const auto it = blocksByHandle.find(pHandleData); it != blocksByHandle.end() && it->second.empty())
+        {
+            blocksByHandle.erase(it);
+        }
+
+        // The caller handed us the ownership of the waiter, which is normally passed on to the wait block.
+        delete pWaiter;
+
         const auto hr = wil::ResultFromCaughtException();
         pWaitReplyMessage->SetReplyStatus(NTSTATUS_FROM_HRESULT(hr));
         return hr;
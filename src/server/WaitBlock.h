@@ -24,6 +24,7 @@ Revision History:
 #include <list>
 
 class ConsoleWaitQueue;
+class ConsoleHandleData;
 
 class ConsoleWaitBlock
 {
@@ -38,6 +39,7 @@ public:
 private:
     ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
                      _In_ ConsoleWaitQueue* const pObjectQueue,
+                     const ConsoleHandleData* const pObjectHandle,
                      const CONSOLE_API_MSG* const pWaitReplyMessage,
                      _In_ IWaitRoutine* const pWaiter);
 
@@ -47,6 +49,9 @@ private:
     ConsoleWaitQueue* const _pObjectQueue;
     std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itObjectQueue;
 
+    const ConsoleHandleData* const _pObjectHandle;
+    std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itObjectHandleQueue;
+
     CONSOLE_API_MSG _WaitReplyMessage;
 
     IWaitRoutine* const _pWaiter;
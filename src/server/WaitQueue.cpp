@@ -7,12 +7,14 @@
 #include "WaitBlock.h"
 
 #include "../host/globals.h"
+#include "../host/handle.h"
 #include "../host/utils.hpp"
 
 // Routine Description:
 // - Instantiates a new ConsoleWaitQueue
 ConsoleWaitQueue::ConsoleWaitQueue() :
-    _blocks()
+    _blocks(),
+    _blocksByHandle()
 {
 }
 
@@ -48,6 +50,11 @@ ConsoleWaitQueue::~ConsoleWaitQueue()
     //
     // Therefore, I've inverted the queue management responsibility into the WaitBlock itself
     // and made it a friend to this WaitQueue class.
+    //
+    // The queues are shared with the output worker and the threads that notify them,
+    // which is why they're only ever modified while holding the console lock.
+    LockConsole();
+    const auto unlock = wil::scope_exit([] { UnlockConsole(); });
 
     return ConsoleWaitBlock::s_CreateWait(pWaitReplyMessage,
                                           pWaiter);
@@ -103,6 +110,46 @@ bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
     return fResult;
 }
 
+// Routine Description:
+// - Instructs this queue to attempt to callback the requests that were issued on the given object handle
+// - Requests waiting on other handles of the same object are left alone.
+// Arguments:
+// - fNotifyAll - If true, we will notify all items of the handle. If false, we will only notify the first item.
+// - TerminationReason - A reason/message to pass to each waiter signaling it should terminate appropriately.
+// - pHandleData - The object handle whose waiters should be notified.
+// Return Value:
+// - True if any block was successfully notified. False if no blocks were successful.
+bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
+                                     const WaitTerminationReason TerminationReason,
+                                     const ConsoleHandleData* const pHandleData)
+{
+    const auto it = _blocksByHandle.find(pHandleData);
+    if (it == _blocksByHandle.end())
+    {
+        return false;
+    }
+
+    // Successfully notified blocks remove themselves from the handle's list and the
+    // last one removes the list itself. That's why we need to iterate over a copy.
+    const std::vector<ConsoleWaitBlock*> blocks{ it->second.begin(), it->second.end() };
+    auto fResult = false;
+
+    for (const auto WaitBlock : blocks)
+    {
+        if (_NotifyBlock(WaitBlock, TerminationReason))
+        {
+            fResult = true;
+        }
+
+        if (!fNotifyAll)
+        {
+            break;
+        }
+    }
+
+    return fResult;
+}
+
 // Routine Description:
 // - A helper to delete successfully notified callbacks
 // Arguments:
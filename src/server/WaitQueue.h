@@ -18,6 +18,7 @@ Revision History:
 #pragma once
 
 #include <list>
+#include <unordered_map>
 
 #include "../host/conapi.h"
 
@@ -25,6 +26,8 @@ Revision History:
 #include "WaitBlock.h"
 #include "WaitTerminationReason.h"
 
+class ConsoleHandleData;
+
 class ConsoleWaitQueue
 {
 public:
@@ -37,6 +40,10 @@ public:
     bool NotifyWaiters(const bool fNotifyAll,
                        const WaitTerminationReason TerminationReason);
 
+    bool NotifyWaiters(const bool fNotifyAll,
+                       const WaitTerminationReason TerminationReason,
+                       const ConsoleHandleData* const pHandleData);
+
     [[nodiscard]] static HRESULT s_CreateWait(_Inout_ CONSOLE_API_MSG* const pWaitReplyMessage,
                                               _In_ IWaitRoutine* const pWaiter);
 
@@ -46,5 +53,9 @@ private:
 
     std::list<ConsoleWaitBlock*> _blocks;
 
+    // The blocks that this queue services as the object queue, grouped by the handle they were issued on.
+    // This allows us to notify the waiters of a single handle without walking past everyone else's.
+    std::unordered_map<const ConsoleHandleData*, std::list<ConsoleWaitBlock*>> _blocksByHandle;
+
     friend class ConsoleWaitBlock; // Blocks live in multiple queues so we let them manage the lifetime.
 };
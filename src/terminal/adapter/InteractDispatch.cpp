@@ -15,7 +15,6 @@
 #include "InteractDispatch.hpp"
 #include "../../host/conddkrefs.h"
 #include "../../interactivity/inc/ServiceLocator.hpp"
-#include "../../interactivity/inc/EventSynthesis.hpp"
 #include "../../types/inc/Viewport.hpp"
 
 using namespace Microsoft::Console::Interactivity;
@@ -67,15 +66,10 @@ bool InteractDispatch::WriteString(const std::wstring_view string)
 {
     if (!string.empty())
     {
-        const auto codepage = _api.GetConsoleOutputCP();
-        InputEventQueue keyEvents;
-
-        for (const auto& wch : string)
-        {
-            CharToKeyEvents(wch, codepage, keyEvents);
-        }
-
-        WriteInput(keyEvents);
+        // This is how pastes arrive from the terminal. The input buffer will synthesize
+        // key events for the text only if the client reads them with ReadConsoleInput().
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        gci.GetActiveInputBuffer()->WriteText(string, _api.GetConsoleOutputCP());
     }
     return true;
 }
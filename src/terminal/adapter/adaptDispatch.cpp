@@ -985,12 +985,23 @@ void AdaptDispatch::_ChangeRectAttributes(const Page& page, const til::rect& cha
 {
     if (changeRect)
     {
+        // The changes are applied to each run of attributes instead of each cell and the
+        // results are committed with a single replace_ranges() call per row. Rows written
+        // by applications that change their colors frequently can have hundreds of runs.
+        std::vector<til::rle_range<TextAttribute, uint16_t>> ranges;
+
         for (auto row = changeRect.top; row < changeRect.bottom; row++)
         {
-            auto& rowBuffer = page.Buffer().GetMutableRowByOffset(row);
-            for (auto col = changeRect.left; col < changeRect.right; col++)
+            auto& attributes = page.Buffer().GetMutableRowByOffset(row).Attributes();
+            const auto width = gsl::narrow_cast<til::CoordType>(attributes.size());
+            auto col = gsl::narrow_cast<uint16_t>(std::clamp(changeRect.left, 0, width));
+            const auto end = gsl::narrow_cast<uint16_t>(std::clamp(changeRect.right, 0, width));
+
+            const auto slice = attributes.slice(col, end);
+            ranges.clear();
+            for (const auto& run : slice.runs())
             {
-                auto attr = rowBuffer.GetAttrByColumn(col);
+                auto attr = run.value;
                 auto characterAttributes = attr.GetCharacterAttributes();
                 characterAttributes &= changeOps.andAttrMask;
                 characterAttributes ^= changeOps.xorAttrMask;
@@ -1007,8 +1018,10 @@ void AdaptDispatch::_ChangeRectAttributes(const Page& page, const til::rect& cha
                 {
                     attr.SetUnderlineColor(*changeOps.underlineColor);
                 }
-                rowBuffer.ReplaceAttributes(col, col + 1, attr);
+                ranges.push_back({ col, gsl::narrow_cast<uint16_t>(col + run.length), attr });
+                col = gsl::narrow_cast<uint16_t>(col + run.length);
             }
+            attributes.replace_ranges(ranges);
         }
         page.Buffer().TriggerRedraw(Viewport::FromExclusive(changeRect));
         _api.NotifyAccessibilityChange(changeRect);
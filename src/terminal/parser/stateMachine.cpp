@@ -2206,6 +2206,18 @@ bool StateMachine::IsProcessingLastCharacter() const noexcept
     return _processingLastCharacter;
 }
 
+// Routine Description:
+// - Determines whether the state machine is in the ground state, that is,
+//   it isn't in the middle of parsing an escape sequence or control string.
+// Arguments:
+// - <none>
+// Return Value:
+// - True if we're in the ground state. False if not.
+bool StateMachine::IsGround() const noexcept
+{
+    return _state == VTStates::Ground;
+}
+
 // Routine Description:
 // - Registers a function that will be called once the current CSI action is
 //   complete and the state machine has returned to the ground state.
@@ -65,6 +65,7 @@ namespace Microsoft::Console::VirtualTerminal
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const std::wstring_view string);
         bool IsProcessingLastCharacter() const noexcept;
+        bool IsGround() const noexcept;
 
         void OnCsiComplete(const std::function<void()> callback);
 
@@ -0,0 +1,153 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+
+#include <til/arena.h>
+
+using namespace std::literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class ArenaTests
+{
+    TEST_CLASS(ArenaTests);
+
+    TEST_METHOD(Alignment)
+    {
+        til::arena arena{ 1024 * 1024 };
+
+        const auto a = arena.push_uninitialized<uint8_t>(3);
+        const auto b = arena.push_uninitialized<uint64_t>(1);
+        const auto c = arena.allocate(1, 256);
+
+        VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(b.data()) % alignof(uint64_t));
+        VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(c) % 256);
+        VERIFY_IS_TRUE(reinterpret_cast<uintptr_t>(a.data()) < reinterpret_cast<uintptr_t>(b.data()));
+        VERIFY_IS_TRUE(reinterpret_cast<uintptr_t>(b.data()) < reinterpret_cast<uintptr_t>(c));
+    }
+
+    TEST_METHOD(PushAndPop)
+    {
+        til::arena arena{ 1024 * 1024 };
+
+        const auto zeroed = arena.push_zeroed<uint32_t>(64);
+        VERIFY_IS_TRUE(std::all_of(zeroed.begin(), zeroed.end(), [](auto v) { return v == 0; }));
+
+        const auto pos = arena.position();
+        const auto copy = arena.push_copy(L"hello"sv);
+        VERIFY_ARE_EQUAL(L"hello"sv, copy);
+        VERIFY_IS_TRUE(arena.position() > pos);
+
+        arena.pop_to(pos);
+        VERIFY_ARE_EQUAL(pos, arena.position());
+
+        // Popping to a position past the current one is a no-op.
+        arena.pop_to(pos + 100);
+        VERIFY_ARE_EQUAL(pos, arena.position());
+
+        // The memory gets reused after popping.
+        const auto again = arena.push_uninitialized<wchar_t>(5);
+        VERIFY_ARE_EQUAL(static_cast<const void*>(copy.data()), static_cast<const void*>(again.data()));
+
+        arena.clear();
+        VERIFY_ARE_EQUAL(0u, arena.position());
+    }
+
+#ifndef NDEBUG
+    TEST_METHOD(Poisoning)
+    {
+        til::arena arena{ 1024 * 1024 };
+
+        const auto pos = arena.position();
+        const auto data = arena.push_uninitialized<uint8_t>(16);
+        VERIFY_IS_TRUE(std::all_of(data.begin(), data.end(), [](auto v) { return v == 0xCD; }));
+
+        arena.pop_to(pos);
+        VERIFY_IS_TRUE(std::all_of(data.begin(), data.end(), [](auto v) { return v == 0xDD; }));
+    }
+#endif
+
+    TEST_METHOD(Decommit)
+    {
+        til::arena arena{ 64 * 1024 * 1024 };
+
+        const auto large = arena.push_uninitialized<uint8_t>(32 * 1024 * 1024);
+        large.back() = 1;
+        VERIFY_IS_TRUE(arena.committed() >= large.size());
+
+        // Most of the memory of a large allocation should be returned to the OS once it's popped.
+        arena.clear();
+        VERIFY_IS_TRUE(arena.committed() < large.size() / 2);
+
+        // ...and it can be committed again.
+        const auto again = arena.push_uninitialized<uint8_t>(32 * 1024 * 1024);
+        again.back() = 1;
+    }
+
+    TEST_METHOD(Exhaustion)
+    {
+        til::arena arena{ 1024 * 1024 };
+
+        VERIFY_THROWS(std::ignore = arena.allocate(2 * 1024 * 1024), std::bad_alloc);
+        VERIFY_THROWS(std::ignore = arena.push_uninitialized<uint64_t>(SIZE_MAX / 4), std::bad_array_new_length);
+
+        // A failed allocation must leave the arena usable.
+        VERIFY_ARE_EQUAL(0u, arena.position());
+        std::ignore = arena.allocate(1024);
+    }
+
+    TEST_METHOD(Scope)
+    {
+        til::arena arena{ 1024 * 1024 };
+        std::ignore = arena.allocate(10);
+
+        const auto pos = arena.position();
+        {
+            til::arena_scope scope{ arena };
+            std::ignore = scope->allocate(1000);
+            VERIFY_ARE_NOT_EQUAL(pos, arena.position());
+        }
+        VERIFY_ARE_EQUAL(pos, arena.position());
+    }
+
+    TEST_METHOD(Resource)
+    {
+        til::arena arena{ 1024 * 1024 };
+
+        {
+            til::arena_resource resource{ arena };
+            std::pmr::vector<std::pmr::wstring> strings{ &resource };
+            for (auto i = 0; i < 100; ++i)
+            {
+                strings.emplace_back(L"a string that is too long for the small string optimization");
+            }
+
+            VERIFY_ARE_EQUAL(100u, strings.size());
+            VERIFY_ARE_EQUAL(L"a string that is too long for the small string optimization"sv, strings.back());
+            VERIFY_IS_TRUE(arena.position() > 100 * sizeof(std::pmr::wstring));
+        }
+
+        arena.clear();
+        VERIFY_ARE_EQUAL(0u, arena.position());
+    }
+
+    TEST_METHOD(ScratchArenas)
+    {
+        auto scratch1 = til::get_scratch_arena();
+        auto scratch2 = til::get_scratch_arena(scratch1);
+        auto scratch3 = til::get_scratch_arena(scratch2);
+
+        VERIFY_ARE_NOT_EQUAL(&scratch1.get(), &scratch2.get());
+        VERIFY_ARE_EQUAL(&scratch1.get(), &scratch3.get());
+
+        const auto pos = scratch1->position();
+        {
+            auto nested = til::get_scratch_arena(scratch2);
+            std::ignore = nested->allocate(100);
+        }
+        VERIFY_ARE_EQUAL(pos, scratch1->position());
+    }
+};
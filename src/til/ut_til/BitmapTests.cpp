@@ -1092,4 +1092,175 @@ class BitmapTests
         }
         VERIFY_ARE_EQUAL(expected, actual);
     }
+
+    TEST_METHOD(SizeConstructWithFillLarge)
+    {
+        // The fill must cover all words and not just the first one.
+        const til::size sz{ 400, 200 };
+        const til::bitmap bitmap{ sz, true };
+        VERIFY_ARE_EQUAL(80000u, bitmap._bits.size());
+        VERIFY_IS_TRUE(bitmap._bits.all());
+        VERIFY_ARE_EQUAL(200u, bitmap.runs().size());
+    }
+
+    TEST_METHOD(RunsAcrossWords)
+    {
+        // The map is wide enough for runs to start and end in different words
+        // and for rows to not be aligned to word boundaries.
+        til::bitmap map{ til::size{ 150, 4 } };
+
+        const std::vector<til::rect> rects{
+            til::rect{ 60, 0, 70, 1 }, // crosses the first word boundary
+            til::rect{ 0, 1, 150, 2 }, // full row, starts and ends in the middle of a word
+            til::rect{ 149, 2, 150, 3 }, // single cell at the end of a row
+            til::rect{ 0, 3, 1, 4 }, // ...and at the start of the next one
+            til::rect{ 10, 3, 140, 4 }, // spans more than 2 words
+        };
+        for (const auto& rc : rects)
+        {
+            map.set(rc);
+        }
+
+        _checkBits(rects, map);
+
+        const auto runs = map.runs();
+        VERIFY_ARE_EQUAL(rects, std::vector<til::rect>(runs.begin(), runs.end()));
+    }
+
+    TEST_METHOD(Union)
+    {
+        til::bitmap a{ til::size{ 100, 10 } };
+        til::bitmap b{ til::size{ 100, 10 } };
+        a.set(til::rect{ 0, 0, 50, 5 });
+        b.set(til::rect{ 25, 2, 100, 10 });
+
+        Log::Comment(L"Bitmaps of the same size are combined word by word.");
+        auto actual = a;
+        actual |= b;
+        _checkBits({ til::rect{ 0, 0, 50, 5 }, til::rect{ 25, 2, 100, 10 } }, actual);
+
+        Log::Comment(L"Bitmaps of different sizes only combine the overlapping part.");
+        til::bitmap small{ til::size{ 10, 2 } };
+        small.set_all();
+        actual = b;
+        actual |= small;
+        _checkBits({ til::rect{ 0, 0, 10, 2 }, til::rect{ 25, 2, 100, 10 } }, actual);
+
+        til::bitmap large{ til::size{ 200, 20 } };
+        large.set(til::rect{ 90, 8, 200, 20 });
+        actual = a;
+        actual |= large;
+        _checkBits({ til::rect{ 0, 0, 50, 5 }, til::rect{ 90, 8, 100, 10 } }, actual);
+    }
+
+    TEST_METHOD(Intersect)
+    {
+        til::bitmap a{ til::size{ 100, 10 } };
+        til::bitmap b{ til::size{ 100, 10 } };
+        a.set(til::rect{ 0, 0, 50, 5 });
+        b.set(til::rect{ 25, 2, 100, 10 });
+
+        Log::Comment(L"Bitmaps of the same size are combined word by word.");
+        auto actual = a;
+        actual &= b;
+        _checkBits(til::rect{ 25, 2, 50, 5 }, actual);
+
+        Log::Comment(L"Bits outside of a smaller bitmap get unset.");
+        til::bitmap small{ til::size{ 30, 4 } };
+        small.set_all();
+        actual = a;
+        actual &= small;
+        _checkBits(til::rect{ 0, 0, 30, 4 }, actual);
+    }
+
+    BEGIN_TEST_METHOD(Benchmark)
+        TEST_METHOD_PROPERTY(L"Ignore", L"true")
+    END_TEST_METHOD()
 };
+
+void BitmapTests::Benchmark()
+{
+    static constexpr til::size sz{ 400, 200 };
+    static constexpr int iterations = 10000;
+
+    const auto measure = [](const wchar_t* name, auto&& run) {
+        const auto beg = std::chrono::steady_clock::now();
+        for (auto i = 0; i < iterations; ++i)
+        {
+            run();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        const auto us = std::chrono::duration<double, std::micro>(end - beg).count() / iterations;
+        Log::Comment(NoThrowString().Format(L"%-32s %8.2f us", name, us));
+    };
+
+    // A typical frame with scattered invalidations: A blinking cursor, a selection
+    // spanning a few rows and a couple of hovered pattern matches, as well as a
+    // frame where a scroll invalidated large parts of the viewport.
+    til::bitmap scattered{ sz };
+    scattered.set(til::point{ 123, 45 });
+    scattered.set(til::rect{ 17, 60, 400, 61 });
+    scattered.set(til::rect{ 0, 61, 400, 70 });
+    scattered.set(til::rect{ 0, 70, 233, 71 });
+    for (auto y = 80; y < 200; y += 7)
+    {
+        scattered.set(til::rect{ (y * 13) % 350, y, (y * 13) % 350 + 42, y + 1 });
+    }
+
+    til::bitmap scrolled{ sz };
+    scrolled.set(til::rect{ 0, 150, 400, 200 });
+    scrolled.set(til::rect{ 0, 20, 80, 150 });
+
+    // Iterating cell by cell is what the run extraction used to do within a run.
+    const auto cellByCell = [](const til::bitmap& map) {
+        size_t runs = 0;
+        for (auto y = 0; y < sz.height; ++y)
+        {
+            auto prev = false;
+            for (auto x = 0; x < sz.width; ++x)
+            {
+                const auto bit = map._bits[map._rc.index_of<size_t>({ x, y })];
+                runs += bit && !prev;
+                prev = bit;
+            }
+        }
+        return runs;
+    };
+
+    size_t sink = 0;
+
+    measure(L"runs (scattered, cell by cell)", [&]() { sink += cellByCell(scattered); });
+    measure(L"runs (scattered)", [&]() {
+        for (const auto& run : scattered)
+        {
+            sink += run.left;
+        }
+    });
+    measure(L"runs (scrolled, cell by cell)", [&]() { sink += cellByCell(scrolled); });
+    measure(L"runs (scrolled)", [&]() {
+        for (const auto& run : scrolled)
+        {
+            sink += run.left;
+        }
+    });
+
+    til::bitmap map{ sz };
+    measure(L"set rect (partial rows)", [&]() {
+        map.reset_all();
+        map.set(til::rect{ 3, 10, 397, 190 });
+    });
+    measure(L"set rect (full rows)", [&]() {
+        map.reset_all();
+        map.set(til::rect{ 0, 10, 400, 190 });
+    });
+    measure(L"union", [&]() {
+        map = scattered;
+        map |= scrolled;
+    });
+    measure(L"intersect", [&]() {
+        map = scattered;
+        map &= scrolled;
+    });
+
+    Log::Comment(NoThrowString().Format(L"(%zu)", sink));
+}
@@ -0,0 +1,203 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/coroutine.h>
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+// Coroutine lambdas must not capture anything, because the lambda object is gone by the time the
+// coroutine resumes. That's why the coroutines below are free functions that take their state as arguments.
+namespace
+{
+    til::task<int> doubled(int value)
+    {
+        co_return value * 2;
+    }
+
+    til::task<int> nested()
+    {
+        const auto a = co_await doubled(1);
+        const auto b = co_await doubled(a);
+        co_return a + b;
+    }
+
+    til::task<void> store(int& out)
+    {
+        out = co_await nested();
+    }
+
+    til::task<void> sum_many(int count, int& out)
+    {
+        // Each iteration completes a task synchronously. Without symmetric transfer this would overflow the stack.
+        for (auto i = 0; i < count; ++i)
+        {
+            out += co_await doubled(1);
+        }
+    }
+
+    til::task<void> throw_after_resume()
+    {
+        co_await til::resume_background();
+        throw std::runtime_error{ "test" };
+    }
+
+    til::task<void> get_thread_id(DWORD& id)
+    {
+        co_await til::resume_background();
+        id = GetCurrentThreadId();
+    }
+
+    til::task<void> sleep(til::filetime_duration duration)
+    {
+        co_await til::resume_after(duration);
+    }
+
+    til::task<void> wait_for(HANDLE handle, std::optional<til::filetime_duration> timeout, bool& signaled)
+    {
+        signaled = co_await til::resume_on_signal(handle, timeout);
+    }
+
+    til::task<void> read_all(til::async_file& file, std::string& out, til::io_result& last)
+    {
+        char buffer[16];
+        for (;;)
+        {
+            last = co_await file.read(&buffer[0], sizeof(buffer));
+            if (last.error != ERROR_SUCCESS)
+            {
+                co_return;
+            }
+            out.append(&buffer[0], last.transferred);
+        }
+    }
+
+    // Owns the file, which gets destroyed as soon as the read completes.
+    til::task<void> read_once(til::async_file file, til::io_result& result)
+    {
+        char buffer[16];
+        result = co_await file.read(&buffer[0], sizeof(buffer));
+    }
+}
+
+class CoroutineTests
+{
+    TEST_CLASS(CoroutineTests);
+
+    TEST_METHOD(TaskValue)
+    {
+        auto result = 0;
+        til::spawn(store(result)).get();
+        VERIFY_ARE_EQUAL(6, result);
+    }
+
+    TEST_METHOD(SymmetricTransfer)
+    {
+        auto result = 0;
+        til::spawn(sum_many(1000000, result)).get();
+        VERIFY_ARE_EQUAL(2000000, result);
+    }
+
+    TEST_METHOD(TaskException)
+    {
+        const auto handle = til::spawn(throw_after_resume());
+        VERIFY_THROWS(handle.get(), std::runtime_error);
+        VERIFY_IS_TRUE(handle.done());
+    }
+
+    TEST_METHOD(ResumeBackground)
+    {
+        DWORD id = 0;
+        til::spawn(get_thread_id(id)).get();
+        VERIFY_ARE_NOT_EQUAL(0u, id);
+        VERIFY_ARE_NOT_EQUAL(GetCurrentThreadId(), id);
+    }
+
+    TEST_METHOD(ResumeAfter)
+    {
+        const auto beg = std::chrono::steady_clock::now();
+        const auto handle = til::spawn(sleep(50ms));
+        VERIFY_IS_TRUE(handle.wait(5000));
+        // Timers may fire a little bit early due to the timer resolution.
+        VERIFY_IS_TRUE(std::chrono::steady_clock::now() - beg >= 40ms);
+    }
+
+    TEST_METHOD(ResumeOnSignal)
+    {
+        wil::unique_event event{ wil::EventOptions::ManualReset };
+
+        auto signaled = true;
+        til::spawn(wait_for(event.get(), 10ms, signaled)).get();
+        VERIFY_IS_FALSE(signaled);
+
+        const auto handle = til::spawn(wait_for(event.get(), std::nullopt, signaled));
+        VERIFY_IS_FALSE(handle.wait(50));
+        event.SetEvent();
+        VERIFY_IS_TRUE(handle.wait(5000));
+        VERIFY_IS_TRUE(signaled);
+
+        // Already signaled handles complete without suspending.
+        signaled = false;
+        til::spawn(wait_for(event.get(), 0ms, signaled)).get();
+        VERIFY_IS_TRUE(signaled);
+    }
+
+    TEST_METHOD(PipeRead)
+    {
+        auto [read, write] = til::create_overlapped_pipe();
+        til::async_file file{ std::move(read) };
+
+        std::string received;
+        til::io_result last;
+        const auto handle = til::spawn(read_all(file, received, last));
+
+        const auto data = "Hello, World! This is more than 16 bytes long."sv;
+        VERIFY_WIN32_BOOL_SUCCEEDED(WriteFile(write.get(), data.data(), gsl::narrow_cast<DWORD>(data.size()), nullptr, nullptr));
+        write.reset();
+
+        VERIFY_IS_TRUE(handle.wait(5000));
+        VERIFY_ARE_EQUAL(data, std::string_view{ received });
+        VERIFY_ARE_EQUAL(static_cast<DWORD>(ERROR_BROKEN_PIPE), last.error);
+    }
+
+    TEST_METHOD(PipeCancel)
+    {
+        auto [read, write] = til::create_overlapped_pipe();
+        til::async_file file{ std::move(read) };
+
+        std::string received;
+        til::io_result last;
+        const auto handle = til::spawn(read_all(file, received, last));
+        VERIFY_IS_FALSE(handle.wait(50));
+
+        file.cancel();
+        VERIFY_IS_TRUE(handle.wait(5000));
+        VERIFY_ARE_EQUAL(static_cast<DWORD>(ERROR_OPERATION_ABORTED), last.error);
+        VERIFY_IS_TRUE(received.empty());
+
+        // Cancellation is sticky and also affects reads that start afterwards.
+        til::spawn(read_all(file, received, last)).get();
+        VERIFY_ARE_EQUAL(static_cast<DWORD>(ERROR_OPERATION_ABORTED), last.error);
+    }
+
+    TEST_METHOD(PipeDestroyedOnCompletion)
+    {
+        // The data is already there, so the completion races with the awaiter that's still returning
+        // from ReadFile(), while the coroutine destroys the file right after it gets resumed.
+        for (auto i = 0; i < 100; ++i)
+        {
+            auto [read, write] = til::create_overlapped_pipe();
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteFile(write.get(), "abc", 3, nullptr, nullptr));
+
+            til::io_result result;
+            til::spawn(read_once(til::async_file{ std::move(read) }, result)).get();
+            VERIFY_ARE_EQUAL(static_cast<DWORD>(ERROR_SUCCESS), result.error);
+            VERIFY_ARE_EQUAL(3ul, result.transferred);
+        }
+    }
+};
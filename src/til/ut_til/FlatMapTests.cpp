@@ -0,0 +1,256 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/flat_map.h>
+
+using namespace std::string_view_literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+// Maps every key to the same hash, which results in one long probe sequence.
+struct CollidingHash
+{
+    size_t operator()(uint32_t) const noexcept
+    {
+        return 42;
+    }
+};
+
+class FlatMapTests
+{
+    TEST_CLASS(FlatMapTests);
+
+    TEST_METHOD(Basic)
+    {
+        til::flat_map<uint32_t, int> map;
+        VERIFY_IS_TRUE(map.empty());
+        VERIFY_ARE_EQUAL(map.end(), map.find(1));
+        VERIFY_ARE_EQUAL(map.begin(), map.end());
+
+        const auto [it1, inserted1] = map.try_emplace(1, 10);
+        VERIFY_IS_TRUE(inserted1);
+        VERIFY_ARE_EQUAL(1u, it1->first);
+        VERIFY_ARE_EQUAL(10, it1->second);
+
+        const auto [it2, inserted2] = map.try_emplace(1, 20);
+        VERIFY_IS_FALSE(inserted2);
+        VERIFY_ARE_EQUAL(10, it2->second);
+
+        map.insert_or_assign(1, 30);
+        VERIFY_ARE_EQUAL(30, map.at(1));
+
+        map[2] = 40;
+        VERIFY_ARE_EQUAL(40, map.at(2));
+        VERIFY_ARE_EQUAL(2u, map.size());
+        VERIFY_IS_TRUE(map.contains(2));
+        VERIFY_IS_FALSE(map.contains(3));
+        VERIFY_THROWS(map.at(3), std::out_of_range);
+
+        VERIFY_ARE_EQUAL(1u, map.erase(1));
+        VERIFY_ARE_EQUAL(0u, map.erase(1));
+        VERIFY_ARE_EQUAL(1u, map.size());
+
+        map.clear();
+        VERIFY_IS_TRUE(map.empty());
+        VERIFY_ARE_EQUAL(map.end(), map.find(2));
+    }
+
+    TEST_METHOD(HeterogeneousLookup)
+    {
+        til::flat_map<std::wstring, int> map;
+        map.try_emplace(L"foo"sv, 1);
+        map.try_emplace(std::wstring{ L"bar" }, 2);
+        map[L"baz"] = 3;
+
+        VERIFY_ARE_EQUAL(1, map.at(L"foo"sv));
+        VERIFY_ARE_EQUAL(2, map.at(L"bar"));
+        VERIFY_ARE_EQUAL(3, map.at(std::wstring{ L"baz" }));
+        VERIFY_IS_FALSE(map.contains(L"missing"sv));
+        VERIFY_ARE_EQUAL(1u, map.erase(L"foo"sv));
+        VERIFY_ARE_EQUAL(2u, map.size());
+    }
+
+    TEST_METHOD(Iteration)
+    {
+        til::flat_map<uint32_t, uint32_t> map;
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            map.try_emplace(i, i * 2);
+        }
+
+        std::vector<bool> seen(1000);
+        for (const auto& [key, value] : std::as_const(map))
+        {
+            VERIFY_IS_FALSE(seen[key]);
+            VERIFY_ARE_EQUAL(key * 2, value);
+            seen[key] = true;
+        }
+        VERIFY_IS_TRUE(std::all_of(seen.begin(), seen.end(), [](bool b) { return b; }));
+    }
+
+    TEST_METHOD(CopyAndMove)
+    {
+        til::flat_map<std::wstring, std::wstring> map;
+        for (auto i = 0; i < 100; ++i)
+        {
+            map.try_emplace(std::to_wstring(i), std::to_wstring(i * i));
+        }
+
+        auto copy = map;
+        VERIFY_ARE_EQUAL(100u, copy.size());
+        VERIFY_ARE_EQUAL(L"81", copy.at(L"9"sv));
+
+        copy.erase(L"9"sv);
+        VERIFY_IS_TRUE(map.contains(L"9"sv));
+
+        auto moved = std::move(map);
+        VERIFY_ARE_EQUAL(100u, moved.size());
+        VERIFY_IS_TRUE(map.empty());
+        VERIFY_IS_FALSE(map.contains(L"9"sv));
+
+        map = moved;
+        VERIFY_ARE_EQUAL(100u, map.size());
+        VERIFY_ARE_EQUAL(L"9801", map.at(L"99"sv));
+    }
+
+    // erase() shifts the items of a probe sequence backwards instead of leaving tombstones.
+    // With all keys in one sequence, this verifies that no item becomes unreachable.
+    TEST_METHOD(EraseWithCollisions)
+    {
+        til::flat_map<uint32_t, uint32_t, CollidingHash, std::equal_to<>> map;
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            map.try_emplace(i, i);
+        }
+
+        for (uint32_t i = 0; i < 100; i += 3)
+        {
+            VERIFY_ARE_EQUAL(1u, map.erase(i));
+        }
+
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            VERIFY_ARE_EQUAL(i % 3 != 0, map.contains(i));
+        }
+    }
+
+    TEST_METHOD(EraseIf)
+    {
+        til::flat_map<uint32_t, uint32_t> map;
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            map.try_emplace(i, i);
+        }
+
+        const auto removed = map.erase_if([](const auto& pair) { return pair.second % 3 == 0; });
+        VERIFY_ARE_EQUAL(34u, removed);
+        VERIFY_ARE_EQUAL(66u, map.size());
+
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            VERIFY_ARE_EQUAL(i % 3 != 0, map.contains(i));
+        }
+    }
+
+    // Compares random insertions and erasures with std::unordered_map.
+    TEST_METHOD(Random)
+    {
+        til::flat_map<uint32_t, uint32_t> map;
+        std::unordered_map<uint32_t, uint32_t> expected;
+        uint32_t state = 1;
+
+        for (auto i = 0; i < 100000; ++i)
+        {
+            // A 32-bit xor-shift random number generator.
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            const auto key = state % 512;
+            if (state & 0x80000000)
+            {
+                VERIFY_ARE_EQUAL(expected.erase(key), map.erase(key));
+            }
+            else
+            {
+                expected.insert_or_assign(key, state);
+                map.insert_or_assign(key, state);
+            }
+        }
+
+        VERIFY_ARE_EQUAL(expected.size(), map.size());
+        for (const auto& [key, value] : map)
+        {
+            VERIFY_ARE_EQUAL(expected.at(key), value);
+        }
+    }
+
+    BEGIN_TEST_METHOD(Benchmark)
+        TEST_METHOD_PROPERTY(L"Ignore", L"true")
+    END_TEST_METHOD()
+};
+
+// Compares lookups with std::unordered_map for the kind of keys flat_map is used for:
+// codepoints (CodepointWidthDetector) and strings (TextBuffer's hyperlink IDs).
+void FlatMapTests::Benchmark()
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto measure = [](const wchar_t* name, auto& map, const auto& keys) {
+        static constexpr size_t rounds = 200;
+        size_t sink = 0;
+
+        const auto beg = clock::now();
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            for (const auto& key : keys)
+            {
+                const auto it = map.find(key);
+                sink += it != map.end() ? it->second : 1;
+            }
+        }
+        const auto end = clock::now();
+
+        const auto ns = std::chrono::duration<double, std::nano>(end - beg).count() / (rounds * keys.size());
+        Log::Comment(NoThrowString().Format(L"%-40s %6.2f ns/lookup (%zu)", name, ns, sink));
+    };
+
+    std::vector<char32_t> codepoints;
+    for (char32_t i = 0; i < 4096; ++i)
+    {
+        codepoints.emplace_back(0x2000 + i * 7);
+    }
+
+    std::vector<std::wstring> strings;
+    for (size_t i = 0; i < 4096; ++i)
+    {
+        strings.emplace_back(fmt::format(L"custom-id-{}%{}", i, til::hash(i)));
+    }
+
+    {
+        til::flat_map<char32_t, uint8_t> flat;
+        std::unordered_map<char32_t, uint8_t> std;
+        for (size_t i = 0; i < codepoints.size(); i += 2)
+        {
+            flat.try_emplace(codepoints[i], uint8_t{ 2 });
+            std.try_emplace(codepoints[i], uint8_t{ 2 });
+        }
+        measure(L"char32_t, 50% hits, til::flat_map", flat, codepoints);
+        measure(L"char32_t, 50% hits, std::unordered_map", std, codepoints);
+    }
+
+    {
+        til::flat_map<std::wstring, uint16_t> flat;
+        std::unordered_map<std::wstring, uint16_t> std;
+        for (size_t i = 0; i < strings.size(); i += 2)
+        {
+            flat.try_emplace(strings[i], gsl::narrow_cast<uint16_t>(i));
+            std.try_emplace(strings[i], gsl::narrow_cast<uint16_t>(i));
+        }
+        measure(L"wstring, 50% hits, til::flat_map", flat, strings);
+        measure(L"wstring, 50% hits, std::unordered_map", std, strings);
+    }
+}
@@ -62,4 +62,38 @@ class FlatSetTests
         VERIFY_ARE_EQUAL(entry1, entry2);
         VERIFY_ARE_EQUAL(123u, entry2->value);
     }
+
+    TEST_METHOD(EraseIf)
+    {
+        til::linear_flat_set<Data, DataHashTrait> set;
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            set.insert(i);
+        }
+
+        const auto removed = set.erase_if([](const Data& d) { return d.value % 3 == 0; });
+        VERIFY_ARE_EQUAL(34u, removed);
+        VERIFY_ARE_EQUAL(66u, set.size());
+
+        // Items that collided with removed ones must still be reachable.
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const auto entry = set.lookup(i);
+            if (i % 3 == 0)
+            {
+                VERIFY_IS_NULL(entry);
+            }
+            else
+            {
+                VERIFY_IS_NOT_NULL(entry);
+                VERIFY_ARE_EQUAL(i, entry->value);
+            }
+        }
+
+        // The set should remain fully functional for insertions.
+        const auto [entry, inserted] = set.insert(3);
+        VERIFY_IS_TRUE(inserted);
+        VERIFY_ARE_EQUAL(67u, set.size());
+    }
 };
@@ -43,4 +43,128 @@ class HashTests
 #endif
         }
     }
+
+    // These values must never change, because stream_hasher results with the stable_seed may be persisted on disk.
+    TEST_METHOD(StreamTestVectors)
+    {
+        struct Test
+        {
+            std::string_view input;
+            uint64_t expected;
+        };
+
+        static constexpr std::array tests{
+            Test{ "", 0x02db02450ef1f6e2 },
+            Test{ "a", 0xeccfc7981b377bba },
+            Test{ "abc", 0xf17a4436bb530244 },
+            Test{ "message digest", 0x09e6f66395309ead },
+            Test{ "abcdefghijklmnopqrstuvwxyz", 0xa6cdbb1ddc8bed92 },
+            Test{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xde65055b00c4d374 },
+            Test{ "12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x808b1bca0f0c07ab },
+        };
+
+        for (const auto& t : tests)
+        {
+            const auto actual = til::stream_hasher{}.write(t.input).finalize();
+            VERIFY_ARE_EQUAL(t.expected, actual);
+        }
+
+        // This one is long enough to cover the scrambling of the accumulators every 1KiB.
+        const auto input = makeInput(5000);
+        VERIFY_ARE_EQUAL(0xcec7207c68ec38b5, til::stream_hasher{}.write(input.data(), input.size()).finalize());
+        VERIFY_ARE_EQUAL(0xf96663ac82db1644, til::stream_hasher{ 1234 }.write(input.data(), input.size()).finalize());
+    }
+
+    TEST_METHOD(StreamSplitting)
+    {
+        const auto input = makeInput(5000);
+
+        for (const auto len : { 0u, 1u, 63u, 64u, 65u, 1023u, 1024u, 1025u, 5000u })
+        {
+            const auto expected = til::stream_hasher{}.write(input.data(), len).finalize();
+
+            for (const auto chunk : { 1u, 7u, 64u, 100u, 1024u })
+            {
+                til::stream_hasher h;
+                for (size_t i = 0; i < len; i += chunk)
+                {
+                    h.write(input.data() + i, std::min<size_t>(chunk, len - i));
+                }
+                VERIFY_ARE_EQUAL(expected, h.finalize(), NoThrowString().Format(L"len=%u chunk=%u", len, chunk));
+            }
+        }
+    }
+
+    TEST_METHOD(StreamSensitivity)
+    {
+        auto input = makeInput(3000);
+        const auto expected = til::stream_hasher{}.write(input.data(), input.size()).finalize();
+
+        VERIFY_ARE_NOT_EQUAL(expected, til::stream_hasher{ 1 }.write(input.data(), input.size()).finalize());
+        VERIFY_ARE_NOT_EQUAL(expected, til::stream_hasher{}.write(input.data(), input.size() - 1).finalize());
+
+        // Padding the last stripe with zeroes must not make trailing zeroes irrelevant.
+        input.push_back(0);
+        VERIFY_ARE_NOT_EQUAL(expected, til::stream_hasher{}.write(input.data(), input.size()).finalize());
+        input.pop_back();
+
+        for (size_t i = 0; i < input.size() * 8; ++i)
+        {
+            input[i / 8] ^= static_cast<uint8_t>(1 << (i % 8));
+            const auto actual = til::stream_hasher{}.write(input.data(), input.size()).finalize();
+            input[i / 8] ^= static_cast<uint8_t>(1 << (i % 8));
+
+            if (actual == expected)
+            {
+                VERIFY_FAIL(NoThrowString().Format(L"flipping bit %zu didn't change the hash", i));
+            }
+        }
+    }
+
+    BEGIN_TEST_METHOD(Benchmark)
+        TEST_METHOD_PROPERTY(L"Ignore", L"true")
+    END_TEST_METHOD()
+
+private:
+    static std::vector<uint8_t> makeInput(size_t len)
+    {
+        std::vector<uint8_t> input(len);
+        for (size_t i = 0; i < len; ++i)
+        {
+            input[i] = static_cast<uint8_t>(i * 7 + i / 251);
+        }
+        return input;
+    }
 };
+
+// Compares til::hasher with til::stream_hasher for small keys (like the glyph atlas keys)
+// and for rows of text (2 bytes per column), up to multi-KiB inputs.
+void HashTests::Benchmark()
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto input = makeInput(64 * 1024);
+
+    for (const auto len : { 16u, 240u, 800u, 4096u, 65536u })
+    {
+        const auto iterations = 256 * 1024 * 1024 / (len + 64);
+        size_t sink = 0;
+
+        const auto t0 = clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            sink += til::hasher{ i }.write(input.data(), len).finalize();
+        }
+        const auto t1 = clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            sink += static_cast<size_t>(til::stream_hasher{ i }.write(input.data(), len).finalize());
+        }
+        const auto t2 = clock::now();
+
+        const auto bytes = static_cast<double>(len) * iterations;
+        const auto hasherGBs = bytes / std::chrono::duration<double>(t1 - t0).count() / 1e9;
+        const auto streamGBs = bytes / std::chrono::duration<double>(t2 - t1).count() / 1e9;
+        Log::Comment(NoThrowString().Format(L"%5u bytes: hasher %6.2f GB/s, stream_hasher %6.2f GB/s (%zx)", len, hasherGBs, streamGBs, sink));
+    }
+}
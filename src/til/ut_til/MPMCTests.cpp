@@ -0,0 +1,501 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+
+#include <condition_variable>
+
+#include <til/mpmc.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+namespace
+{
+    struct drop_indicator
+    {
+        explicit drop_indicator(int& counter) noexcept :
+            _counter(&counter) {}
+
+        drop_indicator(const drop_indicator&) = delete;
+        drop_indicator& operator=(const drop_indicator&) = delete;
+
+        drop_indicator(drop_indicator&& other) noexcept
+        {
+            _counter = std::exchange(other._counter, nullptr);
+        }
+
+        drop_indicator& operator=(drop_indicator&& other) noexcept
+        {
+            _counter = std::exchange(other._counter, nullptr);
+            return *this;
+        }
+
+        ~drop_indicator()
+        {
+            if (_counter)
+            {
+                ++*_counter;
+            }
+        }
+
+    private:
+        int* _counter = nullptr;
+    };
+
+    template<typename T>
+    void drop(T&& val)
+    {
+        auto _ = std::move(val);
+    }
+
+    // Items are tagged with the index of the producer in the upper and a sequence number in the lower bits.
+    constexpr uint64_t makeItem(uint64_t producer, uint64_t sequence) noexcept
+    {
+        return producer << 32 | sequence;
+    }
+
+    // Pushes `count` items, alternating between single items and batches of varying sizes.
+    template<typename Producer>
+    void produceItems(const Producer& tx, uint64_t producer, uint64_t count)
+    {
+        std::array<uint64_t, 37> batch{};
+        uint64_t sequence = 0;
+
+        while (sequence < count)
+        {
+            const auto n = std::min<uint64_t>(count - sequence, 1 + sequence % batch.size());
+            if (n == 1)
+            {
+                tx.emplace(makeItem(producer, sequence++));
+            }
+            else
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    batch[i] = makeItem(producer, sequence++);
+                }
+                tx.push_n(batch.begin(), gsl::narrow_cast<size_t>(n));
+            }
+        }
+    }
+
+    // Pops items until the producers are gone and verifies that every producer's items arrive in order.
+    // Returns all popped items.
+    template<typename Consumer>
+    std::vector<uint64_t> consumeItems(const Consumer& rx, size_t producers)
+    {
+        std::vector<uint64_t> items;
+        std::vector<uint64_t> next(producers);
+        std::array<uint64_t, 64> buffer{};
+        auto ok = true;
+
+        for (;;)
+        {
+            const auto [count, alive] = rx.pop_n(til::mpmc::block_initially, buffer.begin(), buffer.size());
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto producer = buffer[i] >> 32;
+                const auto sequence = buffer[i] & 0xffffffff;
+                ok = ok && producer < producers && sequence >= next[producer];
+                next[producer] = sequence + 1;
+            }
+            items.insert(items.end(), buffer.begin(), buffer.begin() + count);
+            if (!alive)
+            {
+                break;
+            }
+        }
+
+        VERIFY_IS_TRUE(ok);
+        return items;
+    }
+
+    // The baseline the benchmark compares against.
+    template<typename T>
+    struct locked_deque
+    {
+        void push(T item)
+        {
+            {
+                std::lock_guard lock{ _mutex };
+                _items.push_back(std::move(item));
+            }
+            _cv.notify_one();
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard lock{ _mutex };
+                _closed = true;
+            }
+            _cv.notify_all();
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock lock{ _mutex };
+            _cv.wait(lock, [&]() { return !_items.empty() || _closed; });
+            if (_items.empty())
+            {
+                return std::nullopt;
+            }
+            auto item = std::move(_items.front());
+            _items.pop_front();
+            return item;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::deque<T> _items;
+        bool _closed = false;
+    };
+}
+
+class MPMCTests
+{
+    BEGIN_TEST_CLASS(MPMCTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:10") // 10s timeout
+    END_TEST_CLASS()
+
+    TEST_METHOD(SmokeTest);
+    TEST_METHOD(NonBlockingTest);
+    TEST_METHOD(MinimumCapacityTest);
+    TEST_METHOD(DropTest);
+    TEST_METHOD(DropProducersTest);
+    TEST_METHOD(MPSCStressTest);
+    TEST_METHOD(MPMCStressTest);
+
+    // Run with /runIgnoredTests to compare the throughput against a std::mutex + std::deque queue.
+    BEGIN_TEST_METHOD(Benchmark)
+        TEST_METHOD_PROPERTY(L"Ignore", L"true")
+    END_TEST_METHOD()
+};
+
+void MPMCTests::SmokeTest()
+{
+    // This test mostly ensures that the API wasn't broken.
+
+    {
+        // construction
+        auto [tx, rx] = til::mpsc::channel<int>(32);
+        std::array<int, 3> data{};
+
+        // copy and move constructor
+        auto tx2(tx);
+        auto tx3(std::move(tx2));
+        auto rx2(std::move(rx));
+
+        // copy and move assignment operator
+        tx2 = tx3;
+        tx = std::move(tx3);
+        rx = std::move(rx2);
+
+        // push
+        tx.emplace(0);
+        tx.try_emplace(0);
+        tx.push(data.begin(), data.end());
+        tx.push(til::mpsc::block_initially, data.begin(), data.end());
+        tx.push(til::mpsc::block_forever, data.begin(), data.end());
+        tx.push(til::mpsc::non_blocking, data.begin(), data.end());
+        tx.push_n(data.begin(), data.size());
+        tx.push_n(til::mpsc::block_initially, data.begin(), data.size());
+        tx2.push_n(til::mpsc::block_forever, data.begin(), data.size());
+        tx2.push_n(til::mpsc::non_blocking, data.begin(), data.size());
+
+        // pop
+        auto x = rx.pop();
+        auto y = rx.try_pop();
+        rx.pop_n(data.begin(), data.size());
+        rx.pop_n(til::mpsc::block_initially, data.begin(), data.size());
+        rx.pop_n(til::mpsc::block_forever, data.begin(), data.size());
+        rx.pop_n(til::mpsc::non_blocking, data.begin(), data.size());
+    }
+
+    {
+        auto [tx, rx] = til::mpmc::channel<int>(32);
+
+        // consumers can be copied as well
+        auto rx2(rx);
+        rx2 = rx;
+
+        tx.emplace(1);
+        tx.emplace(2);
+        VERIFY_ARE_EQUAL(1, rx.pop());
+        VERIFY_ARE_EQUAL(2, rx2.pop());
+    }
+}
+
+void MPMCTests::NonBlockingTest()
+{
+    // The capacity is rounded up to the next power of two.
+    auto [tx, rx] = til::mpsc::channel<int>(3);
+    std::array<int, 6> data{ 1, 2, 3, 4, 5, 6 };
+
+    VERIFY_IS_FALSE(rx.try_pop().has_value());
+
+    VERIFY_IS_TRUE(tx.try_emplace(0));
+    {
+        const auto [count, alive] = tx.push_n(til::mpsc::non_blocking, data.begin(), data.size());
+        VERIFY_ARE_EQUAL(3u, count);
+        VERIFY_IS_TRUE(alive);
+    }
+    VERIFY_IS_FALSE(tx.try_emplace(7));
+
+    VERIFY_ARE_EQUAL(0, rx.try_pop());
+    VERIFY_ARE_EQUAL(1, rx.try_pop());
+
+    // Only 2 of the 3 items fit.
+    {
+        const auto [count, alive] = tx.push_n(til::mpsc::non_blocking, data.begin() + 3, 3);
+        VERIFY_ARE_EQUAL(2u, count);
+        VERIFY_IS_TRUE(alive);
+    }
+
+    // The items wrap around the end of the ring buffer and thus require two acquisitions.
+    std::array<int, 8> out{};
+    {
+        const auto [count, alive] = rx.pop_n(til::mpsc::non_blocking, out.begin(), out.size());
+        VERIFY_ARE_EQUAL(4u, count);
+        VERIFY_IS_TRUE(alive);
+    }
+    VERIFY_ARE_EQUAL(2, out[0]);
+    VERIFY_ARE_EQUAL(3, out[1]);
+    VERIFY_ARE_EQUAL(4, out[2]);
+    VERIFY_ARE_EQUAL(5, out[3]);
+}
+
+void MPMCTests::MinimumCapacityTest()
+{
+    // A capacity of 1 is rounded up to 2, the smallest capacity the slot sequence numbers work with.
+    {
+        auto [tx, rx] = til::mpsc::channel<int>(1);
+        VERIFY_IS_TRUE(tx.try_emplace(1));
+        VERIFY_IS_TRUE(tx.try_emplace(2));
+        VERIFY_IS_FALSE(tx.try_emplace(3));
+        VERIFY_ARE_EQUAL(1, rx.try_pop());
+        VERIFY_ARE_EQUAL(2, rx.try_pop());
+        VERIFY_IS_FALSE(rx.try_pop().has_value());
+    }
+
+    // No items may get lost while both sides block on the tiny capacity.
+    {
+        static constexpr uint64_t count = 1000;
+        auto [tx, rx] = til::mpmc::channel<uint64_t>(1);
+
+        std::thread t([tx = std::move(tx)]() {
+            produceItems(tx, 0, count);
+        });
+        const auto items = consumeItems(rx, 1);
+        t.join();
+
+        VERIFY_ARE_EQUAL(count, items.size());
+    }
+}
+
+void MPMCTests::DropTest()
+{
+    auto [tx, rx] = til::mpmc::channel<drop_indicator>(8);
+    auto counter = 0;
+
+    for (auto i = 0; i < 5; ++i)
+    {
+        tx.emplace(counter);
+    }
+    VERIFY_ARE_EQUAL(counter, 0);
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        rx.pop();
+    }
+    VERIFY_ARE_EQUAL(counter, 3);
+
+    // Dropping one of two consumers keeps the channel open.
+    auto rx2 = rx;
+    drop(rx);
+    VERIFY_IS_TRUE(tx.emplace(counter));
+    VERIFY_ARE_EQUAL(counter, 3);
+
+    // Once all consumers are gone, the producers get notified...
+    drop(rx2);
+    VERIFY_IS_FALSE(tx.emplace(counter));
+    VERIFY_ARE_EQUAL(counter, 3);
+
+    // ...and the remaining items get destroyed once the producers are gone too.
+    drop(tx);
+    VERIFY_ARE_EQUAL(counter, 6);
+}
+
+void MPMCTests::DropProducersTest()
+{
+    auto [tx, rx] = til::mpsc::channel<int>(8);
+    auto tx2 = tx;
+
+    // A consumer that waits for items gets woken up once all producers are gone.
+    std::thread t([rx = std::move(rx)]() {
+        VERIFY_ARE_EQUAL(1, rx.pop());
+        VERIFY_ARE_EQUAL(2, rx.pop());
+        VERIFY_IS_FALSE(rx.pop().has_value());
+    });
+
+    tx.emplace(1);
+    drop(tx);
+    tx2.emplace(2);
+    drop(tx2);
+
+    t.join();
+}
+
+void MPMCTests::MPSCStressTest()
+{
+    static constexpr size_t producers = 4;
+    static constexpr uint64_t itemsPerProducer = 100000;
+
+    // A small capacity ensures that both sides block frequently.
+    auto [tx, rx] = til::mpsc::channel<uint64_t>(64);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([tx = tx, i]() {
+            produceItems(tx, i, itemsPerProducer);
+        });
+    }
+    drop(tx);
+
+    const auto items = consumeItems(rx, producers);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    VERIFY_ARE_EQUAL(producers * itemsPerProducer, items.size());
+}
+
+void MPMCTests::MPMCStressTest()
+{
+    static constexpr size_t producers = 4;
+    static constexpr size_t consumers = 4;
+    static constexpr uint64_t itemsPerProducer = 100000;
+
+    auto [tx, rx] = til::mpmc::channel<uint64_t>(64);
+    std::vector<std::thread> threads;
+    std::array<std::vector<uint64_t>, consumers> results;
+
+    for (size_t i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([tx = tx, i]() {
+            produceItems(tx, i, itemsPerProducer);
+        });
+    }
+    for (size_t i = 0; i < consumers; ++i)
+    {
+        threads.emplace_back([rx = rx, &result = results[i]]() {
+            result = consumeItems(rx, producers);
+        });
+    }
+    drop(tx);
+    drop(rx);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    // Every item must have been received exactly once.
+    std::vector<uint64_t> items;
+    for (const auto& r : results)
+    {
+        items.insert(items.end(), r.begin(), r.end());
+    }
+    std::ranges::sort(items);
+
+    std::vector<uint64_t> expected;
+    for (uint64_t p = 0; p < producers; ++p)
+    {
+        for (uint64_t s = 0; s < itemsPerProducer; ++s)
+        {
+            expected.emplace_back(makeItem(p, s));
+        }
+    }
+
+    VERIFY_IS_TRUE(items == expected);
+}
+
+void MPMCTests::Benchmark()
+{
+    static constexpr size_t producers = 4;
+    static constexpr uint64_t itemsPerProducer = 1000000;
+    static constexpr auto total = static_cast<double>(producers * itemsPerProducer);
+
+    const auto measure = [](const wchar_t* name, auto&& run) {
+        const auto beg = std::chrono::steady_clock::now();
+        run();
+        const auto end = std::chrono::steady_clock::now();
+        const auto seconds = std::chrono::duration<double>(end - beg).count();
+        Log::Comment(NoThrowString().Format(L"%-24s %8.1f M items/s", name, total / seconds / 1e6));
+    };
+
+    measure(L"std::mutex + std::deque", [&]() {
+        locked_deque<uint64_t> queue;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back([&queue, i]() {
+                for (uint64_t s = 0; s < itemsPerProducer; ++s)
+                {
+                    queue.push(makeItem(i, s));
+                }
+            });
+        }
+        std::thread consumer([&]() {
+            while (queue.pop())
+            {
+            }
+        });
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        queue.close();
+        consumer.join();
+    });
+
+    const auto runChannel = [](auto channel, bool batched) {
+        auto [tx, rx] = std::move(channel);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back([tx = tx, i, batched]() {
+                if (batched)
+                {
+                    produceItems(tx, i, itemsPerProducer);
+                    return;
+                }
+                for (uint64_t s = 0; s < itemsPerProducer; ++s)
+                {
+                    tx.emplace(makeItem(i, s));
+                }
+            });
+        }
+        drop(tx);
+        std::array<uint64_t, 64> buffer{};
+        while (rx.pop_n(til::mpmc::block_initially, buffer.begin(), buffer.size()).second)
+        {
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    };
+
+    measure(L"til::mpsc emplace", [&]() { runChannel(til::mpsc::channel<uint64_t>(4096), false); });
+    measure(L"til::mpsc push_n", [&]() { runChannel(til::mpsc::channel<uint64_t>(4096), true); });
+    measure(L"til::mpmc emplace", [&]() { runChannel(til::mpmc::channel<uint64_t>(4096), false); });
+    measure(L"til::mpmc push_n", [&]() { runChannel(til::mpmc::channel<uint64_t>(4096), true); });
+}
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/ring_buffer.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class RingBufferTests
+{
+    TEST_CLASS(RingBufferTests);
+
+    static std::vector<int> contents(const til::ring_buffer<int>& rb)
+    {
+        std::vector<int> v(rb.size());
+        VERIFY_ARE_EQUAL(rb.size(), rb.copy_to(0, v));
+        return v;
+    }
+
+    TEST_METHOD(Basic)
+    {
+        til::ring_buffer<int> rb;
+        VERIFY_IS_TRUE(rb.empty());
+        VERIFY_ARE_EQUAL(0u, rb.capacity());
+
+        rb.push_back(2);
+        rb.push_back(3);
+        rb.push_front(1);
+        VERIFY_ARE_EQUAL(3u, rb.size());
+        VERIFY_ARE_EQUAL(1, rb.front());
+        VERIFY_ARE_EQUAL(3, rb.back());
+        VERIFY_ARE_EQUAL(2, rb[1]);
+        VERIFY_ARE_EQUAL(2, rb.at(1));
+        VERIFY_THROWS(rb.at(3), std::out_of_range);
+
+        rb.pop_front();
+        rb.pop_back();
+        VERIFY_ARE_EQUAL((std::vector{ 2 }), contents(rb));
+
+        rb.clear();
+        VERIFY_IS_TRUE(rb.empty());
+    }
+
+    TEST_METHOD(AppendAndPrependWrapAround)
+    {
+        til::ring_buffer<int> rb;
+        rb.reserve(16);
+        VERIFY_ARE_EQUAL(16u, rb.capacity());
+
+        const int a[]{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+        rb.append(a);
+        rb.pop_front(10);
+
+        // This write wraps around the end of the allocation.
+        const int b[]{ 12, 13, 14, 15, 16, 17, 18, 19 };
+        rb.append(b);
+        VERIFY_ARE_EQUAL(16u, rb.capacity());
+
+        const auto [first, second] = rb.spans();
+        VERIFY_ARE_EQUAL(6u, first.size());
+        VERIFY_ARE_EQUAL(4u, second.size());
+
+        // So does this one, but in the other direction.
+        rb.pop_front(8);
+        const int c[]{ -5, -4, -3, -2, -1 };
+        rb.prepend(c);
+        VERIFY_ARE_EQUAL((std::vector{ -5, -4, -3, -2, -1, 18, 19 }), contents(rb));
+        VERIFY_ARE_EQUAL(16u, rb.capacity());
+    }
+
+    TEST_METHOD(GrowPreservesOrder)
+    {
+        til::ring_buffer<int> rb;
+        std::vector<int> expected;
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            if (i % 3 == 0)
+            {
+                rb.push_front(i);
+                expected.insert(expected.begin(), i);
+            }
+            else
+            {
+                rb.push_back(i);
+                expected.push_back(i);
+            }
+        }
+
+        VERIFY_ARE_EQUAL(expected, contents(rb));
+        VERIFY_ARE_EQUAL(1024u, rb.capacity());
+
+        rb.pop_front(600);
+        rb.shrink_to_fit();
+        VERIFY_ARE_EQUAL(512u, rb.capacity());
+        expected.erase(expected.begin(), expected.begin() + 600);
+        VERIFY_ARE_EQUAL(expected, contents(rb));
+
+        rb.pop_front(1000);
+        rb.shrink_to_fit();
+        VERIFY_ARE_EQUAL(0u, rb.capacity());
+    }
+
+    TEST_METHOD(AppendAndPrependRingBuffers)
+    {
+        til::ring_buffer<int> a;
+        til::ring_buffer<int> b;
+        for (auto i = 0; i < 10; ++i)
+        {
+            a.push_back(i);
+            b.push_front(-i - 1);
+        }
+
+        a.prepend(b);
+        VERIFY_ARE_EQUAL((std::vector{ -10, -9, -8, -7, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), contents(a));
+
+        b.clear();
+        b.push_back(42);
+        b.append(b);
+        VERIFY_ARE_EQUAL((std::vector{ 42, 42 }), contents(b));
+
+        auto copy = b;
+        auto moved = std::move(b);
+        VERIFY_IS_TRUE(b.empty());
+        VERIFY_ARE_EQUAL(contents(copy), contents(moved));
+    }
+
+    TEST_METHOD(EraseIf)
+    {
+        til::ring_buffer<int> rb;
+        for (auto i = 0; i < 20; ++i)
+        {
+            rb.push_back(i);
+        }
+        rb.pop_front(10);
+        for (auto i = 20; i < 30; ++i)
+        {
+            rb.push_back(i);
+        }
+
+        VERIFY_ARE_EQUAL(10u, rb.erase_if([](int i) { return i % 2 == 0; }));
+        VERIFY_ARE_EQUAL((std::vector{ 11, 13, 15, 17, 19, 21, 23, 25, 27, 29 }), contents(rb));
+    }
+
+    TEST_METHOD(CopyToOffset)
+    {
+        til::ring_buffer<int> rb;
+        for (auto i = 0; i < 10; ++i)
+        {
+            rb.push_front(i);
+        }
+
+        std::array<int, 4> dest{};
+        VERIFY_ARE_EQUAL(4u, rb.copy_to(2, dest));
+        VERIFY_ARE_EQUAL((std::array{ 7, 6, 5, 4 }), dest);
+        VERIFY_ARE_EQUAL(2u, rb.copy_to(8, dest));
+        VERIFY_ARE_EQUAL(0u, rb.copy_to(20, dest));
+    }
+};
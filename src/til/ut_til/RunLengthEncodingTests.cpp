@@ -601,4 +601,222 @@ class RunLengthEncodingTests
             VERIFY_ARE_EQUAL(-static_cast<difference_type>(1), lower - upper);
         }
     }
+
+    TEST_METHOD(ReplaceRanges)
+    {
+        struct TestCase
+        {
+            std::string_view source;
+            std::vector<rle_vector::range_type> ranges;
+            std::string_view expected;
+        };
+
+        const std::array<TestCase, 7> test_cases{
+            {
+                // no ranges
+                { "1|3 3|2|1 1 1|5 5", {}, "1|3 3|2|1 1 1|5 5" },
+                // empty ranges
+                { "1|3 3|2|1 1 1|5 5", { { 0, 0, 6 }, { 4, 4, 6 }, { 9, 9, 6 } }, "1|3 3|2|1 1 1|5 5" },
+                // all
+                { "1|3 3|2|1 1 1|5 5", { { 0, 9, 6 } }, "6 6 6 6 6 6 6 6 6" },
+                // within runs
+                { "1|3 3|2|1 1 1|5 5", { { 2, 3, 6 }, { 5, 6, 7 }, { 8, 9, 8 } }, "1|3|6|2|1|7|1|5|8" },
+                // join with each other and with existing runs
+                { "1|3 3|2|1 1 1|5 5", { { 1, 3, 1 }, { 3, 4, 1 }, { 7, 8, 5 } }, "1 1 1 1 1 1 1|5 5" },
+                // adjacent ranges with distinct values
+                { "1|3 3|2|1 1 1|5 5", { { 0, 2, 6 }, { 2, 4, 7 }, { 4, 9, 8 } }, "6 6|7 7|8 8 8 8 8" },
+                // end_index past size()
+                { "1|3 3|2|1 1 1|5 5", { { 7, 100, 6 } }, "1|3 3|2|1 1 1|6 6" },
+            }
+        };
+
+        auto idx = 0;
+
+        for (const auto& test_case : test_cases)
+        {
+            rle_vector rle{ rle_encode(test_case.source) };
+            rle.replace_ranges(test_case.ranges);
+
+            VERIFY_ARE_EQUAL(
+                test_case.expected,
+                rle,
+                NoThrowString().Format(
+                    L"test case: %d\nexpected:  %hs\nactual:    %s",
+                    idx,
+                    test_case.expected.data(),
+                    rle.to_string().c_str()));
+
+            ++idx;
+        }
+
+        // overlapping or unsorted ranges
+        rle_vector rle{ rle_encode("1|3 3|2|1 1 1|5 5"sv) };
+        const std::array<rle_vector::range_type, 2> overlapping{ { { 0, 3, 6 }, { 2, 4, 7 } } };
+        const std::array<rle_vector::range_type, 2> unsorted{ { { 4, 5, 6 }, { 0, 1, 7 } } };
+        const std::array<rle_vector::range_type, 1> inverted{ { { 5, 4, 6 } } };
+        VERIFY_THROWS(rle.replace_ranges(overlapping), std::out_of_range);
+        VERIFY_THROWS(rle.replace_ranges(unsorted), std::out_of_range);
+        VERIFY_THROWS(rle.replace_ranges(inverted), std::out_of_range);
+        VERIFY_ARE_EQUAL("1|3 3|2|1 1 1|5 5"sv, rle);
+    }
+
+    // Rows with at least index_threshold runs use a prefix sum for lookups, which is only partially
+    // invalidated by modifications. This compares random modifications with an uncompressed copy.
+    TEST_METHOD(RandomWithIndex)
+    {
+        static constexpr size_type width = 300;
+
+        basic_container expected(width, 0);
+        rle_vector rle{ width, 0 };
+        uint32_t state = 1;
+
+        const auto random = [&](uint32_t max) {
+            // A 32-bit xor-shift random number generator.
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state % max;
+        };
+
+        const auto verify = [&]() {
+            // Using the const overload of runs(), because the other one discards the index.
+            VERIFY_IS_TRUE(expected == rle_decode(std::as_const(rle).runs()));
+            for (size_type i = 0; i < expected.size(); ++i)
+            {
+                VERIFY_ARE_EQUAL(expected[i], rle.at(i));
+            }
+            VERIFY_THROWS(rle.at(gsl::narrow_cast<size_type>(expected.size())), std::out_of_range);
+        };
+
+        // Colorize the row from left to right, like a program that changes its colors for every few columns.
+        for (size_type i = 0; i < width; i += 2)
+        {
+            const auto value = gsl::narrow_cast<value_type>(i % 7);
+            rle.replace(i, i + 2, value);
+            expected[i] = value;
+            expected[i + 1] = value;
+        }
+        VERIFY_IS_TRUE(std::as_const(rle).runs().size() >= rle_vector::index_threshold);
+        verify();
+
+        for (auto i = 0; i < 2000; ++i)
+        {
+            const auto size = gsl::narrow_cast<size_type>(expected.size());
+
+            switch (random(4))
+            {
+            case 0:
+            {
+                // TODO GH#10135: replace() doesn't support empty ranges yet (it inserts runs with a length of 0).
+                const auto begin = gsl::narrow_cast<size_type>(random(size));
+                const auto end = gsl::narrow_cast<size_type>(begin + 1 + random(size - begin));
+                const auto value = gsl::narrow_cast<value_type>(random(8));
+                rle.replace(begin, end, value);
+                std::fill(expected.begin() + begin, expected.begin() + end, value);
+                break;
+            }
+            case 1:
+            {
+                std::vector<rle_vector::range_type> ranges;
+                for (size_type pos = gsl::narrow_cast<size_type>(random(8)); pos < size; pos += gsl::narrow_cast<size_type>(random(8)))
+                {
+                    const auto end = std::min<size_type>(size, gsl::narrow_cast<size_type>(pos + random(4)));
+                    const auto value = gsl::narrow_cast<value_type>(random(8));
+                    ranges.push_back({ pos, end, value });
+                    std::fill(expected.begin() + pos, expected.begin() + end, value);
+                    pos = end;
+                }
+                rle.replace_ranges(ranges);
+                break;
+            }
+            case 2:
+            {
+                const auto begin = gsl::narrow_cast<size_type>(random(size + 1));
+                const auto end = gsl::narrow_cast<size_type>(begin + random(size - begin + 1));
+                VERIFY_IS_TRUE(expected.substr(begin, end - begin) == rle_decode(rle.slice(begin, end).runs()));
+                break;
+            }
+            default:
+            {
+                const auto new_size = gsl::narrow_cast<size_type>(width - 20 + random(40));
+                rle.resize_trailing_extent(new_size);
+                expected.resize(new_size, expected.back());
+                break;
+            }
+            }
+
+            verify();
+        }
+    }
+
+    BEGIN_TEST_METHOD(Benchmark)
+        TEST_METHOD_PROPERTY(L"Ignore", L"true")
+    END_TEST_METHOD()
 };
+
+// Simulates rows written by programs that change the SGR attributes every few columns,
+// for instance syntax highlighted diffs or colored directory listings.
+void RunLengthEncodingTests::Benchmark()
+{
+    using clock = std::chrono::steady_clock;
+    using attr_rle = til::small_rle<uint64_t, uint16_t, 1>;
+
+    const auto measure = [](const wchar_t* name, size_t ops, auto&& func) {
+        static constexpr size_t rounds = 200;
+        uint64_t sink = 0;
+
+        const auto beg = clock::now();
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            sink += func();
+        }
+        const auto end = clock::now();
+
+        const auto ns = std::chrono::duration<double, std::nano>(end - beg).count() / (rounds * ops);
+        Log::Comment(NoThrowString().Format(L"%-48s %8.2f ns/op (%llu)", name, ns, sink));
+    };
+
+    for (const uint16_t width : { uint16_t{ 120 }, uint16_t{ 1000 } })
+    {
+        for (const uint16_t columnsPerRun : { uint16_t{ 8 }, uint16_t{ 1 } })
+        {
+            const auto runs = width / columnsPerRun;
+            std::vector<attr_rle::range_type> ranges;
+            for (uint16_t x = 0; x < width; x += columnsPerRun)
+            {
+                ranges.push_back({ x, gsl::narrow_cast<uint16_t>(x + columnsPerRun), x / columnsPerRun % 2 + 1u });
+            }
+
+            attr_rle row{ width, 0 };
+
+            Log::Comment(NoThrowString().Format(L"%u columns, %u runs:", width, runs));
+
+            measure(L"  write runs left to right with replace()", runs, [&]() {
+                row = attr_rle{ width, 0 };
+                for (const auto& r : ranges)
+                {
+                    row.replace(r.begin, r.end, r.value);
+                }
+                return std::as_const(row).runs().size();
+            });
+            measure(L"  write runs with a single replace_ranges()", runs, [&]() {
+                row = attr_rle{ width, 0 };
+                row.replace_ranges(ranges);
+                return std::as_const(row).runs().size();
+            });
+            measure(L"  at() for each column", width, [&]() {
+                uint64_t sum = 0;
+                for (uint16_t x = 0; x < width; ++x)
+                {
+                    sum += row.at(x);
+                }
+                return sum;
+            });
+            measure(L"  replace() a single column in the middle", 2, [&]() {
+                row.replace(width / 2, width / 2 + 1, 3);
+                row.replace(width / 2, width / 2 + 1, 4);
+                return std::as_const(row).runs().size();
+            });
+        }
+    }
+}
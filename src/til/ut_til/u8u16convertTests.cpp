@@ -17,6 +17,10 @@ class Utf8Utf16ConvertTests
     TEST_METHOD(TestU8ToU16Partials);
     TEST_METHOD(TestU16ToU8Partials);
     TEST_METHOD(TestU8ToU16OneByOne);
+    TEST_METHOD(TestU8ToU16Blocks);
+    TEST_METHOD(TestU16ToU8Blocks);
+    TEST_METHOD(TestU8ToU16Invalid);
+    TEST_METHOD(TestU16ToU8Invalid);
 };
 
 void Utf8Utf16ConvertTests::TestU8ToU16()
@@ -191,3 +195,99 @@ void Utf8Utf16ConvertTests::TestU8ToU16OneByOne()
     VERIFY_SUCCEEDED(til::u8u16(u8String1_4, u16Out1, state));
     VERIFY_ARE_EQUAL(u16StringComp1, u16Out1);
 }
+
+void Utf8Utf16ConvertTests::TestU8ToU16Blocks()
+{
+    // The ASCII fast path processes up to 32 bytes at a time. Move a non-ASCII
+    // character across all block boundaries to test the transitions between the paths.
+    for (size_t offset = 0; offset < 70; ++offset)
+    {
+        std::string u8String(offset, 'a');
+        u8String.append("\xE2\x82\xAC"); // EURO SIGN
+        u8String.append(70 - offset, 'b');
+
+        std::wstring u16StringComp(offset, L'a');
+        u16StringComp.push_back(gsl::narrow_cast<wchar_t>(0x20AC));
+        u16StringComp.append(70 - offset, L'b');
+
+        std::wstring u16Out{};
+        VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+        VERIFY_ARE_EQUAL(u16StringComp, u16Out);
+    }
+}
+
+void Utf8Utf16ConvertTests::TestU16ToU8Blocks()
+{
+    // See TestU8ToU16Blocks.
+    for (size_t offset = 0; offset < 40; ++offset)
+    {
+        std::wstring u16String(offset, L'a');
+        u16String.push_back(gsl::narrow_cast<wchar_t>(0x20AC)); // EURO SIGN
+        u16String.append(40 - offset, L'b');
+
+        std::string u8StringComp(offset, 'a');
+        u8StringComp.append("\xE2\x82\xAC");
+        u8StringComp.append(40 - offset, 'b');
+
+        std::string u8Out{};
+        VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+        VERIFY_ARE_EQUAL(u8StringComp, u8Out);
+    }
+}
+
+void Utf8Utf16ConvertTests::TestU8ToU16Invalid()
+{
+    // Every maximal subpart of an ill-formed sequence is replaced with a single U+FFFD.
+    const std::string u8String{
+        '\x80', // lone continuation byte
+        '\xC0', // never valid
+        '\xAF',
+        '\xE0', // overlong encoding
+        '\x80',
+        '\xAF',
+        '\xED', // surrogate
+        '\xA0',
+        '\x80',
+        '\xF4', // beyond U+10FFFF
+        '\x90',
+        '\x80',
+        '\x80',
+        '\xE2', // truncated EURO SIGN
+        '\x82',
+        '\x41' // LATIN CAPITAL LETTER A
+    };
+
+    const std::wstring u16StringComp{ L"\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\xFFFD\x41" };
+
+    std::wstring u16Out{};
+    VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+    VERIFY_ARE_EQUAL(u16StringComp, u16Out);
+
+    // A cached partial which isn't continued must not swallow the next character.
+    til::u8state state{};
+    VERIFY_SUCCEEDED(til::u8u16("\xE2\x82", u16Out, state));
+    VERIFY_ARE_EQUAL(L"", u16Out);
+    VERIFY_SUCCEEDED(til::u8u16("A", u16Out, state));
+    VERIFY_ARE_EQUAL(L"\xFFFD" L"A", u16Out);
+}
+
+void Utf8Utf16ConvertTests::TestU16ToU8Invalid()
+{
+    // Unpaired surrogates are replaced with U+FFFD.
+    const std::wstring u16String{
+        gsl::narrow_cast<wchar_t>(0xDF5C), // low surrogate only
+        gsl::narrow_cast<wchar_t>(0xD853), // high surrogate only
+        gsl::narrow_cast<wchar_t>(0x0041) // LATIN CAPITAL LETTER A
+    };
+
+    std::string u8Out{};
+    VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+    VERIFY_ARE_EQUAL("\xEF\xBF\xBD\xEF\xBF\xBD" "A", u8Out);
+
+    // A cached high surrogate which isn't followed by a low surrogate must not swallow the next character.
+    til::u16state state{};
+    VERIFY_SUCCEEDED(til::u16u8(std::wstring_view{ L"\xD853", 1 }, u8Out, state));
+    VERIFY_ARE_EQUAL("", u8Out);
+    VERIFY_SUCCEEDED(til::u16u8(L"A", u8Out, state));
+    VERIFY_ARE_EQUAL("\xEF\xBF\xBD" "A", u8Out);
+}
@@ -148,6 +148,24 @@ static constexpr Benchmark s_benchmarks[] = {
             static constexpr COORD size{ 64, 64 };
             static constexpr SMALL_RECT rect{ 0, 0, 63, 63 };
 
+            while (ctx.wants_more())
+            {
+                auto written = rect;
+
+                ctx.mark_beg();
+                const auto res = WriteConsoleOutputW(ctx.output, ctx.char_4Ki.data(), size, pos, &written);
+                ctx.mark_end();
+                debugAssert(res == TRUE);
+            }
+        },
+    },
+    Benchmark{
+        .title = "WriteConsoleOutputW full rows",
+        .exec = [](BenchmarkContext& ctx) {
+            static constexpr COORD pos{ 0, 0 };
+            static constexpr COORD size{ s_buffer_size.X, 4096 / s_buffer_size.X };
+            static constexpr SMALL_RECT rect{ 0, 0, size.X - 1, size.Y - 1 };
+
             while (ctx.wants_more())
             {
                 auto written = rect;
@@ -341,6 +359,28 @@ static constexpr Benchmark s_benchmarks[] = {
             }
         },
     },
+    Benchmark{
+        .title = "ReadConsoleOutputW full rows",
+        .exec = [](BenchmarkContext& ctx) {
+            static constexpr COORD pos{ 0, 0 };
+            static constexpr COORD size{ s_buffer_size.X, 4096 / s_buffer_size.X };
+            static constexpr SMALL_RECT rect{ 0, 0, size.X - 1, size.Y - 1 };
+            const auto scratch = mem::get_scratch_arena(ctx.arena);
+            const auto buf = scratch.arena.push_uninitialized<CHAR_INFO>(size.X * size.Y);
+
+            WriteConsoleW(ctx.output, ctx.utf16_128Ki.data(), static_cast<DWORD>(ctx.utf16_128Ki.size()), nullptr, nullptr);
+
+            while (ctx.wants_more())
+            {
+                auto read = rect;
+
+                ctx.mark_beg();
+                ReadConsoleOutputW(ctx.output, buf, size, pos, &read);
+                ctx.mark_end();
+                debugAssert(read.Right == rect.Right && read.Bottom == rect.Bottom);
+            }
+        },
+    },
 #endif
 #if ENABLE_TEST_INPUT
     Benchmark{
@@ -3,6 +3,8 @@
 // NOTE The functions u8u16 and u16u8 contain own algorithms. Tests have shown that they perform
 // worse than the platform API functions.
 // Thus, these functions are *unrelated* to the til::u8u16 and til::u16u8 implementation.
+// The til::u8u16 and til::u16u8 functions are benchmarked alongside them, as they replaced
+// the platform API functions with a SIMD implementation.
 
 #include <iostream>
 #include <memory>
@@ -13,6 +15,8 @@
 
 #include "U8U16Test.hpp"
 
+#include <LibraryIncludes.h>
+
 typedef NTSTATUS(WINAPI* t_RtlUTF8ToUnicodeN)(PWSTR, ULONG, PULONG, PCCH, ULONG);
 typedef NTSTATUS(WINAPI* t_RtlUnicodeToUTF8N)(PCHAR, ULONG, PULONG, PCWSTR, ULONG);
 NTSTATUS(WINAPI* p_RtlUTF8ToUnicodeN)
@@ -85,6 +89,18 @@ void u16u8_ptr_WholeString(std::wstring_view testU16, std::string& u8Str)
               << "\n HRESULT " << hRes << "\n length " << u8Str.length() << "\n elapsed " << duration << std::endl;
 }
 
+void til_u16u8_WholeString(std::wstring_view testU16)
+{
+    PrintHeader(__func__);
+    GetDuration();
+    std::string u8Str{};
+    const HRESULT hRes = til::u16u8(testU16, u8Str);
+    const double duration = GetDuration();
+    const char randElem8 = u8Str.at(RandomIndex(static_cast<ptrdiff_t>(u8Str.length())));
+    std::cout << " ignore me " << static_cast<int>(static_cast<unsigned char>(randElem8))
+              << "\n HRESULT " << hRes << "\n length " << u8Str.length() << "\n elapsed " << duration << std::endl;
+}
+
 void WideCharToMultiByte_Chunks(std::wstring_view testU16, size_t u8CharLen, size_t chunkLen)
 {
     PrintHeader(__func__);
@@ -182,6 +198,30 @@ void u16u8_ptr_Chunks(std::wstring_view testU16, size_t chunkLen)
               << "\n HRESULT " << hRes << "\n length " << length << "\n elapsed " << duration << std::endl;
 }
 
+void til_u16u8_Chunks(std::wstring_view testU16, size_t chunkLen)
+{
+    PrintHeader(__func__);
+    const size_t endLoop{ testU16.length() / chunkLen };
+    double duration{};
+    size_t length{};
+    HRESULT hRes{};
+    std::string u8Str{};
+    til::u16state state{};
+
+    for (size_t i{}; i < endLoop; ++i)
+    {
+        const std::wstring_view sv{ &testU16.at(i), chunkLen };
+        GetDuration();
+        hRes = til::u16u8(sv, u8Str, state);
+        duration += GetDuration();
+        length += u8Str.length();
+    }
+
+    const char randElem8 = u8Str.at(RandomIndex(static_cast<ptrdiff_t>(u8Str.length())));
+    std::cout << " ignore me " << static_cast<int>(static_cast<unsigned char>(randElem8))
+              << "\n HRESULT " << hRes << "\n length " << length << "\n elapsed " << duration << std::endl;
+}
+
 void MultiByteToWideChar_WholeString(std::string_view u8Str)
 {
     PrintHeader(__func__);
@@ -233,6 +273,18 @@ void u8u16_ptr_WholeString(std::string_view u8Str)
               << "\n HRESULT " << hRes << "\n length " << u16Str.length() << "\n elapsed " << duration << std::endl;
 }
 
+void til_u8u16_WholeString(std::string_view u8Str)
+{
+    PrintHeader(__func__);
+    GetDuration();
+    std::wstring u16Str{};
+    const HRESULT hRes = til::u8u16(u8Str, u16Str);
+    const double duration = GetDuration();
+    const wchar_t randElem16 = u16Str.at(RandomIndex(static_cast<ptrdiff_t>(u16Str.length())));
+    std::cout << " ignore me " << static_cast<int>(randElem16)
+              << "\n HRESULT " << hRes << "\n length " << u16Str.length() << "\n elapsed " << duration << std::endl;
+}
+
 void MultiByteToWideChar_Chunks(std::string_view u8Str, size_t u8CharLen, size_t u16ChunkLen)
 {
     PrintHeader(__func__);
@@ -330,6 +382,30 @@ void u8u16_ptr_Chunks(std::string_view u8Str, size_t u8CharLen, size_t u16ChunkL
               << "\n HRESULT " << hRes << "\n length " << length << "\n elapsed " << duration << std::endl;
 }
 
+void til_u8u16_Chunks(std::string_view u8Str, size_t u8CharLen, size_t u16ChunkLen)
+{
+    PrintHeader(__func__);
+    const size_t endLoop{ u8Str.length() / u16ChunkLen };
+    double duration{};
+    size_t length{};
+    HRESULT hRes{};
+    std::wstring u16Str{};
+    til::u8state state{};
+
+    for (size_t i{}; i < endLoop; i += u8CharLen)
+    {
+        const std::string_view sv{ &u8Str.at(i), u16ChunkLen * u8CharLen };
+        GetDuration();
+        hRes = til::u8u16(sv, u16Str, state);
+        duration += GetDuration();
+        length += u16Str.length();
+    }
+
+    const wchar_t randElem16 = u16Str.at(RandomIndex(static_cast<ptrdiff_t>(u16Str.length())));
+    std::cout << " ignore me " << static_cast<int>(randElem16)
+              << "\n HRESULT " << hRes << "\n length " << length << "\n elapsed " << duration << std::endl;
+}
+
 void CompNaturalLang_WholeString(const std::string& fileName)
 {
     std::string head{ __func__ };
@@ -354,6 +430,12 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     duration = GetDuration();
     std::cout << " u8u16_ptr           length " << u16Str.length() << " elapsed " << duration << std::endl;
 
+    GetDuration();
+    std::wstring u16StrTil{};
+    hRes = til::u8u16(u8Str, u16StrTil);
+    duration = GetDuration();
+    std::cout << " til::u8u16          length " << u16StrTil.length() << " elapsed " << duration << std::endl;
+
     GetDuration();
     std::unique_ptr<char[]> u8Buffer{ std::make_unique<char[]>(u16Str.length() * 3) };
     length = WideCharToMultiByte(65001, 0, u16Str.data(), static_cast<int>(u16Str.length()), u8Buffer.get(), static_cast<int>(u16Str.length()) * 3, nullptr, nullptr);
@@ -366,6 +448,12 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     hRes = u16u8_ptr(u16Str, u8StrOut);
     duration = GetDuration();
     std::cout << " u16u8_ptr           length " << u8StrOut.length() << " elapsed " << duration << std::endl;
+
+    GetDuration();
+    std::string u8StrTil{};
+    hRes = til::u16u8(u16Str, u8StrTil);
+    duration = GetDuration();
+    std::cout << " til::u16u8          length " << u8StrTil.length() << " elapsed " << duration << std::endl;
 }
 
 void CompNaturalLang_Chunks(const std::string& fileName)
@@ -391,10 +479,14 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     int lenTotalWC2MB{};
     size_t lenTotalU8U16{};
     size_t lenTotalU16U8{};
+    size_t lenTotalTilU8U16{};
+    size_t lenTotalTilU16U8{};
     double durTotalMB2WC{};
     double durTotalWC2MB{};
     double durTotalU8U16{};
     double durTotalU16U8{};
+    double durTotalTilU8U16{};
+    double durTotalTilU16U8{};
 
     GetDuration();
     std::unique_ptr<wchar_t[]> u16Buffer{ std::make_unique<wchar_t[]>(chunkSize) };
@@ -412,6 +504,9 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     std::string u8StrOut{};
     durTotalU16U8 += GetDuration();
 
+    til::u8state u8State{};
+    til::u16state u16State{};
+
     for (size_t idx = 0u; idx < u16Str.length(); idx += chunkSize)
     {
         std::wstring u16Chunk{ u16Str.substr(idx, chunkSize) };
@@ -434,12 +529,61 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         hRes = u16u8_ptr(u16Chunk, u8StrOut);
         durTotalU16U8 += GetDuration();
         lenTotalU16U8 += u8StrOut.length();
+
+        GetDuration();
+        hRes = til::u8u16(u8Chunk, u16StrOut, u8State);
+        durTotalTilU8U16 += GetDuration();
+        lenTotalTilU8U16 += u16StrOut.length();
+
+        GetDuration();
+        hRes = til::u16u8(u16Chunk, u8StrOut, u16State);
+        durTotalTilU16U8 += GetDuration();
+        lenTotalTilU16U8 += u8StrOut.length();
     }
 
     std::cout << " MultiByteToWideChar length " << lenTotalMB2WC << " elapsed " << durTotalMB2WC << std::endl;
     std::cout << " u8u16_ptr           length " << lenTotalU8U16 << " elapsed " << durTotalU8U16 << std::endl;
     std::cout << " WideCharToMultiByte length " << lenTotalWC2MB << " elapsed " << durTotalWC2MB << std::endl;
     std::cout << " u16u8_ptr           length " << lenTotalU16U8 << " elapsed " << durTotalU16U8 << std::endl;
+    std::cout << " til::u8u16          length " << lenTotalTilU8U16 << " elapsed " << durTotalTilU8U16 << std::endl;
+    std::cout << " til::u16u8          length " << lenTotalTilU16U8 << " elapsed " << durTotalTilU16U8 << std::endl;
+}
+
+// ASCII makes up the vast majority of terminal output and is what the SIMD fast paths of til::u8u16 and til::u16u8 are for.
+void CompAscii_WholeString(size_t length)
+{
+    PrintHeader(__func__);
+    std::string u8Str(length, '\0');
+    for (size_t i{}; i < length; ++i)
+    {
+        u8Str[i] = static_cast<char>(0x20 + i % 0x5F);
+    }
+
+    GetDuration();
+    std::unique_ptr<wchar_t[]> u16Buffer{ std::make_unique<wchar_t[]>(u8Str.length()) };
+    int len = MultiByteToWideChar(65001, 0, u8Str.data(), static_cast<int>(u8Str.length()), u16Buffer.get(), static_cast<int>(u8Str.length()));
+    double duration = GetDuration();
+    u16Buffer.reset();
+    std::cout << " MultiByteToWideChar length " << len << " elapsed " << duration << std::endl;
+
+    GetDuration();
+    std::wstring u16Str{};
+    HRESULT hRes = til::u8u16(u8Str, u16Str);
+    duration = GetDuration();
+    std::cout << " til::u8u16          length " << u16Str.length() << " elapsed " << duration << std::endl;
+
+    GetDuration();
+    std::unique_ptr<char[]> u8Buffer{ std::make_unique<char[]>(u16Str.length() * 3) };
+    len = WideCharToMultiByte(65001, 0, u16Str.data(), static_cast<int>(u16Str.length()), u8Buffer.get(), static_cast<int>(u16Str.length()) * 3, nullptr, nullptr);
+    duration = GetDuration();
+    u8Buffer.reset();
+    std::cout << " WideCharToMultiByte length " << len << " elapsed " << duration << std::endl;
+
+    GetDuration();
+    std::string u8StrOut{};
+    hRes = til::u16u8(u16Str, u8StrOut);
+    duration = GetDuration();
+    std::cout << " til::u16u8          length " << u8StrOut.length() << " elapsed " << duration << std::endl;
 }
 
 int main()
@@ -480,6 +624,7 @@ int main()
     RtlUnicodeToUTF8N_WholeString(testU16);
     u16u8_WholeString(testU16, u8Str);
     u16u8_ptr_WholeString(testU16, u8Str);
+    til_u16u8_WholeString(testU16);
 
     const size_t u8CharLen{ u8Str.length() / testU16.length() };
     const size_t u8ChunkLen{ u8CharLen * chunkLen };
@@ -494,6 +639,7 @@ int main()
     RtlUnicodeToUTF8N_Chunks(testU16, u8CharLen, chunkLen);
     u16u8_Chunks(testU16, chunkLen);
     u16u8_ptr_Chunks(testU16, chunkLen);
+    til_u16u8_Chunks(testU16, chunkLen);
 
     std::cout << "\n\n### UTF-8 To UTF-16 ###" << std::endl;
 
@@ -501,11 +647,17 @@ int main()
     RtlUTF8ToUnicodeN_WholeString(u8Str);
     u8u16_WholeString(u8Str);
     u8u16_ptr_WholeString(u8Str);
+    til_u8u16_WholeString(u8Str);
 
     MultiByteToWideChar_Chunks(u8Str, u8CharLen, chunkLen);
     RtlUTF8ToUnicodeN_Chunks(u8Str, u8CharLen, chunkLen);
     u8u16_Chunks(u8Str, u8CharLen, chunkLen);
     u8u16_ptr_Chunks(u8Str, u8CharLen, chunkLen);
+    til_u8u16_Chunks(u8Str, u8CharLen, chunkLen);
+
+    std::cout << "\n\n### ASCII ###" << std::endl;
+
+    CompAscii_WholeString(u16Length);
 
     std::cout << "\n\n### Natural Languages ###" << std::endl;
 
@@ -50,3 +50,43 @@ void NotifyGlyphWidthFontChanged() noexcept
 {
     widthDetector.NotifyFontChanged();
 }
+
+// Function Description:
+// - Advances `state` to the grapheme cluster that follows the current one
+//   in `chars`. See CodepointWidthDetector::GraphemeNext.
+// Arguments:
+// - state - the current position, which receives the next grapheme cluster and its width
+// - chars - the text to segment
+// Return Value:
+// - false if there are no more grapheme clusters in chars
+bool GraphemeClusterNext(GraphemeState& state, const std::wstring_view& chars) noexcept
+{
+    return widthDetector.GraphemeNext(state, chars);
+}
+
+// Function Description:
+// - Advances `state` over the next run of grapheme clusters in `chars`, all but the last
+//   of which consist of a single codepoint. See CodepointWidthDetector::GraphemeNextRun.
+// Arguments:
+// - state - the current position, which receives the offsets of the run
+// - chars - the text to segment
+// - widths - receives the widths of the grapheme clusters in the run
+// Return Value:
+// - the number of grapheme clusters in the run, or 0 if there are no more in chars
+size_t GraphemeClusterNextRun(GraphemeState& state, const std::wstring_view& chars, std::span<uint8_t> widths) noexcept
+{
+    return widthDetector.GraphemeNextRun(state, chars, widths);
+}
+
+// Function Description:
+// - Returns the offset of the grapheme cluster that precedes `position`
+//   in `chars`. See CodepointWidthDetector::GraphemePrev.
+// Arguments:
+// - chars - the text to segment
+// - position - the offset of the start of a grapheme cluster in chars
+// Return Value:
+// - the offset of the previous grapheme cluster, or 0
+size_t GraphemeClusterPrev(const std::wstring_view& chars, size_t position) noexcept
+{
+    return CodepointWidthDetector::GraphemePrev(chars, position);
+}
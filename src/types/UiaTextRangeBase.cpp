@@ -4,6 +4,8 @@
 #include "precomp.h"
 #include "UiaTextRangeBase.hpp"
 
+#include <til/arena.h>
+
 #include "UiaTracing.h"
 
 using namespace Microsoft::Console::Types;
@@ -864,7 +866,9 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
         // vector to put coords into. they go in as four doubles in the
         // order: left, top, width, height. each line will have its own
         // set of coords.
-        std::vector<double> coords;
+        const auto scratch = til::get_scratch_arena();
+        til::arena_resource scratchResource{ scratch };
+        std::pmr::vector<double> coords{ &scratchResource };
 
         // GH#6402: Get the actual buffer size here, instead of the one
         //          constrained by the virtual bottom.
@@ -898,6 +902,7 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
         else
         {
             const auto textRects = buffer.GetTextRects(startAnchor, endAnchor, _blockRange, true);
+            coords.reserve(textRects.size() * 4);
 
             for (const auto& rect : textRects)
             {
@@ -916,17 +921,18 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
         {
             return E_OUTOFMEMORY;
         }
-        auto hr = E_UNEXPECTED;
-        const auto l = gsl::narrow<LONG>(coords.size());
-        for (LONG i = 0; i < l; ++i)
+        if (!coords.empty())
         {
-            hr = SafeArrayPutElement(*ppRetVal, &i, &coords.at(i));
+            void* data = nullptr;
+            const auto hr = SafeArrayAccessData(*ppRetVal, &data);
             if (FAILED(hr))
             {
                 SafeArrayDestroy(*ppRetVal);
                 *ppRetVal = nullptr;
                 return hr;
             }
+            memcpy(data, coords.data(), coords.size() * sizeof(double));
+            SafeArrayUnaccessData(*ppRetVal);
         }
     }
     CATCH_RETURN();
@@ -1364,7 +1370,7 @@ til::point UiaTextRangeBase::_getDocumentEnd() const
 // - coords - vector to add the calculated coords to
 // Return Value:
 // - <none>
-void UiaTextRangeBase::_getBoundingRect(const til::rect& textRect, _Inout_ std::vector<double>& coords) const
+void UiaTextRangeBase::_getBoundingRect(const til::rect& textRect, _Inout_ std::pmr::vector<double>& coords) const
 {
     const auto currentFontSize = _getScreenFontSize();
 
@@ -148,7 +148,7 @@ namespace Microsoft::Console::Types
         Viewport _getOptimizedBufferSize() const noexcept;
         til::point _getDocumentEnd() const;
 
-        void _getBoundingRect(const til::rect& textRect, _Inout_ std::vector<double>& coords) const;
+        void _getBoundingRect(const til::rect& textRect, _Inout_ std::pmr::vector<double>& coords) const;
 
         void _expandToEnclosingUnit(TextUnit unit);
 
@@ -15,6 +15,10 @@ Author:
 
 #include "convert.hpp"
 
+#include <span>
+
+#include <til/flat_map.h>
+
 // use to measure the width of a codepoint
 class CodepointWidthDetector final
 {
@@ -24,6 +28,10 @@ public:
     void SetFallbackMethod(std::function<bool(const std::wstring_view&)> pfnFallback) noexcept;
     void NotifyFontChanged() noexcept;
 
+    bool GraphemeNext(GraphemeState& state, const std::wstring_view& str) noexcept;
+    size_t GraphemeNextRun(GraphemeState& state, const std::wstring_view& str, std::span<uint8_t> widths) noexcept;
+    static size_t GraphemePrev(const std::wstring_view& str, size_t offset) noexcept;
+
 #ifdef UNIT_TESTING
     friend class CodepointWidthDetectorTests;
 #endif
@@ -31,7 +39,9 @@ public:
 private:
     uint8_t _lookupGlyphWidth(char32_t codepoint, const std::wstring_view& glyph) noexcept;
     uint8_t _checkFallbackViaCache(char32_t codepoint, const std::wstring_view& glyph) noexcept;
+    bool _graphemeNextSlow(GraphemeState& state, const std::wstring_view& str) noexcept;
+    static size_t _graphemeNext(const std::wstring_view& str, size_t offset, bool& emojiPresentation) noexcept;
 
-    std::unordered_map<char32_t, uint8_t> _fallbackCache;
+    til::flat_map<char32_t, uint8_t> _fallbackCache;
     std::function<bool(const std::wstring_view&)> _pfnFallbackMethod;
 };
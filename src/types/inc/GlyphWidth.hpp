@@ -11,6 +11,7 @@ Abstract:
 #pragma once
 
 #include <functional>
+#include <span>
 #include <string_view>
 
 #include "convert.hpp"
@@ -19,3 +20,6 @@ bool IsGlyphFullWidth(const std::wstring_view& glyph) noexcept;
 bool IsGlyphFullWidth(const wchar_t wch) noexcept;
 void SetGlyphWidthFallback(std::function<bool(const std::wstring_view&)> pfnFallback) noexcept;
 void NotifyGlyphWidthFontChanged() noexcept;
+bool GraphemeClusterNext(GraphemeState& state, const std::wstring_view& chars) noexcept;
+size_t GraphemeClusterNextRun(GraphemeState& state, const std::wstring_view& chars, std::span<uint8_t> widths) noexcept;
+size_t GraphemeClusterPrev(const std::wstring_view& chars, size_t position) noexcept;
@@ -24,6 +24,22 @@ enum class CodepointWidth : BYTE
     Wide,
 };
 
+// The iteration state of CodepointWidthDetector::GraphemeNext(), which walks through a string one
+// grapheme cluster at a time. Set `end` to the offset to start at (usually 0) and call it in a loop.
+struct GraphemeState
+{
+    // The offsets of the grapheme cluster that was found.
+    size_t beg = 0;
+    size_t end = 0;
+    // The number of columns the grapheme cluster occupies.
+    int width = 0;
+
+    // GraphemeNext() needs to look at the first codepoint of the next cluster to find the end of the current one.
+    // It's cached here so that the next call doesn't need to look up its properties again.
+    char32_t _nextCodepoint = 0x110000;
+    uint8_t _nextProperties = 0;
+};
+
 [[nodiscard]] std::wstring ConvertToW(const UINT codepage,
                                       const std::string_view source);
 
@@ -5,9 +5,21 @@
 # (we use the null coalescing operator)
 
 ################################################################################
-# This script generates the an array suitable for replacing the body of
+# This script generates the lookup tables suitable for replacing the body of
 # src/types/CodepointWidthDetector.cpp from a Unicode UCD XML document[1]
-# compliant with UAX#42[2].
+# compliant with UAX#42[2]. The tables form a 3-stage trie: The properties of
+# every codepoint are packed into a byte, split into blocks of 2 codepoints and
+# deduplicated (stage 3). The resulting list of block indices is then split
+# and deduplicated again in blocks of 128 (stage 2), which leaves an index
+# of 4352 entries for the upper bits of the codepoint (stage 1).
+#
+# Each byte contains the Grapheme_Cluster_Break property in the lower 4 bits
+# (with Extended_Pictographic folded in as an additional value), the
+# Indic_Conjunct_Break property in the next 2 bits and the width in the upper
+# 2 bits. The cluster properties are used to implement the extended grapheme
+# cluster boundary rules of UAX#29[3]. All Hangul syllables are stored as LV,
+# because the LV/LVT pattern repeats every 28 codepoints which would defeat the
+# deduplication. CodepointWidthDetector derives LVT at runtime.
 #
 # This script supports a quasi-mandatory "overrides" file, overrides.xml.
 # If you do not have overrides, supply the -NoOverrides parameter. This was
@@ -25,6 +37,7 @@
 #
 # [1]: https://www.unicode.org/Public/UCD/latest/ucdxml/
 # [2]: https://www.unicode.org/reports/tr42/
+# [3]: https://www.unicode.org/reports/tr29/
 
 [Diagnostics.CodeAnalysis.SuppressMessageAttribute('PSAvoidUsingPositionalParameters', '')]
 [Diagnostics.CodeAnalysis.SuppressMessageAttribute('PSUseProcessBlockForPipelineCommand', '')]
@@ -52,6 +65,33 @@ Enum CodepointWidth {
     Ambiguous;
 }
 
+# The order must match the ClusterBreak enum in CodepointWidthDetector.cpp.
+Enum ClusterBreak {
+    Other;
+    CR;
+    LF;
+    Control;
+    Extend;
+    ZWJ;
+    RI;
+    Prepend;
+    SpacingMark;
+    L;
+    V;
+    T;
+    LV;
+    LVT;
+    ExtPic;
+}
+
+# The order must match the IndicConjunctBreak enum in CodepointWidthDetector.cpp.
+Enum IndicConjunctBreak {
+    None;
+    Linker;
+    Consonant;
+    Extend;
+}
+
 # UCD Functions {{{
 Function Get-UCDEntryRange($entry) {
     $s = $e = 0
@@ -84,6 +124,41 @@ Function Get-UCDEntryWidth($entry) {
     }
 }
 
+Function Get-UCDEntryClusterBreak($entry) {
+    If ($entry.ExtPict -eq "Y") {
+        [ClusterBreak]::ExtPic
+        Return
+    }
+
+    Switch($entry.GCB) {
+        "XX"  { [ClusterBreak]::Other; Return }
+        "CR"  { [ClusterBreak]::CR; Return }
+        "LF"  { [ClusterBreak]::LF; Return }
+        "CN"  { [ClusterBreak]::Control; Return }
+        "EX"  { [ClusterBreak]::Extend; Return }
+        "ZWJ" { [ClusterBreak]::ZWJ; Return }
+        "RI"  { [ClusterBreak]::RI; Return }
+        "PP"  { [ClusterBreak]::Prepend; Return }
+        "SM"  { [ClusterBreak]::SpacingMark; Return }
+        "L"   { [ClusterBreak]::L; Return }
+        "V"   { [ClusterBreak]::V; Return }
+        "T"   { [ClusterBreak]::T; Return }
+        # Hangul syllables: See the comment at the top.
+        "LV"  { [ClusterBreak]::LV; Return }
+        "LVT" { [ClusterBreak]::LV; Return }
+        default { throw "Unexpected Grapheme_Cluster_Break property" }
+    }
+}
+
+Function Get-UCDEntryIndicConjunctBreak($entry) {
+    Switch($entry.InCB) {
+        "Linker"    { [IndicConjunctBreak]::Linker; Return }
+        "Consonant" { [IndicConjunctBreak]::Consonant; Return }
+        "Extend"    { [IndicConjunctBreak]::Extend; Return }
+        default     { [IndicConjunctBreak]::None; Return }
+    }
+}
+
 Function Get-UCDEntryFlags($entry) {
     If ($script:Pack) {
         # If we're "pack"ing entries, only the computed width matters for telling them apart
@@ -255,6 +330,64 @@ ForEach($_ in $ranges) {
     $c += $_.End - $_.Start + 1
 }
 
+# Expand the ranges into the width of every single codepoint: 1 = narrow, 2 = wide, 3 = ambiguous.
+$widths = [byte[]]::New(0x110000)
+[Array]::Fill($widths, [byte]1)
+ForEach($_ in $ranges) {
+    $value = $_.Width -eq [CodepointWidth]::Ambiguous ? 3 : 2
+    For($i = $_.Start; $i -le $_.End; $i++) {
+        $widths[$i] = $value
+    }
+}
+
+# Merge in the grapheme cluster properties. Overrides only ever affect the width.
+$properties = [byte[]]::New(0x110000)
+For($i = 0; $i -lt $properties.Length; $i++) {
+    $properties[$i] = $widths[$i] -shl 6
+}
+ForEach($v in $UCDRepertoire) {
+    $s, $e = Get-UCDEntryRange $v
+    $value = [byte](Get-UCDEntryClusterBreak $v) -bor ([byte](Get-UCDEntryIndicConjunctBreak $v) -shl 4)
+    For($i = $s; $i -le $e; $i++) {
+        $properties[$i] = $properties[$i] -bor $value
+    }
+}
+
+# Splits $Data into blocks of $BlockSize and deduplicates them.
+# Returns the list of block indices and the concatenated unique blocks.
+Function Split-DedupedBlocks([byte[]]$Data, [int]$BlockSize) {
+    $known = [System.Collections.Generic.Dictionary[string, int]]::New()
+    $indices = [System.Collections.Generic.List[byte]]::New()
+    $blocks = [System.Collections.Generic.List[byte]]::New()
+    For($i = 0; $i -lt $Data.Length; $i += $BlockSize) {
+        $key = [Convert]::ToBase64String($Data, $i, $BlockSize)
+        $index = 0
+        If (-not $known.TryGetValue($key, [ref]$index)) {
+            $index = $known.Count
+            If ($index -gt 255) {
+                throw "Too many unique blocks of size $BlockSize for a byte sized index"
+            }
+            $known.Add($key, $index)
+            $blocks.AddRange([System.ArraySegment[byte]]::New($Data, $i, $BlockSize))
+        }
+        $indices.Add([byte]$index)
+    }
+    ,$indices.ToArray()
+    ,$blocks.ToArray()
+}
+
+$stage3Indices, $stage3 = Split-DedupedBlocks $properties 2
+$stage1, $stage2 = Split-DedupedBlocks $stage3Indices 128
+
+Function Format-Table([string]$Name, [byte[]]$Data) {
+"    static constexpr std::array<uint8_t, {0}> {1}{{" -f $Data.Length, $Name
+For($i = 0; $i -lt $Data.Length; $i += 32) {
+    $end = [Math]::Min($i + 32, $Data.Length) - 1
+"        {0}," -f (($Data[$i..$end] | ForEach-Object { "0x{0:x2}" -f $_ }) -join ", ")
+}
+"    };"
+}
+
 # Emit Code
 "    // Generated by {0} -Pack:{1} -Full:{2} -NoOverrides:{3}" -f $MyInvocation.MyCommand.Name, $Pack, $Full, $NoOverrides
 "    // on {0} from {1}." -f (Get-Date -AsUTC -Format "u"), $InputObject.ucd.description
@@ -263,14 +396,7 @@ If (-not $NoOverrides) {
 "    // {0} (0x{0:X}) codepoints overridden." -f $overrideCount
 "    // Override path: {0}" -f $OverridePath
 }
-"    static constexpr std::array<UnicodeRange, {0}> s_wideAndAmbiguousTable{{" -f $ranges.Count
-ForEach($_ in $ranges) {
-    $isAmbiguous = $_.Width -eq [CodepointWidth]::Ambiguous
-    $comment = ""
-    if ($null -ne $_.Comment) {
-        # We only vend comments when we aren't packing tightly
-        $comment = " // {0}" -f $_.Comment
-    }
-"        UnicodeRange{{ 0x{0:x}, 0x{1:x}, {2} }},{3}" -f $_.Start, $_.End, [int]$isAmbiguous, $comment
-}
-"    };"
+"    // {0} bytes in 3 stages." -f ($stage1.Length + $stage2.Length + $stage3.Length)
+Format-Table "s_stage1" $stage1
+Format-Table "s_stage2" $stage2
+Format-Table "s_stage3" $stage3